@@ -0,0 +1,76 @@
+/*!
+ * @file bench_adversarial.cpp
+ * Per-operation latency under keys built to collide. The account KeyHash XORs
+ * the key fields, so ("Mallory", i, i, 0) lands in one collision list for every
+ * i. With treeification off the list is scanned (O(n) per operation); with it on
+ * (the default) the list is indexed (O(log n)). Random keys give the baseline.
+ * Usage: bench_adversarial [max_keys] [lookups]
+ */
+#include <algorithm>
+#include <vector>
+
+#include "../driver/account.h"
+#include "../include/hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+using Table = ac::HashTbl< Account::AcctKey, Account, KeyHash, KeyEqual >;
+
+/// Prints mean, p99 and max of a latency sample, in microseconds.
+void summary( const std::string & label, std::vector< double > & us ) {
+    std::sort( us.begin(), us.end() );
+    double sum{0};
+    for ( auto v : us ) sum += v;
+    std::cout << "  " << label << ": mean " << sum / us.size() << " us, p99 " << us[ us.size() * 99 / 100 ]
+              << " us, max " << us.back() << " us\n";
+}
+
+void run( const std::string & label, const std::vector< Account::AcctKey > & keys, std::size_t threshold,
+          std::uint64_t lookups ) {
+    Table table;
+    table.treeify_threshold( threshold );
+    std::vector< double > inserts, finds;
+    inserts.reserve( keys.size() );
+    bench::Timer total;
+    for ( const auto & k : keys ) {
+        bench::Timer t;
+        table.insert( k, Account( std::get< 0 >( k ), std::get< 1 >( k ), std::get< 2 >( k ), std::get< 3 >( k ) ) );
+        inserts.push_back( t.seconds() * 1e6 );
+    }
+    bench::Rng rng;
+    Account a;
+    finds.reserve( lookups );
+    for ( std::uint64_t i{0}; i < lookups; i++ ) {
+        const auto & k = keys[ rng.next() % keys.size() ];
+        bench::Timer t;
+        table.retrieve( k, a );
+        finds.push_back( t.seconds() * 1e6 );
+    }
+    std::cout << label << ", " << keys.size() << " keys (" << table.treeified_buckets() << " indexed lists), "
+              << total.seconds() << " s\n";
+    summary( "insert", inserts );
+    summary( "retrieve", finds );
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto max_keys = bench::arg_or( argc, argv, 1, 20000 );
+    auto lookups = bench::arg_or( argc, argv, 2, 100000 );
+
+    for ( std::uint64_t n = 1000; n <= max_keys; n *= 4 ) {
+        std::vector< Account::AcctKey > colliding, random;
+        bench::Rng rng;
+        for ( std::uint64_t i{0}; i < n; i++ ) {
+            colliding.emplace_back( "Mallory", int( i ), int( i ), 0 );
+            random.emplace_back( "Client " + std::to_string( rng.next() % 1000000 ), int( rng.next() % 300 ),
+                                 int( rng.next() % 5000 ), int( i ) );
+        }
+        run( "random keys", random, 8, lookups );
+        run( "colliding keys, lists", colliding, 0, lookups );
+        run( "colliding keys, treeified", colliding, 8, lookups );
+    }
+    return EXIT_SUCCESS;
+}
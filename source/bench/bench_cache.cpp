@@ -0,0 +1,111 @@
+/*!
+ * @file bench_cache.cpp
+ * Read-through cache over a skewed key stream: HashCache (CLOCK) against the
+ * HashTbl + std::list LRU that clients used to bolt on, then HashCache read by
+ * several threads at once.
+ * Usage: bench_cache [n_keys] [capacity] [ops] [threads]
+ */
+#include <list>
+#include <thread>
+#include <vector>
+
+#include "../include/hashtbl.h"
+#include "../include/hash_cache.h"
+#include "bench_util.h"
+
+namespace {
+
+/// LRU the old way: every hit splices its node to the front of a list.
+class ListLru {
+    public:
+        explicit ListLru( std::size_t capacity_ ) : m_capacity{ capacity_ }, m_index( capacity_ ) {}
+        bool get( std::uint64_t key_, std::uint64_t & data_ ) {
+            std::list< Node >::iterator it;
+            if (not m_index.retrieve( key_, it )) { m_misses++; return false; }
+            m_order.splice( m_order.begin(), m_order, it );
+            data_ = it->data;
+            m_hits++;
+            return true;
+        }
+        void put( std::uint64_t key_, std::uint64_t data_ ) {
+            if (m_order.size() == m_capacity) {
+                m_index.erase( m_order.back().key );
+                m_order.pop_back();
+            }
+            m_order.push_front( Node{ key_, data_ } );
+            m_index.insert( key_, m_order.begin() );
+        }
+        double hit_ratio() const { return double( m_hits ) / ( m_hits + m_misses ); }
+    private:
+        struct Node { std::uint64_t key, data; };
+        std::size_t m_capacity;
+        std::list< Node > m_order;
+        ac::HashTbl< std::uint64_t, std::list< Node >::iterator > m_index;
+        std::size_t m_hits = 0, m_misses = 0;
+};
+
+/// Skewed keys: small keys are far more frequent than large ones.
+std::vector< std::uint64_t > skewed_keys( std::uint64_t n, std::uint64_t count, std::uint64_t seed ) {
+    bench::Rng rng( seed );
+    std::vector< std::uint64_t > keys( count );
+    for ( auto & k : keys )
+        k = rng.next() % ( rng.next() % n + 1 );
+    return keys;
+}
+
+template< class Cache >
+double run( Cache & cache, const std::vector< std::uint64_t > & keys ) {
+    std::uint64_t v, sum{0};
+    bench::Timer t;
+    for ( auto k : keys ) {
+        if ( not cache.get( k, v ) ) {
+            v = k * 3;               // The "backing store".
+            cache.put( k, v );
+        }
+        sum += v;
+    }
+    double secs = t.seconds();
+    if ( sum == 1 ) std::cout << sum << '\n';   // Uses sum, so the loop is not optimized away.
+    return secs;
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 1000000 );
+    auto capacity = bench::arg_or( argc, argv, 2, 100000 );
+    auto ops = bench::arg_or( argc, argv, 3, 4000000 );
+    auto threads = bench::arg_or( argc, argv, 4, 4 );
+    auto keys = skewed_keys( n, ops, 3 );
+
+    {
+        ListLru lru( capacity );
+        double secs = run( lru, keys );
+        bench::report( "HashTbl + std::list LRU", ops, secs );
+        std::cout << "  hit ratio " << lru.hit_ratio() << "\n";
+    }
+    {
+        ac::HashCache< std::uint64_t, std::uint64_t > cache( capacity );
+        double secs = run( cache, keys );
+        bench::report( "HashCache (CLOCK)", ops, secs );
+        std::cout << "  hit ratio " << cache.stats().hit_ratio() << "  evictions " << cache.stats().evictions << "\n";
+    }
+    {
+        ac::HashCache< std::uint64_t, std::uint64_t > cache( capacity );
+        run( cache, keys );          // Warm up.
+        cache.reset_stats();
+        std::vector< std::thread > pool;
+        bench::Timer t;
+        for ( std::uint64_t i{0}; i < threads; i++ )
+            pool.emplace_back( [&cache, &keys, i, threads]() {
+                std::uint64_t v;
+                for ( std::size_t j = i; j < keys.size(); j += threads )
+                    if ( not cache.get( keys[j], v ) ) cache.put( keys[j], keys[j] * 3 );
+            } );
+        for ( auto & th : pool ) th.join();
+        bench::report( "HashCache, " + std::to_string( threads ) + " threads", ops, t.seconds() );
+        std::cout << "  hit ratio " << cache.stats().hit_ratio() << "\n";
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+/*!
+ * @file bench_churn.cpp
+ * Erase-heavy steady state: the table holds n live keys while every step erases
+ * a random live key and inserts a fresh one. Lookup latency, memory and (for
+ * IntHashTbl) probe lengths are sampled per epoch; they should stay flat.
+ * The chained HashTbl (std::list erase) runs the same scenario as a baseline,
+ * followed by a clear()/refill cycle for both tables.
+ * Usage: bench_churn [n_live] [epochs] [ops_per_epoch]
+ */
+#include <vector>
+
+#include "../include/hashtbl.h"
+#include "../include/int_hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+struct NoStats {
+    template< class Table > void operator()( const Table & ) const {}
+};
+struct ProbeStats {
+    template< class Table > void operator()( const Table & t ) const {
+        double avg; std::size_t longest;
+        t.probe_stats( avg, longest );
+        std::cout << "  probe avg " << avg << " max " << longest;
+    }
+};
+
+template< class Table, class Stats >
+void churn( const char * name, std::uint64_t n, std::uint64_t epochs, std::uint64_t ops, Stats stats )
+{
+    std::cout << name << "\n";
+    Table table;
+    std::vector< std::uint64_t > live( n );
+    bench::Rng rng( 7 );
+    std::uint64_t next_key{1};
+    for ( auto & k : live ) {
+        k = next_key++ * 0x9E3779B97F4A7C15ull >> 8;
+        table.insert( k, int( k ) );
+    }
+    int v;
+    for ( std::uint64_t e{0}; e < epochs; e++ ) {
+        bench::Timer t;
+        for ( std::uint64_t i{0}; i < ops; i++ ) {
+            auto & victim = live[rng.next() % n];
+            table.erase( victim );
+            victim = next_key++ * 0x9E3779B97F4A7C15ull >> 8;
+            table.insert( victim, int( victim ) );
+        }
+        double churn_secs = t.seconds();
+        t.reset();
+        std::uint64_t found{0};
+        for ( std::uint64_t i{0}; i < ops; i++ )
+            found += table.retrieve( live[rng.next() % n], v );
+        double lookup_ns = t.seconds() * 1e9 / ops;
+        std::cout << "  epoch " << e << ": churn " << ( 2 * ops / churn_secs ) << " ops/s"
+                  << "  lookup " << lookup_ns << " ns" << "  rss " << ( bench::rss_bytes() >> 20 ) << " MiB";
+        stats( table );
+        std::cout << ( found == ops ? "" : "  MISSING KEYS" ) << "\n";
+    }
+
+    bench::Timer t;
+    for ( int round{0}; round < 5; round++ ) {
+        table.clear();
+        for ( auto k : live )
+            table.insert( k, int( k ) );
+    }
+    bench::report( "  clear() + refill x5", 5 * n, t.seconds() );
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 500000 );
+    auto epochs = bench::arg_or( argc, argv, 2, 10 );
+    auto ops = bench::arg_or( argc, argv, 3, 1000000 );
+    churn< ac::IntHashTbl< std::uint64_t, int > >( "IntHashTbl (backward-shift erase)", n, epochs, ops, ProbeStats{} );
+    churn< ac::HashTbl< std::uint64_t, int > >( "HashTbl (std::list erase)", n, epochs, ops, NoStats{} );
+    return EXIT_SUCCESS;
+}
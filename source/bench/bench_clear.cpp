@@ -0,0 +1,76 @@
+/*!
+ * @file bench_clear.cpp
+ * Clear-and-refill cycles of a table whose bucket array is much larger than what
+ * each cycle stores (a per-request scratch table), with the eager clear() against
+ * lazy_clear(), on the heap and on a huge-page arena; then the destruction of a
+ * large arena table, whose nodes need no destructor.
+ * Usage: bench_clear [buckets] [keys_per_cycle] [cycles]
+ */
+#include <memory>
+#include <vector>
+
+#include "../include/hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+using Table = ac::HashTbl< std::uint64_t, std::uint64_t >;
+
+void cycles( const std::string & label, const ac::MemoryPolicy & policy_, bool lazy_,
+             std::uint64_t buckets_, const std::vector< std::uint64_t > & keys_, std::uint64_t n_cycles_ )
+{
+    Table htable( buckets_, policy_ );
+    htable.lazy_clear( lazy_ );
+    std::uint64_t found{0}, d{0};
+    bench::Timer timer;
+    for ( std::uint64_t c{0}; c < n_cycles_; ++c )
+    {
+        for ( auto k : keys_ )
+            htable.insert( k + c, k );
+        for ( auto k : keys_ )
+            found += htable.retrieve( k + c, d ) ? 1 : 0;
+        htable.clear();
+    }
+    double secs = timer.seconds();
+    bench::report( label, n_cycles_ * keys_.size() * 2, secs );
+    if ( found != n_cycles_ * keys_.size() ) std::cerr << "lost keys\n";
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto buckets = bench::arg_or( argc, argv, 1, 1000003 );
+    auto per_cycle = bench::arg_or( argc, argv, 2, 1000 );
+    auto n_cycles = bench::arg_or( argc, argv, 3, 2000 );
+
+    bench::Rng rng;
+    std::vector< std::uint64_t > keys( per_cycle );
+    for ( auto & k : keys ) k = rng.next();
+
+    ac::MemoryPolicy heap, huge;
+    huge.huge_pages = true;
+    std::cout << buckets << " buckets, " << per_cycle << " keys per cycle, " << n_cycles << " cycles\n";
+    cycles( "heap, eager clear", heap, false, buckets, keys, n_cycles );
+    cycles( "heap, lazy clear", heap, true, buckets, keys, n_cycles );
+    cycles( "huge pages, eager clear", huge, false, buckets, keys, n_cycles );
+    cycles( "huge pages, lazy clear", huge, true, buckets, keys, n_cycles );
+
+    // Tear down: the heap table frees node by node, the arena drops its chunks.
+    const std::uint64_t n = buckets * 2;
+    for ( const auto & policy : { heap, huge } )
+    {
+        std::unique_ptr< Table > htable( new Table( buckets, policy ) );
+        for ( std::uint64_t i{0}; i < n; ++i )
+            htable->insert( rng.next(), i );
+        bench::Timer timer;
+        htable->clear();
+        bench::report( policy.huge_pages ? "huge pages, clear of a full table" : "heap, clear of a full table", n, timer.seconds() );
+        for ( std::uint64_t i{0}; i < n; ++i )
+            htable->insert( rng.next(), i );
+        timer.reset();
+        htable.reset();
+        bench::report( policy.huge_pages ? "huge pages, destruction" : "heap, destruction", n, timer.seconds() );
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*!
+ * @file bench_compressed.cpp
+ * Memory and lookup cost of accounts in a HashTbl against a CompressedHashTbl, whose
+ * data is kept in compressed blocks (dictionary-encoded names, bit-packed codes).
+ * Reports the memory each table added to the process per account, and how much of
+ * it is data (the rest is the key index, measured alone), then lookups per second
+ * over every key (cold) and over a small hot set, with the block cache hit ratio.
+ * Usage: bench_compressed [n_accounts] [lookups] [block_values] [cache_blocks]
+ */
+#include <string>
+#include <vector>
+
+#include "../driver/account.h"
+#include "../include/compressed_hashtbl.h"
+#include "../include/hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+// A population with the repetition real accounts have: a few thousand first and last
+// names, a handful of banks, some hundreds of branches, numbers in one range.
+Account make_account( bench::Rng & rng_, std::uint64_t id_ ) {
+    static const char * first[] = { "Ana", "Bruno", "Carla", "Davi", "Elisa", "Fabio", "Gabriela", "Heitor",
+                                    "Iara", "Joao", "Karina", "Lucas", "Marina", "Nuno", "Olga", "Pedro" };
+    static const char * last[] = { "Silva", "Santos", "Oliveira", "Souza", "Rodrigues", "Ferreira", "Alves",
+                                   "Pereira", "Lima", "Gomes", "Costa", "Ribeiro", "Martins", "Carvalho" };
+    std::string name = first[ rng_.next() % 16 ];
+    name += ' ';
+    name += last[ rng_.next() % 14 ];
+    name += ' ';
+    name += std::to_string( rng_.next() % 100 );
+    return Account( name, int( 1 + rng_.next() % 5 ), int( rng_.next() % 500 ), int( 100000 + id_ ),
+                    float( rng_.next() % 1000000 ) / 100 );
+}
+
+template< class Table >
+void lookups( const std::string & label, const Table & table_, const std::vector< std::uint64_t > & keys_,
+              std::uint64_t n_ ) {
+    bench::Rng rng{ 7 };
+    Account a;
+    double sum{0};
+    bench::Timer timer;
+    for ( std::uint64_t i{0}; i < n_; ++i )
+        if ( table_.retrieve( keys_[ rng.next() % keys_.size() ], a ) ) sum += a.m_balance;
+    bench::report( label, n_, timer.seconds() );
+    if ( sum < 0 ) std::cout << sum << '\n';
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 1000000 );
+    auto n_lookups = bench::arg_or( argc, argv, 2, 1000000 );
+    auto block_values = bench::arg_or( argc, argv, 3, 256 );
+    auto cache_blocks = bench::arg_or( argc, argv, 4, 64 );
+
+    std::vector< std::uint64_t > keys( n );
+    for ( std::uint64_t i{0}; i < n; ++i ) keys[i] = i * 2654435761u;
+    std::vector< std::uint64_t > hot( keys.begin(), keys.begin() + std::min< std::uint64_t >( n, std::max< std::uint64_t >( cache_blocks / 2, 1 ) ) );
+
+    auto rss0 = bench::rss_bytes();
+    ac::CompressedHashTbl< std::uint64_t, Account > compressed( block_values, cache_blocks, n );
+    bench::Rng rng;
+    for ( std::uint64_t i{0}; i < n; ++i ) compressed.insert( keys[i], make_account( rng, i ) );
+    compressed.flush();
+    auto rss1 = bench::rss_bytes();
+    ac::HashTbl< std::uint64_t, Account > plain( n );
+    rng = bench::Rng();
+    for ( std::uint64_t i{0}; i < n; ++i ) plain.insert( keys[i], make_account( rng, i ) );
+    auto rss2 = bench::rss_bytes();
+    // The keys alone, as CompressedHashTbl indexes them: what both tables pay besides the data.
+    ac::HashTbl< std::uint64_t, ac::CompressedHashTbl< std::uint64_t, Account >::Slot > index( n );
+    for ( std::uint64_t i{0}; i < n; ++i ) index.insert( keys[i], { 0, 0 } );
+    auto rss3 = bench::rss_bytes();
+    auto keys_bytes = double( rss3 - rss2 );
+
+    std::cout << n << " accounts, blocks of " << block_values << ", " << cache_blocks << " cached\n";
+    std::cout << "HashTbl: " << ( rss2 - rss1 ) / double( n ) << " bytes/account, "
+              << ( rss2 - rss1 - keys_bytes ) / n << " of them data\n";
+    std::cout << "CompressedHashTbl: " << ( rss1 - rss0 ) / double( n ) << " bytes/account, "
+              << ( rss1 - rss0 - keys_bytes ) / n << " of them data ("
+              << compressed.compressed_bytes() / double( n ) << " compressed bytes in " << compressed.block_count()
+              << " blocks)\n";
+
+    lookups( "HashTbl, every key", plain, keys, n_lookups );
+    auto before = compressed.stats();
+    lookups( "CompressedHashTbl, every key", compressed, keys, n_lookups );
+    auto after = compressed.stats();
+    std::cout << "  block cache hit ratio " << double( after.hits - before.hits ) /
+                 ( after.hits + after.misses - before.hits - before.misses ) << '\n';
+    lookups( "HashTbl, hot set", plain, hot, n_lookups );
+    before = compressed.stats();
+    lookups( "CompressedHashTbl, hot set", compressed, hot, n_lookups );
+    after = compressed.stats();
+    std::cout << "  block cache hit ratio " << double( after.hits - before.hits ) /
+                 ( after.hits + after.misses - before.hits - before.misses ) << '\n';
+    return 0;
+}
@@ -0,0 +1,53 @@
+/*!
+ * @file bench_disk_hashtbl.cpp
+ * DiskHashTbl lookups per second as the table outgrows its buffer pool: tables of
+ * 1/4 to 8 times the entries the pool can hold, probed uniformly at random. Misses
+ * are served from the OS page cache here; drop it (or use a larger table than the
+ * machine's RAM) to see device reads.
+ * Usage: bench_disk_hashtbl [pool_pages] [lookups] [file]
+ */
+#include <string>
+#include <vector>
+
+#include "../driver/account_loader.h"   // AccountRecord
+#include "../include/disk_hashtbl.h"
+#include "bench_util.h"
+
+int main( int argc, char * argv[] )
+{
+    auto pool = bench::arg_or( argc, argv, 1, 2048 );
+    auto lookups = bench::arg_or( argc, argv, 2, 1000000 );
+    std::string path = argc > 3 ? argv[3] : "bench_disk_hashtbl.tbl";
+
+    using Table = ac::DiskHashTbl< std::uint64_t, AccountRecord >;
+    // Buckets run about 3/4 full after splits.
+    const std::uint64_t fits = pool * Table::slots_per_page() * 3 / 4;
+    std::cout << "Pool of " << pool << " pages (" << pool * Table::PAGE_SIZE / ( 1 << 20 ) << " MiB), ~"
+              << fits << " entries\n";
+
+    const char * labels[] = { "1/4", "1/2", "1", "2", "4", "8" };
+    const double ratios[] = { 0.25, 0.5, 1.0, 2.0, 4.0, 8.0 };
+    for ( int i{0}; i < 6; i++ ) {
+        const auto n = std::uint64_t( fits * ratios[i] );
+        Table table( path, pool, true );
+        AccountRecord r{};
+        bench::Timer t;
+        for ( std::uint64_t k{0}; k < n; k++ ) {
+            r.m_number = std::int32_t( k );
+            table.insert( k, r );
+        }
+        double load = t.seconds();
+        table.reset_pool_stats();
+        bench::Rng rng;
+        std::uint64_t hits{0};
+        t.reset();
+        for ( std::uint64_t l{0}; l < lookups; l++ ) hits += table.retrieve( rng.next() % n, r );
+        bench::report( "working set " + std::string( labels[i] ) + "x pool (" + std::to_string( n ) + " entries)",
+                       lookups, t.seconds() );
+        const auto & s = table.pool_stats();
+        std::cout << "  load " << load << " s, " << table.page_count() << " pages, depth " << table.global_depth()
+                  << ", miss ratio " << double( s.misses ) / double( s.hits + s.misses ) << ", " << hits << " hits\n";
+    }
+    ::unlink( path.c_str() );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+/*!
+ * @file bench_dump.cpp
+ * Dumping an account table: operator<< with std::endl per element (the old
+ * behaviour), operator<<, dump_text(), parallel_dump_text() and dump_binary().
+ * Usage: bench_dump [n_accounts] [threads]
+ */
+#include <cstdio>
+#include <fstream>
+#include <functional>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../include/hashtbl_dump.h"
+#include "../driver/account_loader.h"
+#include "bench_util.h"
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 1000000 );
+    auto threads = bench::arg_or( argc, argv, 2, std::thread::hardware_concurrency() );
+    const char * path = "bench_dump.out";
+
+    AccountTable table;
+    table.reserve( n );
+    bench::Rng rng;
+    for (std::size_t i{0}; i < n; i++) {
+        Account a( "Client " + std::to_string( rng.next() % 1000000 ), int( rng.next() % 300 ),
+                   int( rng.next() % 5000 ), int( i ), float( rng.next() % 100000 ) / 100.f );
+        table.insert( a.getKey(), a );
+    }
+
+    {
+        bench::Timer t;
+        std::ofstream out( path );
+        table.for_each( [&]( const AccountTable::entry_type & e ) { out << e << std::endl; } );
+        bench::report( "operator<< + std::endl  ", table.size(), t.seconds() );
+    }
+    {
+        bench::Timer t;
+        std::ofstream out( path );
+        out << table;
+        out.flush();
+        bench::report( "operator<<              ", table.size(), t.seconds() );
+    }
+    auto run_fd = [&]( const char * label, std::function< std::size_t( int ) > dump ) {
+        int fd = ::open( path, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+        bench::Timer t;
+        auto count = dump( fd );
+        bench::report( label, count, t.seconds() );
+        ::close( fd );
+    };
+    run_fd( "dump_text               ", [&]( int fd ) { return ac::dump_text( table, fd, AccountFormatter{} ); } );
+    run_fd( "parallel_dump_text      ", [&]( int fd ) {
+        return ac::parallel_dump_text( table, fd, []() { return AccountFormatter{}; }, threads ); } );
+    run_fd( "dump_binary             ", [&]( int fd ) { return ac::dump_binary( table, fd, AccountEncoder{} ); } );
+
+    std::remove( path );
+    return EXIT_SUCCESS;
+}
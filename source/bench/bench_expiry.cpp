@@ -0,0 +1,86 @@
+/*!
+ * @file bench_expiry.cpp
+ * Session-style workload on a simulated clock: every millisecond a batch of
+ * sessions is inserted with a random time to live. Compares the periodic sweep
+ * (copy the table, scan it, erase what expired) with TtlHashTbl's timer wheel,
+ * reporting the latency of each batch, sweep included.
+ * Usage: bench_expiry [batches] [batch_size] [sweep_every_ms]
+ */
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include "../include/hashtbl.h"
+#include "../include/ttl_hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+/// Simulated time, in milliseconds.
+struct SimClock {
+    using duration = std::chrono::milliseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point< SimClock >;
+    static const bool is_steady = true;
+    static time_point now() { return s_now; }
+    static time_point s_now;
+};
+SimClock::time_point SimClock::s_now;
+
+void print_batches( const char * label, std::vector< double > & us, std::size_t final_size ) {
+    double total{0};
+    for ( auto u : us ) total += u;
+    std::sort( us.begin(), us.end() );
+    std::cout << label << ": batch mean " << total / us.size() << " us  p50 " << us[ us.size() / 2 ] << " us  p99 " << us[ us.size() * 99 / 100 ]
+              << " us  max " << us.back() << " us  final size " << final_size << "\n";
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto batches = bench::arg_or( argc, argv, 1, 20000 );
+    auto batch = bench::arg_or( argc, argv, 2, 100 );
+    auto sweep_every = bench::arg_or( argc, argv, 3, 1000 );
+    const std::uint64_t max_ttl = 5000; // ms
+
+    {   // Periodic sweep: data plus expiry time, scanned through a copy.
+        using Session = std::pair< std::uint64_t, long >;
+        ac::HashTbl< std::uint64_t, Session > table;
+        std::vector< double > us;
+        bench::Rng rng( 1 );
+        std::uint64_t key{0};
+        for ( std::uint64_t b{0}; b < batches; b++ ) {
+            long now = long( b );
+            bench::Timer t;
+            for ( std::uint64_t i{0}; i < batch; i++, key++ )
+                table.insert( key, Session{ key, now + 1 + long( rng.next() % max_ttl ) } );
+            if ( b % sweep_every == 0 ) {
+                auto copy = table;
+                copy.for_each( [&]( const ac::HashEntry< std::uint64_t, Session > & e ) {
+                    if ( e.m_data.second <= now ) table.erase( e.m_key );
+                } );
+            }
+            us.push_back( t.seconds() * 1e6 );
+        }
+        print_batches( "periodic sweep", us, table.size() );
+    }
+    {   // Timer wheel: insert() advances the wheel, removing what expired since the last call.
+        ac::TtlHashTbl< std::uint64_t, std::uint64_t, std::hash< std::uint64_t >,
+                        std::equal_to< std::uint64_t >, SimClock > table;
+        std::vector< double > us;
+        bench::Rng rng( 1 );
+        std::uint64_t key{0};
+        for ( std::uint64_t b{0}; b < batches; b++ ) {
+            SimClock::s_now = SimClock::time_point{ std::chrono::milliseconds( b ) };
+            bench::Timer t;
+            for ( std::uint64_t i{0}; i < batch; i++, key++ )
+                table.insert( key, key, std::chrono::milliseconds( 1 + rng.next() % max_ttl ) );
+            us.push_back( t.seconds() * 1e6 );
+        }
+        print_batches( "timer wheel", us, table.size() );
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/*!
+ * @file bench_group_by.cpp
+ * Sum of balances per (bank, branch): the at()/insert() loop that operator[]
+ * used to run (an exception per new group), operator[], GroupBy::update(),
+ * GroupBy::update_batch() and the parallel GroupBy::aggregate().
+ * Usage: bench_group_by [n_accounts] [n_branches] [threads]
+ */
+#include <stdexcept>
+#include <vector>
+
+#include "../include/hashtbl.h"
+#include "../include/group_by.h"
+#include "bench_util.h"
+
+namespace {
+
+struct Row { int bank; int branch; float balance; };
+
+/// (bank, branch) packed in one integer key.
+std::uint64_t branch_key( const Row & r ) { return ( std::uint64_t( r.bank ) << 32 ) | std::uint32_t( r.branch ); }
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 10000000 );
+    auto branches = bench::arg_or( argc, argv, 2, 100000 );
+    auto threads = bench::arg_or( argc, argv, 3, 0 );
+
+    bench::Rng rng;
+    std::vector< Row > rows( n );
+    for ( auto & r : rows ) {
+        auto b = rng.next() % branches;
+        r = Row{ int( b % 300 ), int( b / 300 ), float( rng.next() % 100000 ) / 100.f };
+    }
+    using Group = ac::GroupBy< std::uint64_t, ac::agg::Sum< double > >;
+    auto check = [&]( const std::string & label, double secs, double total, std::size_t groups ) {
+        bench::report( label, n, secs );
+        std::cout << "  " << groups << " groups, total " << total << "\n";
+    };
+
+    {
+        bench::Timer t;
+        ac::HashTbl< std::uint64_t, double > table;
+        for ( const auto & r : rows ) {
+            try { table.at( branch_key( r ) ) += r.balance; }
+            catch ( const std::out_of_range & ) { table.insert( branch_key( r ), r.balance ); }
+        }
+        double secs = t.seconds(), total{0};
+        table.for_each( [&]( const ac::HashEntry< std::uint64_t, double > & e ) { total += e.m_data; } );
+        check( "at() + insert() on miss", secs, total, table.size() );
+    }
+    {
+        bench::Timer t;
+        ac::HashTbl< std::uint64_t, double > table;
+        for ( const auto & r : rows ) table[ branch_key( r ) ] += r.balance;
+        double secs = t.seconds(), total{0};
+        table.for_each( [&]( const ac::HashEntry< std::uint64_t, double > & e ) { total += e.m_data; } );
+        check( "operator[]", secs, total, table.size() );
+    }
+    auto total_of = []( const Group & g ) {
+        double total{0};
+        g.for_each( [&]( const Group::table_type::entry_type & e ) { total += e.m_data; } );
+        return total;
+    };
+    {
+        bench::Timer t;
+        Group g;
+        for ( const auto & r : rows ) g.update( branch_key( r ), double( r.balance ) );
+        double secs = t.seconds();
+        check( "GroupBy::update()", secs, total_of( g ), g.size() );
+    }
+    {
+        bench::Timer t;
+        Group g;
+        g.update_batch( rows.begin(), rows.end(), branch_key, []( const Row & r ) { return double( r.balance ); } );
+        double secs = t.seconds();
+        check( "GroupBy::update_batch()", secs, total_of( g ), g.size() );
+    }
+    {
+        bench::Timer t;
+        auto g = Group::aggregate( rows, branch_key, []( const Row & r ) { return double( r.balance ); }, threads );
+        double secs = t.seconds();
+        check( "GroupBy::aggregate(), " + std::to_string( ac::worker_count( threads ) ) + " workers",
+               secs, total_of( g ), g.size() );
+    }
+    return EXIT_SUCCESS;
+}
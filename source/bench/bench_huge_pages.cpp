@@ -0,0 +1,163 @@
+/*!
+ * @file bench_huge_pages.cpp
+ * Random lookups in tables much larger than the TLB reach, with the default heap
+ * against 2 MiB huge pages (MemoryPolicy), and a sharded table with and without
+ * NUMA binding plus node-local routing of the workers. Reports throughput, the
+ * dTLB load misses of the lookups (perf_event_open; "n/a" where perf is not
+ * allowed) and the memory the kernel backed with huge pages.
+ * Usage: bench_huge_pages [n_keys] [lookups] [threads]
+ */
+#include <cstring>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include "../include/hashtbl.h"
+#include "../include/int_hashtbl.h"
+#include "../include/parallel.h"
+#include "../include/sharded_hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+/// Counts dTLB load misses of the calling thread between start() and stop().
+class TlbCounter {
+    public:
+        TlbCounter() {
+            perf_event_attr attr;
+            std::memset( &attr, 0, sizeof( attr ) );
+            attr.size = sizeof( attr );
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) |
+                          ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            m_fd = int( ::syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 ) );
+        }
+        ~TlbCounter() { if ( m_fd >= 0 ) ::close( m_fd ); }
+        void start() {
+            if ( m_fd < 0 ) return;
+            ::ioctl( m_fd, PERF_EVENT_IOC_RESET, 0 );
+            ::ioctl( m_fd, PERF_EVENT_IOC_ENABLE, 0 );
+        }
+        // Misses since start(), as text.
+        std::string stop() {
+            if ( m_fd < 0 ) return "n/a";
+            ::ioctl( m_fd, PERF_EVENT_IOC_DISABLE, 0 );
+            std::uint64_t n{0};
+            if ( ::read( m_fd, &n, sizeof( n ) ) != sizeof( n ) ) return "n/a";
+            return std::to_string( n );
+        }
+    private:
+        int m_fd;
+};
+
+/// Anonymous memory of this process the kernel currently backs with huge pages, in MiB.
+std::uint64_t huge_mib() {
+    std::ifstream smaps( "/proc/self/smaps_rollup" );
+    std::string key;
+    std::uint64_t kb{0};
+    while ( smaps >> key ) {
+        if ( key == "AnonHugePages:" ) { smaps >> kb; break; }
+        smaps.ignore( 1 << 10, '\n' );
+    }
+    return kb >> 10;
+}
+
+template< class Table >
+void run( const std::string & label, Table & table, const std::vector< std::uint64_t > & keys,
+          const std::vector< std::uint64_t > & probe ) {
+    bench::Timer t;
+    for ( auto k : keys ) table.insert( k, k );
+    double build = t.seconds();
+    TlbCounter tlb;
+    std::uint64_t hits{0}, v;
+    t.reset();
+    tlb.start();
+    for ( auto k : probe ) hits += table.retrieve( k, v );
+    auto misses = tlb.stop();
+    double secs = t.seconds();
+    bench::report( label, probe.size(), secs );
+    std::cout << "  build " << build << " s, " << hits << " hits, dTLB load misses " << misses << ", "
+              << huge_mib() << " MiB on huge pages, rss " << ( bench::rss_bytes() >> 20 ) << " MiB\n";
+}
+
+using Sharded = ac::ShardedHashTbl< std::uint64_t, std::uint64_t >;
+
+/// Parallel lookups; with route_, worker w runs on node w % nodes and only takes keys of that node.
+void run_sharded( const std::string & label, bool numa_, bool huge_, bool route_, std::size_t threads,
+                  const std::vector< std::uint64_t > & keys, const std::vector< std::uint64_t > & probe ) {
+    ac::ShardOptions opts;
+    opts.shards = 64;
+    opts.expected = keys.size();
+    opts.huge_pages = huge_;
+    opts.numa = numa_;
+    Sharded table( opts );
+    for ( auto k : keys ) table.insert( k, k );
+
+    const int nodes = ac::numa::node_count();
+    const std::size_t workers = ac::worker_count( threads );
+    // Per node, the probe keys whose shard lives there (routing is decided before the clock starts).
+    std::vector< std::vector< std::uint64_t > > local( nodes );
+    for ( auto k : probe ) local[ route_ ? table.node_of( k ) : 0 ].push_back( k );
+
+    std::vector< std::uint64_t > hits( workers );
+    bench::Timer t;
+    ac::run_workers( workers, [&]( std::size_t w ) {
+        int node = route_ ? int( w % nodes ) : 0;
+        if ( route_ ) ac::numa::run_on_node( node );
+        // The workers of a node split its keys.
+        std::size_t peers = route_ ? ( workers - node + nodes - 1 ) / nodes : workers;
+        std::size_t rank = route_ ? w / nodes : w;
+        const auto & mine = local[node];
+        std::uint64_t v;
+        for ( std::size_t i = rank; i < mine.size(); i += peers )
+            hits[w] += table.retrieve( mine[i], v );
+    } );
+    double secs = t.seconds();
+    std::uint64_t total{0};
+    for ( auto h : hits ) total += h;
+    bench::report( label, probe.size(), secs );
+    std::cout << "  " << workers << " workers, " << nodes << " nodes, " << total << " hits, "
+              << huge_mib() << " MiB on huge pages\n";
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 4000000 );
+    auto m = bench::arg_or( argc, argv, 2, 10000000 );
+    auto threads = bench::arg_or( argc, argv, 3, 0 );
+
+    bench::Rng rng;
+    std::vector< std::uint64_t > keys( n ), probe( m );
+    for ( auto & k : keys ) k = rng.next() >> 1;   // Below the IntHashTbl sentinel.
+    for ( auto & k : probe ) k = keys[ rng.next() % n ];
+
+    ac::MemoryPolicy huge;
+    huge.huge_pages = true;
+    {
+        ac::HashTbl< std::uint64_t, std::uint64_t > table( n );
+        run( "HashTbl, heap", table, keys, probe );
+    }
+    {
+        ac::HashTbl< std::uint64_t, std::uint64_t > table( n, huge );
+        run( "HashTbl, huge pages", table, keys, probe );
+    }
+    {
+        ac::IntHashTbl< std::uint64_t, std::uint64_t > table( n * 4 / 3 );
+        run( "IntHashTbl, heap", table, keys, probe );
+    }
+    {
+        ac::IntHashTbl< std::uint64_t, std::uint64_t > table( n * 4 / 3, std::numeric_limits< std::uint64_t >::max(), huge );
+        run( "IntHashTbl, huge pages", table, keys, probe );
+    }
+    run_sharded( "ShardedHashTbl, heap, any shard", false, false, false, threads, keys, probe );
+    run_sharded( "ShardedHashTbl, huge pages, any shard", false, true, false, threads, keys, probe );
+    run_sharded( "ShardedHashTbl, huge pages + NUMA, local shards", true, true, true, threads, keys, probe );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+/*!
+ * @file bench_ingest.cpp
+ * Account file ingest throughput: getline + insert() loop vs. load_accounts().
+ * Usage: bench_ingest [n_records] [threads]
+ */
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "../driver/account_loader.h"
+#include "bench_util.h"
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 1000000 );
+    LoadOptions opts;
+    opts.threads = bench::arg_or( argc, argv, 2, 0 );
+
+    bench::Rng rng;
+    std::vector< Account > accounts;
+    accounts.reserve( n );
+    for (std::size_t i{0}; i < n; i++)
+        accounts.emplace_back( "Client " + std::to_string( rng.next() % 1000000 ),
+                               int( rng.next() % 300 ), int( rng.next() % 5000 ), int( i ),
+                               float( rng.next() % 100000 ) / 100.f );
+    const std::string csv = "bench_ingest.csv", bin = "bench_ingest.bin";
+    save_accounts( csv, AccountFormat::csv, accounts );
+    save_accounts( bin, AccountFormat::binary, accounts );
+
+    {
+        bench::Timer t;
+        AccountTable table;
+        std::ifstream in( csv );
+        std::string line, field;
+        while ( std::getline( in, line ) ) {
+            std::istringstream ss( line );
+            Account a;
+            std::getline( ss, a.m_name, ',' );
+            std::getline( ss, field, ',' ); a.m_bank_code = std::stoi( field );
+            std::getline( ss, field, ',' ); a.m_branch_code = std::stoi( field );
+            std::getline( ss, field, ',' ); a.m_number = std::stoi( field );
+            std::getline( ss, field, ',' ); a.m_balance = std::stof( field );
+            table.insert( a.getKey(), a );
+        }
+        bench::report( "getline + insert() (csv)", table.size(), t.seconds() );
+    }
+    for ( auto fmt : { AccountFormat::csv, AccountFormat::binary } ) {
+        AccountTable table;
+        auto stats = load_accounts( fmt == AccountFormat::csv ? csv : bin, fmt, table, opts );
+        bench::report( fmt == AccountFormat::csv ? "load_accounts (csv)     " : "load_accounts (binary)  ",
+                       stats.records, stats.seconds );
+    }
+    std::remove( csv.c_str() );
+    std::remove( bin.c_str() );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+/*!
+ * @file bench_int_keys.cpp
+ * Bulk load of integer ids: chained HashTbl vs. IntHashTbl.
+ * Usage: bench_int_keys [n_keys]
+ */
+#include <vector>
+
+#include "../include/hashtbl.h"
+#include "../include/int_hashtbl.h"
+#include "bench_util.h"
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 2000000 );
+    std::vector< std::uint64_t > keys( n );
+    std::vector< int > values( n );
+    bench::Rng rng;
+    for (std::size_t i{0}; i < n; i++) {
+        keys[i] = rng.next() >> 16;
+        values[i] = int( i );
+    }
+
+    {
+        bench::Timer t;
+        ac::HashTbl< std::uint64_t, int > tbl;
+        for (std::size_t i{0}; i < n; i++)
+            tbl.insert( keys[i], values[i] );
+        bench::report( "HashTbl insert loop   ", n, t.seconds() );
+    }
+    {
+        bench::Timer t;
+        ac::IntHashTbl< std::uint64_t, int > tbl;
+        for (std::size_t i{0}; i < n; i++)
+            tbl.insert( keys[i], values[i] );
+        bench::report( "IntHashTbl insert loop", n, t.seconds() );
+    }
+    {
+        bench::Timer t;
+        ac::IntHashTbl< std::uint64_t, int > tbl;
+        tbl.insert( keys.data(), values.data(), n );
+        bench::report( "IntHashTbl bulk insert", n, t.seconds() );
+
+        t.reset();
+        std::uint64_t found{0};
+        int v;
+        for (std::size_t i{0}; i < n; i++)
+            found += tbl.retrieve( keys[i], v );
+        bench::report( "IntHashTbl retrieve   ", found, t.seconds() );
+    }
+    return EXIT_SUCCESS;
+}
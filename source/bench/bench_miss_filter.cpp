@@ -0,0 +1,64 @@
+/*!
+ * @file bench_miss_filter.cpp
+ * Miss-heavy lookups against the Account table, with and without the
+ * membership filter, at a few target false positive rates.
+ * Usage: bench_miss_filter [n_accounts] [lookups] [miss_percent]
+ */
+#include <string>
+#include <vector>
+
+#include "../include/hashtbl.h"
+#include "../driver/account.h"
+#include "bench_util.h"
+
+namespace {
+
+using Table = ac::HashTbl< Account::AcctKey, Account, KeyHash, KeyEqual >;
+
+void run( const char * label, Table & table, const std::vector< Account::AcctKey > & probe ) {
+    table.reset_filter_stats();
+    Account out;
+    std::uint64_t found{0};
+    bench::Timer t;
+    for ( const auto & k : probe )
+        found += table.retrieve( k, out );
+    double secs = t.seconds();
+    bench::report( label, probe.size(), secs );
+    auto stats = table.filter_stats();
+    std::cout << "  hits " << found;
+    if ( table.filter() )
+        std::cout << "  filter " << ( table.filter()->bytes() >> 10 ) << " KiB, k=" << table.filter()->hashes()
+                  << "  definite misses " << stats.definite_misses
+                  << "  false positive rate " << stats.false_positive_rate();
+    std::cout << "\n";
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 500000 );
+    auto lookups = bench::arg_or( argc, argv, 2, 2000000 );
+    auto miss_pct = bench::arg_or( argc, argv, 3, 70 );
+
+    Table table;
+    bench::Rng rng( 5 );
+    for ( std::uint64_t i{0}; i < n; i++ ) {
+        Account a{ "Client " + std::to_string( i ), int( i % 500 ), int( i % 9973 ), int( i ), 100.f };
+        table.insert( a.getKey(), a );
+    }
+    std::vector< Account::AcctKey > probe( lookups );
+    for ( auto & k : probe ) {
+        std::uint64_t i = rng.next() % n;
+        bool miss = rng.next() % 100 < miss_pct;
+        // A miss is an existing account number under another name (a stale or forged ID).
+        k = Account::AcctKey{ ( miss ? "Unknown " : "Client " ) + std::to_string( i ), int( i % 500 ), int( i % 9973 ), int( i ) };
+    }
+
+    run( "no filter", table, probe );
+    for ( double fpr : { 0.05, 0.01, 0.001 } ) {
+        table.enable_filter( fpr );
+        run( ( "filter fpr " + std::to_string( fpr ) ).c_str(), table, probe );
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+/*!
+ * @file bench_packed_key.cpp
+ * Account lookups by the three key encodings: the string tuple (AcctKey), the
+ * interned tuple (InternedKey) and the packed word (PackedKey). The lookup keys
+ * are built outside the timed loop, as a caller holding keys would.
+ * Usage: bench_packed_key [n_accounts] [lookups]
+ */
+#include <vector>
+
+#include "../driver/account.h"
+#include "../include/hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+template< class Key, class Hash, class Equal >
+void run( const std::string & label, const std::vector< Account > & accounts, const std::vector< Key > & keys,
+          const std::vector< std::size_t > & probe ) {
+    ac::HashTbl< Key, Account, Hash, Equal > table( accounts.size() );
+    bench::Timer t;
+    for ( std::size_t i{0}; i < accounts.size(); i++ ) table.insert( keys[i], accounts[i] );
+    double build = t.seconds();
+    Account a;
+    std::size_t hits{0};
+    t.reset();
+    for ( auto i : probe ) hits += table.retrieve( keys[i], a );
+    bench::report( label, probe.size(), t.seconds() );
+    std::cout << "  build " << build << " s, " << hits << " hits\n";
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 1000000 );
+    auto m = bench::arg_or( argc, argv, 2, 10000000 );
+
+    bench::Rng rng;
+    std::vector< Account > accounts;
+    accounts.reserve( n );
+    for ( std::uint64_t i{0}; i < n; i++ )
+        accounts.emplace_back( "Client number " + std::to_string( rng.next() % ( n / 4 + 1 ) ),
+                               int( rng.next() % 300 ), int( rng.next() % 5000 ), int( i ), 1.f );
+    std::vector< std::size_t > probe( m );
+    for ( auto & p : probe ) p = rng.next() % n;
+
+    ac::StringPool pool;
+    std::vector< Account::AcctKey > plain;
+    std::vector< Account::InternedKey > interned;
+    std::vector< Account::PackedKey > packed;
+    for ( const auto & a : accounts ) {
+        plain.push_back( a.getKey() );
+        interned.push_back( a.getKey( pool ) );
+        packed.push_back( a.getPackedKey( pool ) );
+    }
+    run< Account::AcctKey, KeyHash, KeyEqual >( "AcctKey (string tuple)", accounts, plain, probe );
+    run< Account::InternedKey, InternedKeyHash, InternedKeyEqual >( "InternedKey", accounts, interned, probe );
+    run< Account::PackedKey, PackedKeyHash, PackedKeyEqual >( "PackedKey", accounts, packed, probe );
+
+    // Building the lookup key from an account: allocates a string copy vs. not at all.
+    bench::Timer t;
+    std::size_t sink{0};
+    for ( auto i : probe ) sink += std::get< 0 >( accounts[i].getKey() ).size();
+    bench::report( "getKey()", m, t.seconds() );
+    t.reset();
+    Account::PackedKey key;
+    for ( auto i : probe ) sink += accounts[i].findKey( pool, key ) ? key.m_name.m_offset : 0;
+    bench::report( "findKey( pool, PackedKey& )", m, t.seconds() );
+    std::cout << "  (" << sink << ")\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+/*!
+ * @file bench_parallel_bulk.cpp
+ * Batch jobs over a whole table: apply interest (parallel_for_each), sum the balances
+ * (parallel_reduce) and purge a tenth of the accounts (erase_if), with 1, 2, 4, ...
+ * workers, against the serial baseline of for_each plus one erase() per key.
+ * Usage: bench_parallel_bulk [n_entries] [max_threads]
+ */
+#include <vector>
+
+#include "../include/hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+using Table = ac::HashTbl< std::uint64_t, double >;
+
+void fill( Table & table, std::uint64_t n ) {
+    table.clear();
+    for ( std::uint64_t k{0}; k < n; k++ ) table.insert( k, 100.0 );
+}
+
+bool closed( std::uint64_t k ) { return k % 10 == 3; }
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 10000000 );
+    auto max_threads = bench::arg_or( argc, argv, 2, ac::worker_count( 0 ) );
+    Table table( n );
+
+    // Serial baseline: walk the table, then erase key by key.
+    fill( table, n );
+    {
+        bench::Timer t;
+        double sum{0};
+        table.for_each( [&]( const Table::entry_type & e ) { sum += e.m_data * 1.01; } );
+        bench::report( "serial for_each (sum with interest)", n, t.seconds() );
+        std::cout << "  sum " << sum << "\n";
+        std::vector< std::uint64_t > doomed;
+        table.for_each( [&]( const Table::entry_type & e ) { if ( closed( e.m_key ) ) doomed.push_back( e.m_key ); } );
+        t.reset();
+        for ( auto k : doomed ) table.erase( k );
+        bench::report( "serial erase() per key", doomed.size(), t.seconds() );
+    }
+
+    for ( std::uint64_t threads{1}; threads <= max_threads; threads *= 2 ) {
+        fill( table, n );
+        std::cout << "--- " << threads << " threads\n";
+        bench::Timer t;
+        table.parallel_for_each( []( const std::uint64_t &, double & balance ) { balance *= 1.01; }, threads );
+        bench::report( "  parallel_for_each (interest)", n, t.seconds() );
+        t.reset();
+        double sum = table.parallel_reduce( 0.0, []( const Table::entry_type & e ) { return e.m_data; },
+                                            []( double a, double b ) { return a + b; }, threads );
+        bench::report( "  parallel_reduce (sum)", n, t.seconds() );
+        t.reset();
+        auto erased = table.erase_if( []( const std::uint64_t & k, const double & ) { return closed( k ); }, threads );
+        bench::report( "  erase_if (purge)", n, t.seconds() );
+        std::cout << "  sum " << sum << ", erased " << erased << ", left " << table.size() << "\n";
+    }
+    return EXIT_SUCCESS;
+}
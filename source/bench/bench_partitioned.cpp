@@ -0,0 +1,127 @@
+/*!
+ * @file bench_partitioned.cpp
+ * Aggregate throughput of a PartitionedHashTbl as partitions are added: 1, 2, 4, ...
+ * PartitionServer processes, loaded with the same accounts, driven by as many client
+ * processes, each sending retrieves in batches. A batch of 1 shows the round-trip cost
+ * that batching amortizes.
+ * Usage: bench_partitioned [n_accounts] [max_partitions] [lookups_per_client] [batch]
+ */
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+
+#include "../driver/account.h"
+#include "../include/partitioned_hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+using Server = ac::PartitionServer< Account::AcctKey, Account, KeyHash, KeyEqual >;
+using Front = ac::PartitionedHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual >;
+
+Account account( std::uint64_t i ) {
+    return Account( "Client " + std::to_string( i ), int( i % 300 ), int( i % 5000 ), int( i ), 1.f );
+}
+
+pid_t spawn_server( const std::string & path ) {
+    pid_t pid = ::fork();
+    if ( pid == 0 ) {
+        try { Server server( path ); server.run(); }
+        catch ( const std::exception & e ) { std::cerr << e.what() << "\n"; ::_exit( 1 ); }
+        ::_exit( 0 );
+    }
+    return pid;
+}
+
+/// Retrieves `lookups` random accounts through a front end of its own; returns the seconds taken.
+double client( const std::vector< std::string > & paths, std::uint64_t n, std::uint64_t lookups,
+               std::size_t batch, std::uint64_t seed ) {
+    Front front( batch );
+    for ( const auto & p : paths ) front.add_partition( p );
+    bench::Rng rng( seed );
+    std::vector< Front::Request > requests( batch, Front::Request{ ac::PartitionOp::retrieve, Account::AcctKey(), Account(), false } );
+    std::uint64_t hits{0};
+    bench::Timer t;
+    for ( std::uint64_t done{0}; done < lookups; done += batch ) {
+        for ( auto & r : requests ) r.m_key = account( rng.next() % n ).getKey();
+        front.execute( requests );
+        for ( const auto & r : requests ) hits += r.m_ok;
+    }
+    double secs = t.seconds();
+    if ( hits == 0 ) std::cerr << "no hits?\n";
+    return secs;
+}
+
+/// Runs `clients` client processes at once; returns the slowest one's time.
+double run_clients( std::size_t clients, const std::vector< std::string > & paths, std::uint64_t n,
+                    std::uint64_t lookups, std::size_t batch ) {
+    int fds[2];
+    if ( ::pipe( fds ) != 0 ) { std::perror( "pipe" ); std::exit( EXIT_FAILURE ); }
+    for ( std::size_t c{0}; c < clients; c++ ) {
+        if ( ::fork() == 0 ) {
+            ::close( fds[0] );
+            double secs = client( paths, n, lookups, batch, c + 1 );
+            ssize_t w = ::write( fds[1], &secs, sizeof( secs ) );
+            ::_exit( w == ssize_t( sizeof( secs ) ) ? 0 : 1 );
+        }
+    }
+    ::close( fds[1] );
+    double secs, slowest{0};
+    while ( ::read( fds[0], &secs, sizeof( secs ) ) == ssize_t( sizeof( secs ) ) ) slowest = std::max( slowest, secs );
+    ::close( fds[0] );
+    for ( std::size_t c{0}; c < clients; c++ ) ::wait( nullptr );
+    return slowest;
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 200000 );
+    auto max_parts = bench::arg_or( argc, argv, 2, 4 );
+    auto lookups = bench::arg_or( argc, argv, 3, 200000 );
+    auto batch = std::size_t( bench::arg_or( argc, argv, 4, 256 ) );
+    const std::string base = "/tmp/bench_partitioned_" + std::to_string( ::getpid() ) + "_";
+
+    for ( std::uint64_t parts{1}; parts <= max_parts; parts *= 2 ) {
+        std::vector< std::string > paths;
+        std::vector< pid_t > servers;
+        for ( std::uint64_t p{0}; p < parts; p++ ) {
+            paths.push_back( base + std::to_string( p ) );
+            servers.push_back( spawn_server( paths.back() ) );
+        }
+        {
+            Front loader( 1024 );
+            for ( const auto & p : paths ) loader.add_partition( p );
+            std::vector< Front::Request > load;
+            load.reserve( n );
+            for ( std::uint64_t i{0}; i < n; i++ ) {
+                Account a = account( i );
+                load.push_back( Front::Request{ ac::PartitionOp::insert, a.getKey(), a, false } );
+            }
+            bench::Timer t;
+            loader.execute( load );
+            bench::report( std::to_string( parts ) + " partitions, load", n, t.seconds() );
+
+            double secs = run_clients( parts, paths, n, lookups, batch );
+            bench::report( "  " + std::to_string( parts ) + " clients, batches of " + std::to_string( batch ),
+                           parts * lookups, secs );
+            if ( parts == 1 ) {
+                secs = run_clients( 1, paths, n, lookups / 10, 1 );
+                bench::report( "  1 client, unbatched", lookups / 10, secs );
+            }
+
+            // One more partition: how many keys move.
+            auto extra = base + std::to_string( parts );
+            servers.push_back( spawn_server( extra ) );
+            t.reset();
+            auto moved = loader.add_partition( extra );
+            std::cout << "  adding partition " << parts + 1 << " moved " << moved << " of " << n << " keys ("
+                      << 100.0 * moved / n << "%) in " << t.seconds() << " s\n";
+            loader.shutdown();
+        }
+        for ( pid_t s : servers ) ::waitpid( s, nullptr, 0 );
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/*!
+ * @file bench_secondary_index.cpp
+ * "All accounts of branch b of bank k" over a table of accounts: a scan of a plain
+ * HashTbl against a lookup in a (bank, branch) SecondaryIndex of an IndexedHashTbl,
+ * plus what maintaining the index costs the inserts.
+ * Usage: bench_secondary_index [n_accounts] [n_branches] [queries]
+ */
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../driver/account.h"
+#include "../include/indexed_hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+using Branch = std::pair< int, int >;
+
+struct BranchHash {
+    std::size_t operator()( const Branch & b ) const { return std::hash< int >()( b.first ) * 31 + std::hash< int >()( b.second ); }
+};
+
+Account account( std::uint64_t i, std::uint64_t branches ) {
+    return Account( "Client " + std::to_string( i ), int( 1 + i % 5 ), int( i / 5 % ( branches / 5 ) ), int( i ), 1.f );
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 1000000 );
+    auto branches = std::max< std::uint64_t >( bench::arg_or( argc, argv, 2, 5000 ), 5 );
+    auto queries = bench::arg_or( argc, argv, 3, 50 );
+
+    std::vector< Account > accounts;
+    accounts.reserve( n );
+    for ( std::uint64_t i{0}; i < n; i++ ) accounts.push_back( account( i, branches ) );
+    bench::Rng rng( 3 );
+    std::vector< Branch > probes( queries );
+    for ( auto & b : probes ) {
+        const Account & a = accounts[ rng.next() % n ];
+        b = Branch( a.m_bank_code, a.m_branch_code );
+    }
+
+    ac::HashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > plain;
+    bench::Timer t;
+    for ( const auto & a : accounts ) plain.insert( a.getKey(), a );
+    bench::report( "HashTbl insert", n, t.seconds() );
+
+    ac::IndexedHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > indexed;
+    const auto & by_branch = indexed.add_index< Branch, BranchHash >(
+        []( const Account & a ) { return Branch( a.m_bank_code, a.m_branch_code ); } );
+    t.reset();
+    for ( const auto & a : accounts ) indexed.insert( a.getKey(), a );
+    bench::report( "IndexedHashTbl insert (1 index)", n, t.seconds() );
+
+    double scanned{0}, found{0};
+    t.reset();
+    for ( const auto & b : probes )
+        plain.for_each( [&]( const decltype( plain )::entry_type & e ) {
+            if ( e.m_data.m_bank_code == b.first and e.m_data.m_branch_code == b.second ) scanned += e.m_data.m_balance;
+        } );
+    bench::report( "branch query, table scan", queries, t.seconds() );
+
+    t.reset();
+    for ( std::uint64_t r{0}; r < 1000; r++ )
+        for ( const auto & b : probes )
+            for ( const Account * a : by_branch.find( b ) ) found += a->m_balance;
+    bench::report( "branch query, secondary index", queries * 1000, t.seconds() );
+    std::cout << "  " << scanned << " / " << found / 1000 << " balance summed (scan / index)\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+/*!
+ * @file bench_shm.cpp
+ * Worker processes serving lookups from one table: each worker with its own
+ * HashTbl copy, against all workers mapping a single ShmHashTbl. Prints each
+ * worker's proportional set size (Pss: shared pages split among their users)
+ * and the combined lookup rate, for 1 .. max_workers workers.
+ * Usage: bench_shm [entries] [max_workers] [lookups_per_worker]
+ */
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+
+#include "../include/hashtbl.h"
+#include "../include/shm_hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+/// A fixed-size account record, as stored in shared memory (no heap pointers).
+struct Record {
+    char m_name[32];
+    int m_bank, m_branch, m_number;
+    float m_balance;
+};
+
+Record make_record( std::uint64_t k ) {
+    Record r{};
+    std::snprintf( r.m_name, sizeof( r.m_name ), "Client %llu", (unsigned long long) k );
+    r.m_bank = int( k % 300 );
+    r.m_branch = int( k % 5000 );
+    r.m_number = int( k );
+    r.m_balance = 1.f;
+    return r;
+}
+
+/// Pss of this process in bytes, from /proc/self/smaps_rollup (0 where unavailable).
+std::uint64_t pss_bytes() {
+    std::ifstream in( "/proc/self/smaps_rollup" );
+    std::string field;
+    std::uint64_t kb{0};
+    while ( in >> field ) {
+        if ( field == "Pss:" ) { in >> kb; return kb * 1024; }
+        in.ignore( 1 << 16, '\n' );
+    }
+    return 0;
+}
+
+struct WorkerResult { double seconds; std::uint64_t hits, pss; };
+
+/// Forks `workers` processes running work(), waits until all are done, and prints the totals.
+template< class Work >
+void run_workers( const std::string & label, unsigned workers, std::uint64_t lookups, Work work ) {
+    int fds[2];
+    if ( ::pipe( fds ) != 0 ) { std::perror( "pipe" ); std::exit( EXIT_FAILURE ); }
+    for ( unsigned w{0}; w < workers; w++ ) {
+        if ( ::fork() == 0 ) {
+            ::close( fds[0] );
+            WorkerResult r = work( w );
+            ssize_t n = ::write( fds[1], &r, sizeof( r ) );
+            ::_exit( n == ssize_t( sizeof( r ) ) ? 0 : 1 );
+        }
+    }
+    ::close( fds[1] );
+    double slowest{0};
+    std::uint64_t pss{0}, hits{0};
+    WorkerResult r;
+    while ( ::read( fds[0], &r, sizeof( r ) ) == ssize_t( sizeof( r ) ) ) {
+        slowest = std::max( slowest, r.seconds );
+        pss += r.pss;
+        hits += r.hits;
+    }
+    ::close( fds[0] );
+    while ( ::wait( nullptr ) > 0 ) {}
+    bench::report( label + ", " + std::to_string( workers ) + " workers", workers * lookups, slowest );
+    std::cout << "  Pss total " << pss / ( 1 << 20 ) << " MiB (" << pss / workers / ( 1 << 20 )
+              << " MiB per worker), " << hits << " hits\n";
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 1000000 );
+    auto max_workers = unsigned( bench::arg_or( argc, argv, 2, 4 ) );
+    auto lookups = bench::arg_or( argc, argv, 3, 2000000 );
+
+    using Shared = ac::ShmHashTbl< std::uint64_t, Record >;
+    const std::string name = "/ac_bench_shm_" + std::to_string( ::getpid() );
+    Shared::remove( name );
+    {
+        Shared table = Shared::create( name, n );
+        for ( std::uint64_t k{0}; k < n; k++ ) table.insert( k, make_record( k ) );
+        std::cout << "Shared segment: " << table.segment_bytes() / ( 1 << 20 ) << " MiB\n";
+    }
+
+    for ( unsigned workers{1}; workers <= max_workers; workers *= 2 ) {
+        // Every worker loads its own copy, as separate server processes would.
+        run_workers( "HashTbl per process", workers, lookups, [&]( unsigned w ) {
+            ac::HashTbl< std::uint64_t, Record > table( n );
+            for ( std::uint64_t k{0}; k < n; k++ ) table.insert( k, make_record( k ) );
+            bench::Rng rng( w + 1 );
+            Record r;
+            WorkerResult out{ 0, 0, 0 };
+            bench::Timer t;
+            for ( std::uint64_t i{0}; i < lookups; i++ ) out.hits += table.retrieve( rng.next() % n, r );
+            out.seconds = t.seconds();
+            out.pss = pss_bytes();
+            return out;
+        } );
+        run_workers( "ShmHashTbl shared", workers, lookups, [&]( unsigned w ) {
+            Shared table = Shared::open( name );
+            bench::Rng rng( w + 1 );
+            Record r;
+            WorkerResult out{ 0, 0, 0 };
+            bench::Timer t;
+            for ( std::uint64_t i{0}; i < lookups; i++ ) out.hits += table.retrieve( rng.next() % n, r );
+            out.seconds = t.seconds();
+            out.pss = pss_bytes();
+            return out;
+        } );
+    }
+    Shared::remove( name );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+/*!
+ * @file bench_table_diff.cpp
+ * Syncing a standby with a primary that changed a little: a full copy (operator=)
+ * against diff() + apply(), with the bytes each ships (the whole table encoded vs
+ * the encoded change set), then against the standby shipping its digest, kept up to
+ * date by DigestedHashTbl, for changes_for() on the primary.
+ * Usage: bench_table_diff [n_accounts] [changes_per_million]
+ */
+#include <string>
+
+#include "../driver/account.h"
+#include "../include/table_diff.h"
+#include "bench_util.h"
+
+namespace {
+
+using Table = ac::HashTbl< Account::AcctKey, Account, KeyHash, KeyEqual >;
+using Digested = ac::DigestedHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual >;
+
+Account account( std::uint64_t i, float balance ) {
+    return Account( "Client " + std::to_string( i ), int( 1 + i % 5 ), int( i % 5000 ), int( i ), balance );
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 1000000 );
+    auto per_million = bench::arg_or( argc, argv, 2, 1000 );   // 0.1%.
+
+    Table primary, standby;
+    bench::Timer t;
+    for ( std::uint64_t i{0}; i < n; i++ ) {
+        auto a = account( i, 1.f );
+        primary.insert( a.getKey(), a );
+    }
+    auto build_secs = t.seconds();
+    standby = primary;
+    const auto bits = ac::TableDigest::bits_for( n );
+    Digested dprimary( bits ), dstandby( bits );
+    t.reset();
+    for ( std::uint64_t i{0}; i < n; i++ ) {
+        auto a = account( i, 1.f );
+        dprimary.insert( a.getKey(), a );
+    }
+    auto digested_build_secs = t.seconds();
+    primary.for_each( [&]( const Table::entry_type & e ) { dstandby.insert( e.m_key, e.m_data ); } );
+    bench::Rng rng( 9 );
+    auto changes = n * per_million / 1000000;
+    for ( std::uint64_t c{0}; c < changes; c++ ) {
+        auto i = rng.next() % n;
+        switch ( c % 3 ) {
+            case 0: { auto a = account( i, 2.f ); primary.insert( a.getKey(), a ); dprimary.insert( a.getKey(), a ); break; }
+            case 1: { auto a = account( n + c, 1.f ); primary.insert( a.getKey(), a ); dprimary.insert( a.getKey(), a ); break; }
+            default: primary.erase( account( i, 1.f ).getKey() ); dprimary.erase( account( i, 1.f ).getKey() );
+        }
+    }
+    std::cout << "build: " << build_secs << " s, " << digested_build_secs << " s keeping the digest up to date\n";
+
+    t.reset();
+    Table copy;
+    copy = primary;
+    auto copy_secs = t.seconds();
+    std::string wire;
+    primary.for_each( [&]( const Table::entry_type & e ) {
+        ac::Codec< Account::AcctKey >::encode( wire, e.m_key );
+        ac::Codec< Account >::encode( wire, e.m_data );
+    } );
+    std::cout << "full copy: " << copy_secs << " s, " << wire.size() / 1024 << " KiB encoded\n";
+
+    ac::DiffStats stats;
+    t.reset();
+    auto delta = ac::diff( standby, primary, ac::DiffOptions{}, &stats );
+    auto diff_secs = t.seconds();
+    t.reset();
+    auto applied = ac::apply( standby, delta );
+    auto apply_secs = t.seconds();
+    wire.clear();
+    delta.encode( wire );
+    std::cout << "diff: " << diff_secs << " s (" << stats.differing_leaves << " of " << stats.leaves
+              << " ranges differ, " << stats.compared << " entries compared), apply: " << apply_secs << " s\n"
+              << "  " << delta.m_upserts.size() << " upserts, " << delta.m_erases.size() << " erases, "
+              << wire.size() / 1024 << " KiB encoded, " << applied << " applied\n";
+    t.reset();
+    bool same = ac::diff( standby, primary ).empty();
+    std::cout << "  re-diff after apply: " << ( same ? "equal" : "DIFFERENT" ) << " in " << t.seconds() << " s\n";
+
+    // The standby ships its digest; the primary answers with the entries of the differing leaves.
+    t.reset();
+    std::string digest_wire;
+    dstandby.digest().encode( digest_wire );
+    ac::TableDigest remote( 0 );
+    const char * p = digest_wire.data();
+    remote.decode( p, digest_wire.data() + digest_wire.size() );
+    auto answer = ac::changes_for( dprimary, remote, ac::DiffOptions{}, &stats );
+    auto changes_secs = t.seconds();
+    t.reset();
+    ac::apply( dstandby, answer );
+    apply_secs = t.seconds();
+    wire.clear();
+    answer.encode( wire );
+    bool synced = dstandby.digest() == dprimary.digest() and dstandby.size() == dprimary.size();
+    std::cout << "changes_for (digest kept up to date): " << changes_secs << " s (" << stats.differing_leaves
+              << " of " << stats.leaves << " ranges differ), apply: " << apply_secs << " s\n"
+              << "  " << digest_wire.size() / 1024 << " KiB digest in, " << answer.m_upserts.size() << " upserts, "
+              << wire.size() / 1024 << " KiB encoded out: " << ( synced ? "equal" : "DIFFERENT" ) << "\n";
+    return same and synced ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,76 @@
+/*!
+ * @file bench_tail_latency.cpp
+ * Per-lookup latency percentiles for the chained HashTbl and the cuckoo layout,
+ * at a few load levels and with a mix of hits and misses. Each lookup is timed
+ * on its own, so the numbers include the clock overhead (printed first).
+ * Usage: bench_tail_latency [n_keys] [lookups] [miss_percent]
+ */
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "../include/hashtbl_layout.h"
+#include "bench_util.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+inline std::uint64_t ns_between( Clock::time_point a, Clock::time_point b ) {
+    return std::uint64_t( std::chrono::duration_cast< std::chrono::nanoseconds >( b - a ).count() );
+}
+
+void print_percentiles( const char * label, std::vector< std::uint64_t > & ns ) {
+    std::sort( ns.begin(), ns.end() );
+    auto at = [&]( double q ) { return ns[ std::size_t( q * ( ns.size() - 1 ) ) ]; };
+    std::cout << "  " << label << ": p50 " << at( 0.5 ) << " ns  p99 " << at( 0.99 )
+              << " ns  p99.9 " << at( 0.999 ) << " ns  max " << ns.back() << " ns\n";
+}
+
+template< class Table >
+void run( const char * label, std::uint64_t n, std::uint64_t lookups, std::uint64_t miss_pct ) {
+    Table table;
+    for ( std::uint64_t k{0}; k < n; k++ )
+        table.insert( k * 2, int( k ) );   // Even keys hit, odd keys miss.
+
+    bench::Rng rng( 11 );
+    std::vector< std::uint64_t > probe( lookups ), ns( lookups );
+    for ( auto & k : probe ) {
+        k = ( rng.next() % n ) * 2;
+        if ( rng.next() % 100 < miss_pct ) k++;
+    }
+    int v;
+    std::uint64_t found{0};
+    for ( std::uint64_t i{0}; i < lookups; i++ ) {
+        auto t0 = Clock::now();
+        found += table.retrieve( probe[i], v );
+        ns[i] = ns_between( t0, Clock::now() );
+    }
+    std::cout << label << " (" << n << " keys, " << found << " hits, "
+              << table.bucket_count() << " buckets)\n";
+    print_percentiles( "retrieve", ns );
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 1000000 );
+    auto lookups = bench::arg_or( argc, argv, 2, 2000000 );
+    auto miss_pct = bench::arg_or( argc, argv, 3, 20 );
+
+    std::vector< std::uint64_t > overhead( 100000 );
+    for ( auto & o : overhead ) {
+        auto t0 = Clock::now();
+        o = ns_between( t0, Clock::now() );
+    }
+    print_percentiles( "clock overhead", overhead );
+
+    for ( auto size : { n / 4, n / 2, n } ) {
+        run< ac::BasicHashTbl< std::uint64_t, int, std::hash< std::uint64_t >,
+                               std::equal_to< std::uint64_t >, ac::chained_layout > >( "HashTbl (chained)", size, lookups, miss_pct );
+        run< ac::BasicHashTbl< std::uint64_t, int, std::hash< std::uint64_t >,
+                               std::equal_to< std::uint64_t >, ac::cuckoo_layout > >( "CuckooHashTbl", size, lookups, miss_pct );
+    }
+    return EXIT_SUCCESS;
+}
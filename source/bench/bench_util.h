@@ -0,0 +1,61 @@
+/*!
+ * @file bench_util.h
+ * Small helpers shared by the benchmark drivers.
+ */
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include <unistd.h> // sysconf
+
+namespace bench {
+    /// Wall-clock stopwatch.
+    class Timer {
+        public:
+            Timer() : m_start{ std::chrono::steady_clock::now() } {}
+            void reset() { m_start = std::chrono::steady_clock::now(); }
+            // Seconds elapsed since construction or last reset().
+            double seconds() const {
+                return std::chrono::duration<double>( std::chrono::steady_clock::now() - m_start ).count();
+            }
+        private:
+            std::chrono::steady_clock::time_point m_start;
+    };
+
+    /// Returns argv[idx] as an integer, or def_ when it was not given.
+    inline std::uint64_t arg_or( int argc, char * argv[], int idx, std::uint64_t def_ ) {
+        return idx < argc ? std::strtoull( argv[idx], nullptr, 10 ) : def_;
+    }
+
+    /// xorshift64* generator; deterministic and cheap enough not to dominate a loop.
+    struct Rng {
+        std::uint64_t s;
+        explicit Rng( std::uint64_t seed = 88172645463325252ull ) : s{ seed ? seed : 1 } {}
+        std::uint64_t next() {
+            s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+            return s * 2685821657736338717ull;
+        }
+    };
+
+    /// Resident set size of this process, in bytes (0 where /proc is not available).
+    inline std::uint64_t rss_bytes() {
+        std::ifstream statm( "/proc/self/statm" );
+        std::uint64_t pages{0}, resident{0};
+        statm >> pages >> resident;
+        return resident * static_cast< std::uint64_t >( ::sysconf( _SC_PAGESIZE ) );
+    }
+
+    /// Prints one result line: "<label>: <ops> ops in <secs> s (<rate> ops/s)".
+    inline void report( const std::string & label, std::uint64_t ops, double secs ) {
+        std::cout << label << ": " << ops << " ops in " << secs << " s ("
+                  << ( secs > 0 ? ops / secs : 0 ) << " ops/s)\n";
+    }
+} // namespace bench
+
+#endif
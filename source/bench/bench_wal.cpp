@@ -0,0 +1,69 @@
+/*!
+ * @file bench_wal.cpp
+ * Durable mutations per second under each sync policy of the write-ahead log,
+ * with one writer and with several: SyncMode::none (write only), every (one
+ * fdatasync per commit, shared by the commits that queue behind it) and group
+ * (the syncing thread waits up to max_delay for more commits), then the time
+ * to recover the table from the log.
+ * Usage: bench_wal [ops] [threads] [log path]
+ */
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/durable_hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+using Table = ac::DurableHashTbl< std::uint64_t, std::uint64_t >;
+
+void run( const std::string & label, const std::string & path, ac::WalOptions options,
+          std::uint64_t ops, std::uint64_t threads ) {
+    std::remove( path.c_str() );
+    Table table( path, options );
+    std::vector< std::thread > pool;
+    bench::Timer t;
+    for ( std::uint64_t i{0}; i < threads; i++ )
+        pool.emplace_back( [&table, i, ops, threads]() {
+            bench::Rng rng( i + 1 );
+            for ( std::uint64_t j = i; j < ops; j += threads )
+                table.insert( rng.next() % ( ops / 2 + 1 ), j );
+        } );
+    for ( auto & th : pool ) th.join();
+    double secs = t.seconds();
+    auto stats = table.log_stats();
+    bench::report( label + ", " + std::to_string( threads ) + " thread(s)", ops, secs );
+    std::cout << "  " << stats.syncs << " batches, " << double( stats.records ) / stats.syncs
+              << " records/batch, " << stats.bytes / 1024 << " KiB\n";
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto ops = bench::arg_or( argc, argv, 1, 20000 );
+    auto threads = bench::arg_or( argc, argv, 2, 8 );
+    std::string path = argc > 3 ? argv[3] : "bench_wal.log";
+
+    ac::WalOptions none, every, group;
+    none.mode = ac::SyncMode::none;
+    every.mode = ac::SyncMode::every;
+    group.mode = ac::SyncMode::group;
+    for ( std::uint64_t n : { std::uint64_t( 1 ), threads } ) {
+        run( "none", path, none, ops, n );
+        run( "every", path, every, ops, n );
+        for ( int us : { 100, 500, 2000 } ) {
+            group.max_delay = std::chrono::microseconds( us );
+            run( "group, max_delay " + std::to_string( us ) + " us", path, group, ops, n );
+        }
+    }
+    {
+        bench::Timer t;
+        Table table( path );
+        bench::report( "recovery (replay into a reserved table)", table.recovered(), t.seconds() );
+    }
+    std::remove( path.c_str() );
+    return EXIT_SUCCESS;
+}
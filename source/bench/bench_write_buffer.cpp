@@ -0,0 +1,68 @@
+/*!
+ * @file bench_write_buffer.cpp
+ * Insert bursts into a plain HashTbl and into a BufferedHashTbl, both starting small:
+ * per-insert latency percentiles (the plain table's rehashes show up in its tail) and
+ * the sustained ingest rate, counting the final flush() of the buffered table.
+ * Usage: bench_write_buffer [n_inserts] [key_space] [buffer_capacity]
+ */
+#include <chrono>
+#include <vector>
+
+#include "../driver/hdr_histogram.h"
+#include "../include/buffered_hashtbl.h"
+#include "bench_util.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+inline std::uint64_t ns_between( Clock::time_point a, Clock::time_point b ) {
+    return std::uint64_t( std::chrono::duration_cast< std::chrono::nanoseconds >( b - a ).count() );
+}
+
+void print_percentiles( const HdrHistogram & h ) {
+    std::cout << "  insert: p50 " << h.percentile( 50 ) << " ns  p99 " << h.percentile( 99 )
+              << " ns  p99.9 " << h.percentile( 99.9 ) << " ns  max " << h.max() << " ns\n";
+}
+
+/// Inserts keys_ one at a time, timing each insert; finish_ runs once at the end, inside the total time.
+template< class Table, class Finish >
+void run( const char * label, Table & table, const std::vector< std::uint64_t > & keys_, Finish finish_ ) {
+    HdrHistogram h;
+    bench::Timer t;
+    for ( auto k : keys_ ) {
+        auto t0 = Clock::now();
+        table.insert( k, k );
+        h.record( ns_between( t0, Clock::now() ) );
+    }
+    auto elements = finish_();
+    bench::report( label, keys_.size(), t.seconds() );
+    std::cout << "  " << elements << " elements\n";
+    print_percentiles( h );
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    auto n = bench::arg_or( argc, argv, 1, 2000000 );
+    auto space = bench::arg_or( argc, argv, 2, 1000000 );   // Fewer keys than inserts: some updates.
+    auto capacity = bench::arg_or( argc, argv, 3, 4096 );
+
+    bench::Rng rng( 5 );
+    std::vector< std::uint64_t > keys( n );
+    for ( auto & k : keys ) k = rng.next() % space;
+
+    {
+        ac::HashTbl< std::uint64_t, std::uint64_t > table;
+        run( "HashTbl", table, keys, [&] { return table.size(); } );
+    }
+    {
+        ac::BufferedHashTbl< std::uint64_t, std::uint64_t > table( capacity );
+        run( "BufferedHashTbl", table, keys, [&] { return table.size(); } );   // size() flushes.
+        auto stats = table.stats();
+        std::cout << "  " << stats.merges << " merges of " << stats.merged << " writes, "
+                  << stats.stalls << " stalls\n";
+    }
+    return EXIT_SUCCESS;
+}
@@ -3,6 +3,12 @@
  */
 #include "account.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
 /// Basic constructor.
 Account::Account( std::string n, int bnc, int brc, int nmr, float bal )
     : m_name( n )
@@ -17,6 +23,35 @@ Account::AcctKey Account::getKey(void) const {
     return std::make_tuple( m_name, m_bank_code, m_branch_code, m_number );
 }
 
+/// Returns the account key, interning the client name in pool.
+Account::InternedKey Account::getKey( ac::StringPool & pool ) const {
+    return std::make_tuple( pool.intern( m_name ), m_bank_code, m_branch_code, m_number );
+}
+
+/// Builds the interned key for a lookup without touching the pool.
+bool Account::findKey( const ac::StringPool & pool, InternedKey & key ) const {
+    ac::StringHandle name;
+    if ( not pool.find( m_name, name ) )
+        return false;
+    key = std::make_tuple( name, m_bank_code, m_branch_code, m_number );
+    return true;
+}
+
+/// Returns the packed key, interning the client name in pool.
+Account::PackedKey Account::getPackedKey( ac::StringPool & pool ) const {
+    PackedKey key;
+    if ( not PackedKey::pack( m_bank_code, m_branch_code, m_number, key.m_codes ) )
+        throw std::out_of_range( "[Account::getPackedKey()]: bank or branch code does not fit in 16 bits." );
+    key.m_name = pool.intern( m_name );
+    return key;
+}
+
+/// Builds the packed key for a lookup without allocating.
+bool Account::findKey( const ac::StringPool & pool, PackedKey & key ) const {
+    return PackedKey::pack( m_bank_code, m_branch_code, m_number, key.m_codes ) and
+        pool.find( m_name, key.m_name );
+}
+
 std::ostream& operator<< ( std::ostream & os_, const Account::AcctKey & ak_ ) {
     return os_ << "K{"
                << std::get<0>( ak_ ) << ","
@@ -34,6 +69,49 @@ std::ostream& operator<< ( std::ostream & os_, const Account & acct_ ) {
         "> Balance: <" << acct_.m_balance << "> ]";
 }
 
+/// Appends to out the same text operator<< writes for an account, without a stream.
+void append_account( std::string & out, const Account & acct_ ) {
+    char buf[96];
+    out += "[ Client: <";
+    out += acct_.m_name;
+    // %g is the default formatting of a float in an ostream.
+    int n = std::snprintf( buf, sizeof( buf ), "> Bank: <%d> Branch: <%d> Number: <%d> Balance: <%g> ]",
+                           acct_.m_bank_code, acct_.m_branch_code, acct_.m_number, double( acct_.m_balance ) );
+    out.append( buf, std::min< std::size_t >( n, sizeof( buf ) - 1 ) );
+}
+
+/// Appends a compact binary encoding of an account to out.
+void encode_account( std::string & out, const Account & acct_ ) {
+    char buf[sizeof( std::uint32_t ) + 3 * sizeof( std::int32_t ) + sizeof( float )];
+    std::uint32_t len = static_cast< std::uint32_t >( acct_.m_name.size() );
+    std::int32_t codes[] = { acct_.m_bank_code, acct_.m_branch_code, acct_.m_number };
+    std::memcpy( buf, &len, sizeof( len ) );
+    out.append( buf, sizeof( len ) );
+    out += acct_.m_name;
+    std::memcpy( buf, codes, sizeof( codes ) );
+    std::memcpy( buf + sizeof( codes ), &acct_.m_balance, sizeof( float ) );
+    out.append( buf, sizeof( codes ) + sizeof( float ) );
+}
+
+bool decode_account( const char *& p_, const char * end_, Account & acct_ ) {
+    std::uint32_t len;
+    std::int32_t codes[3];
+    if (end_ - p_ < static_cast< std::ptrdiff_t >( sizeof( len ) )) return false;
+    std::memcpy( &len, p_, sizeof( len ) );
+    if (end_ - p_ < static_cast< std::ptrdiff_t >( sizeof( len ) + len + sizeof( codes ) + sizeof( float ) )) return false;
+    p_ += sizeof( len );
+    acct_.m_name.assign( p_, len );
+    p_ += len;
+    std::memcpy( codes, p_, sizeof( codes ) );
+    p_ += sizeof( codes );
+    std::memcpy( &acct_.m_balance, p_, sizeof( float ) );
+    p_ += sizeof( float );
+    acct_.m_bank_code = codes[0];
+    acct_.m_branch_code = codes[1];
+    acct_.m_number = codes[2];
+    return true;
+}
+
 /// Compare two accounts
 bool operator==( const Account & a, const Account & b ) {
     return ( a.m_name == b.m_name and
@@ -58,3 +136,18 @@ bool KeyEqual::operator()( const Account::AcctKey & _lhs, const Account::AcctKey
         std::get<2>(_lhs) == std::get<2>(_rhs) and
         std::get<3>(_lhs) == std::get<3>(_rhs);
 }
+
+std::size_t InternedKeyHash::operator()( const Account::InternedKey & _k ) const {
+    return std::get<0>( _k ).m_hash xor
+        std::hash< int >()(std::get<1>( _k )) xor
+        std::hash< int >()(std::get<2>( _k )) xor
+        std::hash< int >()(std::get<3>( _k ));
+}
+
+// Functor that test two interned keys for equality: the names compare by handle.
+bool InternedKeyEqual::operator()( const Account::InternedKey & _lhs, const Account::InternedKey & _rhs ) const {
+    return std::get<0>(_lhs) == std::get<0>(_rhs) and
+        std::get<1>(_lhs) == std::get<1>(_rhs) and
+        std::get<2>(_lhs) == std::get<2>(_rhs) and
+        std::get<3>(_lhs) == std::get<3>(_rhs);
+}
@@ -6,9 +6,16 @@
 #ifndef ACCOUNT_H
 #define ACCOUNT_H
 
+#include <cstdint>
 #include <iostream>
 #include <functional>
 #include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "../include/string_pool.h"
+#include "../include/codec.h"
+#include "../include/block_codec.h"
 
 /// Represents a bank account.
 struct Account {
@@ -20,17 +27,103 @@ struct Account {
 
     // Nickname for the account key.
     using AcctKey = std::tuple< std::string, int, int, int >;
+    // Account key whose client name is interned in a ac::StringPool.
+    using InternedKey = std::tuple< ac::StringHandle, int, int, int >;
+    /// Account key packed in one machine word: bank code (16 bits), branch code (16 bits)
+    /// and account number (32 bits), with the client name interned in a ac::StringPool.
+    /*! Keys are hashed and compared by the word first; the name only breaks ties, by handle. */
+    struct PackedKey {
+        std::uint64_t m_codes;    //!< bank << 48 | branch << 32 | number.
+        ac::StringHandle m_name;  //!< Client name.
+
+        int bank() const { return int( m_codes >> 48 ); }
+        int branch() const { return int( ( m_codes >> 32 ) & 0xFFFF ); }
+        int number() const { return int( std::uint32_t( m_codes ) ); }
+        /// Packs the codes into codes_; false if bank or branch is outside [0, 65535].
+        static bool pack( int bank_, int branch_, int number_, std::uint64_t & codes_ ) {
+            if (bank_ < 0 or bank_ > 0xFFFF or branch_ < 0 or branch_ > 0xFFFF) return false;
+            codes_ = std::uint64_t( bank_ ) << 48 | std::uint64_t( branch_ ) << 32 | std::uint32_t( number_ );
+            return true;
+        }
+    };
 
     /// Basic constructor.
     Account( std::string = "<empty>", int = 0, int = 0, int = 0, float = 0.f );
 		     
 	/// Returns the account key.
 	AcctKey getKey(void) const;
+	/// Returns the account key, interning the client name in pool.
+	InternedKey getKey( ac::StringPool & pool ) const;
+	/// Builds the interned key for a lookup without touching the pool.
+	/*! @return false if the name was never interned, i.e. no stored key can match. */
+	bool findKey( const ac::StringPool & pool, InternedKey & key ) const;
+	/// Returns the packed key, interning the client name in pool (which allocates only for a new name).
+	/*! @throw std::out_of_range if the bank or branch code does not fit in 16 bits. */
+	PackedKey getPackedKey( ac::StringPool & pool ) const;
+	/// Builds the packed key for a lookup without allocating.
+	/*! @return false if the name was never interned or a code does not fit, i.e. no stored key can match. */
+	bool findKey( const ac::StringPool & pool, PackedKey & key ) const;
 	
 	/// Stream extractor of the account information. 
 	friend std::ostream &operator<< ( std::ostream & _os, const Account & _acct );
 };
 
+/// Appends to out the same text operator<< writes for an account, without a stream.
+void append_account( std::string & out, const Account & acct );
+
+/// Appends a compact binary encoding of an account to out (name length, name, codes, balance).
+void encode_account( std::string & out, const Account & acct );
+
+/// Reads an account written by encode_account() from [p, end), advancing p.
+/*! @return false if the input is too short. */
+bool decode_account( const char *& p, const char * end, Account & acct );
+
+/// Text formatter of table entries holding accounts (see ac::dump_text()).
+struct AccountFormatter {
+    template< class Entry >
+    void operator()( const Entry & e, std::string & out ) const { append_account( out, e.m_data ); }
+};
+
+/// Binary encoder of table entries holding accounts (see ac::dump_binary()).
+struct AccountEncoder {
+    template< class Entry >
+    void operator()( const Entry & e, std::string & out ) const { encode_account( out, e.m_data ); }
+};
+
+namespace ac {
+    /// Binary encoding of accounts (see ac::Codec), the one encode_account() writes.
+    template<>
+    struct Codec< Account > {
+        static void encode( std::string & out, const Account & acct ) { encode_account( out, acct ); }
+        static bool decode( const char *& p, const char * end, Account & acct ) { return decode_account( p, end, acct ); }
+    };
+
+    /// Blocks of accounts (see ac::CompressedHashTbl), column by column: the names
+    /// dictionary-encoded, the codes bit-packed from the block minimum, the balances raw.
+    template<>
+    struct BlockCodec< Account > {
+        static void encode( std::string & out, const std::vector< Account > & v, StringPool & dict ) {
+            column::encode_strings( out, v.size(), [&v]( std::size_t i ) -> const std::string & { return v[i].m_name; }, dict );
+            column::encode_ints( out, v.size(), [&v]( std::size_t i ) { return std::int64_t( v[i].m_bank_code ); } );
+            column::encode_ints( out, v.size(), [&v]( std::size_t i ) { return std::int64_t( v[i].m_branch_code ); } );
+            column::encode_ints( out, v.size(), [&v]( std::size_t i ) { return std::int64_t( v[i].m_number ); } );
+            for (const auto & a : v) Codec< float >::encode( out, a.m_balance );
+        }
+        static bool decode( const char *& p, const char * end, std::vector< Account > & v, const StringPool & dict ) {
+            if (not column::decode_strings( p, end, v.size(), [&v]( std::size_t i, const char * s, std::size_t len ) {
+                        v[i].m_name.assign( s, len );
+                    }, dict ) or
+                not column::decode_ints( p, end, v.size(), [&v]( std::size_t i, std::int64_t x ) { v[i].m_bank_code = int( x ); } ) or
+                not column::decode_ints( p, end, v.size(), [&v]( std::size_t i, std::int64_t x ) { v[i].m_branch_code = int( x ); } ) or
+                not column::decode_ints( p, end, v.size(), [&v]( std::size_t i, std::int64_t x ) { v[i].m_number = int( x ); } ))
+                return false;
+            for (auto & a : v)
+                if (not Codec< float >::decode( p, end, a.m_balance )) return false;
+            return true;
+        }
+    };
+}
+
 /// Compare two accounts
 bool operator==( const Account & a, const Account & b );
 
@@ -42,7 +135,36 @@ struct KeyHash {
 
 // Functor that test two keys for equality.
 struct KeyEqual {
+    using agrees_with_less = std::true_type;   // Field by field, as the < of the tuple: treeified lists may order by it.
 	bool operator()( const Account::AcctKey & , const Account::AcctKey & ) const;
 };
 
+/// Functor that hashes an interned key, using the hash precomputed by the pool.
+struct InternedKeyHash {
+    std::size_t operator()( const Account::InternedKey & ) const;
+};
+
+/// Functor that tests two interned keys (from the same pool) for equality.
+struct InternedKeyEqual {
+	bool operator()( const Account::InternedKey & , const Account::InternedKey & ) const;
+};
+
+/// Functor that hashes a packed key: the codes word mixed with the name hash the pool computed.
+/*! Defined here, unlike the functors above, so that lookups inline it. */
+struct PackedKeyHash {
+    std::size_t operator()( const Account::PackedKey & k_ ) const {
+        std::uint64_t h = k_.m_codes ^ ( std::uint64_t( k_.m_name.m_hash ) << 16 );
+        h ^= h >> 33; h *= 0xFF51AFD7ED558CCDull;   // MurmurHash3 finalizer.
+        h ^= h >> 33; h *= 0xC4CEB9FE1A85EC53ull;
+        return std::size_t( h ^ ( h >> 33 ) );
+    }
+};
+
+/// Functor that tests two packed keys (from the same pool) for equality: one word, then the name handle.
+struct PackedKeyEqual {
+    bool operator()( const Account::PackedKey & a_, const Account::PackedKey & b_ ) const {
+        return a_.m_codes == b_.m_codes and a_.m_name == b_.m_name;
+    }
+};
+
 #endif
@@ -0,0 +1,324 @@
+/*!
+ * @file: account_loader.cpp
+ */
+#include "account_loader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using hashed_entry = std::pair< std::size_t, AccountTable::entry_type >;
+
+/// Read-only mapping of a whole file.
+class MappedFile {
+    public:
+        explicit MappedFile( const std::string & path ) {
+            m_fd = ::open( path.c_str(), O_RDONLY );
+            if ( m_fd < 0 )
+                throw std::runtime_error( "[load_accounts()]: cannot open " + path );
+            struct stat st;
+            if ( ::fstat( m_fd, &st ) != 0 ) {
+                ::close( m_fd );
+                throw std::runtime_error( "[load_accounts()]: cannot stat " + path );
+            }
+            m_size = static_cast< std::size_t >( st.st_size );
+            if ( m_size > 0 ) {
+                void * p = ::mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0 );
+                if ( p == MAP_FAILED ) {
+                    ::close( m_fd );
+                    throw std::runtime_error( "[load_accounts()]: cannot map " + path );
+                }
+                ::madvise( p, m_size, MADV_SEQUENTIAL );
+                m_data = static_cast< const char * >( p );
+            }
+        }
+        ~MappedFile() {
+            if ( m_data ) ::munmap( const_cast< char * >( m_data ), m_size );
+            ::close( m_fd );
+        }
+        MappedFile( const MappedFile & ) = delete;
+        MappedFile & operator=( const MappedFile & ) = delete;
+
+        const char * data() const { return m_data; }
+        std::size_t size() const { return m_size; }
+
+    private:
+        int m_fd = -1;
+        const char * m_data = nullptr;
+        std::size_t m_size = 0;
+};
+
+/// Parses a decimal int; advances p past it. Returns false on a malformed or out-of-range field.
+bool parse_int( const char *& p, const char * end, int & out ) {
+    bool neg = ( p < end and *p == '-' );
+    if ( neg ) ++p;
+    if ( p == end or *p < '0' or *p > '9' ) return false;
+    // Magnitude limit: -INT_MIN is one more than INT_MAX.
+    const long long limit = neg ? -static_cast< long long >( INT_MIN ) : INT_MAX;
+    long long v{0};
+    while ( p < end and *p >= '0' and *p <= '9' ) {
+        v = v * 10 + ( *p++ - '0' );
+        if ( v > limit ) return false;
+    }
+    out = static_cast< int >( neg ? -v : v );
+    return true;
+}
+
+/// Parses the name field of a CSV line into name, up to and past the comma after it.
+/// A quoted name ("...", with "" for a quote) may hold commas; it may not span lines.
+bool parse_name( const char *& p, const char * end, std::string & name ) {
+    if ( p == end or *p != '"' ) {
+        auto comma = static_cast< const char * >( std::memchr( p, ',', end - p ) );
+        if ( comma == nullptr ) return false;
+        name.assign( p, comma );
+        p = comma + 1;
+        return true;
+    }
+    name.clear();
+    for ( ++p; p < end; ++p ) {
+        if ( *p != '"' ) name += *p;
+        else if ( p + 1 < end and p[1] == '"' ) name += *p++;
+        else break;   // The closing quote.
+    }
+    if ( end - p < 2 or p[1] != ',' ) return false;
+    p += 2;
+    return true;
+}
+
+/// Parses one CSV line [p, end) into acct.
+bool parse_csv_line( const char * p, const char * end, Account & acct ) {
+    if ( end > p and end[-1] == '\r' ) --end;
+    if ( not parse_name( p, end, acct.m_name ) ) return false;
+    int * fields[] = { &acct.m_bank_code, &acct.m_branch_code, &acct.m_number };
+    for ( auto f : fields ) {
+        if ( not parse_int( p, end, *f ) or p == end or *p != ',' ) return false;
+        ++p;
+    }
+    // strtof needs a terminated string; the balance field is short.
+    char buf[32];
+    std::size_t len = end - p;
+    if ( len == 0 or len >= sizeof( buf ) ) return false;   // Cut short, it could still parse.
+    std::memcpy( buf, p, len );
+    buf[len] = '\0';
+    char * stop;
+    acct.m_balance = std::strtof( buf, &stop );
+    return stop == buf + len;
+}
+
+/// A chunk of input, and what its parser produced.
+struct Chunk {
+    const char * begin;
+    const char * end;
+    std::vector< hashed_entry > entries; //!< Sorted by bucket.
+    std::size_t rejected = 0;
+    bool done = false;
+    std::exception_ptr error;            //!< What the parser threw, if it did.
+};
+
+/// Splits [data, data+size) into chunks that end on record boundaries.
+std::vector< Chunk > make_chunks( const char * data, std::size_t size, AccountFormat fmt, std::size_t chunk_bytes ) {
+    std::vector< Chunk > chunks;
+    const char * end = data + size;
+    const char * p = data;
+    if ( fmt == AccountFormat::binary )
+        chunk_bytes = std::max< std::size_t >( 1, chunk_bytes / sizeof( AccountRecord ) ) * sizeof( AccountRecord );
+    while ( p < end ) {
+        const char * q = p + std::min< std::size_t >( chunk_bytes, end - p );
+        if ( fmt == AccountFormat::csv and q < end ) {
+            auto nl = static_cast< const char * >( std::memchr( q, '\n', end - q ) );
+            q = nl ? nl + 1 : end;
+        }
+        chunks.push_back( Chunk{ p, q, {}, 0, false, nullptr } );
+        p = q;
+    }
+    return chunks;
+}
+
+/// Parses a chunk, hashing each key and grouping the entries by bucket.
+void parse_chunk( Chunk & c, AccountFormat fmt, std::size_t bucket_count ) {
+    KeyHash hashFunc;
+    Account acct;
+    auto emit = [&]( const Account & a ) {
+        auto key = a.getKey();
+        auto h = hashFunc( key );
+        c.entries.emplace_back( h, AccountTable::entry_type{ std::move( key ), a } );
+    };
+    if ( fmt == AccountFormat::csv ) {
+        for ( const char * p = c.begin; p < c.end; ) {
+            auto nl = static_cast< const char * >( std::memchr( p, '\n', c.end - p ) );
+            const char * eol = nl ? nl : c.end;
+            if ( eol > p ) {
+                if ( parse_csv_line( p, eol, acct ) ) emit( acct );
+                else c.rejected++;
+            }
+            p = eol + 1;
+        }
+    }
+    else {
+        AccountRecord r;
+        for ( const char * p = c.begin; p + sizeof( r ) <= c.end; p += sizeof( r ) ) {
+            std::memcpy( &r, p, sizeof( r ) );
+            auto len = strnlen( r.m_name, sizeof( r.m_name ) );
+            if ( len == sizeof( r.m_name ) ) {   // No terminating '\0': not a record save_accounts() wrote.
+                c.rejected++;
+                continue;
+            }
+            acct.m_name.assign( r.m_name, len );
+            acct.m_bank_code = r.m_bank_code;
+            acct.m_branch_code = r.m_branch_code;
+            acct.m_number = r.m_number;
+            acct.m_balance = r.m_balance;
+            emit( acct );
+        }
+        if ( ( c.end - c.begin ) % sizeof( r ) != 0 ) c.rejected++;   // A partial record at the end of the file.
+    }
+    // Stable, so repeated keys in a chunk still resolve to the last one in the file.
+    std::stable_sort( c.entries.begin(), c.entries.end(),
+               [bucket_count]( const hashed_entry & a, const hashed_entry & b ) {
+                   return a.first % bucket_count < b.first % bucket_count; } );
+}
+
+} // namespace
+
+LoadStats load_accounts( const std::string & path, AccountFormat fmt, AccountTable & table, const LoadOptions & opts ) {
+    auto start = std::chrono::steady_clock::now();
+    LoadStats stats;
+    MappedFile file( path );
+
+    // Reserve once, so no rehash() happens while batches go in and buckets stay put.
+    auto expected = opts.expected_records;
+    if ( expected == 0 )
+        expected = fmt == AccountFormat::binary ? file.size() / sizeof( AccountRecord ) : file.size() / 32;
+    table.reserve( table.size() + expected );
+    const auto bucket_count = table.bucket_count();
+
+    auto chunks = make_chunks( file.data(), file.size(), fmt, std::max< std::size_t >( opts.chunk_bytes, 1 ) );
+    auto n_threads = opts.threads ? opts.threads : std::max( 1u, std::thread::hardware_concurrency() );
+    n_threads = std::min< std::size_t >( n_threads, std::max< std::size_t >( chunks.size(), 1 ) );
+
+    // Parsed chunks wait for the inserting thread with their entries: a parser only starts
+    // a chunk while fewer than max_pending chunks are ahead of it, so memory stays bounded.
+    const std::size_t max_pending = 2 * n_threads;
+    std::mutex mtx;
+    std::condition_variable ready;   // A chunk was parsed.
+    std::condition_variable room;    // A chunk was inserted (or the load stopped).
+    std::size_t inserted{0};         // Chunks the inserting thread is done with; under mtx.
+    bool stopping{false};            // Under mtx.
+    std::atomic< std::size_t > next_chunk{ 0 };
+    std::vector< std::thread > parsers;
+    // Stops handing out chunks and waits for the parsers; on errors too, as a joinable thread terminates.
+    auto join_parsers = [&]() {
+        next_chunk.store( chunks.size() );
+        {
+            std::lock_guard< std::mutex > lock( mtx );
+            stopping = true;
+        }
+        room.notify_all();
+        for ( auto & t : parsers ) t.join();
+    };
+    try {
+        for ( std::size_t t{0}; t < n_threads; t++ ) {
+            parsers.emplace_back( [&]() {
+                for ( std::size_t i; ( i = next_chunk.fetch_add( 1 ) ) < chunks.size(); ) {
+                    {
+                        std::unique_lock< std::mutex > lock( mtx );
+                        room.wait( lock, [&]() { return stopping or i < inserted + max_pending; } );
+                        if ( stopping ) return;
+                    }
+                    try { parse_chunk( chunks[i], fmt, bucket_count ); }
+                    catch ( ... ) { chunks[i].error = std::current_exception(); }
+                    std::lock_guard< std::mutex > lock( mtx );
+                    chunks[i].done = true;
+                    ready.notify_one();
+                }
+            } );
+        }
+
+        // Insert chunks in file order as soon as they are parsed, overlapping with the parsers.
+        for ( auto & c : chunks ) {
+            {
+                std::unique_lock< std::mutex > lock( mtx );
+                ready.wait( lock, [&c]() { return c.done; } );
+            }
+            if ( c.error ) std::rethrow_exception( c.error );
+            stats.records += c.entries.size();
+            stats.rejected += c.rejected;
+            stats.inserted += table.insert_hashed( c.entries.begin(), c.entries.end() );
+            std::vector< hashed_entry >().swap( c.entries );
+            {
+                std::lock_guard< std::mutex > lock( mtx );
+                inserted++;
+            }
+            room.notify_all();
+        }
+    }
+    catch ( ... ) {
+        join_parsers();
+        throw;
+    }
+    join_parsers();
+
+    stats.seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+    return stats;
+}
+
+std::size_t save_accounts( const std::string & path, AccountFormat fmt, const std::vector< Account > & accounts ) {
+    std::ofstream out( path, std::ios::binary | std::ios::trunc );
+    if ( not out )
+        throw std::runtime_error( "[save_accounts()]: cannot create " + path );
+    std::size_t rejected{0};
+    if ( fmt == AccountFormat::csv ) {
+        out.precision( 9 ); // Enough digits for a float to round-trip.
+        for ( const auto & a : accounts ) {
+            if ( a.m_name.find_first_of( "\r\n" ) != std::string::npos ) {   // A line per account.
+                rejected++;
+                continue;
+            }
+            if ( a.m_name.find_first_of( ",\"" ) == std::string::npos ) out << a.m_name;
+            else {
+                out << '"';
+                for ( char ch : a.m_name ) {
+                    if ( ch == '"' ) out << '"';   // Doubled inside quotes.
+                    out << ch;
+                }
+                out << '"';
+            }
+            out << ',' << a.m_bank_code << ',' << a.m_branch_code << ','
+                << a.m_number << ',' << a.m_balance << '\n';
+        }
+    }
+    else {
+        for ( const auto & a : accounts ) {
+            AccountRecord r;
+            if ( a.m_name.size() >= sizeof( r.m_name ) ) {   // Would lose its end, and maybe its key.
+                rejected++;
+                continue;
+            }
+            std::memset( &r, 0, sizeof( r ) );
+            std::strncpy( r.m_name, a.m_name.c_str(), sizeof( r.m_name ) - 1 );
+            r.m_bank_code = a.m_bank_code;
+            r.m_branch_code = a.m_branch_code;
+            r.m_number = a.m_number;
+            r.m_balance = a.m_balance;
+            out.write( reinterpret_cast< const char * >( &r ), sizeof( r ) );
+        }
+    }
+    return rejected;
+}
@@ -0,0 +1,68 @@
+/*!
+ * @file account_loader.h
+ * Streaming bulk loader of account files into a HashTbl.
+ */
+
+#ifndef ACCOUNT_LOADER_H
+#define ACCOUNT_LOADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../include/hashtbl.h"
+#include "account.h"
+
+/// The account table filled by the loader.
+using AccountTable = ac::HashTbl< Account::AcctKey, Account, KeyHash, KeyEqual >;
+
+/// Account file formats.
+enum class AccountFormat {
+    csv,    //!< One `name,bank,branch,number,balance` line per account; a name with commas is "quoted".
+    binary  //!< Fixed-size AccountRecord structs, back to back.
+};
+
+/// On-disk layout of the binary format (64 bytes, host byte order).
+struct AccountRecord {
+    char m_name[48];            //!< Client name, '\0'-padded.
+    std::int32_t m_bank_code;   //!< Bank id.
+    std::int32_t m_branch_code; //!< Branch id.
+    std::int32_t m_number;      //!< Account number.
+    float m_balance;            //!< Account balance.
+};
+
+/// Loader settings.
+struct LoadOptions {
+    std::size_t threads = 0;              //!< Parser threads; 0 means one per hardware thread.
+    std::size_t chunk_bytes = 4u << 20;   //!< Bytes of input handed to a parser at a time.
+    std::size_t expected_records = 0;     //!< Table reservation; 0 estimates it from the file size.
+};
+
+/// What a load did.
+struct LoadStats {
+    std::size_t records = 0;   //!< Records parsed.
+    std::size_t inserted = 0;  //!< New keys stored in the table.
+    std::size_t rejected = 0;  //!< Malformed CSV lines (out-of-range fields included) and binary records skipped, a partial last record included.
+    double seconds = 0;        //!< Wall-clock time of the load.
+};
+
+/// Loads an account file into table.
+/*! The file is memory-mapped and cut into chunks at record boundaries. Parser
+ *  threads turn chunks into (KeyHash value, entry) batches grouped by bucket,
+ *  while the calling thread moves finished batches into the table with
+ *  HashTbl::insert_hashed(), in file order. At most 2 x threads parsed chunks wait
+ *  for it at a time, so the loader holds a few chunks, not the file. The table is
+ *  reserved once up front.
+ *  Throws std::runtime_error if the file cannot be read, and rethrows what a parser
+ *  throws (e.g. std::bad_alloc); the batches inserted until then stay in the table.
+ */
+LoadStats load_accounts( const std::string & path, AccountFormat fmt, AccountTable & table,
+                         const LoadOptions & opts = LoadOptions{} );
+
+/// Writes accounts in the given format (test data and benchmark input).
+/*! Returns how many accounts it left out: names with line breaks (CSV), or too long
+ *  for AccountRecord::m_name, i.e. over 47 characters (binary).
+ */
+std::size_t save_accounts( const std::string & path, AccountFormat fmt, const std::vector< Account > & accounts );
+
+#endif
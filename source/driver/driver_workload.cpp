@@ -0,0 +1,100 @@
+/*!
+ * @file driver_workload.cpp
+ * Macro-benchmark: loads a synthetic account population into an AccountTable,
+ * replays a mixed operation stream and writes the latency percentiles as JSON.
+ *
+ * Usage: driver_workload [--population=N] [--operations=N] [--mix=read,insert,update,erase]
+ *                        [--zipf=THETA] [--hit=RATIO] [--seed=N] [--label=TEXT] [--out=FILE]
+ * e.g.   driver_workload --population=5000000 --mix=50,25,20,5 --zipf=0 --out=uniform.json
+ */
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "workload.h"
+
+namespace {
+
+void usage( const char * prog ) {
+    std::cerr << "Usage: " << prog << " [--population=N] [--operations=N] [--mix=read,insert,update,erase]\n"
+              << "       [--zipf=THETA (0 uniform, < 1)] [--hit=RATIO] [--seed=N] [--label=TEXT] [--out=FILE]\n";
+}
+
+/// Fills spec, label and out from the command line; throws std::invalid_argument on a bad option.
+void parse( int argc, char * argv[], WorkloadSpec & spec, std::string & label, std::string & out ) {
+    for ( int i{1}; i < argc; i++ ) {
+        std::string arg = argv[i];
+        auto eq = arg.find( '=' );
+        if ( arg.compare( 0, 2, "--" ) != 0 or eq == std::string::npos )
+            throw std::invalid_argument( "bad option " + arg );
+        std::string key = arg.substr( 2, eq - 2 ), value = arg.substr( eq + 1 );
+        if ( key == "population" )      spec.population = std::stoull( value );
+        else if ( key == "operations" ) spec.operations = std::stoull( value );
+        else if ( key == "zipf" )       spec.zipf_theta = std::stod( value );
+        else if ( key == "hit" )        spec.hit_ratio = std::stod( value );
+        else if ( key == "seed" )       spec.seed = std::stoull( value );
+        else if ( key == "label" )      label = value;
+        else if ( key == "out" )        out = value;
+        else if ( key == "mix" ) {
+            std::stringstream ss( value );
+            std::string w;
+            double * weights[] = { &spec.read, &spec.insert, &spec.update, &spec.erase };
+            for ( auto weight : weights ) {
+                if ( not std::getline( ss, w, ',' ) ) throw std::invalid_argument( "--mix needs four weights" );
+                *weight = std::stod( w );
+            }
+        }
+        else throw std::invalid_argument( "unknown option " + arg );
+    }
+}
+
+} // namespace
+
+int main( int argc, char * argv[] )
+{
+    WorkloadSpec spec;
+    std::string label = "HashTbl", out;
+    try {
+        parse( argc, argv, spec, label, out );
+    }
+    catch ( const std::exception & e ) {
+        std::cerr << e.what() << "\n";
+        usage( argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << ">>> Generating " << spec.population << " accounts and " << spec.operations << " operations...\n";
+    std::vector< Account > population;
+    std::vector< Operation > ops;
+    try {
+        population = make_population( spec );
+        ops = make_operations( spec );
+    }
+    catch ( const std::invalid_argument & e ) {
+        std::cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    AccountTable table;
+    table.reserve( spec.population );
+    for ( const auto & a : population )
+        table.insert( a.getKey(), a );
+    std::cerr << ">>> Loaded " << table.size() << " accounts; replaying...\n";
+
+    auto result = run_workload( table, ops );
+    auto json = workload_json( spec, result, label );
+    if ( out.empty() )
+        std::cout << json;
+    else {
+        std::ofstream file( out );
+        if ( not ( file << json ) ) {
+            std::cerr << "cannot write " << out << "\n";
+            return EXIT_FAILURE;
+        }
+        std::cerr << ">>> Results written to " << out << "\n";
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+/*!
+ * @file hdr_histogram.h
+ * High dynamic range histogram of latencies (HdrHistogram layout, fixed precision).
+ */
+
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/// Counts any 64-bit values with a fixed relative precision, in constant memory.
+/*! Values below 2^sub_bits are counted exactly. Above that, each power of two
+ *  [2^k, 2^(k+1)) is split in 2^(sub_bits-1) equal sub-buckets, so a value is
+ *  reported within 1 / 2^(sub_bits-1) of itself (0.2% with the default 10 bits)
+ *  whatever its magnitude. Recording is an index computation and an increment.
+ */
+class HdrHistogram {
+    public:
+        explicit HdrHistogram( unsigned sub_bits_ = 10 )
+            : m_sub_bits{ std::max( 2u, std::min( sub_bits_, 20u ) ) },
+              m_counts( ( std::size_t{1} << m_sub_bits ) + ( 64 - m_sub_bits ) * ( std::size_t{1} << ( m_sub_bits - 1 ) ), 0 )
+        {}
+
+        void record( std::uint64_t v_, std::uint64_t n_ = 1 ) {
+            m_counts[ index_of( v_ ) ] += n_;
+            m_total += n_;
+            m_sum += double( v_ ) * n_;
+            m_min = std::min( m_min, v_ );
+            m_max = std::max( m_max, v_ );
+        }
+
+        // Adds the counts of other_ (same sub_bits) to this histogram.
+        void merge( const HdrHistogram & other_ ) {
+            for (std::size_t i{0}; i < m_counts.size() and i < other_.m_counts.size(); i++)
+                m_counts[i] += other_.m_counts[i];
+            m_total += other_.m_total;
+            m_sum += other_.m_sum;
+            m_min = std::min( m_min, other_.m_min );
+            m_max = std::max( m_max, other_.m_max );
+        }
+
+        void reset() {
+            std::fill( m_counts.begin(), m_counts.end(), 0 );
+            m_total = 0;
+            m_sum = 0;
+            m_min = std::numeric_limits< std::uint64_t >::max();
+            m_max = 0;
+        }
+
+        std::uint64_t count() const { return m_total; }
+        std::uint64_t min() const { return m_total ? m_min : 0; }
+        std::uint64_t max() const { return m_max; }
+        double mean() const { return m_total ? m_sum / m_total : 0.0; }
+
+        // Smallest value v such that at least q_ percent of the recorded values are <= v
+        // (up to the precision: the highest value of v's sub-bucket, capped at max()).
+        std::uint64_t percentile( double q_ ) const {
+            if (m_total == 0) return 0;
+            auto rank = std::uint64_t( q_ / 100.0 * m_total + 0.5 );
+            rank = std::max< std::uint64_t >( rank, 1 );
+            std::uint64_t seen{0};
+            for (std::size_t i{0}; i < m_counts.size(); i++) {
+                seen += m_counts[i];
+                if (seen >= rank) return std::min( highest_of( i ), m_max );
+            }
+            return m_max;
+        }
+
+    private:
+        std::size_t index_of( std::uint64_t v_ ) const {
+            const std::uint64_t sub = std::uint64_t{1} << m_sub_bits;
+            if (v_ < sub) return std::size_t( v_ );
+            unsigned msb = 63 - unsigned( __builtin_clzll( v_ ) );
+            unsigned shift = msb - m_sub_bits + 1;   // v_ >> shift is in [sub/2, sub).
+            return std::size_t( sub + ( shift - 1 ) * ( sub / 2 ) + ( ( v_ >> shift ) - sub / 2 ) );
+        }
+        std::uint64_t highest_of( std::size_t i_ ) const {
+            const std::uint64_t sub = std::uint64_t{1} << m_sub_bits;
+            if (i_ < sub) return i_;
+            std::uint64_t shift = ( i_ - sub ) / ( sub / 2 ) + 1;
+            std::uint64_t top = ( i_ - sub ) % ( sub / 2 ) + sub / 2;
+            return ( ( top + 1 ) << shift ) - 1;
+        }
+
+        unsigned m_sub_bits;
+        std::vector< std::uint64_t > m_counts;
+        std::uint64_t m_total = 0;
+        double m_sum = 0;
+        std::uint64_t m_min = std::numeric_limits< std::uint64_t >::max();
+        std::uint64_t m_max = 0;
+};
+
+#endif
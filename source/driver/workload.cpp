@@ -0,0 +1,201 @@
+/*!
+ * @file workload.cpp
+ */
+#include "workload.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>      // std::setprecision
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+/// splitmix64 finalizer: spreads ids and ranks over 64 bits.
+std::uint64_t mix( std::uint64_t x ) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+    x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBull;
+    return x ^ ( x >> 31 );
+}
+
+double zeta( std::uint64_t n, double theta ) {
+    double sum{0};
+    for ( std::uint64_t i{1}; i <= n; i++ ) sum += 1.0 / std::pow( double( i ), theta );
+    return sum;
+}
+
+const char * const FIRST_NAMES[] = { "Alex", "Aline", "Bruna", "Carlito", "Cristiano", "Davi", "Elisa", "Fabio",
+                                     "Gabriela", "Heitor", "Iara", "Januario", "Jose", "Larissa", "Lima", "Saulo" };
+const char * const LAST_NAMES[] = { "Bastos", "Souza", "Ronaldo", "Lima", "Cunha", "Junior", "Pardo", "Medeiros",
+                                    "Oliveira", "Santos", "Ferreira", "Alves", "Pereira", "Costa", "Rocha", "Dias" };
+
+void append_latency( std::ostream & out, const char * name, const HdrHistogram & h, std::uint64_t hits, bool last ) {
+    out << "    \"" << name << "\": { \"count\": " << h.count() << ", \"hits\": " << hits
+        << ", \"mean_ns\": " << std::fixed << std::setprecision( 1 ) << h.mean() << std::defaultfloat
+        << ", \"p50_ns\": " << h.percentile( 50 ) << ", \"p90_ns\": " << h.percentile( 90 )
+        << ", \"p99_ns\": " << h.percentile( 99 ) << ", \"p999_ns\": " << h.percentile( 99.9 )
+        << ", \"max_ns\": " << h.max() << " }" << ( last ? "" : "," ) << "\n";
+}
+
+/// s_ as the contents of a JSON string: quotes and backslashes escaped, control characters as \u00XX.
+std::string json_escape( const std::string & s_ ) {
+    std::string out;
+    out.reserve( s_.size() );
+    for ( char c : s_ ) {
+        if ( c == '"' or c == '\\' ) out += '\\';
+        if ( static_cast< unsigned char >( c ) >= 0x20 ) {
+            out += c;
+            continue;
+        }
+        char code[8];
+        std::snprintf( code, sizeof( code ), "\\u%04x", unsigned( c ) );
+        out += code;
+    }
+    return out;
+}
+
+} // namespace
+
+const char * op_name( OpType t ) {
+    switch ( t ) {
+        case OpType::read:   return "read";
+        case OpType::insert: return "insert";
+        case OpType::update: return "update";
+        case OpType::erase:  return "erase";
+    }
+    return "?";
+}
+
+ZipfGenerator::ZipfGenerator( std::uint64_t n_, double theta_ )
+    : m_n{ n_ }, m_theta{ theta_ }
+{
+    if ( n_ == 0 or theta_ < 0 or theta_ >= 1 )
+        throw std::invalid_argument( "[ZipfGenerator]: needs n > 0 and 0 <= theta < 1." );
+    m_alpha = 1.0 / ( 1.0 - theta_ );
+    m_zeta_n = theta_ > 0 ? zeta( n_, theta_ ) : double( n_ );
+    m_eta = ( 1.0 - std::pow( 2.0 / n_, 1.0 - theta_ ) ) / ( 1.0 - zeta( std::min< std::uint64_t >( n_, 2 ), theta_ ) / m_zeta_n );
+    m_half_pow = 1.0 + std::pow( 0.5, theta_ );
+}
+
+std::uint64_t ZipfGenerator::next( std::mt19937_64 & rng_ ) {
+    double u = m_unit( rng_ );
+    if ( m_theta == 0 or m_n < 3 ) return std::min( std::uint64_t( u * m_n ), m_n - 1 );
+    double uz = u * m_zeta_n;
+    if ( uz < 1.0 ) return 0;
+    if ( uz < m_half_pow ) return 1;
+    return std::min( std::uint64_t( m_n * std::pow( m_eta * u - m_eta + 1.0, m_alpha ) ), m_n - 1 );
+}
+
+Account synthetic_account( std::uint64_t id_ ) {
+    auto h = mix( id_ );
+    std::string name = FIRST_NAMES[ h & 15 ];
+    name += ' ';
+    name += LAST_NAMES[ ( h >> 4 ) & 15 ];
+    return Account( name, int( 1 + ( h >> 8 ) % 300 ), int( ( h >> 24 ) % 5000 ), int( id_ ),
+                    float( ( h >> 40 ) % 10000000 ) / 100.f );
+}
+
+std::vector< Account > make_population( const WorkloadSpec & spec_ ) {
+    std::vector< Account > accounts;
+    accounts.reserve( spec_.population );
+    for ( std::uint64_t id{0}; id < spec_.population; id++ )
+        accounts.push_back( synthetic_account( id ) );
+    return accounts;
+}
+
+std::vector< Operation > make_operations( const WorkloadSpec & spec_ ) {
+    const double total = spec_.read + spec_.insert + spec_.update + spec_.erase;
+    if ( spec_.population == 0 or total <= 0 )
+        throw std::invalid_argument( "[make_operations()]: needs a population and a non-empty operation mix." );
+    const double cut[] = { spec_.read / total, ( spec_.read + spec_.insert ) / total,
+                           ( spec_.read + spec_.insert + spec_.update ) / total };
+    std::mt19937_64 rng( spec_.seed );
+    std::uniform_real_distribution< double > unit( 0.0, 1.0 );
+    ZipfGenerator zipf( spec_.population, spec_.zipf_theta );
+    std::uint64_t next_id = spec_.population;   // Next id to insert.
+    std::uint64_t oldest = spec_.population;    // Oldest id inserted by the stream and not erased yet.
+
+    std::vector< Operation > ops( spec_.operations );
+    for ( auto & op : ops ) {
+        double pick = unit( rng );
+        op.m_type = pick < cut[0] ? OpType::read : pick < cut[1] ? OpType::insert : pick < cut[2] ? OpType::update : OpType::erase;
+        if ( op.m_type == OpType::insert ) {
+            op.m_account = synthetic_account( next_id++ );
+            op.m_key = op.m_account.getKey();
+            continue;
+        }
+        if ( op.m_type == OpType::erase ) {
+            // Churn: the oldest account the stream inserted (a miss while there is none).
+            bool pending = oldest < next_id;
+            Account a = synthetic_account( pending ? oldest++ : 0 );
+            if ( not pending ) a.m_number = -1 - a.m_number;
+            op.m_key = a.getKey();
+            continue;
+        }
+        // Scrambled rank: the hot accounts are spread over the ids.
+        auto id = mix( zipf.next( rng ) ) % spec_.population;
+        Account a = synthetic_account( id );
+        if ( op.m_type == OpType::read and unit( rng ) >= spec_.hit_ratio )
+            a.m_number = -1 - a.m_number;   // Stored numbers are never negative.
+        op.m_key = a.getKey();
+    }
+    return ops;
+}
+
+WorkloadResult run_workload( AccountTable & table_, const std::vector< Operation > & ops_ ) {
+    using Clock = std::chrono::steady_clock;
+    WorkloadResult result;
+    Account a;
+    auto start = Clock::now();
+    for ( const auto & op : ops_ ) {
+        bool hit{false};
+        auto t0 = Clock::now();
+        switch ( op.m_type ) {
+            case OpType::read:   hit = table_.retrieve( op.m_key, a ); break;
+            case OpType::insert: hit = table_.insert( op.m_key, op.m_account ); break;
+            case OpType::update: {
+                Account * acct = table_.find( op.m_key );
+                if ( acct != nullptr ) { acct->m_balance += 1.f; hit = true; }
+                break;
+            }
+            case OpType::erase:  hit = table_.erase( op.m_key ); break;
+        }
+        auto t1 = Clock::now();
+        auto type = std::size_t( op.m_type );
+        result.latency[type].record( std::uint64_t( std::chrono::duration_cast< std::chrono::nanoseconds >( t1 - t0 ).count() ) );
+        result.hits[type] += hit;
+    }
+    result.seconds = std::chrono::duration< double >( Clock::now() - start ).count();
+    result.final_size = table_.size();
+    result.bucket_count = table_.bucket_count();
+    return result;
+}
+
+std::string workload_json( const WorkloadSpec & spec_, const WorkloadResult & result_, const std::string & label_ ) {
+    std::uint64_t ops{0};
+    HdrHistogram all;
+    std::uint64_t hits{0};
+    for ( std::size_t t{0}; t < OP_TYPES; t++ ) {
+        ops += result_.latency[t].count();
+        all.merge( result_.latency[t] );
+        hits += result_.hits[t];
+    }
+    std::ostringstream out;   // Grows with the label, which has no length limit.
+    out << "{\n  \"label\": \"" << json_escape( label_ ) << "\",\n"
+        << "  \"spec\": { \"population\": " << spec_.population << ", \"operations\": " << spec_.operations
+        << ", \"read\": " << spec_.read << ", \"insert\": " << spec_.insert << ", \"update\": " << spec_.update
+        << ", \"erase\": " << spec_.erase << ", \"zipf_theta\": " << spec_.zipf_theta
+        << ", \"hit_ratio\": " << spec_.hit_ratio << ", \"seed\": " << spec_.seed << " },\n"
+        << std::fixed << std::setprecision( 6 ) << "  \"seconds\": " << result_.seconds << ",\n"
+        << std::setprecision( 1 ) << "  \"throughput\": " << ( result_.seconds > 0 ? ops / result_.seconds : 0.0 ) << ",\n"
+        << std::defaultfloat << std::setprecision( 6 )
+        << "  \"table\": { \"size\": " << result_.final_size << ", \"buckets\": " << result_.bucket_count << " },\n"
+        << "  \"latency\": {\n";
+    for ( std::size_t t{0}; t < OP_TYPES; t++ )
+        append_latency( out, op_name( OpType( t ) ), result_.latency[t], result_.hits[t], false );
+    append_latency( out, "all", all, hits, true );
+    out << "  }\n}\n";
+    return out.str();
+}
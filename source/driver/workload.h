@@ -0,0 +1,87 @@
+/*!
+ * @file workload.h
+ * Synthetic account workloads: populations, operation streams with a key skew,
+ * and their replay against an AccountTable with per-operation latency histograms.
+ */
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "account.h"
+#include "account_loader.h"   // AccountTable
+#include "hdr_histogram.h"
+
+/// What a workload run does.
+struct WorkloadSpec {
+    std::size_t population = 1000000;   //!< Accounts loaded before the operations.
+    std::size_t operations = 1000000;   //!< Operations replayed.
+    double read = 0.80;                  //!< Operation mix; the four weights are normalized.
+    double insert = 0.05;
+    double update = 0.10;
+    double erase = 0.05;
+    double zipf_theta = 0.99;            //!< Key skew of reads and updates; 0 is uniform.
+    double hit_ratio = 0.90;             //!< Fraction of reads aimed at loaded accounts (the rest miss).
+    std::uint64_t seed = 42;
+};
+
+enum class OpType : std::uint8_t { read, insert, update, erase };
+static const std::size_t OP_TYPES = 4;
+
+/// Name of an operation type, as used in the JSON output.
+const char * op_name( OpType );
+
+/// One operation of a stream, with its key built ahead of the run.
+struct Operation {
+    OpType m_type;
+    Account::AcctKey m_key;
+    Account m_account;   //!< The account an insert stores (default for the other types).
+};
+
+/// Zipfian ranks in [0, n): rank 0 is the most frequent, with P(r) ~ 1 / (r+1)^theta.
+/*! The generator of Gray et al., "Quickly generating billion-record synthetic
+ *  databases" (as in YCSB): O(n) setup, O(1) per draw. theta 0 gives uniform ranks.
+ */
+class ZipfGenerator {
+    public:
+        ZipfGenerator( std::uint64_t n_, double theta_ );
+        std::uint64_t next( std::mt19937_64 & rng_ );
+
+    private:
+        std::uint64_t m_n;
+        double m_theta, m_alpha, m_zeta_n, m_eta, m_half_pow;
+        std::uniform_real_distribution< double > m_unit{ 0.0, 1.0 };
+};
+
+/// The synthetic account number id_ (0 <= id_ < 2^31): deterministic, and distinct ids give distinct keys.
+Account synthetic_account( std::uint64_t id_ );
+
+/// The accounts 0 .. spec_.population-1, loaded before the run.
+std::vector< Account > make_population( const WorkloadSpec & spec_ );
+
+/// The operation stream of spec_. Reads and updates pick loaded accounts by Zipfian rank
+/// (scrambled over the ids, so hot accounts are not neighbours), and read misses pick accounts
+/// that are never stored. Inserts add fresh ids after the population; erases remove them again,
+/// oldest first, so the population the reads aim at stays intact.
+std::vector< Operation > make_operations( const WorkloadSpec & spec_ );
+
+/// Outcome of a run.
+struct WorkloadResult {
+    double seconds = 0;                          //!< Wall time of the whole stream.
+    HdrHistogram latency[OP_TYPES];              //!< Nanoseconds per operation, by OpType.
+    std::uint64_t hits[OP_TYPES] = {};           //!< Operations that found their key (inserts: that were new).
+    std::size_t final_size = 0;
+    std::size_t bucket_count = 0;
+};
+
+/// Replays ops_ against table_, timing each operation on its own.
+WorkloadResult run_workload( AccountTable & table_, const std::vector< Operation > & ops_ );
+
+/// The spec and the result as one JSON object (latencies in nanoseconds).
+std::string workload_json( const WorkloadSpec & spec_, const WorkloadResult & result_, const std::string & label_ );
+
+#endif
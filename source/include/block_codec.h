@@ -0,0 +1,201 @@
+/*!
+ * @file block_codec.h
+ * Column encodings of blocks of values: bit-packed integers and dictionary-encoded strings.
+ */
+#ifndef _BLOCK_CODEC_H_
+#define _BLOCK_CODEC_H_
+
+#include <algorithm>   // std::min, std::max
+#include <cstdint>
+#include <cstring>     // memcpy
+#include <string>
+#include <type_traits> // is_integral, enable_if
+#include <vector>
+
+#include "codec.h"
+#include "string_pool.h"
+
+namespace ac // Associative container
+{
+    /// Building blocks of BlockCodecs: each encodes one column (one field of n values) of a block.
+    /*! A column is read through get_(i) and written back through set_(i, value), so a
+     *  codec can encode the fields of a struct without copying them out first. The
+     *  number of values is not stored: the caller knows it.
+     */
+    namespace column {
+        inline void put_varint( std::string & out_, std::uint64_t v_ ) {
+            while (v_ >= 0x80) {
+                out_ += char( v_ | 0x80 );
+                v_ >>= 7;
+            }
+            out_ += char( v_ );
+        }
+        inline bool get_varint( const char *& p_, const char * end_, std::uint64_t & v_ ) {
+            v_ = 0;
+            for (unsigned shift{0}; p_ != end_ and shift < 64; shift += 7) {
+                auto byte = std::uint8_t( *p_++ );
+                v_ |= std::uint64_t( byte & 0x7F ) << shift;
+                if (byte < 0x80) return true;
+            }
+            return false;
+        }
+        // Bits needed to store v_ (0 for 0).
+        inline unsigned width( std::uint64_t v_ ) {
+            unsigned w{0};
+            for (; v_ != 0; v_ >>= 1) ++w;
+            return w;
+        }
+
+        /// Appends n_ values of width_ bits each (get_(i) must fit), least significant bits first.
+        template< class Get >
+        void pack_bits( std::string & out_, std::size_t n_, unsigned width_, Get get_ ) {
+            std::uint64_t word{0};
+            unsigned used{0};   // Bits of word already filled.
+            for (std::size_t i{0}; i < n_; ++i) {
+                std::uint64_t v = get_( i );
+                word |= v << used;
+                if (used + width_ < 64) {
+                    used += width_;
+                    continue;
+                }
+                for (unsigned b{0}; b < 64; b += 8) out_ += char( word >> b );
+                word = used > 0 ? v >> ( 64 - used ) : 0;   // The bits that did not fit.
+                used = used + width_ - 64;
+            }
+            for (unsigned b{0}; b < used; b += 8) out_ += char( word >> b );
+        }
+        // The 8 bytes at p_ as a little-endian word.
+        inline std::uint64_t load_le64( const std::uint8_t * p_ ) {
+            std::uint64_t w;
+            std::memcpy( &w, p_, sizeof( w ) );
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            w = __builtin_bswap64( w );
+#endif
+            return w;
+        }
+        /// Reads n_ values written by pack_bits() and passes them to set_(i, v).
+        template< class Set >
+        bool unpack_bits( const char *& p_, const char * end_, std::size_t n_, unsigned width_, Set set_ ) {
+            auto bytes = ( std::uint64_t( n_ ) * width_ + 7 ) / 8;
+            if (std::uint64_t( end_ - p_ ) < bytes) return false;
+            auto base = reinterpret_cast< const std::uint8_t * >( p_ );
+            const std::uint64_t mask = width_ == 64 ? ~std::uint64_t{0} : ( std::uint64_t{1} << width_ ) - 1;
+            std::uint64_t pos{0};   // Bit offset.
+            for (std::size_t i{0}; i < n_; ++i, pos += width_) {
+                auto at = pos >> 3;
+                unsigned off = unsigned( pos & 7 );
+                if (width_ + off <= 64 and at + 8 <= bytes) {
+                    set_( i, ( load_le64( base + at ) >> off ) & mask );   // One load while 8 bytes remain.
+                    continue;
+                }
+                std::uint64_t v{0};
+                for (unsigned got{0}; got < width_; ) {
+                    off = unsigned( ( pos + got ) & 7 );
+                    unsigned take = std::min( 8 - off, width_ - got );
+                    v |= std::uint64_t( ( base[ ( pos + got ) >> 3 ] >> off ) & ( ( 1u << take ) - 1 ) ) << got;
+                    got += take;
+                }
+                set_( i, v );
+            }
+            p_ += bytes;
+            return true;
+        }
+
+        /// Integers (get_(i) returns an std::int64_t): frame of reference, i.e. the block
+        /// minimum, then every value's distance to it bit-packed with the width of the largest.
+        template< class Get >
+        void encode_ints( std::string & out_, std::size_t n_, Get get_ ) {
+            if (n_ == 0) return;
+            std::int64_t lo = get_( 0 ), hi = lo;
+            for (std::size_t i{1}; i < n_; ++i) {
+                std::int64_t v = get_( i );
+                lo = std::min( lo, v );
+                hi = std::max( hi, v );
+            }
+            auto base = std::uint64_t( lo );
+            put_varint( out_, ( base << 1 ) ^ std::uint64_t( lo >> 63 ) );   // Zigzag: small negatives stay short.
+            unsigned w = width( std::uint64_t( hi ) - base );
+            out_ += char( w );
+            pack_bits( out_, n_, w, [&]( std::size_t i ) { return std::uint64_t( get_( i ) ) - base; } );
+        }
+        /// Reads n_ integers written by encode_ints() and passes them to set_(i, std::int64_t).
+        template< class Set >
+        bool decode_ints( const char *& p_, const char * end_, std::size_t n_, Set set_ ) {
+            if (n_ == 0) return true;
+            std::uint64_t zz;
+            if (not get_varint( p_, end_, zz ) or p_ == end_) return false;
+            auto base = ( zz >> 1 ) ^ ( 0 - ( zz & 1 ) );
+            unsigned w = std::uint8_t( *p_++ );
+            if (w > 64) return false;
+            return unpack_bits( p_, end_, n_, w, [&]( std::size_t i, std::uint64_t d ) {
+                set_( i, std::int64_t( base + d ) );
+            } );
+        }
+
+        /// Strings (get_(i) returns a const std::string &): dictionary-encoded, i.e. each one
+        /// interned in dict_, the StringPool of the table, and stored as its handle in an
+        /// integer column. Repeated strings, in the block or not, cost a few bits each.
+        template< class Get >
+        void encode_strings( std::string & out_, std::size_t n_, Get get_, StringPool & dict_ ) {
+            std::vector< std::uint32_t > handles( n_ );
+            for (std::size_t i{0}; i < n_; ++i) handles[i] = dict_.intern( get_( i ) ).m_offset;
+            encode_ints( out_, n_, [&handles]( std::size_t i ) { return std::int64_t( handles[i] ); } );
+        }
+        /// Reads n_ strings written by encode_strings() and passes them to set_(i, const char *, length).
+        template< class Set >
+        bool decode_strings( const char *& p_, const char * end_, std::size_t n_, Set set_, const StringPool & dict_ ) {
+            bool valid{true};
+            bool read = decode_ints( p_, end_, n_, [&]( std::size_t i, std::int64_t h ) {
+                if (h < 0 or std::uint64_t( h ) >= dict_.bytes()) { valid = false; return; }
+                StringHandle handle{ std::uint32_t( h ), 0 };   // c_str() and length() only need the offset.
+                set_( i, dict_.c_str( handle ), dict_.length( handle ) );
+            } );
+            return read and valid;
+        }
+    } // namespace column
+
+    /// Encoding of a block of T values, for CompressedHashTbl: `encode(out, v, dict)` appends
+    /// the values of v; `decode(p, end, v, dict)` reads v.size() values into v, advances p and
+    /// returns false if the input is malformed. dict is the table's string dictionary.
+    /*! By default the values are stored one after the other in their Codec encoding, which
+     *  drops the per-value memory overhead but does not compress them. Specialize it with
+     *  the column encodings above for real savings (see Account in driver/account.h).
+     */
+    template< class T, class Enable = void >
+    struct BlockCodec {
+        static void encode( std::string & out_, const std::vector< T > & v_, StringPool & ) {
+            for (const auto & x : v_) Codec< T >::encode( out_, x );
+        }
+        static bool decode( const char *& p_, const char * end_, std::vector< T > & v_, const StringPool & ) {
+            for (auto & x : v_)
+                if (not Codec< T >::decode( p_, end_, x )) return false;
+            return true;
+        }
+    };
+
+    /// Integral types: one integer column.
+    template< class T >
+    struct BlockCodec< T, typename std::enable_if< std::is_integral< T >::value >::type > {
+        static void encode( std::string & out_, const std::vector< T > & v_, StringPool & ) {
+            column::encode_ints( out_, v_.size(), [&v_]( std::size_t i ) { return std::int64_t( v_[i] ); } );
+        }
+        static bool decode( const char *& p_, const char * end_, std::vector< T > & v_, const StringPool & ) {
+            return column::decode_ints( p_, end_, v_.size(), [&v_]( std::size_t i, std::int64_t x ) { v_[i] = T( x ); } );
+        }
+    };
+
+    /// Strings: one string column.
+    template<>
+    struct BlockCodec< std::string > {
+        static void encode( std::string & out_, const std::vector< std::string > & v_, StringPool & dict_ ) {
+            column::encode_strings( out_, v_.size(), [&v_]( std::size_t i ) -> const std::string & { return v_[i]; }, dict_ );
+        }
+        static bool decode( const char *& p_, const char * end_, std::vector< std::string > & v_, const StringPool & dict_ ) {
+            return column::decode_strings( p_, end_, v_.size(), [&v_]( std::size_t i, const char * s, std::size_t len ) {
+                v_[i].assign( s, len );
+            }, dict_ );
+        }
+    };
+
+} // namespace ac
+#endif
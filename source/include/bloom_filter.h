@@ -0,0 +1,153 @@
+/*!
+ * @file bloom_filter.h
+ * Blocked Bloom filter: every key sets and tests bits of a single 64-byte block.
+ */
+#ifndef _BLOOM_FILTER_H_
+#define _BLOOM_FILTER_H_
+
+#include <algorithm>  // std::fill, std::max, std::min
+#include <atomic>
+#include <cmath>      // std::log, std::ceil
+#include <cstdint>    // uint64_t
+#include <cstring>    // memcpy
+#include <stdexcept>  // std::invalid_argument
+#include <vector>
+
+namespace ac // Associative container
+{
+    /// Counters kept by a table that answers lookups through a filter.
+    struct FilterStats {
+        std::size_t lookups = 0;         //!< Lookups that consulted the filter.
+        std::size_t definite_misses = 0; //!< Lookups the filter answered alone ("not in the table").
+        std::size_t false_positives = 0; //!< Lookups the filter let through that still missed.
+
+        /// Fraction of the absent keys the filter failed to reject.
+        double false_positive_rate() const {
+            auto absent = definite_misses + false_positives;
+            return absent == 0 ? 0.0 : double( false_positives ) / absent;
+        }
+    };
+
+    /// FilterStats that concurrent const lookups count into. The increments are relaxed:
+    /// the counters order nothing, and a snapshot taken during lookups may mix them.
+    struct AtomicFilterStats {
+        std::atomic< std::size_t > lookups{ 0 };
+        std::atomic< std::size_t > definite_misses{ 0 };
+        std::atomic< std::size_t > false_positives{ 0 };
+
+        static void bump( std::atomic< std::size_t > & counter_ ) { counter_.fetch_add( 1, std::memory_order_relaxed ); }
+        FilterStats load() const {
+            FilterStats s;
+            s.lookups = lookups.load( std::memory_order_relaxed );
+            s.definite_misses = definite_misses.load( std::memory_order_relaxed );
+            s.false_positives = false_positives.load( std::memory_order_relaxed );
+            return s;
+        }
+        void store( const FilterStats & s_ ) {
+            lookups.store( s_.lookups, std::memory_order_relaxed );
+            definite_misses.store( s_.definite_misses, std::memory_order_relaxed );
+            false_positives.store( s_.false_positives, std::memory_order_relaxed );
+        }
+        void reset() { store( FilterStats{} ); }
+    };
+
+    /// Approximate membership: may_contain() never misses a key that was add()ed.
+    /*! The bit array is split into 512-bit blocks aligned to cache lines. A key
+     *  selects one block with part of its hash and k bits inside that block with
+     *  the rest, so both add() and may_contain() touch one cache line. Keys
+     *  cannot be removed; owners rebuild the filter instead (see HashTbl).
+     */
+    class BlockedBloomFilter {
+        public:
+            using size_type = std::size_t;
+            static constexpr size_type BLOCK_WORDS = 8; //!< 64-bit words per block (one cache line).
+            static constexpr size_type BLOCK_BITS = BLOCK_WORDS * 64;
+
+            /// Sized for n_ keys at a false positive rate of about fpr_, which must be in (0, 1):
+            /// throws std::invalid_argument otherwise.
+            BlockedBloomFilter( size_type n_, double fpr_ ) : m_fpr{ fpr_ }
+            {
+                // 0 (or NaN) would ask for infinitely many bits, 1 for none at all.
+                if (not ( fpr_ > 0 and fpr_ < 1 ))
+                    throw std::invalid_argument( "[BlockedBloomFilter]: the false positive rate must be in (0, 1)." );
+                resize( n_ );
+            }
+
+            BlockedBloomFilter( const BlockedBloomFilter & other_ )
+                : m_fpr{ other_.m_fpr }, m_k{ other_.m_k }, m_blocks{ other_.m_blocks }
+            {
+                allocate();
+                std::memcpy( m_bits, other_.m_bits, m_blocks * BLOCK_WORDS * sizeof( std::uint64_t ) );
+            }
+            BlockedBloomFilter & operator=( const BlockedBloomFilter & ) = delete;
+
+            /// Drops every key and resizes the filter for n_ keys.
+            void resize( size_type n_ ) {
+                // Classic Bloom sizing: m/n = -ln(p) / ln(2)^2 bits per key, k = (m/n) ln(2).
+                const double ln2 = 0.6931471805599453;
+                double bits_per_key = -std::log( m_fpr ) / ( ln2 * ln2 );
+                m_k = static_cast< unsigned >( std::min( 16.0, std::max( 1.0, std::ceil( bits_per_key * ln2 ) ) ) );
+                auto bits = static_cast< size_type >( std::ceil( std::max< size_type >( n_, 1 ) * bits_per_key ) );
+                m_blocks = ( bits + BLOCK_BITS - 1 ) / BLOCK_BITS;
+                allocate();
+            }
+
+            /// Drops every key.
+            void clear() { std::fill( m_bits, m_bits + m_blocks * BLOCK_WORDS, std::uint64_t( 0 ) ); }
+
+            /// Records the key whose (table) hash is h_.
+            void add( std::uint64_t h_ ) {
+                auto g = mix( h_ );
+                std::uint64_t * block = m_bits + block_of( g ) * BLOCK_WORDS;
+                // Bit positions a, a + b, a + 2b, ... from the half of g_ the block did not use.
+                auto a = std::uint32_t( g >> 32 ), b = std::uint32_t( ( g >> 32 ) * 0x9E3779B97F4A7C15ull >> 32 ) | 1;
+                for (unsigned i{0}; i < m_k; i++, a += b)
+                    block[ ( a >> 6 ) & ( BLOCK_WORDS - 1 ) ] |= std::uint64_t( 1 ) << ( a & 63 );
+            }
+
+            /// False means the key whose hash is h_ was never added.
+            bool may_contain( std::uint64_t h_ ) const {
+                auto g = mix( h_ );
+                const std::uint64_t * block = m_bits + block_of( g ) * BLOCK_WORDS;
+                // Bit positions a, a + b, a + 2b, ... from the half of g_ the block did not use.
+                auto a = std::uint32_t( g >> 32 ), b = std::uint32_t( ( g >> 32 ) * 0x9E3779B97F4A7C15ull >> 32 ) | 1;
+                for (unsigned i{0}; i < m_k; i++, a += b)
+                    if (not ( block[ ( a >> 6 ) & ( BLOCK_WORDS - 1 ) ] & ( std::uint64_t( 1 ) << ( a & 63 ) ) ))
+                        return false;
+                return true;
+            }
+
+            /// Target false positive rate.
+            double fpr() const { return m_fpr; }
+            /// Bits tested per key.
+            unsigned hashes() const { return m_k; }
+            /// Size of the bit array.
+            size_type bytes() const { return m_blocks * BLOCK_WORDS * sizeof( std::uint64_t ); }
+
+        private:
+            // splitmix64 finalizer: table hashes (e.g. std::hash of an integer) may be the identity.
+            static std::uint64_t mix( std::uint64_t x ) {
+                x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+                x ^= x >> 27; x *= 0x94d049bb133111ebull;
+                return x ^ ( x >> 31 );
+            }
+            // Maps the low half of g_ onto [0, m_blocks) without a division.
+            size_type block_of( std::uint64_t g_ ) const {
+                return size_type( ( ( g_ & 0xFFFFFFFFull ) * m_blocks ) >> 32 );
+            }
+            // The bit array starts at the first 64-byte boundary of m_storage.
+            void allocate() {
+                m_storage.assign( m_blocks * BLOCK_WORDS + BLOCK_WORDS - 1, 0 );
+                auto addr = reinterpret_cast< std::uintptr_t >( m_storage.data() );
+                m_bits = m_storage.data() + ( ( 64 - addr % 64 ) % 64 ) / sizeof( std::uint64_t );
+            }
+
+            double m_fpr;           //!< Target false positive rate.
+            unsigned m_k = 1;       //!< Bits set per key.
+            size_type m_blocks = 1; //!< Number of 512-bit blocks.
+            std::vector< std::uint64_t > m_storage; //!< Bit array plus alignment slack.
+            std::uint64_t * m_bits = nullptr;       //!< First block, cache-line aligned.
+    };
+
+} // namespace ac
+#endif
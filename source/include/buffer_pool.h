@@ -0,0 +1,185 @@
+/*!
+ * @file buffer_pool.h
+ * Fixed-size pages of a file cached in a bounded set of memory frames.
+ */
+#ifndef _BUFFER_POOL_H_
+#define _BUFFER_POOL_H_
+
+#include <algorithm>    // std::max
+#include <cerrno>
+#include <cstdint>
+#include <cstring>      // std::memset, std::strerror
+#include <limits>
+#include <stdexcept>    // std::runtime_error
+#include <string>
+#include <vector>
+
+#include <unistd.h>     // pread, pwrite
+
+#include "int_hashtbl.h"
+
+namespace ac // Associative container
+{
+    /// Counters of a BufferPool.
+    struct BufferPoolStats {
+        std::size_t hits = 0;        //!< Pins of a page already in a frame.
+        std::size_t misses = 0;      //!< Pins that had to load the page (or zero a fresh one).
+        std::size_t writes = 0;      //!< Dirty pages written back.
+        std::size_t evictions = 0;   //!< Pages dropped to make room for another.
+    };
+
+    /// Caches the pages of a file in frames_ frames of memory.
+    /*! A page is pinned while in use and cannot be evicted until every pin is
+     *  released. When a page must be loaded and no frame is free, the CLOCK
+     *  hand picks an unpinned frame not referenced since it last passed,
+     *  writing it back first if it is dirty. The page table is an IntHashTbl
+     *  from page number to frame. Not thread-safe.
+     */
+    class BufferPool {
+        public:
+            BufferPool( int fd_, std::size_t page_size_, std::size_t frames_ )
+                : m_fd{ fd_ }, m_page_size{ page_size_ },
+                  m_map( frames_ * 2, std::numeric_limits< std::uint64_t >::max() ),
+                  m_frames( std::max< std::size_t >( frames_, 1 ) ),
+                  m_data( m_frames.size() * page_size_ )
+            {}
+            BufferPool( const BufferPool & ) = delete;
+            BufferPool & operator=( const BufferPool & ) = delete;
+
+            /// Returns the frame holding page_, loading it if needed. A fresh_ page is
+            /// not read from the file (it is past its end): its frame is zeroed.
+            /// Throws std::runtime_error when every frame is pinned or I/O fails.
+            char * pin( std::uint64_t page_, bool fresh_ = false ) {
+                std::size_t f;
+                if (m_map.retrieve( page_, f )) {
+                    m_stats.hits++;
+                }
+                else {
+                    m_stats.misses++;
+                    f = victim();
+                    char * data = frame( f );
+                    if (fresh_) std::memset( data, 0, m_page_size );
+                    else read_page( page_, data );
+                    m_frames[f] = Frame{ page_, 0, false, true, true };
+                    m_map.insert( page_, f );
+                }
+                m_frames[f].pins++;
+                m_frames[f].referenced = true;
+                return frame( f );
+            }
+
+            /// Releases one pin of page_; dirty_ if the caller changed the frame.
+            void unpin( std::uint64_t page_, bool dirty_ ) {
+                std::size_t f;
+                if (not m_map.retrieve( page_, f ) or m_frames[f].pins == 0)
+                    throw std::logic_error( "[BufferPool::unpin()]: page " + std::to_string( page_ ) + " is not pinned." );
+                m_frames[f].pins--;
+                m_frames[f].dirty = m_frames[f].dirty or dirty_;
+            }
+
+            /// Writes every dirty page back to the file (no fsync).
+            void flush() {
+                for (std::size_t f{0}; f < m_frames.size(); f++) {
+                    if (m_frames[f].used and m_frames[f].dirty) {
+                        write_page( m_frames[f].page, frame( f ) );
+                        m_frames[f].dirty = false;
+                    }
+                }
+            }
+
+            std::size_t frames() const { return m_frames.size(); }
+            std::size_t page_size() const { return m_page_size; }
+            const BufferPoolStats & stats() const { return m_stats; }
+            void reset_stats() { m_stats = BufferPoolStats{}; }
+
+        private:
+            struct Frame {
+                std::uint64_t page;
+                std::uint32_t pins;
+                bool dirty;
+                bool referenced;   //!< Used since the CLOCK hand last passed.
+                bool used;         //!< Holds a page.
+            };
+
+            char * frame( std::size_t f_ ) { return m_data.data() + f_ * m_page_size; }
+
+            // A frame for a new page: a free one, or the CLOCK victim (written back if dirty).
+            std::size_t victim() {
+                for (std::size_t step{0}; step < 2 * m_frames.size(); step++) {
+                    auto f = m_hand;
+                    m_hand = ( m_hand + 1 ) % m_frames.size();
+                    Frame & fr = m_frames[f];
+                    if (not fr.used) return f;
+                    if (fr.pins > 0) continue;
+                    if (fr.referenced) { fr.referenced = false; continue; }
+                    if (fr.dirty) write_page( fr.page, frame( f ) );
+                    m_map.erase( fr.page );
+                    fr.used = false;
+                    m_stats.evictions++;
+                    return f;
+                }
+                throw std::runtime_error( "[BufferPool]: every frame is pinned." );
+            }
+
+            void read_page( std::uint64_t page_, char * data_ ) {
+                std::size_t done{0};
+                while (done < m_page_size) {
+                    auto n = ::pread( m_fd, data_ + done, m_page_size - done, off_t( page_ * m_page_size + done ) );
+                    if (n < 0 and errno == EINTR) continue;
+                    if (n < 0) fail( "read" );
+                    if (n == 0) break;   // Past the end of the file: the rest reads as zeros.
+                    done += std::size_t( n );
+                }
+                std::memset( data_ + done, 0, m_page_size - done );
+            }
+
+            void write_page( std::uint64_t page_, const char * data_ ) {
+                std::size_t done{0};
+                while (done < m_page_size) {
+                    auto n = ::pwrite( m_fd, data_ + done, m_page_size - done, off_t( page_ * m_page_size + done ) );
+                    if (n < 0 and errno == EINTR) continue;
+                    if (n <= 0) fail( "write" );
+                    done += std::size_t( n );
+                }
+                m_stats.writes++;
+            }
+
+            [[noreturn]] static void fail( const std::string & what_ ) {
+                throw std::runtime_error( "[BufferPool]: " + what_ + ": " + std::strerror( errno ) );
+            }
+
+            int m_fd;
+            std::size_t m_page_size;
+            IntHashTbl< std::uint64_t, std::size_t > m_map;   //!< Page number -> frame.
+            std::vector< Frame > m_frames;
+            std::vector< char > m_data;                       //!< The frames, page_size bytes each.
+            std::size_t m_hand = 0;                           //!< CLOCK hand.
+            BufferPoolStats m_stats;
+    };
+
+    /// Pins a page of a BufferPool for the lifetime of the object.
+    class PinnedPage {
+        public:
+            PinnedPage( BufferPool & pool_, std::uint64_t page_, bool fresh_ = false )
+                : m_pool{ &pool_ }, m_page{ page_ }, m_data{ pool_.pin( page_, fresh_ ) }, m_dirty{ fresh_ } {}
+            PinnedPage( PinnedPage && other_ ) noexcept
+                : m_pool{ other_.m_pool }, m_page{ other_.m_page }, m_data{ other_.m_data }, m_dirty{ other_.m_dirty }
+            { other_.m_pool = nullptr; }
+            PinnedPage( const PinnedPage & ) = delete;
+            PinnedPage & operator=( const PinnedPage & ) = delete;
+            ~PinnedPage() { if (m_pool != nullptr) m_pool->unpin( m_page, m_dirty ); }
+
+            std::uint64_t page() const { return m_page; }
+            char * data() const { return m_data; }
+            // Marks the page to be written back.
+            void mark_dirty() { m_dirty = true; }
+
+        private:
+            BufferPool * m_pool;
+            std::uint64_t m_page;
+            char * m_data;
+            bool m_dirty;
+    };
+
+} // namespace ac
+#endif
@@ -0,0 +1,136 @@
+/*!
+ * @file buffered_hashtbl.h
+ * HashTbl with a write buffer in front, merged into the table by a background thread.
+ */
+#ifndef _BUFFERED_HASHTBL_H_
+#define _BUFFERED_HASHTBL_H_
+
+#include <algorithm>    // std::sort, std::min, std::max
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>      // std::pair
+#include <vector>
+
+#include "hashtbl.h"
+#include "rw_lock.h"
+
+namespace ac // Associative container
+{
+    /// Counters of a BufferedHashTbl.
+    struct WriteBufferStats {
+        std::size_t merges = 0;   //!< Buffers merged into the table.
+        std::size_t merged = 0;   //!< Entries (inserts and erases) merged.
+        std::size_t stalls = 0;   //!< Writes that waited for a merge to finish.
+    };
+
+    /// A HashTbl whose writes land in a small append-only buffer first.
+    /*! insert() and erase() append to the active buffer (or update the key's entry
+     *  in it): no list node is allocated and no rehash() runs on the writer's path.
+     *  A full buffer is handed to the merge thread, which sorts it by target bucket
+     *  and applies it to the table in slices of MERGE_SLICE entries under the table's
+     *  write lock, after growing the table once for all of its inserts; meanwhile
+     *  writers fill the other buffer. Writers only wait when both buffers are full.
+     *
+     *  Lookups look in the active buffer, then in the one being merged, then in the
+     *  table, so they always see the latest write (an erase is a tombstone until it
+     *  is merged). Because a write does not look at the table, insert() and erase()
+     *  cannot tell whether the key was there: they return nothing.
+     */
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class BufferedHashTbl {
+        public:
+            using size_type = std::size_t;
+            using table_type = HashTbl< KeyType, DataType, KeyHash, KeyEqual >;
+            static const size_type MERGE_SLICE = 1024;   //!< Entries merged per hold of the table's write lock.
+
+            // Buffers of buffer_capacity_ entries (kept small enough to stay in cache),
+            // in front of a table of table_sz_ buckets.
+            explicit BufferedHashTbl( size_type buffer_capacity_ = 4096, size_type table_sz_ = 1024 );
+            BufferedHashTbl( const BufferedHashTbl & ) = delete;
+            BufferedHashTbl & operator=( const BufferedHashTbl & ) = delete;
+            // Merges what is buffered and stops the merge thread.
+            ~BufferedHashTbl();
+
+            // Inserts key_ or replaces its data.
+            void insert( const KeyType & key_, const DataType & data_ );
+            // Removes key_, if it is stored.
+            void erase( const KeyType & key_ );
+            bool retrieve( const KeyType & key_, DataType & data_ ) const;
+            // Returns 1 if key_ is stored; 0, otherwise.
+            size_type count( const KeyType & key_ ) const { DataType d; return retrieve( key_, d ) ? 1 : 0; }
+            // Waits until every buffered write is in the table.
+            void flush();
+            // Elements in the table, after a flush().
+            size_type size();
+            bool empty() { return size() == 0; }
+            // Removes every element, buffered or not.
+            void clear();
+
+            // Writes buffered and not merged yet.
+            size_type pending() const;
+            size_type buffer_capacity() const { return m_capacity; }
+            WriteBufferStats stats() const;
+
+        private:
+            //! A buffered write: the latest insert or erase of a key.
+            struct Delta {
+                size_type m_hash;   //!< KeyHash value.
+                KeyType m_key;
+                DataType m_data;
+                bool m_erased;
+            };
+
+            //! Append-only log of deltas, indexed by a small open-addressing table of log positions.
+            class WriteBuffer {
+                public:
+                    explicit WriteBuffer( size_type capacity_ );
+                    // The delta of key_, or nullptr.
+                    Delta * find( size_type hash_, const KeyType & key_ );
+                    // Records the latest write of key_ (there must be room for a new key).
+                    void put( size_type hash_, const KeyType & key_, const DataType * data_ );
+                    bool full() const { return m_log.size() == m_capacity; }
+                    bool empty() const { return m_log.empty(); }
+                    size_type size() const { return m_log.size(); }
+                    std::vector< Delta > & log() { return m_log; }
+                    void clear();
+                private:
+                    // First index slot to probe: the hash mixed (Fibonacci hashing), as KeyHash may be the identity.
+                    static size_type slot( size_type hash_, size_type mask_ ) {
+                        return size_type( ( std::uint64_t( hash_ ) * 0x9E3779B97F4A7C15ull ) >> 29 ) & mask_;
+                    }
+                    size_type m_capacity;
+                    std::vector< Delta > m_log;
+                    std::vector< std::uint32_t > m_slots;   //!< Log position + 1; 0 is an empty slot.
+            };
+
+            // Records a write under m_mutex; data_ is nullptr for an erase.
+            void put( const KeyType & key_, const DataType * data_ );
+            // Looks key_ up in the buffers (m_mutex held): 1 found, 0 erased, -1 not buffered.
+            int find_buffered( size_type hash_, const KeyType & key_, DataType & data_ ) const;
+            // Hands the active buffer to the merge thread (m_mutex held, no merge pending).
+            void hand_over();
+            void merge_loop();
+            void merge( WriteBuffer & buffer_ );
+
+            table_type m_table;
+            mutable RwLock m_table_lock;            //!< Readers of m_table vs. the merge thread.
+            size_type m_capacity;
+            WriteBuffer m_buffers[2];
+            WriteBuffer * m_active;                 //!< Takes the writes.
+            WriteBuffer * m_merging;                //!< Being merged while m_pending.
+            bool m_pending = false;
+            bool m_stop = false;
+            WriteBufferStats m_stats;
+            mutable std::mutex m_mutex;             //!< Guards the buffers, the flags and m_stats.
+            std::condition_variable m_cv;
+            std::thread m_merger;
+    };
+
+} // namespace ac
+#include "buffered_hashtbl.inl"
+#endif
@@ -0,0 +1,333 @@
+#include "buffered_hashtbl.h"
+
+namespace ac {
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	const typename BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::MERGE_SLICE;
+
+    /*!
+     * @brief Creates an empty write buffer with room for capacity_ distinct keys.
+     * @param capacity_ keys the buffer holds before it is full.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::WriteBuffer::WriteBuffer( size_type capacity_ )
+        : m_capacity{ capacity_ }
+	{
+        size_type slots{1};
+        while (slots < 2 * m_capacity) slots <<= 1;   // Load factor of the index at most 1/2.
+        m_slots.assign( slots, 0 );
+        m_log.reserve( m_capacity );
+	}
+
+    /*!
+     * @brief Looks up the buffered write of a key.
+     * @param hash_ KeyHash value of key_.
+     * @param key_ key searched for.
+     * @return the key's delta, or nullptr if the key has no buffered write.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	typename BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::Delta *
+    BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::WriteBuffer::find( size_type hash_, const KeyType & key_ )
+    {
+        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
+        auto mask = m_slots.size() - 1;
+        for (auto i = slot( hash_, mask ); m_slots[i] != 0; i = ( i + 1 ) & mask) {
+            Delta & d = m_log[ m_slots[i] - 1 ];
+            if (d.m_hash == hash_ and equalFunc( d.m_key, key_ )) return &d;
+        }
+        return nullptr;
+    }
+
+    /*!
+     * @brief Appends the first buffered write of a key (find() returned nullptr and the buffer is not full).
+     * @param hash_ KeyHash value of key_.
+     * @param key_ key written.
+     * @param data_ data inserted, or nullptr for an erase.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::WriteBuffer::put( size_type hash_, const KeyType & key_,
+                                                                               const DataType * data_ )
+    {
+        auto mask = m_slots.size() - 1;
+        auto i = slot( hash_, mask );
+        while (m_slots[i] != 0) i = ( i + 1 ) & mask;
+        m_log.push_back( Delta{ hash_, key_, data_ != nullptr ? *data_ : DataType(), data_ == nullptr } );
+        m_slots[i] = std::uint32_t( m_log.size() );
+    }
+
+    /*!
+     * @brief Empties the buffer, keeping its memory.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::WriteBuffer::clear()
+    {
+        m_log.clear();
+        std::fill( m_slots.begin(), m_slots.end(), 0 );
+    }
+
+    /*!
+     * @brief Regular constructor: starts the merge thread.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function
+     * performed on the collision list received by the client.
+     * @param buffer_capacity_ distinct keys a write buffer takes before it is merged
+     * (at least 1; a few thousand keep both buffers in cache).
+     * @param table_sz_ initial size of the table.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::BufferedHashTbl( size_type buffer_capacity_, size_type table_sz_ )
+        : m_table( table_sz_ ),
+          m_capacity{ std::min< size_type >( std::max< size_type >( buffer_capacity_, 1 ), UINT32_MAX / 2 ) },
+          m_buffers{ WriteBuffer( m_capacity ), WriteBuffer( m_capacity ) },
+          m_active{ &m_buffers[0] }, m_merging{ &m_buffers[1] }
+	{
+        m_merger = std::thread( &BufferedHashTbl::merge_loop, this );
+	}
+
+    /*!
+     * @brief Destructor: merges the buffered writes, then stops the merge thread.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::~BufferedHashTbl()
+	{
+        flush();
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_merger.join();
+	}
+
+    /*!
+     * @brief Inserts an element, or replaces the data of its key, in the write buffer.
+     * The table sees it when the buffer is merged; lookups see it right away.
+     * @param key_ element key to be inserted.
+     * @param data_ element data to be inserted.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert( const KeyType & key_, const DataType & data_ )
+    {
+        put( key_, &data_ );
+    }
+
+    /*!
+     * @brief Records the removal of a key in the write buffer (a tombstone that hides
+     * the key from lookups until the merge removes it from the table).
+     * @param key_ key of the element to be removed.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::erase( const KeyType & key_ )
+    {
+        put( key_, nullptr );
+    }
+
+    /*!
+     * @brief Records a write in the active buffer. A key written again is updated in
+     * place; a new key is appended, after handing a full buffer over to the merge
+     * thread (waiting, if the other buffer is still being merged).
+     * @param key_ key written.
+     * @param data_ data inserted, or nullptr for an erase.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::put( const KeyType & key_, const DataType * data_ )
+    {
+        KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+        auto hash = hashFunc( key_ );
+        std::unique_lock< std::mutex > lock( m_mutex );
+        Delta * d = m_active->find( hash, key_ );
+        if (d != nullptr) {
+            d->m_erased = data_ == nullptr;
+            if (data_ != nullptr) d->m_data = *data_;
+            return;
+        }
+        if (m_active->full()) {
+            if (m_pending) {
+                m_stats.stalls++;
+                m_cv.wait( lock, [this] { return not m_pending; } );
+            }
+            hand_over();
+        }
+        m_active->put( hash, key_, data_ );
+    }
+
+    /*!
+     * @brief Retrieves the data of a key: from the newest buffered write, if any; else from the table.
+     * @param key_ key searched for.
+     * @param data_ receives the data of the key, if it is stored.
+     * @return true if the key is stored; false otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	bool BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::retrieve( const KeyType & key_, DataType & data_ ) const
+    {
+        KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+        auto hash = hashFunc( key_ );
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            int found = find_buffered( hash, key_, data_ );
+            if (found >= 0) return found == 1;
+        }
+        SharedLock lock( m_table_lock );
+        return m_table.retrieve( key_, data_ );
+    }
+
+    /*!
+     * @brief Looks a key up in the active buffer, then in the one being merged (m_mutex held).
+     * @param hash_ KeyHash value of key_.
+     * @param key_ key searched for.
+     * @param data_ receives the buffered data of the key, if it was inserted.
+     * @return 1 if the newest buffered write inserts the key, 0 if it erases it, -1 if there is none.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	int BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::find_buffered( size_type hash_, const KeyType & key_,
+                                                                            DataType & data_ ) const
+    {
+        const Delta * d = m_active->find( hash_, key_ );
+        if (d == nullptr and m_pending) d = m_merging->find( hash_, key_ );
+        if (d == nullptr) return -1;
+        if (d->m_erased) return 0;
+        data_ = d->m_data;
+        return 1;
+    }
+
+    /*!
+     * @brief Waits until every write made so far is merged into the table.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::flush()
+    {
+        std::unique_lock< std::mutex > lock( m_mutex );
+        m_cv.wait( lock, [this] { return not m_pending; } );
+        if (m_active->empty()) return;
+        hand_over();
+        m_cv.wait( lock, [this] { return not m_pending; } );
+    }
+
+    /*!
+     * @brief Number of elements stored; merges the buffered writes first.
+     * @return the number of elements in the table.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	typename BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size()
+    {
+        flush();
+        SharedLock lock( m_table_lock );
+        return m_table.size();
+    }
+
+    /*!
+     * @brief Removes every element: drops the active buffer (after the pending merge) and clears the table.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::clear()
+    {
+        std::unique_lock< std::mutex > lock( m_mutex );
+        m_cv.wait( lock, [this] { return not m_pending; } );
+        m_active->clear();
+        std::lock_guard< RwLock > table_lock( m_table_lock );
+        m_table.clear();
+    }
+
+    /*!
+     * @brief Number of buffered writes not yet merged, in both buffers.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	typename BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::pending() const
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        return m_active->size() + ( m_pending ? m_merging->size() : 0 );
+    }
+
+    /*!
+     * @brief Merge counters so far.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	WriteBufferStats BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::stats() const
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        return m_stats;
+    }
+
+    /*!
+     * @brief Swaps the buffers and wakes the merge thread up (m_mutex held, no merge pending).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::hand_over()
+    {
+        std::swap( m_active, m_merging );
+        m_pending = true;
+        m_cv.notify_all();
+    }
+
+    /*!
+     * @brief Body of the merge thread: merges each buffer handed over, until the destructor stops it.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::merge_loop()
+    {
+        std::unique_lock< std::mutex > lock( m_mutex );
+        for (;;) {
+            m_cv.wait( lock, [this] { return m_pending or m_stop; } );
+            if (not m_pending) return;
+            lock.unlock();
+            merge( *m_merging );   // Writers only touch m_active; readers only read m_merging.
+            lock.lock();
+            m_stats.merges++;
+            m_stats.merged += m_merging->size();
+            m_merging->clear();
+            m_pending = false;
+            m_cv.notify_all();
+        }
+    }
+
+    /*!
+     * @brief Applies a buffer to the table. The table grows once for all of its inserts;
+     * then the writes are applied in bucket order, MERGE_SLICE at a time under the
+     * write lock, so that readers of the table are held up for one slice at most.
+     * @param buffer_ the buffer being merged (left as is: readers may still look into it).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void BufferedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::merge( WriteBuffer & buffer_ )
+    {
+        const auto & log = buffer_.log();
+        size_type inserts{0};
+        for (const auto & d : log) inserts += d.m_erased ? 0 : 1;
+        size_type buckets;
+        {
+            std::lock_guard< RwLock > lock( m_table_lock );
+            auto needed = m_table.size() + inserts;
+            if (needed > m_table.bucket_count() * m_table.max_load_factor())
+                m_table.reserve( std::max( needed, 2 * m_table.size() ) );   // Doubling, as insert() does: not one rehash per merge.
+            buckets = m_table.bucket_count();   // Only this thread changes the table while a merge is pending.
+        }
+
+        std::vector< std::uint32_t > order( log.size() );
+        for (std::uint32_t i{0}; i < order.size(); i++) order[i] = i;
+        std::sort( order.begin(), order.end(), [&]( std::uint32_t a, std::uint32_t b ) {
+            return log[a].m_hash % buckets < log[b].m_hash % buckets;
+        } );
+
+        using entry_type = typename table_type::entry_type;
+        std::vector< std::pair< size_type, entry_type > > slice;
+        slice.reserve( std::min< size_type >( MERGE_SLICE, log.size() ) );
+        for (size_type first{0}; first < order.size(); first += MERGE_SLICE) {
+            auto last = std::min< size_type >( first + MERGE_SLICE, order.size() );
+            slice.clear();
+            for (auto i = first; i < last; i++) {
+                const Delta & d = log[ order[i] ];
+                if (not d.m_erased) slice.emplace_back( d.m_hash, entry_type( d.m_key, d.m_data ) );
+            }
+            std::lock_guard< RwLock > lock( m_table_lock );
+            m_table.insert_hashed( slice.begin(), slice.end() );
+            for (auto i = first; i < last; i++) {
+                const Delta & d = log[ order[i] ];
+                if (d.m_erased) m_table.erase( d.m_key );
+            }
+        }
+    }
+
+} // Namespace ac.
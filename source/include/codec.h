@@ -0,0 +1,101 @@
+/*!
+ * @file codec.h
+ * Compact binary encoding of keys and data, for logs and wire formats.
+ */
+#ifndef _CODEC_H_
+#define _CODEC_H_
+
+#include <cstdint>     // uint32_t
+#include <cstring>     // memcpy
+#include <string>
+#include <tuple>
+#include <type_traits> // is_arithmetic, enable_if
+#include <utility>     // std::pair
+
+namespace ac // Associative container
+{
+    /// Binary encoding of a T: `encode(out, v)` appends v to out; `decode(p, end, v)`
+    /// reads v from [p, end), advances p and returns false if the input is too short.
+    /*! Specialize it for other types (see Account in driver/account.h). Encodings use
+     *  the host byte order: they are meant for files read back on the same machine.
+     */
+    template< class T, class Enable = void >
+    struct Codec;
+
+    /// Arithmetic types: their bytes.
+    template< class T >
+    struct Codec< T, typename std::enable_if< std::is_arithmetic< T >::value >::type > {
+        static void encode( std::string & out_, const T & v_ ) {
+            out_.append( reinterpret_cast< const char * >( &v_ ), sizeof( T ) );
+        }
+        static bool decode( const char *& p_, const char * end_, T & v_ ) {
+            if (end_ - p_ < static_cast< std::ptrdiff_t >( sizeof( T ) )) return false;
+            std::memcpy( &v_, p_, sizeof( T ) );
+            p_ += sizeof( T );
+            return true;
+        }
+    };
+
+    /// Strings: 32-bit length, then the characters.
+    template<>
+    struct Codec< std::string > {
+        static void encode( std::string & out_, const std::string & v_ ) {
+            Codec< std::uint32_t >::encode( out_, static_cast< std::uint32_t >( v_.size() ) );
+            out_ += v_;
+        }
+        static bool decode( const char *& p_, const char * end_, std::string & v_ ) {
+            std::uint32_t len;
+            if (not Codec< std::uint32_t >::decode( p_, end_, len ) or end_ - p_ < len) return false;
+            v_.assign( p_, len );
+            p_ += len;
+            return true;
+        }
+    };
+
+    namespace detail {
+        // Encodes/decodes the elements I.. of a tuple, in order.
+        template< std::size_t I, std::size_t N >
+        struct TupleCodec {
+            template< class Tuple >
+            static void encode( std::string & out_, const Tuple & t_ ) {
+                Codec< typename std::tuple_element< I, Tuple >::type >::encode( out_, std::get< I >( t_ ) );
+                TupleCodec< I + 1, N >::encode( out_, t_ );
+            }
+            template< class Tuple >
+            static bool decode( const char *& p_, const char * end_, Tuple & t_ ) {
+                return Codec< typename std::tuple_element< I, Tuple >::type >::decode( p_, end_, std::get< I >( t_ ) ) and
+                       TupleCodec< I + 1, N >::decode( p_, end_, t_ );
+            }
+        };
+        template< std::size_t N >
+        struct TupleCodec< N, N > {
+            template< class Tuple > static void encode( std::string &, const Tuple & ) {}
+            template< class Tuple > static bool decode( const char *&, const char *, Tuple & ) { return true; }
+        };
+    } // namespace detail
+
+    /// Tuples (e.g. Account::AcctKey): the elements, in order.
+    template< class... Ts >
+    struct Codec< std::tuple< Ts... > > {
+        static void encode( std::string & out_, const std::tuple< Ts... > & v_ ) {
+            detail::TupleCodec< 0, sizeof...( Ts ) >::encode( out_, v_ );
+        }
+        static bool decode( const char *& p_, const char * end_, std::tuple< Ts... > & v_ ) {
+            return detail::TupleCodec< 0, sizeof...( Ts ) >::decode( p_, end_, v_ );
+        }
+    };
+
+    /// Pairs: first, then second.
+    template< class A, class B >
+    struct Codec< std::pair< A, B > > {
+        static void encode( std::string & out_, const std::pair< A, B > & v_ ) {
+            Codec< A >::encode( out_, v_.first );
+            Codec< B >::encode( out_, v_.second );
+        }
+        static bool decode( const char *& p_, const char * end_, std::pair< A, B > & v_ ) {
+            return Codec< A >::decode( p_, end_, v_.first ) and Codec< B >::decode( p_, end_, v_.second );
+        }
+    };
+
+} // namespace ac
+#endif
@@ -0,0 +1,142 @@
+/*!
+ * @file compressed_hashtbl.h
+ * HashTbl whose data is kept compressed in blocks, decompressed on access through a small cache.
+ */
+#ifndef _COMPRESSED_HASHTBL_H_
+#define _COMPRESSED_HASHTBL_H_
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>    // std::out_of_range
+#include <string>
+#include <vector>
+
+#include "block_codec.h"
+#include "hashtbl.h"
+
+namespace ac // Associative container
+{
+    /// Counters of a CompressedHashTbl.
+    struct CompressionStats {
+        std::size_t hits = 0;     //!< Accesses to a block already in the cache.
+        std::size_t misses = 0;   //!< Accesses that decompressed a block.
+        std::size_t writes = 0;   //!< Dirty blocks compressed back.
+
+        double hit_ratio() const { return hits + misses == 0 ? 0.0 : double( hits ) / ( hits + misses ); }
+    };
+
+    /// A hash table for data that is mostly cold: the keys live in a HashTbl, the data in
+    /// compressed blocks.
+    /*! The index maps each key to a slot of a block. A new key goes to the open block of
+     *  its hash range, so a block groups the data of neighbouring hashes; once full, the
+     *  range opens a new block. Ranges double as the table grows, like buckets do, and
+     *  no data moves when they do: a slot never changes while its key is stored. A
+     *  block is encoded column by column with BlockCodec< DataType > (for accounts:
+     *  dictionary-encoded names and bit-packed codes). The string dictionary is a
+     *  StringPool of the table; a string stays in it once interned, even after the
+     *  data that held it is erased, so it grows with the distinct strings ever stored.
+     *
+     *  Any access to the data decompresses its whole block into one of cache_blocks_
+     *  frames, replaced by CLOCK; writes change the frame, which is compressed back when
+     *  it is evicted or on flush(). Data is returned by value: a reference would not
+     *  survive the next eviction. Blocks with erased slots are refilled before new blocks
+     *  are opened.
+     *  Not thread-safe, not even lookups: they load blocks into the cache.
+     */
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class CompressedHashTbl {
+        public:
+            using size_type = std::size_t;
+            using codec_type = BlockCodec< DataType >;
+            //! Where the data of a key is: block and position in the block.
+            struct Slot {
+                std::uint32_t m_block;
+                std::uint32_t m_pos;
+            };
+            using index_type = HashTbl< KeyType, Slot, KeyHash, KeyEqual >;
+
+            // Blocks of up to block_values_ data, cache_blocks_ of them decompressed at a time,
+            // and an index of table_sz_ buckets.
+            explicit CompressedHashTbl( size_type block_values_ = 256, size_type cache_blocks_ = 16,
+                                        size_type table_sz_ = 1024 );
+            CompressedHashTbl( const CompressedHashTbl & ) = delete;
+            CompressedHashTbl & operator=( const CompressedHashTbl & ) = delete;
+
+            // Inserts an element, or replaces the data of its key; true if the key is new.
+            bool insert( const KeyType & key_, const DataType & data_ );
+            bool erase( const KeyType & key_ );
+            bool retrieve( const KeyType & key_, DataType & data_ ) const;
+            DataType at( const KeyType & key_ ) const;
+            // Returns 1 if key_ is stored; 0, otherwise.
+            size_type count( const KeyType & key_ ) const { return m_index.find( key_ ) != nullptr ? 1 : 0; }
+            // Calls f(data) on the data of key_, in its decompressed block; false if the key is not stored.
+            template< class Func >
+            bool modify( const KeyType & key_, Func f );
+            void clear();
+            size_type size() const { return m_index.size(); }
+            bool empty() const { return m_index.empty(); }
+
+            // Compresses every changed block in the cache (they stay cached).
+            void flush() const;
+            // Bytes of compressed data and of the string dictionary, plus the slots free for reuse.
+            size_type compressed_bytes() const;
+            size_type block_count() const { return m_blocks.size(); }
+            size_type cache_blocks() const { return m_frames.size(); }
+            CompressionStats stats() const { return m_stats; }
+            const index_type & index() const { return m_index; }
+
+        private:
+            static const std::uint32_t NONE = std::numeric_limits< std::uint32_t >::max();
+            static const unsigned MAX_RANGE_BITS = 24;
+            static const size_type RANGE_BLOCKS = 4;   //!< Full blocks per hash range before the ranges double.
+
+            //! A block of data, compressed unless it is in the cache with changes.
+            struct Block {
+                std::string m_bytes;                 //!< codec_type encoding of m_count values.
+                std::uint32_t m_count;               //!< Slots in use or free.
+                std::vector< std::uint32_t > m_free; //!< Erased slots.
+            };
+            //! A cache frame: the decompressed values of a block.
+            struct Frame {
+                std::uint32_t m_block;
+                bool m_dirty;
+                bool m_referenced;
+                std::vector< DataType > m_values;
+            };
+
+            // The values of block_, decompressed into a frame (marked dirty_ for a write).
+            std::vector< DataType > & values( std::uint32_t block_, bool dirty_ ) const;
+            // The frame to load a block into, after compressing back the block it held.
+            std::uint32_t victim() const;
+            // Compresses frame f_ back into its block.
+            void write_back( Frame & f_ ) const;
+            // Range of a hash: its top m_range_bits bits, mixed (Fibonacci hashing) as KeyHash may be the identity.
+            size_type range_of( size_type hash_ ) const {
+                return m_range_bits == 0 ? 0 : size_type( ( std::uint64_t( hash_ ) * 0x9E3779B97F4A7C15ull ) >> ( 64 - m_range_bits ) );
+            }
+            // A slot for the data of a new key of hash hash_.
+            Slot allocate( size_type hash_ );
+            void grow_ranges();
+            size_type live( const Block & b_ ) const { return b_.m_count - b_.m_free.size(); }
+
+            index_type m_index;
+            size_type m_block_values;
+            // The cache is logically const: lookups load blocks into it and compress back the one they evict.
+            mutable std::vector< Block > m_blocks;
+            std::vector< std::uint32_t > m_reusable;           //!< Blocks erase() freed slots in, refilled before new ones open.
+            mutable std::vector< Frame > m_frames;
+            mutable std::vector< std::uint32_t > m_frame_of;   //!< Frame of each block, or NONE.
+            mutable size_type m_hand = 0;                      //!< CLOCK hand.
+            mutable CompressionStats m_stats;
+            mutable std::string m_scratch;                     //!< Encoding buffer.
+            mutable StringPool m_strings;                      //!< Dictionary of the string columns.
+            std::vector< std::uint32_t > m_open;               //!< Open block of each hash range, or NONE.
+            unsigned m_range_bits = 0;
+    };
+
+} // namespace ac
+#include "compressed_hashtbl.inl"
+#endif
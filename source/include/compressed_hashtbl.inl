@@ -0,0 +1,306 @@
+#include "compressed_hashtbl.h"
+
+namespace ac {
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	const std::uint32_t CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::NONE;
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	const unsigned CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::MAX_RANGE_BITS;
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	const std::size_t CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::RANGE_BLOCKS;
+
+    /*!
+     * @brief Constructs an empty table.
+     * @param block_values_ the data stored per block (at least 1).
+     * @param cache_blocks_ the blocks kept decompressed (at least 1).
+     * @param table_sz_ the initial buckets of the key index.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::CompressedHashTbl( size_type block_values_, size_type cache_blocks_,
+                                                                           size_type table_sz_ )
+        : m_index( table_sz_ ), m_block_values{ block_values_ > 0 ? block_values_ : 1 },
+          m_frames( cache_blocks_ > 0 ? cache_blocks_ : 1 ), m_open( 1, NONE )
+    {
+        for (auto & f : m_frames) {
+            f.m_block = NONE;
+            f.m_dirty = f.m_referenced = false;
+        }
+    }
+
+    /*!
+     * @brief Inserts an element, or replaces the data of its key.
+     * @param key_ element key to be inserted.
+     * @param data_ element data to be inserted.
+     * @return true if a new element was inserted; false if the key's data was overwritten.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	bool CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert( const KeyType & key_, const DataType & data_ )
+    {
+        const Slot * stored = m_index.find( key_ );
+        if (stored != nullptr) {
+            values( stored->m_block, true )[ stored->m_pos ] = data_;
+            return false;
+        }
+        if (m_index.size() >= m_open.size() * m_block_values * RANGE_BLOCKS and m_range_bits < MAX_RANGE_BITS)
+            grow_ranges();
+        KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+        Slot slot = allocate( hashFunc( key_ ) );
+        auto & vals = values( slot.m_block, true );
+        Block & block = m_blocks[ slot.m_block ];
+        if (slot.m_pos == block.m_count) {
+            vals.push_back( data_ );
+            block.m_count++;
+        }
+        else vals[ slot.m_pos ] = data_;
+        m_index.insert( key_, slot );
+        return true;
+    }
+
+    /*!
+     * @brief Removes an element. Its slot is reused by a later insert; a block left with
+     * no data releases its bytes.
+     * @param key_ key of the element to be removed.
+     * @return true if the key was found; false otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	bool CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::erase( const KeyType & key_ )
+    {
+        const Slot * stored = m_index.find( key_ );
+        if (stored == nullptr) return false;
+        Slot slot = *stored;
+        m_index.erase( key_ );
+        Block & block = m_blocks[ slot.m_block ];
+        block.m_free.push_back( slot.m_pos );
+        if (block.m_free.size() == 1) m_reusable.push_back( slot.m_block );
+        if (live( block ) == 0) {
+            // Nothing left to decompress: drop the bytes, and the frame's values if it is cached.
+            std::string().swap( block.m_bytes );
+            std::vector< std::uint32_t >().swap( block.m_free );
+            block.m_count = 0;
+            if (m_frame_of[ slot.m_block ] != NONE) {
+                Frame & f = m_frames[ m_frame_of[ slot.m_block ] ];
+                f.m_values.clear();
+                f.m_dirty = false;
+            }
+        }
+        return true;
+    }
+
+    /*!
+     * @brief Retrieves the data of a key, decompressing its block unless it is cached.
+     * @param key_ key of the element.
+     * @param data_ receives the data.
+     * @return true if the key was found; false otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	bool CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::retrieve( const KeyType & key_, DataType & data_ ) const
+    {
+        const Slot * stored = m_index.find( key_ );
+        if (stored == nullptr) return false;
+        data_ = values( stored->m_block, false )[ stored->m_pos ];
+        return true;
+    }
+
+    /*!
+     * @brief Returns a copy of the data of a key.
+     * If the key is not in the table, the method throws an exception of type std::out_of_range.
+     * @param key_ key of the element.
+     * @return the data.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	DataType CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::at( const KeyType & key_ ) const
+    {
+        DataType data;
+        if (not retrieve( key_, data ))
+            throw std::out_of_range("[CompressedHashTbl::at()]: key doesn't exist in the hash table.");
+        return data;
+    }
+
+    /*!
+     * @brief Changes the data of an element in its decompressed block.
+     * @param key_ key of the element to be changed.
+     * @param f callable taking a DataType &.
+     * @return true if the key was found; false otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Func >
+	bool CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::modify( const KeyType & key_, Func f )
+    {
+        const Slot * stored = m_index.find( key_ );
+        if (stored == nullptr) return false;
+        f( values( stored->m_block, true )[ stored->m_pos ] );
+        return true;
+    }
+
+    /*!
+     * @brief Removes every element and releases the blocks and the string dictionary.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::clear()
+    {
+        m_index.clear();
+        m_blocks.clear();
+        m_reusable.clear();
+        m_frame_of.clear();
+        for (auto & f : m_frames) {
+            f.m_block = NONE;
+            f.m_dirty = f.m_referenced = false;
+            f.m_values.clear();
+        }
+        m_open.assign( 1, NONE );
+        m_range_bits = 0;
+        m_strings = StringPool();
+    }
+
+    /*!
+     * @brief Compresses back every cached block with changes. The blocks stay cached.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::flush() const
+    {
+        for (auto & f : m_frames)
+            if (f.m_dirty) write_back( f );
+    }
+
+    /*!
+     * @brief Measures the memory of the blocks: compressed bytes, free-slot lists and the
+     * string dictionary.
+     * Changes still in the cache are not counted until they are compressed (see flush()).
+     * @return the bytes allocated for the blocks.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	typename CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::compressed_bytes() const
+    {
+        size_type bytes = m_blocks.capacity() * sizeof( Block ) + m_strings.bytes();
+        for (const auto & b : m_blocks)
+            bytes += b.m_bytes.capacity() + b.m_free.capacity() * sizeof( std::uint32_t );
+        return bytes;
+    }
+
+    /*!
+     * @brief Finds the decompressed values of a block, loading the block into a frame if needed.
+     * @param block_ the block.
+     * @param dirty_ true if the caller is going to change the values.
+     * @return the values of the block, valid until the next load of another block.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	std::vector< DataType > & CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::values( std::uint32_t block_, bool dirty_ ) const
+    {
+        auto f = m_frame_of[ block_ ];
+        if (f != NONE) {
+            m_stats.hits++;
+        }
+        else {
+            m_stats.misses++;
+            f = victim();
+            Frame & frame = m_frames[f];
+            const Block & block = m_blocks[ block_ ];
+            frame.m_values.resize( block.m_count );
+            const char * p = block.m_bytes.data();
+            if (block.m_count > 0 and not codec_type::decode( p, p + block.m_bytes.size(), frame.m_values, m_strings ))
+                throw std::runtime_error( "[CompressedHashTbl]: block " + std::to_string( block_ ) + " is corrupt." );
+            frame.m_block = block_;
+            frame.m_dirty = false;
+            m_frame_of[ block_ ] = f;
+        }
+        Frame & frame = m_frames[f];
+        frame.m_referenced = true;
+        frame.m_dirty = frame.m_dirty or dirty_;
+        return frame.m_values;
+    }
+
+    /*!
+     * @brief Picks the frame to load a block into: a free one, or the first unreferenced
+     * one the CLOCK hand reaches (clearing the reference bits it passes). The block it
+     * held is compressed back if it changed.
+     * @return the frame, no longer holding any block.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	std::uint32_t CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::victim() const
+    {
+        for (;;) {
+            Frame & f = m_frames[ m_hand ];
+            auto chosen = std::uint32_t( m_hand );
+            m_hand = ( m_hand + 1 ) % m_frames.size();
+            if (f.m_block != NONE and f.m_referenced) {
+                f.m_referenced = false;   // Second chance.
+                continue;
+            }
+            if (f.m_block != NONE) {
+                if (f.m_dirty) write_back( f );
+                m_frame_of[ f.m_block ] = NONE;
+                f.m_block = NONE;
+            }
+            return chosen;
+        }
+    }
+
+    /*!
+     * @brief Compresses the values of a frame into its block. Erased slots are reset to
+     * DataType{} first, so that stale data does not take room in the block.
+     * @param f_ the frame; it stays loaded, and clean.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::write_back( Frame & f_ ) const
+    {
+        Block & block = m_blocks[ f_.m_block ];
+        for (auto pos : block.m_free) f_.m_values[ pos ] = DataType{};
+        m_scratch.clear();
+        codec_type::encode( m_scratch, f_.m_values, m_strings );
+        std::string( m_scratch ).swap( block.m_bytes );   // A copy sized to fit.
+        f_.m_dirty = false;
+        m_stats.writes++;
+    }
+
+    /*!
+     * @brief Chooses the slot of a new key: a free slot of its hash range's open block, or
+     * the next one past its end. When that block is full, the range opens a block that
+     * erase() freed slots in, or a new one.
+     * @param hash_ KeyHash value of the key.
+     * @return the slot. A free slot is taken off its block's list; a slot past the end is
+     * not counted in the block yet: the caller appends the data.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	typename CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::Slot
+    CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::allocate( size_type hash_ )
+    {
+        auto & open = m_open[ range_of( hash_ ) ];
+        for (;;) {
+            if (open != NONE) {
+                Block & block = m_blocks[ open ];
+                if (not block.m_free.empty()) {
+                    Slot slot{ open, block.m_free.back() };
+                    block.m_free.pop_back();
+                    return slot;
+                }
+                if (block.m_count < m_block_values) return Slot{ open, block.m_count };
+            }
+            if (m_reusable.empty()) break;
+            // A block listed by erase() may have been refilled since, as another range's open block.
+            open = m_reusable.back();
+            m_reusable.pop_back();
+        }
+        if (m_blocks.size() >= NONE)
+            throw std::length_error( "[CompressedHashTbl]: too many blocks." );
+        open = std::uint32_t( m_blocks.size() );
+        m_blocks.push_back( Block{ std::string(), 0, std::vector< std::uint32_t >() } );
+        m_frame_of.push_back( NONE );
+        return Slot{ open, 0 };
+    }
+
+    /*!
+     * @brief Doubles the hash ranges. Both halves of a range keep its open block; no data moves.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void CompressedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::grow_ranges()
+    {
+        std::vector< std::uint32_t > ranges( m_open.size() * 2 );
+        for (size_type r{0}; r < m_open.size(); ++r)
+            ranges[ 2 * r ] = ranges[ 2 * r + 1 ] = m_open[r];
+        m_open.swap( ranges );
+        m_range_bits++;
+    }
+
+} // Namespace ac.
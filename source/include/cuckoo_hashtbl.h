@@ -0,0 +1,121 @@
+/*!
+ * @file cuckoo_hashtbl.h
+ * Bucketized cuckoo hash table: two candidate buckets of four slots per key.
+ */
+#ifndef _CUCKOO_HASHTBL_H_
+#define _CUCKOO_HASHTBL_H_
+
+#include <algorithm>    // std::sort
+#include <iostream>     // ostream
+#include <cstdint>      // uint8_t, uint64_t
+#include <initializer_list>
+#include <memory>
+#include <new>          // placement new
+#include <stdexcept>    // std::out_of_range, std::length_error
+#include <type_traits>  // aligned_storage
+#include <vector>
+
+#include "hashtbl.h"
+
+namespace ac // Associative container
+{
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class CuckooHashTbl {
+        public:
+            // Aliases
+            using entry_type = HashEntry<KeyType,DataType>;
+            using size_type = std::size_t;
+
+            static constexpr size_type SLOTS = 4;      //!< Slots per bucket.
+            static constexpr size_type STASH_SIZE = 4; //!< Most entries that may overflow; one more means a rehash.
+
+            explicit CuckooHashTbl( size_type table_sz_ = DEFAULT_SIZE );
+            CuckooHashTbl( const CuckooHashTbl& );
+            CuckooHashTbl( const std::initializer_list< entry_type > & );
+            CuckooHashTbl& operator=( const CuckooHashTbl& );
+            CuckooHashTbl& operator=( const std::initializer_list< entry_type > & );
+
+            virtual ~CuckooHashTbl();
+
+            // Throws std::length_error (see insert()) when too many keys share a hash value.
+            bool insert( const KeyType &, const DataType & );
+            bool retrieve( const KeyType &, DataType & ) const;
+            bool erase( const KeyType & );
+            void clear();
+            bool empty() const { return m_count == 0; };
+            inline size_type size() const { return m_count; };
+            DataType& at( const KeyType& );
+            DataType& operator[]( const KeyType& );
+            // Returns 1 if the key is stored in the table; 0, otherwise.
+            size_type count( const KeyType& ) const;
+            // Makes room for n elements without triggering a rehash().
+            void reserve( size_type );
+            // Returns the number of buckets (each one holds SLOTS entries).
+            size_type bucket_count() const { return m_buckets; };
+            // Calls f(entry) for every element of the table.
+            template< class Func >
+            void for_each( Func ) const;
+            // Returns the maximum load factor of the hash table.
+            float max_load_factor() const { return m_max_load_factor; };
+            // Changes the maximum load factor of the hash table.
+            void max_load_factor(float mlf) { m_max_load_factor = mlf; };
+
+            //* Generates a textual representation of the table and its elements.
+            friend std::ostream & operator<<( std::ostream & os_, const CuckooHashTbl & ht_ ) {
+                ht_.for_each( [&os_]( const entry_type & e ) { os_ << e << '\n'; } );
+                return os_;
+            }
+
+        private:
+            using storage_type = typename std::aligned_storage< sizeof(entry_type), alignof(entry_type) >::type;
+
+            //! Per-bucket metadata: one tag byte per slot, 0 meaning empty. 16 buckets per cache line.
+            struct Bucket {
+                std::uint8_t m_tags[SLOTS];
+            };
+
+            //! Where a key lives: slot index in m_slots, or position in m_stash when stashed.
+            struct Location { bool found; bool stashed; size_type index; };
+
+            static std::uint64_t mix( std::uint64_t );
+            static std::uint8_t tag_of( std::uint64_t h_ ) { return std::uint8_t( h_ >> 56 ) | 1; };
+            size_type first_bucket( std::uint64_t h_ ) const { return size_type( h_ ) & m_mask; };
+            size_type second_bucket( std::uint64_t ) const;
+
+            Location locate( const KeyType &, std::uint64_t ) const;
+            entry_type & entry( const Location & l_ ) { return l_.stashed ? m_stash[l_.index].second : slot( l_.index ); };
+            // Stores a new entry (in a slot, in the stash, or after a rehash()) and counts it.
+            Location add( std::uint64_t, entry_type && );
+            Location place( std::uint64_t, entry_type && );
+            bool displace( size_type, size_type );
+            void put( size_type, std::uint64_t, entry_type && );
+            entry_type & slot( size_type i ) { return *reinterpret_cast< entry_type * >( &m_slots[i] ); };
+            const entry_type & slot( size_type i ) const { return *reinterpret_cast< const entry_type * >( &m_slots[i] ); };
+            void allocate( size_type );
+            void destroy();
+            void rehash( size_type );
+            // Moves every entry, with its hash, out of the slots and the stash into items_.
+            void take_all( std::vector< std::pair<std::uint64_t, entry_type> > & items_ );
+            void copy_from( const CuckooHashTbl& );
+            // A mostly empty table that still overflows holds keys of equal hash values:
+            // a larger table would not separate them either.
+            bool can_grow() const { return m_count * 4 >= m_buckets * SLOTS; };
+
+        private:
+            size_type m_buckets;  //!< Number of buckets, a power of two.
+            size_type m_mask;     //!< m_buckets - 1.
+            size_type m_count;    //!< Numero de elementos na tabela.
+            float m_max_load_factor = 0.9; //!< Fraction of the slots that may be used before a rehash().
+            std::unique_ptr<Bucket[]> m_meta;              //!< Tags, probed before any entry is read.
+            std::unique_ptr<storage_type[]> m_slots;       //!< Entries; slot i belongs to bucket i / SLOTS.
+            std::unique_ptr<std::uint64_t[]> m_hashes;     //!< Mixed hash of each slot, used to displace it.
+            std::vector< std::pair<std::uint64_t, entry_type> > m_stash; //!< Entries no bucket could take.
+            static const short DEFAULT_SIZE = 16;
+    };
+
+} // namespace ac
+#include "cuckoo_hashtbl.inl"
+#endif
@@ -0,0 +1,519 @@
+#include "cuckoo_hashtbl.h"
+
+namespace ac {
+    template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    constexpr typename CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::SLOTS;
+
+    template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    constexpr typename CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::STASH_SIZE;
+
+    /*!
+     * @brief Regular constructor of a cuckoo hash table.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function received by the client.
+     * @param sz number of elements the table must hold; the bucket count is the smallest
+     * power of two with at least sz slots.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::CuckooHashTbl( size_type sz )
+        : m_count{0}
+	{
+        size_type buckets{2};
+        while (buckets * SLOTS < sz) buckets <<= 1;
+        allocate( buckets );
+	}
+
+    /*!
+     * @brief Copy constructor from another cuckoo hash table.
+     * @param source the hash table that will be copied.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::CuckooHashTbl( const CuckooHashTbl& source )
+        : m_count{0}
+	{
+        copy_from( source );
+	}
+
+    /*!
+     * @brief Constructor from an initializer list.
+     * @param ilist the initializer list that the data of the elements will be copied.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::CuckooHashTbl( const std::initializer_list<entry_type>& ilist )
+        : CuckooHashTbl( ilist.size() )
+    {
+        for (const auto & e : ilist)
+            insert( e.m_key, e.m_data );
+    }
+
+    /*!
+     * @brief Assignment operator with another cuckoo hash table.
+     * @param clone the hash table that will be copied.
+     * @return the hash table with the same elements as the copied hash table.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>&
+    CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::operator=( const CuckooHashTbl& clone )
+    {
+        if (this != &clone) {
+            destroy();
+            copy_from( clone );
+        }
+        return *this;
+    }
+
+    /*!
+     * @brief Assignment operator with an initializer list.
+     * @param ilist the initializer list that the data of the elements will be copied.
+     * @return the hash table with the data of the elements of the initializer list.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>&
+    CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::operator=( const std::initializer_list< entry_type >& ilist )
+    {
+        clear();
+        reserve( ilist.size() );
+        for (const auto & e : ilist)
+            insert( e.m_key, e.m_data );
+        return *this;
+    }
+
+    /*!
+     * @brief Destroy the CuckooHashTbl object.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::~CuckooHashTbl( )
+	{
+        destroy(); // The slots hold raw storage, so entries are destroyed by hand.
+	}
+
+    /*!
+     * @brief Inserts into the table the information contained in new_data_ and associated with a key key_.
+     * A key that finds both candidate buckets full displaces entries to their other bucket
+     * (breadth-first search for the shortest path to a free slot). If there is no such
+     * path the entry goes to the stash; when the stash is full, the table doubles and the
+     * insert starts over, so lookups never scan more than STASH_SIZE stashed entries.
+     * @param key_ element key to be inserted.
+     * @param new_data_ element data to be inserted.
+     * @return true if a new element was inserted in the table.
+     * @return false if the key already exists and the data has just been overwritten.
+     * @throw std::length_error if the stash is full and the table mostly empty: too many keys
+     * share a hash value for any table size to separate them. The elements stay as they were.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	bool CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert( const KeyType & key_, const DataType & new_data_ )
+    {
+        auto h = mix( KeyHash{}( key_ ) );
+        auto loc = locate( key_, h );
+        if (loc.found) {
+            entry( loc ).m_data = new_data_;
+            return false;
+        }
+        add( h, entry_type{ key_, new_data_ } );
+        return true;
+    }
+
+    /*!
+     * @brief Stores an entry whose key is not in the table, growing the table first if
+     * the load factor requires it (see insert()).
+     * @param h_ mixed hash of the key.
+     * @param entry_ the new entry.
+     * @return where the entry went.
+     * @throw std::length_error as insert() does; the elements stay as they were.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::Location
+    CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::add( std::uint64_t h_, entry_type && entry_ )
+    {
+        if (m_count + 1 > m_max_load_factor * m_buckets * SLOTS)
+            rehash( m_buckets * 2 );
+        Location loc;
+        while (not ( loc = place( h_, std::move( entry_ ) ) ).found) {
+            if (m_stash.size() < STASH_SIZE) {
+                m_stash.emplace_back( h_, std::move( entry_ ) );
+                loc = Location{ true, true, m_stash.size() - 1 };
+                break;
+            }
+            if (not can_grow())
+                throw std::length_error( "[CuckooHashTbl::insert()]: too many keys share a hash value." );
+            rehash( m_buckets * 2 );
+        }
+        m_count++;
+        return loc;
+    }
+
+    /*!
+     * @brief Clears the data table.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::clear()
+    {
+        destroy();
+        m_stash.clear();
+        m_count = 0;
+    }
+
+    /*!
+     * @brief Retrieves a data item from the table. Reads the tags of the two candidate
+     * buckets and the entries whose tag matches; the stash only when it is not empty.
+     * @param key_ Data key to search for in the table.
+     * @param data_item_ Data record to be filled in when data item is found.
+     * @return true if the data item is found; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::retrieve( const KeyType & key_, DataType & data_item_ ) const
+    {
+        auto loc = locate( key_, mix( KeyHash{}( key_ ) ) );
+        if (not loc.found)
+            return false;
+        data_item_ = loc.stashed ? m_stash[loc.index].second.m_data : slot( loc.index ).m_data;
+        return true;
+    }
+
+    /*!
+     * @brief Removes a table item identified by its key_ key. The freed slot is offered
+     * to the stashed entries, if any.
+     * @param key_ the key of the element to be removed.
+     * @return true if key is found; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::erase( const KeyType & key_ )
+    {
+        auto loc = locate( key_, mix( KeyHash{}( key_ ) ) );
+        if (not loc.found)
+            return false;
+        m_count--;
+        if (loc.stashed) {
+            m_stash.erase( m_stash.begin() + loc.index );
+            return true;
+        }
+        slot( loc.index ).~entry_type();
+        m_meta[loc.index / SLOTS].m_tags[loc.index % SLOTS] = 0;
+        for (size_type i{0}; i < m_stash.size(); ) {
+            if (place( m_stash[i].first, std::move( m_stash[i].second ) ).found)
+                m_stash.erase( m_stash.begin() + i );
+            else
+                i++;
+        }
+        return true;
+    }
+
+    /*!
+     * @brief Returns 1 if key_ is in the table; 0, otherwise.
+     * @param key_ the key to be searched for.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::count( const KeyType & key_ ) const
+    {
+        return locate( key_, mix( KeyHash{}( key_ ) ) ).found ? 1 : 0;
+    }
+
+    /*!
+     * @brief Returns a reference to the data associated with the given key key_.
+     * If the key is not in the table, the method throws an exception of type std::out_of_range.
+     * @param key_ key that we look for the data.
+     * @return DataType& reference to the data associated with the given key.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    DataType& CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::at( const KeyType & key_ )
+    {
+        auto loc = locate( key_, mix( KeyHash{}( key_ ) ) );
+        if (not loc.found)
+            throw std::out_of_range("[CuckooHashTbl::at()]: key doesn't exist in the hash table.");
+        return entry( loc ).m_data;
+    }
+
+    /*!
+     * @brief Returns a reference to the data associated with the given key key_,
+     * inserting a default-constructed data first if the key is not in the table.
+     * One lookup either way: a new entry is used where add() stored it.
+     * @param key_ the given key.
+     * @return DataType& reference to the data associated with the given key.
+     * @throw std::length_error as insert() does.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    DataType& CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::operator[]( const KeyType & key_ )
+    {
+        auto h = mix( KeyHash{}( key_ ) );
+        auto loc = locate( key_, h );
+        if (not loc.found)
+            loc = add( h, entry_type{ key_, DataType{} } );
+        return entry( loc ).m_data;
+    }
+
+    /*!
+     * @brief Makes room for n_ elements, so that inserting them does not trigger a rehash()
+     * because of the load factor.
+     * @param n_ expected number of elements.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::reserve( size_type n_ )
+    {
+        size_type buckets{m_buckets};
+        while (n_ > m_max_load_factor * buckets * SLOTS) buckets <<= 1;
+        if (buckets != m_buckets)
+            rehash( buckets );
+    }
+
+    /*!
+     * @brief Visits every element: the bucket slots in order, then the stash.
+     * @param f called as f(const entry_type &) for each element.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Func >
+    void CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::for_each( Func f ) const
+    {
+        for (size_type i{0}; i < m_buckets * SLOTS; i++)
+            if (m_meta[i / SLOTS].m_tags[i % SLOTS] != 0)
+                f( slot( i ) );
+        for (const auto & e : m_stash)
+            f( e.second );
+    }
+
+    /*!
+     * @brief Finalizer of splitmix64; spreads any KeyHash output over all 64 bits.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    std::uint64_t CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::mix( std::uint64_t h_ )
+    {
+        h_ ^= h_ >> 30; h_ *= 0xbf58476d1ce4e5b9ull;
+        h_ ^= h_ >> 27; h_ *= 0x94d049bb133111ebull;
+        return h_ ^ ( h_ >> 31 );
+    }
+
+    /*!
+     * @brief The second candidate bucket. It differs from the first in the lowest bit at least.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::second_bucket( std::uint64_t h_ ) const
+    {
+        return ( first_bucket( h_ ) ^ ( size_type( h_ >> 32 ) | 1 ) ) & m_mask;
+    }
+
+    /*!
+     * @brief Finds key_ in its two buckets, then in the stash.
+     * @param key_ the key to be searched for.
+     * @param h_ mixed hash of key_.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::Location
+    CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::locate( const KeyType & key_, std::uint64_t h_ ) const
+    {
+        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
+        auto tag = tag_of( h_ );
+        size_type candidates[] = { first_bucket( h_ ), second_bucket( h_ ) };
+        for (auto b : candidates) {
+            for (size_type s{0}; s < SLOTS; s++) {
+                if (m_meta[b].m_tags[s] == tag and equalFunc( slot( b * SLOTS + s ).m_key, key_ ))
+                    return Location{ true, false, b * SLOTS + s };
+            }
+        }
+        for (size_type i{0}; i < m_stash.size(); i++) {
+            if (m_stash[i].first == h_ and equalFunc( m_stash[i].second.m_key, key_ ))
+                return Location{ true, true, i };
+        }
+        return Location{ false, false, 0 };
+    }
+
+    /*!
+     * @brief Stores an entry that is not in the table in one of its buckets, displacing
+     * other entries if needed. entry_ is left untouched when this fails.
+     * @return the slot of the entry; not found if no free slot is reachable.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::Location
+    CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::place( std::uint64_t h_, entry_type && entry_ )
+    {
+        size_type candidates[] = { first_bucket( h_ ), second_bucket( h_ ) };
+        for (auto b : candidates) {
+            for (size_type s{0}; s < SLOTS; s++) {
+                if (m_meta[b].m_tags[s] == 0) {
+                    put( b * SLOTS + s, h_, std::move( entry_ ) );
+                    return Location{ true, false, b * SLOTS + s };
+                }
+            }
+        }
+        if (not displace( candidates[0], candidates[1] ))
+            return Location{ false, false, 0 };
+        // displace() freed a slot in one of the candidates.
+        return place( h_, std::move( entry_ ) );
+    }
+
+    /*!
+     * @brief Breadth-first search from buckets b1_ and b2_ for an entry that can move to
+     * a free slot of its other bucket; then moves the entries along that path, which
+     * frees a slot in b1_ or b2_.
+     * @return true if a slot was freed.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::displace( size_type b1_, size_type b2_ )
+    {
+        constexpr size_type MAX_NODES = 512;
+        struct Node { size_type bucket; size_type parent; size_type parent_slot; };
+        std::vector< Node > nodes;
+        nodes.reserve( MAX_NODES );
+        nodes.push_back( Node{ b1_, MAX_NODES, 0 } );
+        nodes.push_back( Node{ b2_, MAX_NODES, 0 } );
+
+        auto visited = [&nodes]( size_type b ) {
+            for (const auto & n : nodes) if (n.bucket == b) return true;
+            return false;
+        };
+        for (size_type head{0}; head < nodes.size(); head++) {
+            auto b = nodes[head].bucket;
+            for (size_type s{0}; s < SLOTS; s++) {
+                auto from = b * SLOTS + s;
+                auto h = m_hashes[from];
+                auto alt = first_bucket( h ) == b ? second_bucket( h ) : first_bucket( h );
+                for (size_type t{0}; t < SLOTS; t++) {
+                    if (m_meta[alt].m_tags[t] != 0) continue;
+                    // Free slot found: shift the path, from its end back to the root.
+                    auto to = alt * SLOTS + t;
+                    auto node = head;
+                    for (;;) {
+                        put( to, m_hashes[from], std::move( slot( from ) ) );
+                        slot( from ).~entry_type();
+                        m_meta[from / SLOTS].m_tags[from % SLOTS] = 0;
+                        if (nodes[node].parent == MAX_NODES)
+                            return true;
+                        to = from;
+                        from = nodes[node].parent_slot;
+                        node = nodes[node].parent;
+                    }
+                }
+                if (nodes.size() < MAX_NODES and not visited( alt ))
+                    nodes.push_back( Node{ alt, head, from } );
+            }
+        }
+        return false;
+    }
+
+    /*!
+     * @brief Move-constructs an entry in the free slot i_.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::put( size_type i_, std::uint64_t h_, entry_type && entry_ )
+    {
+        ::new ( static_cast< void * >( &m_slots[i_] ) ) entry_type( std::move( entry_ ) );
+        m_meta[i_ / SLOTS].m_tags[i_ % SLOTS] = tag_of( h_ );
+        m_hashes[i_] = h_;
+    }
+
+    /*!
+     * @brief Allocates an empty table with buckets_ buckets (a power of two).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::allocate( size_type buckets_ )
+    {
+        m_buckets = buckets_;
+        m_mask = buckets_ - 1;
+        m_meta = std::unique_ptr<Bucket[]> (new Bucket[m_buckets]());
+        m_slots = std::unique_ptr<storage_type[]> (new storage_type[m_buckets * SLOTS]);
+        m_hashes = std::unique_ptr<std::uint64_t[]> (new std::uint64_t[m_buckets * SLOTS]);
+    }
+
+    /*!
+     * @brief Destroys every entry held in the bucket slots and marks the slots empty.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::destroy()
+    {
+        if (not m_meta) return;
+        for (size_type i{0}; i < m_buckets * SLOTS; i++) {
+            auto & tag = m_meta[i / SLOTS].m_tags[i % SLOTS];
+            if (tag != 0) {
+                slot( i ).~entry_type();
+                tag = 0;
+            }
+        }
+    }
+
+    /*!
+     * @brief Moves every element into a new table with buckets_ buckets. If more entries
+     * than the stash holds find no slot, the table doubles again, as long as growing may
+     * help (see can_grow()).
+     * @throw std::length_error if the entries still overflow the stash once the table is
+     * mostly empty, as insert() does. Every entry is then put back where it was: where an
+     * entry may go depends on its hash only, so entries of equal hash can trade places.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::rehash( size_type buckets_ )
+    {
+        const size_type STASHED = m_buckets * SLOTS;   // Position of a stashed entry in layout.
+        std::vector< std::pair<std::uint64_t, size_type> > layout;   // (hash, slot) of each entry, in that order.
+        layout.reserve( m_count );
+        for (size_type i{0}; i < m_buckets * SLOTS; i++)
+            if (m_meta[i / SLOTS].m_tags[i % SLOTS] != 0)
+                layout.emplace_back( m_hashes[i], i );
+        for (const auto & e : m_stash)
+            layout.emplace_back( e.first, STASHED );
+        const size_type old_buckets = m_buckets;
+
+        std::vector< std::pair<std::uint64_t, entry_type> > items;
+        items.reserve( m_count );
+        for (auto buckets = buckets_; ; buckets *= 2) {
+            take_all( items );
+            allocate( buckets );
+            for (auto & item : items)
+                if (not place( item.first, std::move( item.second ) ).found)
+                    m_stash.emplace_back( item.first, std::move( item.second ) );
+            items.clear();
+            if (m_stash.size() <= STASH_SIZE) return;
+            if (not can_grow()) break;
+        }
+
+        take_all( items );
+        allocate( old_buckets );
+        auto by_hash = []( const std::pair<std::uint64_t, size_type> & a, const std::pair<std::uint64_t, size_type> & b ) {
+            return a.first < b.first;
+        };
+        std::sort( layout.begin(), layout.end(), by_hash );
+        std::sort( items.begin(), items.end(), []( const std::pair<std::uint64_t, entry_type> & a,
+                                                   const std::pair<std::uint64_t, entry_type> & b ) { return a.first < b.first; } );
+        for (size_type j{0}; j < items.size(); j++) {
+            if (layout[j].second == STASHED) m_stash.emplace_back( items[j].first, std::move( items[j].second ) );
+            else put( layout[j].second, items[j].first, std::move( items[j].second ) );
+        }
+        throw std::length_error( "[CuckooHashTbl::rehash()]: too many keys share a hash value." );
+    }
+
+    /*!
+     * @brief Empties the table into items_, each entry with its mixed hash.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::take_all( std::vector< std::pair<std::uint64_t, entry_type> > & items_ )
+    {
+        for (size_type i{0}; i < m_buckets * SLOTS; i++)
+            if (m_meta[i / SLOTS].m_tags[i % SLOTS] != 0)
+                items_.emplace_back( m_hashes[i], std::move( slot( i ) ) );
+        for (auto & e : m_stash)
+            items_.emplace_back( e.first, std::move( e.second ) );
+        destroy();
+        m_stash.clear();
+    }
+
+    /*!
+     * @brief Makes this (empty) table an exact copy of source.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void CuckooHashTbl<KeyType,DataType,KeyHash,KeyEqual>::copy_from( const CuckooHashTbl& source )
+    {
+        allocate( source.m_buckets );
+        for (size_type i{0}; i < m_buckets * SLOTS; i++) {
+            if (source.m_meta[i / SLOTS].m_tags[i % SLOTS] != 0) {
+                ::new ( static_cast< void * >( &m_slots[i] ) ) entry_type( source.slot( i ) );
+                m_meta[i / SLOTS].m_tags[i % SLOTS] = source.m_meta[i / SLOTS].m_tags[i % SLOTS];
+                m_hashes[i] = source.m_hashes[i];
+            }
+        }
+        m_stash = source.m_stash;
+        m_count = source.m_count;
+        m_max_load_factor = source.m_max_load_factor;
+    }
+} // Namespace ac.
@@ -0,0 +1,136 @@
+/*!
+ * @file disk_hashtbl.h
+ * Extendible hash table over the pages of a local file, for tables larger than RAM.
+ */
+#ifndef _DISK_HASHTBL_H_
+#define _DISK_HASHTBL_H_
+
+#include <cstdint>
+#include <functional>   // std::hash, std::equal_to
+#include <memory>
+#include <stdexcept>    // std::runtime_error
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>      // open
+#include <unistd.h>     // close, pread
+
+#include "buffer_pool.h"
+
+namespace ac // Associative container
+{
+    /// A hash table kept in a file of PAGE_SIZE pages, of which a BufferPool holds the hot ones.
+    /*! Extendible hashing: a directory of 2^global_depth entries, indexed by the low
+     *  bits of the key hash, points to the bucket pages; a bucket of local depth d
+     *  holds the keys whose low d bits match its pattern, and is shared by the
+     *  2^(global_depth - d) directory entries that end in them. A full bucket is
+     *  split in two (doubling the directory only when d equals the global depth),
+     *  so an insert rewrites at most the two pages involved, never the whole table
+     *  as HashTbl::rehash() does. Keys whose hashes a split cannot tell apart go
+     *  to overflow pages chained to their bucket. Erases free slots but never merge
+     *  buckets.
+     *
+     *  Keys and data are stored by value, so both must be trivially copyable, and
+     *  KeyHash must give the same value in every run that opens the file. The
+     *  directory lives in memory: it is rebuilt by reading the bucket page headers
+     *  when an existing file is opened. Changes reach the file on flush() (and on
+     *  destruction), with no crash consistency; see wal.h for a logged table.
+     */
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class DiskHashTbl {
+        static_assert( std::is_trivially_copyable< KeyType >::value and std::is_trivially_copyable< DataType >::value,
+                       "DiskHashTbl stores keys and data by value in its pages" );
+
+        public:
+            using size_type = std::size_t;
+            static const size_type PAGE_SIZE = 4096;
+            static const unsigned MAX_DEPTH = 32;   //!< Directory bound: at most 2^32 entries.
+
+            // Opens the table file path_ (created if it does not exist; emptied if truncate_),
+            // caching pool_pages_ pages of it (at least 4). Throws std::runtime_error.
+            explicit DiskHashTbl( const std::string & path_, size_type pool_pages_ = 1024, bool truncate_ = false );
+            DiskHashTbl( const DiskHashTbl & ) = delete;
+            DiskHashTbl & operator=( const DiskHashTbl & ) = delete;
+            // Flushes the table and closes the file.
+            ~DiskHashTbl();
+
+            // Inserts or replaces; true if key_ was new.
+            bool insert( const KeyType & key_, const DataType & data_ );
+            bool retrieve( const KeyType & key_, DataType & data_ ) const;
+            bool erase( const KeyType & key_ );
+            // Returns 1 if key_ is stored; 0, otherwise.
+            size_type count( const KeyType & key_ ) const { DataType d; return retrieve( key_, d ) ? 1 : 0; }
+            size_type size() const { return m_count; }
+            bool empty() const { return m_count == 0; }
+            // Writes the dirty pages and the file header back to the file (no fsync).
+            void flush();
+
+            unsigned global_depth() const { return m_depth; }
+            // Pages of the file, the header page included.
+            size_type page_count() const { return m_pages; }
+            // Entries a bucket page holds.
+            static constexpr size_type slots_per_page() { return ( PAGE_SIZE - sizeof( PageHeader ) ) / sizeof( Slot ); }
+            const BufferPoolStats & pool_stats() const { return m_pool->stats(); }
+            void reset_pool_stats() { m_pool->reset_stats(); }
+
+        private:
+            //! Page 0.
+            struct FileHeader {
+                std::uint64_t m_magic;
+                std::uint32_t m_key_size, m_data_size, m_page_size, m_depth;
+                std::uint64_t m_count, m_pages;
+            };
+            //! Start of every other page.
+            struct PageHeader {
+                std::uint32_t m_depth;      //!< Local depth (bucket pages).
+                std::uint32_t m_count;      //!< Slots in use.
+                std::uint64_t m_pattern;    //!< Low m_depth bits of the hashes of the bucket.
+                std::uint64_t m_overflow;   //!< Next page of the chain; 0 ends it.
+                std::uint32_t m_is_overflow;
+                std::uint32_t m_unused;
+            };
+            struct Slot {
+                KeyType m_key;
+                DataType m_data;
+            };
+            static_assert( ( PAGE_SIZE - sizeof( PageHeader ) ) / sizeof( Slot ) >= 2, "a page must hold two entries" );
+            static const std::uint64_t MAGIC = 0x4C4254484B534944ull; // "DISKHTBL"
+
+            static PageHeader * head( const PinnedPage & p_ ) { return reinterpret_cast< PageHeader * >( p_.data() ); }
+            static Slot * slots( const PinnedPage & p_ ) { return reinterpret_cast< Slot * >( p_.data() + sizeof( PageHeader ) ); }
+            // KeyHash spread over 64 bits: the directory takes the low bits.
+            static std::uint64_t hash( const KeyType & key_ ) {
+                std::uint64_t h = KeyHash{}( key_ );
+                h ^= h >> 33; h *= 0xFF51AFD7ED558CCDull;
+                h ^= h >> 33; h *= 0xC4CEB9FE1A85EC53ull;
+                return h ^ ( h >> 33 );
+            }
+            std::uint64_t bucket_page( std::uint64_t h_ ) const { return m_dir[ h_ & ( ( std::uint64_t{1} << m_depth ) - 1 ) ]; }
+
+            // Finds key_ in the chain starting at page_ and calls found_(page, slot) while its page is pinned.
+            template< class Found >
+            bool locate( std::uint64_t page_, const KeyType & key_, Found found_ ) const;
+            // Stores an entry in the chain starting at page_, adding an overflow page if every page is full.
+            void append( std::uint64_t page_, const Slot & slot_ );
+            // Whether the full bucket at page_ should be split for an entry of hash h_.
+            bool can_split( std::uint64_t page_, std::uint64_t h_ );
+            void split( std::uint64_t page_ );
+            std::uint64_t new_page() { return m_pages++; }
+            void load();
+            void write_header();
+
+            int m_fd = -1;
+            std::unique_ptr< BufferPool > m_pool;   //!< Mutable through the pointer: lookups load pages.
+            std::vector< std::uint64_t > m_dir;     //!< Directory: hash suffix -> bucket page.
+            unsigned m_depth = 0;                   //!< Global depth.
+            size_type m_count = 0;
+            size_type m_pages = 0;
+    };
+
+} // namespace ac
+#include "disk_hashtbl.inl"
+#endif
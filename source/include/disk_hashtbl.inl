@@ -0,0 +1,282 @@
+#include "disk_hashtbl.h"
+
+namespace ac {
+    /*!
+     * @brief Opens (or creates) a table file.
+     * @tparam KeyType trivially copyable type of key stored in the table.
+     * @tparam DataType trivially copyable data type stored in the table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function received by the client.
+     * @param path_ the table file.
+     * @param pool_pages_ pages the buffer pool keeps in memory (at least 4: a split pins three).
+     * @param truncate_ whether to discard what the file holds.
+     * @throw std::runtime_error if the file cannot be opened, or is not a table of these types.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::DiskHashTbl( const std::string & path_, size_type pool_pages_, bool truncate_ )
+    {
+        m_fd = ::open( path_.c_str(), O_RDWR | O_CREAT | ( truncate_ ? O_TRUNC : 0 ), 0644 );
+        if (m_fd < 0)
+            throw std::runtime_error( "[DiskHashTbl]: " + path_ + ": " + std::strerror( errno ) );
+        try {
+            m_pool.reset( new BufferPool( m_fd, PAGE_SIZE, std::max< size_type >( pool_pages_, 4 ) ) );
+            if (::lseek( m_fd, 0, SEEK_END ) > 0) {
+                load();
+            }
+            else {
+                // An empty table: the header page and one bucket of depth 0 for every hash.
+                m_pages = 2;
+                m_dir.assign( 1, 1 );
+                PinnedPage first( *m_pool, 1, true );
+                PinnedPage header( *m_pool, 0, true );
+                write_header();
+            }
+        }
+        catch (const std::runtime_error & e) {
+            ::close( m_fd );
+            throw std::runtime_error( "[DiskHashTbl]: " + path_ + ": " + e.what() );
+        }
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::~DiskHashTbl()
+    {
+        try { flush(); }
+        catch (...) { /* A destructor cannot report it: call flush() to see the error. */ }
+        ::close( m_fd );
+    }
+
+    /*!
+     * @brief Inserts a new entry, or replaces the data of an existing key. When the bucket
+     * of the key is full it is split first, which moves about half of its entries to a new
+     * page and touches no other bucket.
+     * @param key_ the key of the entry.
+     * @param data_ the data of the entry.
+     * @return true if key_ was new; false, if its data was replaced.
+     * @throw std::runtime_error if a page cannot be read or written.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert( const KeyType & key_, const DataType & data_ )
+    {
+        const auto h = hash( key_ );
+        for (;;) {
+            const auto page = bucket_page( h );
+            auto replace = [&]( PinnedPage & p_, size_type s_ ) {
+                std::memcpy( static_cast< void * >( &slots( p_ )[s_].m_data ), &data_, sizeof( DataType ) );
+                p_.mark_dirty();
+            };
+            if (locate( page, key_, replace )) return false;
+            bool full;
+            {
+                PinnedPage p( *m_pool, page );
+                full = head( p )->m_count == slots_per_page();
+            }
+            if (full and can_split( page, h )) {
+                split( page );
+                continue;
+            }
+            Slot slot;
+            std::memcpy( static_cast< void * >( &slot.m_key ), &key_, sizeof( KeyType ) );
+            std::memcpy( static_cast< void * >( &slot.m_data ), &data_, sizeof( DataType ) );
+            append( page, slot );
+            m_count++;
+            return true;
+        }
+    }
+
+    /*!
+     * @brief Looks a key up; reads at most the pages of its bucket's chain.
+     * @param key_ the key to search for.
+     * @param data_ receives a copy of the data when the key is found.
+     * @return true if the key was found; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::retrieve( const KeyType & key_, DataType & data_ ) const
+    {
+        return locate( bucket_page( hash( key_ ) ), key_, [&]( PinnedPage & p_, size_type s_ ) {
+            std::memcpy( static_cast< void * >( &data_ ), &slots( p_ )[s_].m_data, sizeof( DataType ) );
+        } );
+    }
+
+    /*!
+     * @brief Removes the entry of a key: the last entry of its page takes the freed slot.
+     * @param key_ the key of the entry.
+     * @return true if the key was found and removed; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::erase( const KeyType & key_ )
+    {
+        auto remove = [&]( PinnedPage & p_, size_type s_ ) {
+            auto last = --head( p_ )->m_count;
+            if (s_ != last)
+                std::memcpy( static_cast< void * >( &slots( p_ )[s_] ), &slots( p_ )[last], sizeof( Slot ) );
+            p_.mark_dirty();
+        };
+        if (not locate( bucket_page( hash( key_ ) ), key_, remove )) return false;
+        m_count--;
+        return true;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::flush()
+    {
+        write_header();
+        m_pool->flush();
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Found >
+    bool DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::locate( std::uint64_t page_, const KeyType & key_, Found found_ ) const
+    {
+        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
+        while (page_ != 0) {
+            PinnedPage p( *m_pool, page_ );
+            auto ph = head( p );
+            auto sl = slots( p );
+            for (size_type s{0}; s < ph->m_count; s++) {
+                if (equalFunc( sl[s].m_key, key_ )) {
+                    found_( p, s );
+                    return true;
+                }
+            }
+            page_ = ph->m_overflow;
+        }
+        return false;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::append( std::uint64_t page_, const Slot & slot_ )
+    {
+        for (;;) {
+            PinnedPage p( *m_pool, page_ );
+            auto ph = head( p );
+            if (ph->m_count < slots_per_page()) {
+                std::memcpy( static_cast< void * >( &slots( p )[ ph->m_count++ ] ), &slot_, sizeof( Slot ) );
+                p.mark_dirty();
+                return;
+            }
+            if (ph->m_overflow == 0) {
+                auto next = new_page();
+                PinnedPage o( *m_pool, next, true );
+                auto oh = head( o );
+                oh->m_is_overflow = 1;
+                oh->m_depth = ph->m_depth;
+                oh->m_pattern = ph->m_pattern;
+                std::memcpy( static_cast< void * >( &slots( o )[0] ), &slot_, sizeof( Slot ) );
+                oh->m_count = 1;
+                ph->m_overflow = next;
+                p.mark_dirty();
+                return;
+            }
+            page_ = ph->m_overflow;
+        }
+    }
+
+    /*!
+     * @brief A bucket below the global depth can always split (the directory does not
+     * grow). At the global depth, the directory is only doubled if the next hash bit
+     * separates the entries of the full page and the new one: keys that share it would
+     * all land on one side, so they go to an overflow page instead.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::can_split( std::uint64_t page_, std::uint64_t h_ )
+    {
+        PinnedPage p( *m_pool, page_ );
+        auto ld = head( p )->m_depth;
+        if (ld < m_depth) return true;
+        if (ld >= MAX_DEPTH) return false;
+        const auto bit = std::uint64_t{1} << ld;
+        auto sl = slots( p );
+        for (size_type s{0}; s < head( p )->m_count; s++) {
+            if (( hash( sl[s].m_key ) & bit ) != ( h_ & bit )) return true;
+        }
+        return false;
+    }
+
+    /*!
+     * @brief Splits the bucket at page_ (of local depth d) into itself and a new page for
+     * the hashes whose bit d is set, and points half of its directory entries to the new page.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::split( std::uint64_t page_ )
+    {
+        PinnedPage old( *m_pool, page_ );
+        auto oh = head( old );
+        const auto ld = oh->m_depth;
+        if (ld == m_depth) {
+            auto n = m_dir.size();
+            m_dir.resize( 2 * n );
+            std::copy( m_dir.begin(), m_dir.begin() + n, m_dir.begin() + n );
+            m_depth++;
+        }
+        const auto bit = std::uint64_t{1} << ld;
+        const auto sibling = new_page();
+        PinnedPage sib( *m_pool, sibling, true );
+        head( sib )->m_depth = ld + 1;
+        head( sib )->m_pattern = oh->m_pattern | bit;
+        oh->m_depth = ld + 1;
+        old.mark_dirty();
+        for (auto i = head( sib )->m_pattern; i < m_dir.size(); i += bit << 1)
+            m_dir[i] = sibling;
+
+        // Take every entry of the chain out, then put each back on its side. The emptied
+        // overflow pages stay linked and are filled again first.
+        std::vector< Slot > entries;
+        for (auto page = page_; page != 0;) {
+            PinnedPage p( *m_pool, page );
+            auto ph = head( p );
+            entries.insert( entries.end(), slots( p ), slots( p ) + ph->m_count );
+            ph->m_count = 0;
+            ph->m_depth = ld + 1;
+            p.mark_dirty();
+            page = ph->m_overflow;
+        }
+        for (const auto & e : entries)
+            append( ( hash( e.m_key ) & bit ) ? sibling : page_, e );
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::write_header()
+    {
+        PinnedPage p( *m_pool, 0 );
+        auto fh = reinterpret_cast< FileHeader * >( p.data() );
+        fh->m_magic = MAGIC;
+        fh->m_key_size = sizeof( KeyType );
+        fh->m_data_size = sizeof( DataType );
+        fh->m_page_size = PAGE_SIZE;
+        fh->m_depth = m_depth;
+        fh->m_count = m_count;
+        fh->m_pages = m_pages;
+        p.mark_dirty();
+    }
+
+    /*!
+     * @brief Reads the file header and rebuilds the directory from the bucket page headers:
+     * a bucket of depth d and pattern p fills the directory entries p, p + 2^d, p + 2*2^d, ...
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void DiskHashTbl<KeyType,DataType,KeyHash,KeyEqual>::load()
+    {
+        FileHeader fh;
+        if (::pread( m_fd, &fh, sizeof( fh ), 0 ) != ssize_t( sizeof( fh ) ) or fh.m_magic != MAGIC or
+            fh.m_key_size != sizeof( KeyType ) or fh.m_data_size != sizeof( DataType ) or
+            fh.m_page_size != PAGE_SIZE or fh.m_depth > MAX_DEPTH)
+            throw std::runtime_error( "not a table of these key and data types" );
+        m_depth = fh.m_depth;
+        m_count = fh.m_count;
+        m_pages = fh.m_pages;
+        m_dir.assign( size_type{1} << m_depth, 0 );
+        for (std::uint64_t page{1}; page < m_pages; page++) {
+            PageHeader ph;
+            if (::pread( m_fd, &ph, sizeof( ph ), off_t( page * PAGE_SIZE ) ) != ssize_t( sizeof( ph ) ))
+                throw std::runtime_error( "truncated at page " + std::to_string( page ) );
+            if (ph.m_is_overflow) continue;
+            if (ph.m_depth > m_depth)
+                throw std::runtime_error( "bad bucket depth at page " + std::to_string( page ) );
+            for (auto i = ph.m_pattern; i < m_dir.size(); i += std::uint64_t{1} << ph.m_depth)
+                m_dir[i] = page;
+        }
+        for (auto page : m_dir)
+            if (page == 0) throw std::runtime_error( "directory has a hole" );
+    }
+} // Namespace ac.
@@ -0,0 +1,115 @@
+/*!
+ * @file durable_hashtbl.h
+ * HashTbl whose mutations are logged to a write-ahead log and replayed on open.
+ */
+#ifndef _DURABLE_HASHTBL_H_
+#define _DURABLE_HASHTBL_H_
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>    // std::out_of_range, std::runtime_error
+#include <string>
+
+#include "codec.h"
+#include "hashtbl.h"
+#include "wal.h"
+
+namespace ac // Associative container
+{
+    /// A HashTbl that survives a crash.
+    /*! Every mutation is appended to the log under one lock, committed outside it
+     *  (concurrent writers share fsyncs through the log's group commit), and applied
+     *  to the table only once durable, in log order: readers never see a change the
+     *  log could still lose. Meanwhile writers see it through a map of the keys with
+     *  pending mutations, so results and modify() follow the log order. A mutation
+     *  is durable and visible when the call returns; if the log fails, the call throws,
+     *  the mutations it held back are never applied and later ones throw too.
+     *  Opening the table replays the log into a table reserved for it up front;
+     *  checkpoint() rewrites the log as one record per entry. Keys and data are
+     *  encoded with ac::Codec. Writes through operator[] are done with modify(),
+     *  which logs the result.
+     */
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class DurableHashTbl {
+        public:
+            // Aliases
+            using size_type = std::size_t;
+            using table_type = HashTbl< KeyType, DataType, KeyHash, KeyEqual >;
+
+            //! Log record types.
+            enum Op : std::uint8_t { PUT = 1, ERASE = 2, CLEAR = 3 };
+
+            // Opens (or creates) the table logged at path_. A nonzero expected_ is the number of
+            // entries to reserve room for; otherwise the log is scanned once to count them.
+            explicit DurableHashTbl( const std::string & path_, WalOptions options_ = WalOptions{},
+                                     size_type expected_ = 0 );
+            DurableHashTbl( const DurableHashTbl & ) = delete;
+            DurableHashTbl & operator=( const DurableHashTbl & ) = delete;
+
+            bool insert( const KeyType &, const DataType & );
+            bool erase( const KeyType & );
+            // Applies f(data) to the data of key_ (default-constructed if absent) and logs the result.
+            template< class Func >
+            void modify( const KeyType & key_, Func f_ );
+            void clear();
+            bool retrieve( const KeyType &, DataType & ) const;
+            // Returns a copy of the data of key_; throws std::out_of_range if it is absent.
+            DataType at( const KeyType & ) const;
+            size_type count( const KeyType & ) const;
+            size_type size() const;
+            bool empty() const { return size() == 0; };
+            // Rewrites the log as one PUT per entry, dropping the history of overwritten and erased keys.
+            void checkpoint();
+            // Number of log records replayed when the table was opened.
+            size_type recovered() const { return m_recovered; };
+            WalStats log_stats() const { return m_log.stats(); };
+            // The table itself. Not synchronized with concurrent writers.
+            const table_type & table() const { return m_table; };
+
+        private:
+            using lsn_type = WriteAheadLog::lsn_type;
+            //! A logged mutation, applied to m_table once its record is durable.
+            struct Mutation {
+                lsn_type m_lsn;
+                Op m_op;
+                KeyType m_key;
+                DataType m_data;
+            };
+            //! The state of a key after its last logged mutation.
+            struct Pending {
+                lsn_type m_lsn;
+                bool m_present;
+                DataType m_data;
+            };
+
+            // Reserves m_table and replays the log at path_ into it. Returns the records replayed.
+            size_type load( const std::string & path_, size_type expected_ );
+            // Applies a replayed record to m_table.
+            void apply( std::uint8_t op_, const char * p_, size_type n_ );
+            // The data of key_ once every logged mutation applies; nullptr if absent. Needs m_mtx.
+            const DataType * latest( const KeyType & key_ ) const;
+            // Appends a mutation to the log and queues it. Needs m_mtx.
+            lsn_type log( Op op_, const KeyType & key_, const DataType * data_, const std::string & payload_ );
+            // Waits for record lsn_ to be durable, then applies it and those before it.
+            void commit( lsn_type lsn_ );
+            // Applies the queued mutations up to lsn_, which are durable. Needs m_mtx.
+            void publish( lsn_type lsn_ );
+
+        private:
+            std::string m_path;         //!< The log file.
+            table_type m_table;         //!< The durable entries.
+            size_type m_recovered;      //!< Records replayed on open.
+            WriteAheadLog m_log;        //!< Opened after the replay, which may truncate a torn tail.
+            mutable std::mutex m_mtx;   //!< Orders the log records; guards everything below it.
+            std::deque< Mutation > m_queue;                               //!< Logged, not applied yet, in log order.
+            HashTbl< KeyType, Pending, KeyHash, KeyEqual > m_pending;     //!< Keys with queued mutations.
+            lsn_type m_clear_lsn = 0;                                     //!< A queued CLEAR, or 0.
+    };
+
+} // namespace ac
+#include "durable_hashtbl.inl"
+#endif
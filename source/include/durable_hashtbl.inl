@@ -0,0 +1,323 @@
+#include "durable_hashtbl.h"
+
+#include <cstdio>       // std::rename, std::remove
+
+namespace ac {
+    /*!
+     * @brief Opens a durable hash table, replaying its log.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function received by the client.
+     * @param path_ the log file; created if it does not exist.
+     * @param options_ when commits reach the disk (see WalOptions).
+     * @param expected_ number of entries to reserve room for; 0 to count them in the log.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::DurableHashTbl( const std::string & path_, WalOptions options_,
+                                                                        size_type expected_ )
+        : m_path{ path_ }, m_table(), m_recovered{ load( path_, expected_ ) }, m_log( path_, options_ )
+	{ /* empty */ }
+
+    /*!
+     * @brief Inserts or overwrites an entry, durably.
+     * @param key_ element key to be inserted.
+     * @param new_data_ element data to be inserted.
+     * @return true if a new element was inserted; false if the key's data was overwritten.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	bool DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert( const KeyType & key_, const DataType & new_data_ )
+    {
+        std::string payload;
+        Codec< KeyType >::encode( payload, key_ );
+        Codec< DataType >::encode( payload, new_data_ );
+        lsn_type lsn;
+        bool inserted;
+        {
+            std::lock_guard< std::mutex > lock( m_mtx );
+            inserted = latest( key_ ) == nullptr;
+            lsn = log( PUT, key_, &new_data_, payload );
+        }
+        commit( lsn );
+        return inserted;
+    }
+
+    /*!
+     * @brief Removes an entry, durably. Erasing an absent key logs nothing.
+     * @param key_ the key of the element to be removed.
+     * @return true if the key was found; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	bool DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::erase( const KeyType & key_ )
+    {
+        std::string payload;
+        Codec< KeyType >::encode( payload, key_ );
+        lsn_type lsn;
+        {
+            std::lock_guard< std::mutex > lock( m_mtx );
+            if (latest( key_ ) == nullptr)
+                return false;
+            lsn = log( ERASE, key_, nullptr, payload );
+        }
+        commit( lsn );
+        return true;
+    }
+
+    /*!
+     * @brief Read-modify-write of an entry, durably: what `table[key] = ...` does on a HashTbl.
+     * @param key_ the key of the entry; it is inserted with DataType{} if absent.
+     * @param f_ called as f(DataType&) under the table lock, on a copy of the data as of the
+     * last logged mutation; the data it leaves is logged, then stored once durable.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Func >
+	void DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::modify( const KeyType & key_, Func f_ )
+    {
+        std::string payload;
+        Codec< KeyType >::encode( payload, key_ );
+        lsn_type lsn;
+        {
+            std::lock_guard< std::mutex > lock( m_mtx );
+            const DataType * old = latest( key_ );
+            DataType data = old != nullptr ? *old : DataType();
+            f_( data );
+            Codec< DataType >::encode( payload, data );
+            lsn = log( PUT, key_, &data, payload );
+        }
+        commit( lsn );
+    }
+
+    /*!
+     * @brief Removes every entry, durably.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::clear()
+    {
+        lsn_type lsn;
+        {
+            std::lock_guard< std::mutex > lock( m_mtx );
+            lsn = log( CLEAR, KeyType(), nullptr, std::string() );
+        }
+        commit( lsn );
+    }
+
+    /*!
+     * @brief Retrieves the data of a key.
+     * @param key_ Data key to search for in the table.
+     * @param data_item_ Data record to be filled in when data item is found.
+     * @return true if the data item is found; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	bool DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::retrieve( const KeyType & key_, DataType & data_item_ ) const
+    {
+        std::lock_guard< std::mutex > lock( m_mtx );
+        return m_table.retrieve( key_, data_item_ );
+    }
+
+    /*!
+     * @brief Returns a copy of the data of a key (a reference would escape the lock).
+     * If there is no such key, the method throws an exception of type std::out_of_range.
+     * @param key_ key that we look for the data.
+     * @return DataType the data associated with the given key.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	DataType DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::at( const KeyType & key_ ) const
+    {
+        std::lock_guard< std::mutex > lock( m_mtx );
+        const DataType * data = m_table.find( key_ );
+        if (data == nullptr)
+            throw std::out_of_range("[DurableHashTbl::at()]: key doesn't exist in the hash table.");
+        return *data;
+    }
+
+    /*!
+     * @brief Tells whether a key is in the table.
+     * @param key_ the key to search for.
+     * @return 1 if the key is present; 0, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::count( const KeyType & key_ ) const
+    {
+        std::lock_guard< std::mutex > lock( m_mtx );
+        return m_table.find( key_ ) == nullptr ? 0 : 1;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size() const
+    {
+        std::lock_guard< std::mutex > lock( m_mtx );
+        return m_table.size();
+    }
+
+    /*!
+     * @brief Replaces the log by a snapshot of the table: one PUT per entry, written
+     * and synced to a temporary file that is then renamed over the log. A crash at
+     * any point leaves either the old log or the snapshot. Writers wait meanwhile.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::checkpoint()
+    {
+        std::lock_guard< std::mutex > lock( m_mtx );
+        m_log.sync();
+        publish( m_log.last_lsn() );   // The snapshot must hold every durable mutation.
+        auto tmp_path = m_path + ".tmp";
+        std::remove( tmp_path.c_str() ); // Leftover of a checkpoint that crashed.
+        {
+            WalOptions options;
+            options.mode = SyncMode::every;
+            WriteAheadLog snapshot( tmp_path, options );
+            std::string payload;
+            m_table.for_each( [&]( const typename table_type::entry_type & e_ ) {
+                payload.clear();
+                Codec< KeyType >::encode( payload, e_.m_key );
+                Codec< DataType >::encode( payload, e_.m_data );
+                snapshot.append( PUT, payload );
+            } );
+            snapshot.sync();
+        }
+        if (std::rename( tmp_path.c_str(), m_path.c_str() ) != 0)
+            throw std::runtime_error( "[DurableHashTbl::checkpoint()]: cannot rename " + tmp_path );
+        // Make the rename itself durable.
+        auto slash = m_path.find_last_of( '/' );
+        auto dir = slash == std::string::npos ? std::string( "." ) : m_path.substr( 0, slash + 1 );
+        int dir_fd = ::open( dir.c_str(), O_RDONLY | O_DIRECTORY );
+        if (dir_fd >= 0) {
+            ::fsync( dir_fd );
+            ::close( dir_fd );
+        }
+        m_log.reopen();
+    }
+
+    /*!
+     * @brief Sizes the table for the log at path_ and replays the log into it.
+     * @return the number of records replayed.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::load( const std::string & path_, size_type expected_ )
+    {
+        if (expected_ == 0) {
+            // Upper bound: overwrites and erases only make the table smaller.
+            WriteAheadLog::replay( path_, [&]( std::uint8_t op_, const char *, size_type ) {
+                if (op_ == PUT) expected_++;
+            } );
+        }
+        m_table.reserve( expected_ );
+        return WriteAheadLog::replay( path_, [this]( std::uint8_t op_, const char * p_, size_type n_ ) {
+            apply( op_, p_, n_ );
+        } );
+    }
+
+    /*!
+     * @brief Applies a log record to the table.
+     * Throws std::runtime_error if the record does not decode (e.g. the log was
+     * written with another KeyType or DataType).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::apply( std::uint8_t op_, const char * p_, size_type n_ )
+    {
+        const char * end = p_ + n_;
+        KeyType key;
+        switch (op_) {
+            case PUT: {
+                DataType data;
+                if (Codec< KeyType >::decode( p_, end, key ) and Codec< DataType >::decode( p_, end, data )) {
+                    m_table.insert( key, data );
+                    return;
+                }
+                break;
+            }
+            case ERASE:
+                if (Codec< KeyType >::decode( p_, end, key )) {
+                    m_table.erase( key );
+                    return;
+                }
+                break;
+            case CLEAR:
+                m_table.clear();
+                return;
+        }
+        throw std::runtime_error( "[DurableHashTbl]: undecodable record in " + m_path );
+    }
+    /*!
+     * @brief The data of a key as every logged mutation leaves it, applied or not.
+     * @param key_ the key to search for.
+     * @return the data, in m_pending or m_table; nullptr if the key is absent.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	const DataType * DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::latest( const KeyType & key_ ) const
+    {
+        const Pending * p = m_pending.find( key_ );
+        if (p != nullptr)
+            return p->m_present ? &p->m_data : nullptr;
+        if (m_clear_lsn != 0)   // Keys untouched since a queued CLEAR are gone.
+            return nullptr;
+        return m_table.find( key_ );
+    }
+
+    /*!
+     * @brief Appends a mutation to the log and queues it for m_table.
+     * @param op_ the record type.
+     * @param key_ the key of a PUT or ERASE.
+     * @param data_ the new data of a PUT; nullptr otherwise.
+     * @param payload_ the encoded record.
+     * @return the sequence number of the record.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::lsn_type
+    DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::log( Op op_, const KeyType & key_, const DataType * data_,
+                                                            const std::string & payload_ )
+    {
+        lsn_type lsn = m_log.append( op_, payload_ );   // Throws once the log failed.
+        DataType data = data_ != nullptr ? *data_ : DataType();
+        m_queue.push_back( Mutation{ lsn, op_, key_, data } );
+        if (op_ == CLEAR) {
+            m_pending.clear();
+            m_clear_lsn = lsn;
+        }
+        else
+            m_pending.insert( key_, Pending{ lsn, data_ != nullptr, data } );
+        return lsn;
+    }
+
+    /*!
+     * @brief Waits for a record to be durable, then applies it and every record before it.
+     * Throws the log error if it failed first; the queued mutations then stay unapplied.
+     * @param lsn_ the sequence number of the record.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::commit( lsn_type lsn_ )
+    {
+        m_log.commit( lsn_ );
+        std::lock_guard< std::mutex > lock( m_mtx );
+        publish( lsn_ );
+    }
+
+    /*!
+     * @brief Applies the queued mutations up to a durable record, in log order.
+     * @param lsn_ the last durable record to apply (a writer of a later one may have done it already).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void DurableHashTbl<KeyType,DataType,KeyHash,KeyEqual>::publish( lsn_type lsn_ )
+    {
+        while (not m_queue.empty() and m_queue.front().m_lsn <= lsn_) {
+            const Mutation & m = m_queue.front();
+            switch (m.m_op) {
+                case PUT:   m_table.insert( m.m_key, m.m_data ); break;
+                case ERASE: m_table.erase( m.m_key ); break;
+                case CLEAR: m_table.clear(); break;
+            }
+            if (m.m_op == CLEAR) {
+                if (m_clear_lsn == m.m_lsn) m_clear_lsn = 0;
+            }
+            else {
+                const Pending * p = m_pending.find( m.m_key );
+                if (p != nullptr and p->m_lsn == m.m_lsn)   // The last mutation of the key: m_table has caught up.
+                    m_pending.erase( m.m_key );
+            }
+            m_queue.pop_front();
+        }
+    }
+} // Namespace ac.
@@ -0,0 +1,236 @@
+/*!
+ * @file group_by.h
+ * Hash group-by aggregation over HashTbl, with per-worker pre-aggregation.
+ */
+#ifndef _GROUP_BY_H_
+#define _GROUP_BY_H_
+
+#include <algorithm>      // std::min, std::max
+#include <cstddef>
+#include <limits>
+#include <tuple>
+#include <type_traits>    // std::decay
+#include <vector>
+
+#include "hashtbl.h"
+#include "parallel.h"
+
+namespace ac // Associative container
+{
+    /// Aggregate functions for GroupBy.
+    /*! An aggregate is a stateless type with
+     *  - `value_type`, the running result of a group;
+     *  - `static value_type init()`, the result of an empty group;
+     *  - `static void update( value_type &, const Input & )`, which folds in one value;
+     *  - `static void merge( value_type &, const value_type & )`, which folds in another
+     *    partial result of the same group.
+     */
+    namespace agg {
+        template< class T >
+        struct Sum {
+            using value_type = T;
+            static value_type init() { return T{}; }
+            static void update( value_type & acc_, const T & v_ ) { acc_ += v_; }
+            static void merge( value_type & acc_, const value_type & other_ ) { acc_ += other_; }
+        };
+
+        struct Count {
+            using value_type = std::size_t;
+            static value_type init() { return 0; }
+            template< class Input >
+            static void update( value_type & acc_, const Input & ) { acc_++; }
+            static void merge( value_type & acc_, const value_type & other_ ) { acc_ += other_; }
+        };
+
+        template< class T >
+        struct Min {
+            using value_type = T;
+            static value_type init() { return std::numeric_limits< T >::max(); }
+            static void update( value_type & acc_, const T & v_ ) { if (v_ < acc_) acc_ = v_; }
+            static void merge( value_type & acc_, const value_type & other_ ) { update( acc_, other_ ); }
+        };
+
+        template< class T >
+        struct Max {
+            using value_type = T;
+            static value_type init() { return std::numeric_limits< T >::lowest(); }
+            static void update( value_type & acc_, const T & v_ ) { if (acc_ < v_) acc_ = v_; }
+            static void merge( value_type & acc_, const value_type & other_ ) { update( acc_, other_ ); }
+        };
+
+        namespace detail {
+            // Applies the aggregates I.. of a Combine to the matching tuple elements.
+            template< std::size_t I, std::size_t N, class... Aggs >
+            struct Each {
+                using agg_type = typename std::tuple_element< I, std::tuple< Aggs... > >::type;
+                template< class Tuple >
+                static void init( Tuple & t_ ) {
+                    std::get< I >( t_ ) = agg_type::init();
+                    Each< I + 1, N, Aggs... >::init( t_ );
+                }
+                template< class Tuple, class Input >
+                static void update( Tuple & t_, const Input & v_ ) {
+                    agg_type::update( std::get< I >( t_ ), v_ );
+                    Each< I + 1, N, Aggs... >::update( t_, v_ );
+                }
+                template< class Tuple >
+                static void merge( Tuple & t_, const Tuple & other_ ) {
+                    agg_type::merge( std::get< I >( t_ ), std::get< I >( other_ ) );
+                    Each< I + 1, N, Aggs... >::merge( t_, other_ );
+                }
+            };
+            template< std::size_t N, class... Aggs >
+            struct Each< N, N, Aggs... > {
+                template< class Tuple > static void init( Tuple & ) {}
+                template< class Tuple, class Input > static void update( Tuple &, const Input & ) {}
+                template< class Tuple > static void merge( Tuple &, const Tuple & ) {}
+            };
+        } // namespace detail
+
+        /// Several aggregates of the same input at once; the result is the tuple of theirs,
+        /// e.g. Combine< Sum<float>, Count, Min<float>, Max<float> >.
+        template< class... Aggs >
+        struct Combine {
+            using value_type = std::tuple< typename Aggs::value_type... >;
+            using each = detail::Each< 0, sizeof...( Aggs ), Aggs... >;
+            static value_type init() { value_type t; each::init( t ); return t; }
+            template< class Input >
+            static void update( value_type & acc_, const Input & v_ ) { each::update( acc_, v_ ); }
+            static void merge( value_type & acc_, const value_type & other_ ) { each::merge( acc_, other_ ); }
+        };
+    } // namespace agg
+
+    /// Groups values by key and keeps one aggregate (see ac::agg) per group in a HashTbl.
+    /*! update() folds in one row. update_batch() folds in a range of rows: it extracts
+     *  keys and values a block at a time and collapses runs of equal keys (as in data
+     *  sorted or clustered by group) into one table access. aggregate() splits the
+     *  rows over workers, each filling a GroupBy of its own, without locks, and merges
+     *  them at the end; the merge costs one table access per group per worker.
+     */
+	template< class KeyType,
+	          class Agg,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class GroupBy {
+        public:
+            // Aliases
+            using size_type = std::size_t;
+            using result_type = typename Agg::value_type;
+            using table_type = HashTbl< KeyType, result_type, KeyHash, KeyEqual >;
+            static const size_type BATCH = 256;   //!< Rows update_batch() extracts at a time.
+
+            // expected_groups_ presizes the table (0 lets it grow).
+            explicit GroupBy( size_type expected_groups_ = 0 ) { if (expected_groups_) m_table.reserve( expected_groups_ ); }
+
+            // Folds one value into the group of key_.
+            template< class Input >
+            void update( const KeyType & key_, const Input & value_ ) { Agg::update( group( key_ ), value_ ); }
+
+            // Folds the rows [first_, last_) in, grouped by key_of(row), aggregating value_of(row).
+            template< class InputIt, class KeyOf, class ValueOf >
+            void update_batch( InputIt first_, InputIt last_, KeyOf key_of_, ValueOf value_of_ );
+
+            // Folds in the groups of other_ (e.g. the partial result of another worker).
+            void merge( const GroupBy & other_ ) {
+                other_.m_table.for_each( [this]( const typename table_type::entry_type & e_ ) {
+                    Agg::merge( group( e_.m_key ), e_.m_data );
+                } );
+            }
+
+            // Aggregates rows_ with threads_ workers (0: one per hardware thread), each taking
+            // morsel_ rows (at least 1) at a time into its own GroupBy; the partial results are then merged.
+            template< class Row, class KeyOf, class ValueOf >
+            static GroupBy aggregate( const std::vector< Row > & rows_, KeyOf key_of_, ValueOf value_of_,
+                                      size_type threads_ = 0, size_type morsel_ = 16384 );
+
+            // Result of the group of key_, or nullptr if no row had that key.
+            const result_type * find( const KeyType & key_ ) const { return m_table.find( key_ ); }
+            // Calls f(entry) for each group; entry.m_key is the key, entry.m_data the result.
+            template< class Func >
+            void for_each( Func f_ ) const { m_table.for_each( f_ ); }
+            const table_type & table() const { return m_table; }
+            size_type size() const { return m_table.size(); }
+            void clear() { m_table.clear(); }
+            void swap( GroupBy & other_ ) noexcept { m_table.swap( other_.m_table ); }
+
+        private:
+            // The running result of a group, created (with Agg::init()) on first use.
+            result_type & group( const KeyType & key_ ) {
+                result_type * acc = m_table.find( key_ );
+                return acc != nullptr ? *acc : ( m_table[ key_ ] = Agg::init() );
+            }
+
+        private:
+            table_type m_table;   //!< Key -> aggregate of the group.
+    };
+
+    /*!
+     * @brief Folds a range of rows into the groups, one block of BATCH rows at a time:
+     * first the keys and values of the block are extracted into local arrays, then each
+     * run of consecutive equal keys is aggregated locally and merged into the table
+     * with a single lookup.
+     */
+	template< class KeyType, class Agg, class KeyHash, class KeyEqual >
+    template< class InputIt, class KeyOf, class ValueOf >
+    void GroupBy<KeyType,Agg,KeyHash,KeyEqual>::update_batch( InputIt first_, InputIt last_, KeyOf key_of_, ValueOf value_of_ )
+    {
+        using value_type = typename std::decay< decltype( value_of_( *first_ ) ) >::type;
+        KeyEqual equalFunc;
+        std::vector< KeyType > keys;
+        std::vector< value_type > values;
+        keys.reserve( BATCH );
+        values.reserve( BATCH );
+        while (first_ != last_) {
+            keys.clear();
+            values.clear();
+            for (; first_ != last_ and keys.size() < BATCH; ++first_) {
+                keys.push_back( key_of_( *first_ ) );
+                values.push_back( value_of_( *first_ ) );
+            }
+            for (size_type i{0}; i < keys.size(); ) {
+                result_type run = Agg::init();
+                size_type j = i;
+                for (; j < keys.size() and ( j == i or equalFunc( keys[j], keys[i] ) ); j++)
+                    Agg::update( run, values[j] );
+                Agg::merge( group( keys[i] ), run );
+                i = j;
+            }
+        }
+    }
+
+    /*!
+     * @brief Parallel aggregation: workers claim morsels of rows and pre-aggregate them
+     * into worker-local GroupBys (no shared state but the morsel counter), which are
+     * merged into the result once every worker is done.
+     */
+	template< class KeyType, class Agg, class KeyHash, class KeyEqual >
+    template< class Row, class KeyOf, class ValueOf >
+    GroupBy<KeyType,Agg,KeyHash,KeyEqual>
+    GroupBy<KeyType,Agg,KeyHash,KeyEqual>::aggregate( const std::vector< Row > & rows_, KeyOf key_of_, ValueOf value_of_,
+                                                      size_type threads_, size_type morsel_ )
+    {
+        morsel_ = std::max< size_type >( morsel_, 1 );
+        const size_type workers = std::min( worker_count( threads_ ), std::max< size_type >( rows_.size() / morsel_, 1 ) );
+        std::vector< GroupBy > partial( workers );
+        MorselQueue morsels( rows_.size(), morsel_ );
+        run_workers( workers, [&]( size_type w_ ) {
+            size_type first, last;
+            while (morsels.next( first, last ))
+                partial[w_].update_batch( rows_.begin() + first, rows_.begin() + last, key_of_, value_of_ );
+        } );
+        // Merge into the largest partial result, which then needs no table accesses of its own.
+        size_type largest{0};
+        for (size_type w{1}; w < workers; w++)
+            if (partial[w].size() > partial[largest].size()) largest = w;
+        for (size_type w{0}; w < workers; w++)
+            if (w != largest) partial[largest].merge( partial[w] );
+        GroupBy result;   // Takes the merged table over instead of copying it.
+        result.swap( partial[largest] );
+        return result;
+    }
+
+    template< class KeyType, class Agg, class KeyHash, class KeyEqual >
+    const typename GroupBy<KeyType,Agg,KeyHash,KeyEqual>::size_type GroupBy<KeyType,Agg,KeyHash,KeyEqual>::BATCH;
+
+} // namespace ac
+#endif
@@ -0,0 +1,109 @@
+/*!
+ * @file hash_cache.h
+ * Bounded, thread-safe cache over HashTbl with CLOCK (second chance) eviction.
+ */
+#ifndef _HASH_CACHE_H_
+#define _HASH_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>        // std::lock_guard
+#include <vector>
+
+#include "hashtbl.h"
+#include "rw_lock.h"
+
+namespace ac // Associative container
+{
+    /// Counters of a HashCache, summed over its shards.
+    struct CacheStats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+
+        double hit_ratio() const { return hits + misses == 0 ? 0.0 : double( hits ) / ( hits + misses ); }
+    };
+
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class HashCache {
+        public:
+            using size_type = std::size_t;
+
+            //! What the index stores per key: the data, its slot and its reference bit, so a hit
+            //! touches nothing but the index entry.
+            struct Cached {
+                DataType m_data;
+                size_type m_slot;
+                mutable std::atomic< std::uint8_t > m_referenced; //!< The only state a reader writes.
+
+                Cached( const DataType & data_, size_type slot_ ) : m_data( data_ ), m_slot{ slot_ }, m_referenced{ 0 } {}
+                Cached( const Cached & other_ )
+                    : m_data( other_.m_data ), m_slot{ other_.m_slot },
+                      m_referenced{ other_.m_referenced.load( std::memory_order_relaxed ) } {}
+                Cached & operator=( const Cached & other_ ) {
+                    m_data = other_.m_data;
+                    m_slot = other_.m_slot;
+                    m_referenced.store( other_.m_referenced.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+                    return *this;
+                }
+            };
+            using index_type = HashTbl< KeyType, Cached, KeyHash, KeyEqual >;
+
+            /// A cache of at most capacity_ entries, split into shards_ independently locked shards.
+            explicit HashCache( size_type capacity_, size_type shards_ = 16 );
+            HashCache( const HashCache & ) = delete;
+            HashCache & operator=( const HashCache & ) = delete;
+
+            // Copies the cached data of key_ into data_ and returns true; false on a miss.
+            bool get( const KeyType & key_, DataType & data_ ) const;
+            // Returns the cached data of key_, calling load(key_) and caching its result on a miss.
+            template< class Loader >
+            DataType get_or_load( const KeyType & key_, Loader load_ );
+            // Stores data_ under key_, evicting an entry if the shard is full. True if key_ was new.
+            bool put( const KeyType & key_, const DataType & data_ );
+            bool erase( const KeyType & key_ );
+            void clear();
+            size_type size() const;
+            // Maximum number of entries (rounded up to a multiple of the shard count).
+            size_type capacity() const { return m_shard_capacity * m_shards.size(); };
+            CacheStats stats() const;
+            void reset_stats();
+
+            /// Capacity that keeps a cache of fixed-size keys and data within bytes_ of memory.
+            static size_type capacity_for_bytes( size_type bytes_ );
+
+        private:
+            //! Clock position: the key of an entry (to erase it from the index) and its index entry.
+            struct Slot {
+                KeyType m_key;
+                Cached * m_entry;
+            };
+
+            //! A shard is an independent cache: its own lock, index, slots and clock hand.
+            struct Shard {
+                explicit Shard( size_type capacity_ );
+                mutable RwLock m_lock;
+                index_type m_index;                  //!< Sized for the capacity, so it never rehashes.
+                std::unique_ptr< Slot[] > m_slots;   //!< The clock; entry pointers stay valid (no rehash).
+                std::vector< size_type > m_free;     //!< Slots never used or freed by erase().
+                size_type m_hand = 0;                //!< Next slot the clock looks at.
+                mutable std::atomic< std::size_t > m_hits{ 0 };
+                mutable std::atomic< std::size_t > m_misses{ 0 };
+                std::size_t m_evictions = 0;         //!< Written under the exclusive lock only.
+            };
+
+            Shard & shard_of( const KeyType & ) const;
+            size_type take_slot( Shard & );
+
+        private:
+            size_type m_shard_capacity;                    //!< Entries per shard.
+            std::vector< std::unique_ptr< Shard > > m_shards;
+    };
+
+} // namespace ac
+#include "hash_cache.inl"
+#endif
@@ -0,0 +1,245 @@
+#include "hash_cache.h"
+
+namespace ac {
+    /*!
+     * @brief Creates an empty cache.
+     * @tparam KeyType type of key stored in the cache.
+     * @tparam DataType data type stored in the cache.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function received by the client.
+     * @param capacity_ maximum number of entries.
+     * @param shards_ number of independently locked shards (at most capacity_).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	HashCache<KeyType,DataType,KeyHash,KeyEqual>::HashCache( size_type capacity_, size_type shards_ )
+	{
+        capacity_ = std::max< size_type >( capacity_, 1 );
+        shards_ = std::min( std::max< size_type >( shards_, 1 ), capacity_ );
+        m_shard_capacity = ( capacity_ + shards_ - 1 ) / shards_;
+        for (size_type i{0}; i < shards_; i++)
+            m_shards.emplace_back( new Shard( m_shard_capacity ) );
+	}
+
+    /*!
+     * @brief Builds a shard whose index never needs a rehash().
+     * @param capacity_ number of slots of the shard.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	HashCache<KeyType,DataType,KeyHash,KeyEqual>::Shard::Shard( size_type capacity_ )
+        : m_index( capacity_ ), m_slots( new Slot[capacity_] )
+	{
+        m_free.reserve( capacity_ );
+        for (size_type i{capacity_}; i > 0; i--)
+            m_free.push_back( i - 1 );
+	}
+
+    /*!
+     * @brief Looks a key up. Readers of a shard share its lock: a hit only sets the
+     * reference bit (an atomic byte) of the index entry it already read; there is no
+     * list to splice.
+     * @param key_ the key to search for.
+     * @param data_ receives a copy of the cached data on a hit.
+     * @return true on a hit; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool HashCache<KeyType,DataType,KeyHash,KeyEqual>::get( const KeyType & key_, DataType & data_ ) const
+    {
+        Shard & shard = shard_of( key_ );
+        SharedLock lock( shard.m_lock );
+        const Cached * entry = shard.m_index.find( key_ );
+        if (entry == nullptr) {
+            shard.m_misses.fetch_add( 1, std::memory_order_relaxed );
+            return false;
+        }
+        data_ = entry->m_data;
+        // Skip the store when the bit is already set, so hot entries do not bounce their cache line.
+        if (not entry->m_referenced.load( std::memory_order_relaxed ))
+            entry->m_referenced.store( 1, std::memory_order_relaxed );
+        shard.m_hits.fetch_add( 1, std::memory_order_relaxed );
+        return true;
+    }
+
+    /*!
+     * @brief Read-through lookup. Two threads missing the same key may both call load_;
+     * the last put() wins.
+     * @param key_ the key to search for.
+     * @param load_ called as load(key_) on a miss; its result is cached and returned.
+     * @return the cached or loaded data.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Loader >
+    DataType HashCache<KeyType,DataType,KeyHash,KeyEqual>::get_or_load( const KeyType & key_, Loader load_ )
+    {
+        DataType data;
+        if (get( key_, data ))
+            return data;
+        data = load_( key_ );
+        put( key_, data );
+        return data;
+    }
+
+    /*!
+     * @brief Stores data_ under key_. A new entry starts with its reference bit clear,
+     * so entries that are never read again are the first ones evicted.
+     * @param key_ the key of the entry.
+     * @param data_ the data of the entry.
+     * @return true if key_ was not cached; false if its data was overwritten.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool HashCache<KeyType,DataType,KeyHash,KeyEqual>::put( const KeyType & key_, const DataType & data_ )
+    {
+        Shard & shard = shard_of( key_ );
+        std::lock_guard< RwLock > lock( shard.m_lock );
+        Cached * entry = shard.m_index.find( key_ );
+        if (entry != nullptr) {
+            entry->m_data = data_;
+            entry->m_referenced.store( 1, std::memory_order_relaxed );
+            return false;
+        }
+        auto i = take_slot( shard );
+        shard.m_index.insert( key_, Cached( data_, i ) );
+        shard.m_slots[i].m_key = key_;
+        shard.m_slots[i].m_entry = shard.m_index.find( key_ );
+        return true;
+    }
+
+    /*!
+     * @brief Returns a free slot of the shard, evicting an entry when there is none.
+     * The clock hand clears the reference bits it passes and evicts the first entry
+     * whose bit is already clear (it was not read since the hand last passed by).
+     * @param shard_ the shard, locked exclusively by the caller.
+     * @return the slot number.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename HashCache<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    HashCache<KeyType,DataType,KeyHash,KeyEqual>::take_slot( Shard & shard_ )
+    {
+        if (not shard_.m_free.empty()) {
+            auto i = shard_.m_free.back();
+            shard_.m_free.pop_back();
+            return i;
+        }
+        // No free slot: every slot is live, so the hand stops within two turns.
+        for (;;) {
+            auto i = shard_.m_hand;
+            shard_.m_hand = ( i + 1 ) % m_shard_capacity;
+            Slot & slot = shard_.m_slots[i];
+            if (slot.m_entry->m_referenced.load( std::memory_order_relaxed )) {
+                slot.m_entry->m_referenced.store( 0, std::memory_order_relaxed );
+                continue;
+            }
+            shard_.m_index.erase( slot.m_key );
+            shard_.m_evictions++;
+            return i;
+        }
+    }
+
+    /*!
+     * @brief Removes a key from the cache.
+     * @param key_ the key of the entry to be removed.
+     * @return true if key_ was cached; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool HashCache<KeyType,DataType,KeyHash,KeyEqual>::erase( const KeyType & key_ )
+    {
+        Shard & shard = shard_of( key_ );
+        std::lock_guard< RwLock > lock( shard.m_lock );
+        const Cached * entry = shard.m_index.find( key_ );
+        if (entry == nullptr)
+            return false;
+        shard.m_free.push_back( entry->m_slot );
+        shard.m_index.erase( key_ );
+        return true;
+    }
+
+    /*!
+     * @brief Removes every entry; the statistics are kept.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void HashCache<KeyType,DataType,KeyHash,KeyEqual>::clear()
+    {
+        for (auto & shard : m_shards) {
+            std::lock_guard< RwLock > lock( shard->m_lock );
+            shard->m_index.clear();
+            shard->m_free.clear();
+            for (size_type i{m_shard_capacity}; i > 0; i--)
+                shard->m_free.push_back( i - 1 );
+            shard->m_hand = 0;
+        }
+    }
+
+    /*!
+     * @brief Returns the number of cached entries.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename HashCache<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    HashCache<KeyType,DataType,KeyHash,KeyEqual>::size() const
+    {
+        size_type n{0};
+        for (const auto & shard : m_shards) {
+            SharedLock lock( shard->m_lock );
+            n += shard->m_index.size();
+        }
+        return n;
+    }
+
+    /*!
+     * @brief Returns the hit, miss and eviction counters, summed over the shards.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    CacheStats HashCache<KeyType,DataType,KeyHash,KeyEqual>::stats() const
+    {
+        CacheStats total;
+        for (const auto & shard : m_shards) {
+            SharedLock lock( shard->m_lock );
+            total.hits += shard->m_hits.load( std::memory_order_relaxed );
+            total.misses += shard->m_misses.load( std::memory_order_relaxed );
+            total.evictions += shard->m_evictions;
+        }
+        return total;
+    }
+
+    /*!
+     * @brief Zeroes the hit, miss and eviction counters.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void HashCache<KeyType,DataType,KeyHash,KeyEqual>::reset_stats()
+    {
+        for (auto & shard : m_shards) {
+            std::lock_guard< RwLock > lock( shard->m_lock );
+            shard->m_hits.store( 0, std::memory_order_relaxed );
+            shard->m_misses.store( 0, std::memory_order_relaxed );
+            shard->m_evictions = 0;
+        }
+    }
+
+    /*!
+     * @brief Estimates how many entries fit in bytes_: the slot, its free-list entry,
+     * its index node (entry plus two list links) and one collision list of the index.
+     * Memory owned by the key or data (e.g. string characters) is not counted.
+     * @param bytes_ the memory budget.
+     * @return the capacity to pass to the constructor (at least 1).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename HashCache<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    HashCache<KeyType,DataType,KeyHash,KeyEqual>::capacity_for_bytes( size_type bytes_ )
+    {
+        const size_type per_entry = sizeof( Slot ) + sizeof( size_type )
+                                  + sizeof( typename index_type::entry_type ) + 2 * sizeof( void * )
+                                  + sizeof( typename index_type::list_type );
+        return std::max< size_type >( bytes_ / per_entry, 1 );
+    }
+
+    /*!
+     * @brief Picks the shard of a key from the high bits of its (mixed) hash.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename HashCache<KeyType,DataType,KeyHash,KeyEqual>::Shard &
+    HashCache<KeyType,DataType,KeyHash,KeyEqual>::shard_of( const KeyType & key_ ) const
+    {
+        KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+        auto h = static_cast< std::uint64_t >( hashFunc( key_ ) );
+        auto mixed = ( h ^ ( h >> 32 ) ) * 0x9E3779B97F4A7C15ull;
+        return *m_shards[ ( mixed >> 40 ) % m_shards.size() ];
+    }
+} // Namespace ac.
@@ -0,0 +1,237 @@
+/*!
+ * @file hash_join.h
+ * Parallel equi-join of two row vectors, with HashTbl as the build side.
+ */
+#ifndef _HASH_JOIN_H_
+#define _HASH_JOIN_H_
+
+#include <cstdint>
+#include <stdexcept>    // std::length_error
+#include <utility>      // std::pair
+#include <vector>
+
+#include "hashtbl.h"
+#include "parallel.h"
+
+namespace ac // Associative container
+{
+    struct JoinOptions {
+        std::size_t threads = 0;                //!< Workers; 0 means one per hardware thread.
+        std::size_t morsel_rows = 16384;        //!< Probe rows a worker claims at a time (shared mode).
+        bool radix = true;                      //!< Partition the probe side as well (see hash_join()).
+        unsigned radix_bits = 0;                //!< log2 of the partition count in radix mode; 0 derives it from cache_bytes.
+        std::size_t cache_bytes = 256 * 1024;   //!< Size a build partition should fit in (about an L2 cache).
+    };
+
+    struct JoinStats {
+        std::size_t build_rows = 0;
+        std::size_t probe_rows = 0;
+        std::size_t matches = 0;                //!< Calls to the emit callback.
+        std::size_t partitions = 0;             //!< Build-side HashTbls.
+    };
+
+    namespace detail {
+        static const unsigned MAX_RADIX_BITS = 16;
+        static const std::uint32_t HAS_NEXT = 0x80000000u;  //!< Flag of a row index: next_[row] holds another match.
+        static const std::uint32_t ROW_MASK = HAS_NEXT - 1;
+
+        // Partition of a hash: its top bits after a multiplicative remix, so that the
+        // partitions do not correlate with the buckets (hash % size) inside them.
+        inline std::size_t partition_of( std::size_t hash_, unsigned bits_ ) {
+            return bits_ == 0 ? 0 : std::size_t( ( std::uint64_t( hash_ ) * 0x9E3779B97F4A7C15ull ) >> ( 64 - bits_ ) );
+        }
+
+        /// Radix partitions rows_ by key hash in two parallel passes (histogram, then scatter).
+        /*! On return, order_[bounds_[p] .. bounds_[p+1]) are the indices of the rows of partition p,
+         *  in input order. */
+        template< class KeyHash, class Row, class KeyOf >
+        void radix_partition( const std::vector< Row > & rows_, KeyOf key_of_, unsigned bits_, std::size_t workers_,
+                              std::vector< std::uint32_t > & order_, std::vector< std::size_t > & bounds_ )
+        {
+            const std::size_t n = rows_.size(), n_parts = std::size_t( 1 ) << bits_;
+            std::vector< std::uint16_t > part( n );
+            std::vector< std::size_t > hist( workers_ * n_parts, 0 );
+            run_workers( workers_, [&]( std::size_t w_ ) {
+                KeyHash hashFunc;
+                std::size_t * h = &hist[ w_ * n_parts ];
+                for (std::size_t i = n * w_ / workers_; i < n * ( w_ + 1 ) / workers_; i++) {
+                    part[i] = static_cast< std::uint16_t >( partition_of( hashFunc( key_of_( rows_[i] ) ), bits_ ) );
+                    h[ part[i] ]++;
+                }
+            } );
+            // Turn the counts into write positions: partition-major, then worker order.
+            bounds_.assign( n_parts + 1, 0 );
+            std::size_t pos{0};
+            for (std::size_t p{0}; p < n_parts; p++) {
+                bounds_[p] = pos;
+                for (std::size_t w{0}; w < workers_; w++) {
+                    auto c = hist[ w * n_parts + p ];
+                    hist[ w * n_parts + p ] = pos;
+                    pos += c;
+                }
+            }
+            bounds_[n_parts] = pos;
+            order_.resize( n );
+            run_workers( workers_, [&]( std::size_t w_ ) {
+                std::size_t * next = &hist[ w_ * n_parts ];
+                for (std::size_t i = n * w_ / workers_; i < n * ( w_ + 1 ) / workers_; i++)
+                    order_[ next[ part[i] ]++ ] = static_cast< std::uint32_t >( i );
+            } );
+        }
+
+        /// HashTbl over the build rows listed in [first_, last_): key -> last such row. When a key
+        /// repeats, the row carries HAS_NEXT and next_[row] is the previous row (with its own flag),
+        /// so unique keys, the common case, never touch next_.
+        template< class Key, class KeyHash, class KeyEqual, class Build, class BuildKey >
+        void build_partition( HashTbl< Key, std::uint32_t, KeyHash, KeyEqual > & table_,
+                              const std::vector< Build > & build_, BuildKey build_key_,
+                              const std::uint32_t * first_, const std::uint32_t * last_,
+                              std::vector< std::uint32_t > & next_ )
+        {
+            table_.reserve( std::size_t( last_ - first_ ) );
+            for (; first_ != last_; ++first_) {
+                const auto row = *first_;
+                const Key & key = build_key_( build_[row] );
+                std::uint32_t * head = table_.find( key );
+                if (head != nullptr) {
+                    next_[row] = *head;
+                    *head = row | HAS_NEXT;
+                }
+                else
+                    table_.insert( key, row );
+            }
+        }
+
+        /// Emits every build row matching probe row p_.
+        template< class Key, class KeyHash, class KeyEqual, class Build, class Probe, class ProbeKey, class Emit >
+        std::size_t probe_row( const HashTbl< Key, std::uint32_t, KeyHash, KeyEqual > & table_,
+                               const std::vector< Build > & build_, const std::vector< std::uint32_t > & next_,
+                               const Probe & p_, ProbeKey probe_key_, Emit & emit_, std::size_t worker_ )
+        {
+            const std::uint32_t * head = table_.find( probe_key_( p_ ) );
+            if (head == nullptr) return 0;
+            std::size_t matches{0};
+            for (auto v = *head; ; v = next_[ v & ROW_MASK ]) {
+                emit_( build_[ v & ROW_MASK ], p_, worker_ );
+                matches++;
+                if (not ( v & HAS_NEXT )) return matches;
+            }
+        }
+    } // namespace detail
+
+    /// Joins build_ and probe_ on equal keys, calling emit(build_row, probe_row, worker)
+    /// once per matching pair.
+    /*! Build keys need not be unique. The build side is split by key hash into
+     *  partitions, each one indexed by its own HashTbl (key -> rows) built by one
+     *  worker, so the build runs in parallel without locks.
+     *  - Shared mode (radix == false): a few partitions per worker; then workers
+     *    claim morsel_rows probe rows at a time and look each one up in the table of
+     *    its partition. The probe side is read once, in place.
+     *  - Radix mode: partitions are sized to fit cache_bytes, the probe side is
+     *    partitioned the same way, and each worker builds a partition and probes it
+     *    right away, so the lookups hit a cache-resident table. This costs one extra
+     *    pass over the probe keys and 6 bytes per probe row.
+     *  emit runs concurrently on up to worker_count(threads) workers; worker (in
+     *  [0, worker_count(threads))) lets it write to per-worker state without locking.
+     *  The build side may hold up to 2^31 - 1 rows, the probe side up to 2^32 - 1.
+     *  @tparam Key the join key; BuildKey and ProbeKey map a row to it.
+     *  @return the row and match counts.
+     */
+    template< class Key, class KeyHash = std::hash< Key >, class KeyEqual = std::equal_to< Key >,
+              class Build, class BuildKey, class Probe, class ProbeKey, class Emit >
+    JoinStats hash_join( const std::vector< Build > & build_, BuildKey build_key_,
+                         const std::vector< Probe > & probe_, ProbeKey probe_key_,
+                         Emit emit_, const JoinOptions & options_ = JoinOptions{} )
+    {
+        using table_type = HashTbl< Key, std::uint32_t, KeyHash, KeyEqual >;
+        const std::size_t workers = worker_count( options_.threads );
+        if (build_.size() > detail::ROW_MASK or probe_.size() >= UINT32_MAX)
+            throw std::length_error( "[hash_join()]: too many rows." );
+        JoinStats stats;
+        stats.build_rows = build_.size();
+        stats.probe_rows = probe_.size();
+
+        unsigned bits{0};
+        if (options_.radix and options_.radix_bits > 0)
+            bits = options_.radix_bits;
+        else if (options_.radix) {
+            // Rough footprint of an entry: the HashEntry, its list node links and a bucket.
+            const std::size_t entry_bytes = sizeof( HashEntry< Key, std::uint32_t > ) + 3 * sizeof( void * );
+            const std::size_t rows_per_part = std::max< std::size_t >( options_.cache_bytes / entry_bytes, 1 );
+            while (( build_.size() >> bits ) > rows_per_part) bits++;
+        }
+        else
+            while (( std::size_t( 1 ) << bits ) < 4 * workers) bits++;
+        bits = std::min( bits, detail::MAX_RADIX_BITS );
+        const std::size_t n_parts = std::size_t( 1 ) << bits;
+        stats.partitions = n_parts;
+
+        std::vector< std::uint32_t > build_order, next( build_.size() );
+        std::vector< std::size_t > build_bounds;
+        detail::radix_partition< KeyHash >( build_, build_key_, bits, workers, build_order, build_bounds );
+        std::vector< std::size_t > matches( workers, 0 );
+
+        if (options_.radix) {
+            std::vector< std::uint32_t > probe_order;
+            std::vector< std::size_t > probe_bounds;
+            detail::radix_partition< KeyHash >( probe_, probe_key_, bits, workers, probe_order, probe_bounds );
+            MorselQueue parts( n_parts, 1 );
+            run_workers( workers, [&]( std::size_t w_ ) {
+                std::size_t p, end;
+                while (parts.next( p, end )) {
+                    if (probe_bounds[p] == probe_bounds[p + 1]) continue;
+                    table_type table;
+                    detail::build_partition( table, build_, build_key_, build_order.data() + build_bounds[p],
+                                             build_order.data() + build_bounds[p + 1], next );
+                    for (auto i = probe_bounds[p]; i < probe_bounds[p + 1]; i++)
+                        matches[w_] += detail::probe_row( table, build_, next, probe_[ probe_order[i] ],
+                                                          probe_key_, emit_, w_ );
+                }
+            } );
+        }
+        else {
+            std::vector< table_type > tables( n_parts );
+            MorselQueue parts( n_parts, 1 );
+            run_workers( workers, [&]( std::size_t ) {
+                std::size_t p, end;
+                while (parts.next( p, end ))
+                    detail::build_partition( tables[p], build_, build_key_, build_order.data() + build_bounds[p],
+                                             build_order.data() + build_bounds[p + 1], next );
+            } );
+            MorselQueue morsels( probe_.size(), options_.morsel_rows );
+            run_workers( workers, [&]( std::size_t w_ ) {
+                KeyHash hashFunc;
+                std::size_t first, last;
+                while (morsels.next( first, last ))
+                    for (auto i = first; i < last; i++) {
+                        const auto & table = tables[ detail::partition_of( hashFunc( probe_key_( probe_[i] ) ), bits ) ];
+                        matches[w_] += detail::probe_row( table, build_, next, probe_[i], probe_key_, emit_, w_ );
+                    }
+            } );
+        }
+        for (auto m : matches) stats.matches += m;
+        return stats;
+    }
+
+    /// Same join as hash_join(), returning the matching pairs (pointers into build_ and probe_)
+    /// instead of calling back. Each worker fills its own buffer; they are concatenated at the end.
+    template< class Key, class KeyHash = std::hash< Key >, class KeyEqual = std::equal_to< Key >,
+              class Build, class BuildKey, class Probe, class ProbeKey >
+    std::vector< std::pair< const Build *, const Probe * > >
+    hash_join_pairs( const std::vector< Build > & build_, BuildKey build_key_,
+                     const std::vector< Probe > & probe_, ProbeKey probe_key_,
+                     const JoinOptions & options_ = JoinOptions{} )
+    {
+        using pair_type = std::pair< const Build *, const Probe * >;
+        std::vector< std::vector< pair_type > > buffers( worker_count( options_.threads ) );
+        auto stats = hash_join< Key, KeyHash, KeyEqual >( build_, build_key_, probe_, probe_key_,
+            [&buffers]( const Build & b_, const Probe & p_, std::size_t w_ ) { buffers[w_].emplace_back( &b_, &p_ ); },
+            options_ );
+        std::vector< pair_type > out;
+        out.reserve( stats.matches );
+        for (auto & b : buffers) out.insert( out.end(), b.begin(), b.end() );
+        return out;
+    }
+
+} // namespace ac
+#endif
@@ -0,0 +1,115 @@
+/*!
+ * @file hash_ring.h
+ * Consistent hashing: maps key hashes to partitions so that adding a partition moves few keys.
+ */
+#ifndef _HASH_RING_H_
+#define _HASH_RING_H_
+
+#include <algorithm>    // std::lower_bound, std::sort, std::remove_if
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>    // std::invalid_argument, std::logic_error
+#include <utility>      // std::pair
+#include <vector>
+
+namespace ac // Associative container
+{
+    /// A ring of 2^64 positions on which every partition owns vnodes points.
+    /*! A key hash is mixed to a position and belongs to the partition of the first point
+     *  at or after it (wrapping around). A new partition takes over the arcs that end at
+     *  its points, about 1/(n+1) of the ring, each from the one partition that owned it;
+     *  no other key changes hands. More points per partition even out the arcs.
+     */
+    class HashRing {
+        public:
+            /// An arc [first, second] of positions, both ends included.
+            using Range = std::pair< std::uint64_t, std::uint64_t >;
+
+            explicit HashRing( std::size_t vnodes_ = 128 ) : m_vnodes{ std::max< std::size_t >( vnodes_, 1 ) } {}
+
+            /// Adds the points of partition_; throws std::invalid_argument if it has them already.
+            void add( std::size_t partition_ ) {
+                if (contains( partition_ ))
+                    throw std::invalid_argument( "[HashRing::add()]: partition already on the ring." );
+                for (std::size_t r{0}; r < m_vnodes; r++)
+                    m_points.push_back( Point{ mix( ( std::uint64_t( partition_ ) << 32 ) ^ r ), partition_ } );
+                std::sort( m_points.begin(), m_points.end() );
+                m_partitions++;
+            }
+
+            /// Removes the points of partition_; its arcs go to the partitions that follow them.
+            void remove( std::size_t partition_ ) {
+                auto end = std::remove_if( m_points.begin(), m_points.end(),
+                                           [&]( const Point & p ) { return p.m_partition == partition_; } );
+                if (end == m_points.end()) return;
+                m_points.erase( end, m_points.end() );
+                m_partitions--;
+            }
+
+            bool contains( std::size_t partition_ ) const {
+                for (const auto & p : m_points)
+                    if (p.m_partition == partition_) return true;
+                return false;
+            }
+
+            /// The partition that owns a key of hash hash_ (a KeyHash value).
+            /// Throws std::logic_error when the ring is empty.
+            std::size_t owner( std::uint64_t hash_ ) const { return owner_of_position( position( hash_ ) ); }
+
+            /// The partition that owns ring position pos_.
+            std::size_t owner_of_position( std::uint64_t pos_ ) const {
+                if (m_points.empty()) throw std::logic_error( "[HashRing::owner()]: the ring is empty." );
+                auto it = std::lower_bound( m_points.begin(), m_points.end(), Point{ pos_, 0 } );
+                return ( it == m_points.end() ? m_points.front() : *it ).m_partition;
+            }
+
+            /// The arcs partition_ owns, split where they wrap around.
+            std::vector< Range > ranges_of( std::size_t partition_ ) const {
+                std::vector< Range > ranges;
+                for (std::size_t i{0}; i < m_points.size(); i++) {
+                    if (m_points[i].m_partition != partition_) continue;
+                    auto hi = m_points[i].m_pos;
+                    if (m_points.size() == 1) { ranges.emplace_back( 0, UINT64_MAX ); break; }
+                    auto prev = m_points[ i == 0 ? m_points.size() - 1 : i - 1 ].m_pos;
+                    if (i > 0) {
+                        if (prev < hi) ranges.emplace_back( prev + 1, hi );   // (Equal positions: an empty arc.)
+                    }
+                    else {
+                        // The arc of the first point wraps around the end of the ring.
+                        if (prev != UINT64_MAX) ranges.emplace_back( prev + 1, UINT64_MAX );
+                        ranges.emplace_back( 0, hi );
+                    }
+                }
+                return ranges;
+            }
+
+            /// Ring position of a key hash: the hash mixed, so that weak hashes still spread.
+            static std::uint64_t position( std::uint64_t hash_ ) { return mix( hash_ ); }
+
+            std::size_t partitions() const { return m_partitions; }
+            std::size_t vnodes() const { return m_vnodes; }
+
+        private:
+            struct Point {
+                std::uint64_t m_pos;
+                std::size_t m_partition;
+                bool operator<( const Point & o ) const {
+                    return m_pos < o.m_pos or ( m_pos == o.m_pos and m_partition < o.m_partition );
+                }
+            };
+
+            /// splitmix64 finalizer.
+            static std::uint64_t mix( std::uint64_t x ) {
+                x += 0x9E3779B97F4A7C15ull;
+                x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+                x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBull;
+                return x ^ ( x >> 31 );
+            }
+
+            std::size_t m_vnodes;
+            std::size_t m_partitions = 0;
+            std::vector< Point > m_points;   //!< Sorted by position.
+    };
+
+} // namespace ac
+#endif
@@ -12,16 +12,56 @@
 #include <utility> // std::pair
 #include <memory>
 #include <stdexcept> // std::out_of_range
+#include <type_traits> // std::is_base_of, std::is_trivially_destructible
+#include <cstdint>      // uint32_t (generation stamps)
+#include <new>          // placement new
+#include <map>          // std::multimap (treeified collision lists)
+#include <tuple>
+
+#include "bloom_filter.h"
+#include "page_alloc.h"
+#include "parallel.h"
 
 namespace ac // Associative container
 {
+    namespace detail {
+        template< bool... > struct all_true : std::true_type {};
+        template< bool B, bool... Bs > struct all_true< B, Bs... > : std::integral_constant< bool, B and all_true< Bs... >::value > {};
+
+        template< class T, class = void >
+        struct less_expr : std::false_type {};
+        template< class T >
+        struct less_expr< T, decltype( void( std::declval< const T & >() < std::declval< const T & >() ) ) > : std::true_type {};
+
+        /// Whether T can be ordered with <. Tuples and pairs declare < for any element types,
+        /// so they are checked element by element.
+        template< class T > struct less_comparable : less_expr< T > {};
+        template< class... Ts >
+        struct less_comparable< std::tuple< Ts... > > : all_true< less_comparable< Ts >::value... > {};
+        template< class A, class B >
+        struct less_comparable< std::pair< A, B > > : all_true< less_comparable< A >::value, less_comparable< B >::value > {};
+
+        /// Whether KeyEqual declares that it agrees with the < of the keys (`using agrees_with_less = std::true_type;`).
+        template< class E, class = void >
+        struct declares_less_agreement : std::false_type {};
+        template< class E >
+        struct declares_less_agreement< E, decltype( void( typename E::agrees_with_less{} ) ) > : E::agrees_with_less {};
+
+        /// Whether a HashTbl may order keys with <: K must have it, and KeyEqual E must be known to
+        /// agree with it (std::equal_to, or declared so). A case-insensitive E, say, does not.
+        template< class K, class E >
+        struct orders_with_less
+            : all_true< less_comparable< K >::value,
+                        std::is_same< E, std::equal_to< K > >::value or declares_less_agreement< E >::value > {};
+    } // namespace detail
+
 	template<class KeyType, class DataType>
 	struct HashEntry {
         KeyType m_key;   //! Data key
         DataType m_data; //! The data
 
         // Regular constructor.
-        HashEntry( KeyType kt_, DataType dt_ ) : m_key{kt_} , m_data{dt_}
+        HashEntry( KeyType kt_, DataType dt_ ) : m_key{std::move(kt_)} , m_data{std::move(dt_)}
         {/*Empty*/}
 
         friend std::ostream & operator<<( std::ostream & os_, const HashEntry & he_ ) {
@@ -39,10 +79,10 @@ namespace ac // Associative container
         public:
             // Aliases
             using entry_type = HashEntry<KeyType,DataType>;
-            using list_type = std::list< entry_type >;
+            using list_type = std::list< entry_type, NodeAllocator< entry_type > >;
             using size_type = std::size_t;
 
-            explicit HashTbl( size_type table_sz_ = DEFAULT_SIZE );
+            explicit HashTbl( size_type table_sz_ = DEFAULT_SIZE, const MemoryPolicy & policy_ = MemoryPolicy{} );
             HashTbl( const HashTbl& );
             HashTbl( const std::initializer_list< entry_type > & );
             HashTbl& operator=( const HashTbl& );
@@ -51,6 +91,10 @@ namespace ac // Associative container
             virtual ~HashTbl();
 
             bool insert( const KeyType &, const DataType &  );
+            template< class InputIt, class = typename std::iterator_traits<InputIt>::iterator_category >
+            size_type insert( InputIt, InputIt );
+            template< class InputIt >
+            size_type insert_hashed( InputIt, InputIt );
             bool retrieve( const KeyType &, DataType & ) const;
             bool erase( const KeyType & );
             void clear();
@@ -59,19 +103,69 @@ namespace ac // Associative container
             DataType& at( const KeyType& );
             DataType& operator[]( const KeyType& );
             size_type count( const KeyType& ) const;
+            // Returns a pointer to the data of a key, or nullptr when the key is not in the table.
+            DataType* find( const KeyType& );
+            const DataType* find( const KeyType& ) const;
             // Returns the maximum load factor of the hash table.
             float max_load_factor() const { return m_max_load_factor; };
             // Changes the maximum load factor of the hash table.
             void max_load_factor(float mlf) { m_max_load_factor = mlf; };
+            // Makes room for n elements, so that inserting them does not trigger a rehash().
+            void reserve( size_type );
+            // Returns the number of collision lists.
+            size_type bucket_count() const { return m_size; };
+            // Returns the index of the collision list that holds (or would hold) a key.
+            size_type bucket( const KeyType & key_ ) const { return KeyHash{}( key_ ) % m_size; };
+            // Calls f(entry) for every element of the collision lists [first_bucket, last_bucket).
+            template< class Func >
+            void for_each( size_type, size_type, Func ) const;
+            // Calls f(entry) for every element of the table.
+            template< class Func >
+            void for_each( Func f ) const { for_each( 0, m_size, f ); };
+            // Calls f(key, data) for every element, on threads_ workers (0: one per hardware thread)
+            // that claim the collision lists morsel_ at a time. f may change the data.
+            template< class Func >
+            void parallel_for_each( Func f, size_type threads_ = 0, size_type morsel_ = 4096 );
+            // Folds map(entry) with combine, from identity, over every element in parallel.
+            // combine must be associative and commutative, and identity its neutral element.
+            template< class T, class Map, class Combine >
+            T parallel_reduce( T identity, Map map, Combine combine, size_type threads_ = 0, size_type morsel_ = 4096 ) const;
+            // Erases every element for which pred(key, data) holds, in parallel; returns how many.
+            template< class Pred >
+            size_type erase_if( Pred pred, size_type threads_ = 0, size_type morsel_ = 4096 );
+            // Keeps a Bloom filter of the keys: lookups of absent keys then skip the collision lists.
+            // Throws std::invalid_argument unless 0 < fpr < 1 (the filter is then left as it was).
+            void enable_filter( double fpr = 0.01 );
+            // Drops the filter; lookups go back to scanning the collision lists.
+            void disable_filter() { m_filter.reset(); };
+            // Returns the filter, or nullptr when it is disabled.
+            const BlockedBloomFilter * filter() const { return m_filter.get(); };
+            // Counters of the lookups that went through the filter (a snapshot).
+            FilterStats filter_stats() const { return m_filter_stats.load(); };
+            void reset_filter_stats() { m_filter_stats.reset(); };
+            // Length at which a collision list gets an ordered index (see treeify()); 0 disables it.
+            size_type treeify_threshold() const { return m_treeify_threshold; };
+            void treeify_threshold( size_type n );
+            // Number of collision lists that currently have an ordered index.
+            size_type treeified_buckets() const { return m_n_trees; };
+            // With lazy clearing on, clear() takes O(1): it starts a new generation, and a collision
+            // list of an older one reads as empty until it is written to. Off by default.
+            void lazy_clear( bool on_ );
+            bool lazy_clear() const { return m_stamps != nullptr; };
+            // Where the collision lists and their nodes are allocated (set at construction).
+            const MemoryPolicy & memory_policy() const { return m_policy; };
+            // Exchanges the contents (and settings) of two tables in O(1): no element is copied.
+            void swap( HashTbl & other_ ) noexcept;
 
             //* Generates a textual representation of the table and its elements.
             friend std::ostream & operator<<( std::ostream & os_, const HashTbl & ht_ ) {
                 // Run through all elements
                 for (size_t i{0}; i < ht_.m_size; i++) {
+                    if (ht_.stale( i )) continue;
                     auto element = ht_.m_table[i].begin(); // First element of collision list i.
                     auto sz = ht_.m_table[i].size(); // Size of collision list i.
                     for (size_t j{0}; j < sz; j++) {
-                        os_ << *element << std::endl;
+                        os_ << *element << '\n'; // No flush per element; see hashtbl_dump.h for bulk output.
                         element++; // Next element of collision list i.
                     }
                 }
@@ -82,12 +176,83 @@ namespace ac // Associative container
             bool is_prime(size_type n);
             size_type find_next_prime(size_type N);
             void rehash( void );
+            void rehash( size_type );
+            template< class Entry >
+            bool insert_entry( size_type, Entry && );
+            void rebuild_filter();
+            // True when the filter proves that the key with hash h is not in the table.
+            bool filter_rejects( size_type h ) const {
+                if (not m_filter) return false;
+                AtomicFilterStats::bump( m_filter_stats.lookups );
+                if (m_filter->may_contain( h )) return false;
+                AtomicFilterStats::bump( m_filter_stats.definite_misses );
+                return true;
+            };
+            // Counts a lookup the filter let through but the collision list did not satisfy.
+            void filter_missed() const { if (m_filter) AtomicFilterStats::bump( m_filter_stats.false_positives ); };
+            // Counts n_ erased keys whose bits stay set in the filter. A rebuild visits every
+            // collision list and key, so it waits until the stale keys outnumber both: each
+            // erase pays O(1) amortized, and the filter holds at most twice what it was sized for.
+            void filter_erased( size_type n_ ) {
+                if (m_filter and ( m_filter_stale += n_ ) > std::max( m_count, m_size )) rebuild_filter();
+            };
+
+            //! Ordered index of a long collision list: (hash, key) -> list node.
+            struct TreeKey {
+                size_type m_hash;
+                const KeyType * m_key; //!< Points into the list node (or to the key looked up).
+            };
+            struct TreeLess {
+                bool operator()( const TreeKey & a, const TreeKey & b ) const {
+                    if (a.m_hash != b.m_hash) return a.m_hash < b.m_hash;
+                    return less( *a.m_key, *b.m_key, detail::orders_with_less< KeyType, KeyEqual >{} );
+                }
+                static bool less( const KeyType & a, const KeyType & b, std::true_type ) { return a < b; }
+                // Keys without a < that KeyEqual agrees with tie: lookups scan the entries of equal hash with KeyEqual.
+                static bool less( const KeyType &, const KeyType &, std::false_type ) { return false; }
+            };
+            using tree_type = std::multimap< TreeKey, typename list_type::iterator, TreeLess >;
+
+            // Returns the entry of key_ (whose KeyHash value is hash_) in collision list b_, or its end().
+            typename list_type::iterator locate( size_type b_, size_type hash_, const KeyType & key_ ) const;
+            // Bookkeeping after the entry with KeyHash value hash_ was appended to collision list b_.
+            void appended( size_type b_, size_type hash_ );
+            // Removes entry it_ from collision list b_.
+            void unlink( size_type b_, size_type hash_, typename list_type::iterator it_ );
+            void treeify( size_type b_ );
+            // An ordered index of collision list b_.
+            std::unique_ptr< tree_type > build_tree( size_type b_ ) const;
+            // Rebuilds the indexes of the long collision lists (after their nodes moved or were copied).
+            void rebuild_trees();
+            // True when collision list b_ is of an older generation than the table (see lazy_clear()).
+            bool stale( size_type b_ ) const { return m_stamps and m_stamps[b_] != m_generation; };
+            // Collision list b_, to be written to: emptied first if it is stale.
+            list_type & fresh( size_type b_ ) { if (stale( b_ )) purge( b_ ); return m_table[b_]; };
+            void purge( size_type b_ );
+            void forget( size_type b_ );
+            void restamp();
+            // True when list nodes can be dropped without a visit: arena nodes with no destructor to run.
+            bool drops_nodes() const { return m_arena and std::is_trivially_destructible< entry_type >::value; };
+            // An array of n_ empty collision lists, allocated under m_policy.
+            PageArray< list_type > make_buckets( size_type n_ ) const {
+                return PageArray< list_type >( n_, m_policy, typename list_type::allocator_type( m_arena.get() ) );
+            };
 
         private:
             size_type m_size; //!< Tamanho da tabela.
             size_type m_count; //!< Numero de elementos na tabela.
             float m_max_load_factor = 1.0; //!< Fator de carga da tabela.
-            std::unique_ptr<list_type[]> m_table;
+            MemoryPolicy m_policy;                 //!< Placement of m_table and of the list nodes.
+            std::unique_ptr<PageArena> m_arena;    //!< List nodes; null under the default policy (heap nodes).
+            PageArray<list_type> m_table;
+            std::unique_ptr<BlockedBloomFilter> m_filter; //!< Keys of the table; null when the filter is disabled.
+            size_type m_filter_stale = 0;          //!< Erased keys whose bits are still set in m_filter.
+            mutable AtomicFilterStats m_filter_stats; //!< Updated by the const lookups, maybe concurrent.
+            std::unique_ptr< std::unique_ptr< tree_type >[] > m_trees; //!< Index per collision list; null while no list has one.
+            size_type m_n_trees = 0;               //!< Collision lists with an index.
+            size_type m_treeify_threshold = 8;     //!< List length that triggers treeify().
+            std::unique_ptr< std::uint32_t[] > m_stamps; //!< Generation of each collision list; null unless lazy_clear().
+            std::uint32_t m_generation = 0;        //!< Generation of the table.
             //std::list< entry_type > *mpDataTable; //!< Tabela de listas para entradas de tabela.
             static const short DEFAULT_SIZE = 10;
     };
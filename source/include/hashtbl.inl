@@ -10,14 +10,18 @@ namespace ac {
      * performed on the collision list received by the client.
      * @param sz will determine the size of the table, being the smallest 
      * prime number >= than the value specified in this parameter.
+     * @param policy_ where the collision lists and their nodes are allocated
+     * (huge pages, NUMA node); the default is the regular heap.
      */
 	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
-	HashTbl<KeyType,DataType,KeyHash,KeyEqual>::HashTbl( size_type sz )
+	HashTbl<KeyType,DataType,KeyHash,KeyEqual>::HashTbl( size_type sz, const MemoryPolicy & policy_ )
+        : m_policy{ policy_ }
 	{
         // Set attributes.
         m_size = find_next_prime(sz);
         m_count = 0;
-        m_table = std::unique_ptr<list_type[]> (new list_type[m_size]);
+        if (not m_policy.is_default()) m_arena.reset( new PageArena( m_policy ) );
+        m_table = make_buckets( m_size );
 	}
 
     /*!
@@ -31,22 +35,23 @@ namespace ac {
      */
 	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
 	HashTbl<KeyType,DataType,KeyHash,KeyEqual>::HashTbl( const HashTbl& source )
+        : m_policy{ source.m_policy }
 	{
         // Set attributes.
+        if (not m_policy.is_default()) m_arena.reset( new PageArena( m_policy ) );
         m_size = source.m_size;
         m_count = source.m_count;
         m_max_load_factor = source.m_max_load_factor;
-        m_table = std::unique_ptr<list_type[]> (new list_type[m_size]);
-        // Run through all elements.
+        m_table = make_buckets( m_size );
+        // Copy each collision list; every entry is copied exactly once.
         for (size_t i{0}; i < m_size; i++) {
-            auto element = source.m_table[i].begin(); // First element of collision list i.
-            auto sz = source.m_table[i].size(); // Size of collision list i.
-            for (size_t j{0}; j < sz; j++) {
-                entry_type new_entry{ element->m_key , element->m_data }; // Element of collision list.
-                m_table[i].push_back( new_entry ); // Add the element to the collision list.
-                element++; // Next element of collision list i.
-            }
+            if (not source.stale( i )) m_table[i] = source.m_table[i];
         }
+        if (source.m_filter)
+            m_filter.reset( new BlockedBloomFilter( *source.m_filter ) );
+        m_filter_stale = source.m_filter_stale;
+        m_treeify_threshold = source.m_treeify_threshold;
+        rebuild_trees(); // The indexes of the source point into its own lists.
 	}
 
     /*!
@@ -64,7 +69,7 @@ namespace ac {
         // Set attributes.
         m_size = ilist.size();
         m_count = 0;
-        m_table = std::unique_ptr<list_type[]> (new list_type[m_size]);
+        m_table = make_buckets( m_size );
         // Run through all elements.
         auto element = ilist.begin(); // First element of initializer list.
         for (size_t i{0}; i < m_size; i++) {
@@ -82,29 +87,65 @@ namespace ac {
      * performed on the collision list received by the client.
      * @param clone the hash table that will be copied.
      * @return the hash table with the same attributes as the copied hash table.
+     * This table keeps its own memory policy.
      */
 	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
 	HashTbl<KeyType,DataType,KeyHash,KeyEqual>&
     HashTbl<KeyType,DataType,KeyHash,KeyEqual>::operator=( const HashTbl& clone )
     {
+        // The nodes of a stale list may have been handed out again: they are not freed with it.
+        for (size_t i{0}; i < m_size; i++) {
+            if (stale( i )) purge( i );
+        }
         // Set attributes.
         m_size = clone.m_size;
         m_count = clone.m_count;
         m_max_load_factor = clone.m_max_load_factor;
-        m_table = std::unique_ptr<list_type[]> (new list_type[m_size]);
-        // Run through all elements.
+        m_table = make_buckets( m_size );
+        restamp();
+        // Copy each collision list; every entry is copied exactly once.
         for (size_t i{0}; i < m_size; i++) {
-            auto element = clone.m_table[i].begin(); // First element of collision list i.
-            auto sz = clone.m_table[i].size(); // Size of collision list i.
-            for (size_t j{0}; j < sz; j++) {
-                entry_type new_entry{ element->m_key , element->m_data }; // Element of collision list.
-                m_table[i].push_back( new_entry ); // Add the element to the collision list.
-                element++; // Next element of collision list i.
-            }
+            if (not clone.stale( i )) m_table[i] = clone.m_table[i];
         }
+        m_filter.reset( clone.m_filter ? new BlockedBloomFilter( *clone.m_filter ) : nullptr );
+        m_filter_stale = clone.m_filter_stale;
+        m_treeify_threshold = clone.m_treeify_threshold;
+        rebuild_trees(); // The indexes of the clone point into its own lists.
         return *this;
     }
 
+    /*!
+     * @brief Exchanges the contents of two tables. The collision lists stay where they
+     * are, and so do their nodes: each table takes the other's bucket array, arena,
+     * filter and indexes, which keep pointing at the right nodes.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param other_ the table to exchange contents with.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void HashTbl<KeyType,DataType,KeyHash,KeyEqual>::swap( HashTbl & other_ ) noexcept
+    {
+        std::swap( m_size, other_.m_size );
+        std::swap( m_count, other_.m_count );
+        std::swap( m_max_load_factor, other_.m_max_load_factor );
+        std::swap( m_policy, other_.m_policy );
+        m_arena.swap( other_.m_arena );
+        m_table.swap( other_.m_table );
+        m_filter.swap( other_.m_filter );
+        std::swap( m_filter_stale, other_.m_filter_stale );
+        auto stats = m_filter_stats.load(), other_stats = other_.m_filter_stats.load();
+        m_filter_stats.store( other_stats );
+        other_.m_filter_stats.store( stats );
+        m_trees.swap( other_.m_trees );
+        std::swap( m_n_trees, other_.m_n_trees );
+        std::swap( m_treeify_threshold, other_.m_treeify_threshold );
+        m_stamps.swap( other_.m_stamps );
+        std::swap( m_generation, other_.m_generation );
+    }
+
     /*!
      * @brief Assignment operator with a initializer list.
      * @tparam KeyType type of key stored in hash table.
@@ -119,10 +160,18 @@ namespace ac {
 	HashTbl<KeyType,DataType,KeyHash,KeyEqual>&
     HashTbl<KeyType,DataType,KeyHash,KeyEqual>::operator=( const std::initializer_list< entry_type >& ilist )
     {
+        // The nodes of a stale list may have been handed out again: they are not freed with it.
+        for (size_t i{0}; i < m_size; i++) {
+            if (stale( i )) purge( i );
+        }
         // Set attributes.
         m_size = ilist.size();
         m_count = 0;
-        m_table = std::unique_ptr<list_type[]> (new list_type[m_size]);
+        m_table = make_buckets( m_size );
+        restamp();
+        m_trees.reset();
+        m_n_trees = 0;
+        if (m_filter) rebuild_filter();
         // Run through all elements.
         auto element = ilist.begin(); // First element of initializer list.
         for (size_t i{0}; i < m_size; i++) {
@@ -143,7 +192,12 @@ namespace ac {
 	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
 	HashTbl<KeyType,DataType,KeyHash,KeyEqual>::~HashTbl( )
 	{
-        clear(); // Could be empty, due to the use of smart pointer.
+        // The collision lists free their nodes as m_table is destroyed. Arena nodes that need
+        // no destructor are dropped with the arena instead, without visiting each of them.
+        if (drops_nodes()) {
+            for (size_t i{0}; i < m_size; i++)
+                forget( i );
+        }
 	}
 
     /*!
@@ -162,33 +216,351 @@ namespace ac {
 	bool HashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert( const KeyType & key_, const DataType & new_data_ )
     {
         KeyHash hashFunc; // Instantiate the "functor" for primary hash.
-        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
-        entry_type new_entry{ key_ , new_data_ }; // Create a new entry based on arguments.
         // Apply double hashing method, one functor and the other with modulo function.
-        auto end{ hashFunc( key_ ) % m_size };
-        // First element of collision list that will be insert the new_entry.
-        auto it = m_table[end].begin();
-        // Comparing keys inside the collision list.
-        for (size_t i{0}; i < m_table[end].size(); i++) {
+        auto hash{ hashFunc( key_ ) };
+        auto end{ hash % m_size };
+        auto & bucket = fresh( end );
+        // Looking for the key in the collision list (unless the filter proves the key is new).
+        if (not m_filter or m_filter->may_contain( hash )) {
+            auto it = locate( end, hash, key_ );
             // In this case, the key already exists in the table.
-            if ( true == equalFunc( it->m_key, new_entry.m_key ) ) {
+            if (it != bucket.end()) {
                 it->m_data = new_data_; // Update the data of the element.
                 return false;
             }
-            it++;
         }
         // In this case, a new element will be inserted into the table.
-        m_table[end].push_back( new_entry );
-        m_count++;
-        // Check if it is necessary to rehash().
-        if (m_count / m_size > m_max_load_factor) {
-            rehash();
-        }
+        bucket.emplace_back( key_, new_data_ );
+        appended( end, hash );
         return true;
     }
 	
     /*!
-     * @brief Clears the data table.
+     * @brief Inserts a range of entries (anything with m_key and m_data members).
+     * When the range size is known up front, the table is reserved once instead
+     * of rehashing while it grows.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param first the first entry to be inserted.
+     * @param last past the last entry to be inserted.
+     * @return the number of new elements; existing keys just have their data overwritten.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class InputIt, class >
+	typename HashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    HashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert( InputIt first, InputIt last )
+    {
+        using category = typename std::iterator_traits<InputIt>::iterator_category;
+        if (std::is_base_of< std::forward_iterator_tag, category >::value)
+            reserve( m_count + std::distance( first, last ) );
+        size_type inserted{0};
+        for (; first != last; ++first)
+            inserted += insert( first->m_key, first->m_data ) ? 1 : 0;
+        return inserted;
+    }
+
+    /*!
+     * @brief Inserts a range of pairs (KeyHash value, entry) whose hash was computed
+     * ahead of time, e.g. by loader threads. The entries are moved into the table.
+     * Inserting a range already grouped by bucket() keeps the writes local.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param first the first pair to be inserted.
+     * @param last past the last pair to be inserted.
+     * @return the number of new elements; existing keys just have their data overwritten.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class InputIt >
+	typename HashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    HashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert_hashed( InputIt first, InputIt last )
+    {
+        size_type inserted{0};
+        for (; first != last; ++first)
+            inserted += insert_entry( first->first, std::move( first->second ) ) ? 1 : 0;
+        return inserted;
+    }
+
+    /*!
+     * @brief Stores entry_ in the collision list selected by its precomputed hash.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param hash_ KeyHash value of the entry key.
+     * @param entry_ the entry to be stored.
+     * @return true if a new element was inserted; false if the key's data was overwritten.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Entry >
+	bool HashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert_entry( size_type hash_, Entry && entry_ )
+    {
+        auto end{ hash_ % m_size };
+        auto & bucket = fresh( end );
+        auto it = locate( end, hash_, entry_.m_key );
+        if (it != bucket.end()) {
+            it->m_data = std::forward<Entry>( entry_ ).m_data;
+            return false;
+        }
+        bucket.emplace_back( std::forward<Entry>( entry_ ) );
+        appended( end, hash_ );
+        return true;
+    }
+
+    /*!
+     * @brief Makes room for n_ elements: the table grows, at most once, to the smallest
+     * prime size that keeps the load factor of n_ elements within m_max_load_factor.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param n_ expected number of elements.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void HashTbl<KeyType,DataType,KeyHash,KeyEqual>::reserve( size_type n_ )
+    {
+        if (n_ > m_size * m_max_load_factor) {
+            rehash( find_next_prime( static_cast<size_type>( std::ceil( n_ / m_max_load_factor ) ) ) );
+        }
+    }
+
+    /*!
+     * @brief Visits the elements of a range of collision lists, in table order.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param first_bucket first collision list to visit.
+     * @param last_bucket past the last collision list to visit (clamped to bucket_count()).
+     * @param f called as f(const entry_type &) for each element.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Func >
+    void HashTbl<KeyType,DataType,KeyHash,KeyEqual>::for_each( size_type first_bucket, size_type last_bucket, Func f ) const
+    {
+        last_bucket = std::min( last_bucket, m_size );
+        for (auto i = first_bucket; i < last_bucket; i++) {
+            if (stale( i )) continue;
+            for (const auto & element : m_table[i])
+                f( element );
+        }
+    }
+
+    /*!
+     * @brief Calls f on every element of the table from several threads. Workers claim
+     * morsel_ collision lists at a time, so a list is only ever visited by one of them
+     * and f needs no locking for the element it gets.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param f called as f(const KeyType &, DataType &) for each element, concurrently.
+     * @param threads_ number of workers (0: one per hardware thread).
+     * @param morsel_ collision lists claimed by a worker at a time.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Func >
+    void HashTbl<KeyType,DataType,KeyHash,KeyEqual>::parallel_for_each( Func f, size_type threads_, size_type morsel_ )
+    {
+        morsel_ = std::max< size_type >( morsel_, 1 );
+        const size_type workers = std::min( worker_count( threads_ ), ( m_size + morsel_ - 1 ) / morsel_ );
+        MorselQueue morsels( m_size, morsel_ );
+        run_workers( workers, [&]( size_type ) {
+            size_type first, last;
+            while (morsels.next( first, last ))
+                for (auto i = first; i < last; i++)
+                    if (not stale( i ))
+                        for (auto & element : m_table[i])
+                            f( static_cast< const KeyType & >( element.m_key ), element.m_data );
+        } );
+    }
+
+    /*!
+     * @brief Parallel fold of the table: each worker folds the lists it claims into a
+     * partial result of its own, and the partials are combined at the end.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param identity starting value of every partial result (e.g. 0 for a sum).
+     * @param map called as map(const entry_type &) for each element; returns a T.
+     * @param combine called as combine(T, T); must be associative and commutative.
+     * @param threads_ number of workers (0: one per hardware thread).
+     * @param morsel_ collision lists claimed by a worker at a time.
+     * @return the combination of identity and map(e) over every element e.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class T, class Map, class Combine >
+    T HashTbl<KeyType,DataType,KeyHash,KeyEqual>::parallel_reduce( T identity, Map map, Combine combine,
+                                                                   size_type threads_, size_type morsel_ ) const
+    {
+        morsel_ = std::max< size_type >( morsel_, 1 );
+        const size_type workers = std::min( worker_count( threads_ ), ( m_size + morsel_ - 1 ) / morsel_ );
+        std::vector< T > partial( std::max< size_type >( workers, 1 ), identity );
+        MorselQueue morsels( m_size, morsel_ );
+        run_workers( workers, [&]( size_type w_ ) {
+            T acc = identity;
+            size_type first, last;
+            while (morsels.next( first, last ))
+                for (auto i = first; i < last; i++)
+                    if (not stale( i ))
+                        for (const auto & element : m_table[i])
+                            acc = combine( std::move( acc ), map( element ) );
+            partial[w_] = std::move( acc );
+        } );
+        T result = std::move( identity );
+        for (auto & p : partial)
+            result = combine( std::move( result ), std::move( p ) );
+        return result;
+    }
+
+    /*!
+     * @brief Erases, in parallel, every element that satisfies pred. Each worker moves
+     * the erased nodes of the lists it claims into a list of its own and counts them,
+     * so the table-wide bookkeeping (m_count, list indexes, filter) is settled once,
+     * after the workers are done, without locks.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param pred called as pred(const KeyType &, const DataType &), concurrently.
+     * @param threads_ number of workers (0: one per hardware thread).
+     * @param morsel_ collision lists claimed by a worker at a time.
+     * @return the number of elements erased.
+     * @throw whatever pred throws, once every worker has stopped; the elements
+     * erased until then stay erased and are no longer counted by size().
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Pred >
+    typename HashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    HashTbl<KeyType,DataType,KeyHash,KeyEqual>::erase_if( Pred pred, size_type threads_, size_type morsel_ )
+    {
+        morsel_ = std::max< size_type >( morsel_, 1 );
+        const size_type workers = std::max< size_type >( std::min( worker_count( threads_ ), ( m_size + morsel_ - 1 ) / morsel_ ), 1 );
+        std::vector< size_type > erased( workers, 0 ), dropped( workers, 0 );
+        // Nodes of an arena go back to its (unsynchronized) free list on this thread, after the join.
+        // (Built one by one: a copied list would get a heap allocator, and splice needs equal ones.)
+        std::vector< list_type > removed;
+        removed.reserve( workers );
+        for (size_type w{0}; w < workers; w++)
+            removed.emplace_back( typename list_type::allocator_type( m_arena.get() ) );
+        // Counts what left list i_ and fixes its tree; runs even if pred threw halfway through the list.
+        auto settle = [&]( size_type w_, size_type i_, size_type before_ ) {
+            auto & list = m_table[i_];
+            if (list.size() == before_) return;
+            erased[w_] += before_ - list.size();
+            if (m_trees and m_trees[i_]) {
+                if (list.size() <= m_treeify_threshold * 3 / 4) {
+                    m_trees[i_].reset();
+                    dropped[w_]++;
+                }
+                else m_trees[i_] = build_tree( i_ );
+            }
+        };
+        MorselQueue morsels( m_size, morsel_ );
+        auto work = [&]( size_type w_ ) {
+            size_type first, last;
+            while (morsels.next( first, last )) {
+                for (auto i = first; i < last; i++) {
+                    if (stale( i )) continue;
+                    auto & list = m_table[i];
+                    auto before = list.size();
+                    try {
+                        for (auto it = list.begin(); it != list.end();) {
+                            if (pred( static_cast< const KeyType & >( it->m_key ), static_cast< const DataType & >( it->m_data ) ))
+                                removed[w_].splice( removed[w_].end(), list, it++ );
+                            else
+                                ++it;
+                        }
+                    }
+                    catch (...) {
+                        settle( w_, i, before );
+                        throw;
+                    }
+                    settle( w_, i, before );
+                }
+                if (not m_arena) removed[w_].clear();
+            }
+        };
+        // The elements erased before pred threw stay erased, and are accounted for before the rethrow.
+        size_type total{0};
+        auto finish = [&]() {
+            for (size_type w{0}; w < workers; w++) {
+                total += erased[w];
+                m_n_trees -= dropped[w];
+            }
+            removed.clear();
+            m_count -= total;
+            filter_erased( total );
+        };
+        try {
+            run_workers( workers, work );
+        }
+        catch (...) {
+            finish();
+            throw;
+        }
+        finish();
+        return total;
+    }
+
+    /*!
+     * @brief Turns on the membership filter, built from the current keys.
+     * retrieve(), at() and erase() then answer most lookups of absent keys from one
+     * cache line of the filter, and insert() skips the scan of the collision list
+     * for keys that are certainly new. The filter is kept in sync by insert(),
+     * erase(), clear() and rehash().
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param fpr target false positive rate (fraction of absent keys the filter lets through).
+     * @throw std::invalid_argument unless 0 < fpr < 1; the current filter, if any, is kept.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void HashTbl<KeyType,DataType,KeyHash,KeyEqual>::enable_filter( double fpr )
+    {
+        m_filter.reset( new BlockedBloomFilter( 1, fpr ) );
+        rebuild_filter();
+    }
+
+    /*!
+     * @brief Refills the filter from the table keys, sized for the number of elements
+     * the table can hold before its next rehash().
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void HashTbl<KeyType,DataType,KeyHash,KeyEqual>::rebuild_filter()
+    {
+        KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+        // insert() rehashes once m_count / m_size (an integer division) exceeds m_max_load_factor.
+        auto capacity = static_cast<size_type>( ( m_max_load_factor + 1 ) * m_size );
+        m_filter->resize( std::max( capacity, m_count ) );
+        for_each( [&]( const entry_type & e ) { m_filter->add( hashFunc( e.m_key ) ); } );
+        m_filter_stale = 0;
+    }
+
+    /*!
+     * @brief Clears the data table. With lazy_clear() on, the collision lists are not
+     * visited: the table moves to a new generation, and each list of an older one is
+     * emptied when it is next written to. Arena nodes that need no destructor are not
+     * visited either way: the arena hands its memory out again from the start.
      * @tparam KeyType type of key stored in hash table.
      * @tparam DataType data type stored in hash table.
      * @tparam KeyHash type of primary dispersion function received by the client.
@@ -198,11 +570,86 @@ namespace ac {
     template <typename KeyType, typename DataType, typename KeyHash, typename KeyEqual>
     void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::clear()
     {
-        // Clears all linked lists (std::list) in the table.
-        for (size_t i{0}; i < m_size; i++) {
-            m_table[i].clear();
+        if (m_stamps and m_generation < UINT32_MAX) {
+            m_generation++; // Every collision list is stale now.
+        }
+        else {
+            // Clears all linked lists (std::list) in the table.
+            m_generation = 0;
+            for (size_t i{0}; i < m_size; i++) {
+                purge( i );
+            }
         }
+        if (drops_nodes()) m_arena->reset();
         m_count = 0; // No elements in hash table.
+        m_trees.reset();
+        m_n_trees = 0;
+        if (m_filter) {
+            m_filter->clear();
+            m_filter_stale = 0;
+        }
+    }
+
+    /*!
+     * @brief Turns lazy clearing on or off (see clear()). It costs a 32-bit stamp per
+     * collision list, and stale lists keep their nodes until they are written to again.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param on_ true to clear in O(1) from now on; false to empty the stale lists and go back.
+     */
+    template <typename KeyType, typename DataType, typename KeyHash, typename KeyEqual>
+    void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::lazy_clear( bool on_ )
+    {
+        if (on_ == lazy_clear()) return;
+        if (on_) {
+            m_stamps.reset( new std::uint32_t[ m_size ]() );
+            m_generation = 0;
+            return;
+        }
+        for (size_t i{0}; i < m_size; i++) {
+            if (stale( i )) purge( i );
+        }
+        m_stamps.reset();
+    }
+
+    /*!
+     * @brief Empties collision list b_ and stamps it with the current generation.
+     * @param b_ the collision list.
+     */
+    template <typename KeyType, typename DataType, typename KeyHash, typename KeyEqual>
+    void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::purge( size_type b_ )
+    {
+        // After clear() reset the arena, the nodes of a stale list may already hold new entries.
+        if (drops_nodes()) forget( b_ );
+        else m_table[b_].clear();
+        if (m_stamps) m_stamps[b_] = m_generation;
+    }
+
+    /*!
+     * @brief Makes collision list b_ empty without visiting its nodes, which are left to the
+     * arena. Only for nodes that need no destructor (see drops_nodes()).
+     * @param b_ the collision list.
+     */
+    template <typename KeyType, typename DataType, typename KeyHash, typename KeyEqual>
+    void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::forget( size_type b_ )
+    {
+        // Reusing the storage of a list without running its destructor is fine: the only
+        // effect skipped is the deallocation of its nodes, which the arena takes care of.
+        new ( &m_table[b_] ) list_type( typename list_type::allocator_type( m_arena.get() ) );
+    }
+
+    /*!
+     * @brief Stamps every collision list as current, after m_table was rebuilt.
+     */
+    template <typename KeyType, typename DataType, typename KeyHash, typename KeyEqual>
+    void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::restamp()
+    {
+        if (not m_stamps) return;
+        m_stamps.reset( new std::uint32_t[ m_size ]() );
+        m_generation = 0;
     }
 
     /*!
@@ -235,26 +682,26 @@ namespace ac {
     bool HashTbl<KeyType, DataType, KeyHash, KeyEqual>::retrieve( const KeyType & key_, DataType & data_item_ ) const
     {
         KeyHash hashFunc; // Instantiate the "functor" for primary hash.
-        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
         // Apply double hashing method, one functor and the other with modulo function.
-        auto end{ hashFunc( key_ ) % m_size };
-        // First element of collision list that will be searched the element.
-        auto it = m_table[end].begin();
-        for (size_t i{0}; i < m_table[end].size(); i++) {
-            // The element key was found and its data returned.
-            if ( true == equalFunc( it->m_key, key_ ) ) {
-                data_item_ = it->m_data;
-                return true;
-            }
-            it++; // Next element of collision list.
+        auto hash{ hashFunc( key_ ) };
+        // Definite misses are answered without touching the table.
+        if (filter_rejects( hash )) return false;
+        auto end{ hash % m_size };
+        auto it = locate( end, hash, key_ );
+        // The element key was found and its data returned.
+        if (it != m_table[end].end()) {
+            data_item_ = it->m_data;
+            return true;
         }
+        filter_missed();
         return false;
     }
 
     /*!
      * @brief Method that will be called when load factor is greater than m_max_load_factor.
      * This method will create a new table whose size will be equal to smaller
-     * prime number >= than twice the size of the table before the rehash() call. 
+     * prime number >= than twice the size of the table before the rehash() call.
+     * The existing list nodes are moved to the new table, so entries keep their address.
      * @tparam KeyType type of key stored in hash table.
      * @tparam DataType data type stored in hash table.
      * @tparam KeyHash type of primary dispersion function received by the client.
@@ -263,39 +710,41 @@ namespace ac {
      */
     template <typename KeyType, typename DataType, typename KeyHash, typename KeyEqual>
     void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::rehash( void )
+    {
+        rehash( find_next_prime(m_size * 2) );
+    }
+
+    /*!
+     * @brief Moves every element into a new table with size_aux collision lists.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param size_aux the new table size.
+     */
+    template <typename KeyType, typename DataType, typename KeyHash, typename KeyEqual>
+    void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::rehash( size_type size_aux )
     {
         KeyHash hashFunc; // Instantiate the "functor" for primary hash.
-        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
         // Auxiliary hash table.
-        size_type size_aux = find_next_prime(m_size * 2);
-        std::unique_ptr<list_type[]> table_aux = std::unique_ptr<list_type[]> (new list_type[size_aux]);
-        // The table elements will be passed to the auxiliary table.
+        auto table_aux = make_buckets( size_aux );
+        // The list nodes are spliced into the auxiliary table: no entry is copied or reallocated.
         for (size_t i{0}; i < m_size; i++) {
-            auto element = m_table[i].begin(); // First element of collision list i.
-            auto sz = m_table[i].size(); // Size of collision list i.
-            for (size_t j{0}; j < sz; j++) {
-                entry_type new_entry{ element->m_key , element->m_data }; // Element of collision list.
+            if (stale( i )) purge( i );
+            while (not m_table[i].empty()) {
+                auto element = m_table[i].begin(); // First element of collision list i.
                 // Apply double hashing method, one functor and the other with modulo function.
                 auto end{ hashFunc( element->m_key ) % size_aux };
-                table_aux[end].push_back( new_entry ); // Add the element to the collision list.
-                element++; // Next element of collision list i.
+                table_aux[end].splice( table_aux[end].end(), m_table[i], element );
             }
         }
         // Update attributes.
         m_size = size_aux;
-        m_table = std::unique_ptr<list_type[]> (new list_type[m_size]);
-        // The elements of the auxiliary hash table will be passed to the original hash table.
-        for (size_t i{0}; i < m_size; i++) {
-            auto element = table_aux[i].begin(); // First element of collision list i.
-            auto sz = table_aux[i].size(); // Size of collision list i.
-            for (size_t j{0}; j < sz; j++) {
-                entry_type new_entry{ element->m_key , element->m_data }; // Element of collision list.
-                // Apply double hashing method, one functor and the other with modulo function.
-                auto end{ hashFunc( element->m_key ) % size_aux };
-                m_table[end].push_back( new_entry ); // Add the element to the collision list.
-                element++; // Next element of collision list i.
-            }
-        }
+        m_table = std::move( table_aux );
+        restamp();
+        rebuild_trees();
+        if (m_filter) rebuild_filter();
     }
 
     /*!
@@ -312,21 +761,19 @@ namespace ac {
     bool HashTbl< KeyType, DataType, KeyHash, KeyEqual >::erase( const KeyType & key_ )
     {
         KeyHash hashFunc; // Instantiate the "functor" for primary hash.
-        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
         // Apply double hashing method, one functor and the other with modulo function.
-        auto end{ hashFunc( key_ ) % m_size };
-        // First element in the collision list of the element to be removed.
-        auto it = m_table[end].begin();
-        // Comparing keys inside the collision list.
-        for (size_t i{0}; i < m_table[end].size(); i++) {
-            // If it finds the key, removes the element and decreases the number of elements (m_count).
-            if ( true == equalFunc( it->m_key, key_ ) ) {
-                m_table[end].erase(it);
-                m_count--;
-                return true;
-            }
-            it++;
+        auto hash{ hashFunc( key_ ) };
+        if (filter_rejects( hash )) return false;
+        auto end{ hash % m_size };
+        auto it = locate( end, hash, key_ );
+        // If it finds the key, removes the element and decreases the number of elements (m_count).
+        if (it != m_table[end].end()) {
+            unlink( end, hash, it );
+            m_count--;
+            filter_erased( 1 );   // Bloom filter bits cannot be cleared.
+            return true;
         }
+        filter_missed();
         return false;
     }
 
@@ -418,7 +865,7 @@ namespace ac {
         KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
         // Apply double hashing method, one functor and the other with modulo function.
         auto end{ hashFunc( key_ ) % m_size };
-        return m_table[end].size();
+        return stale( end ) ? 0 : m_table[end].size();
     }
 
     /*!
@@ -436,22 +883,61 @@ namespace ac {
     DataType& HashTbl<KeyType, DataType, KeyHash, KeyEqual>::at( const KeyType & key_ )
     {
         KeyHash hashFunc; // Instantiate the "functor" for primary hash.
-        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
         // Apply double hashing method, one functor and the other with modulo function.
-        auto end{ hashFunc( key_ ) % m_size };
-        // First element in the collision list of the element to be searched for.
-        auto it = m_table[end].begin();
-        // Comparing keys inside the collision list.
-        for (size_t i{0}; i < m_table[end].size(); i++) {
-            if ( true == equalFunc( it->m_key, key_ ) ) {
-                return it->m_data;
-            }
-            it++;
+        auto hash{ hashFunc( key_ ) };
+        if (filter_rejects( hash ))
+            throw std::out_of_range("[HashTbl::at()]: key doesn't exist in the hash table.");
+        auto end{ hash % m_size };
+        auto it = locate( end, hash, key_ );
+        if (it != m_table[end].end()) {
+            return it->m_data;
         }
+        filter_missed();
         // The case where the element is not found.
         throw std::out_of_range("[HashTbl::at()]: key doesn't exist in the hash table.");
     }
 
+    /*!
+     * @brief Looks up the data associated with the given key key_ without throwing.
+     * The pointer stays valid until the element is erased: rehash() moves list nodes, not entries.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param key_ key that we look for the data.
+     * @return pointer to the data associated with key_; nullptr if the key is not in the table.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    const DataType* HashTbl<KeyType, DataType, KeyHash, KeyEqual>::find( const KeyType & key_ ) const
+    {
+        KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+        auto hash{ hashFunc( key_ ) };
+        if (filter_rejects( hash )) return nullptr;
+        auto end{ hash % m_size };
+        auto it = locate( end, hash, key_ );
+        if (it != m_table[end].end())
+            return &it->m_data;
+        filter_missed();
+        return nullptr;
+    }
+
+    /*!
+     * @brief Looks up the data associated with the given key key_ without throwing.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function 
+     * performed on the collision list received by the client.
+     * @param key_ key that we look for the data.
+     * @return pointer to the data associated with key_; nullptr if the key is not in the table.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    DataType* HashTbl<KeyType, DataType, KeyHash, KeyEqual>::find( const KeyType & key_ )
+    {
+        return const_cast< DataType* >( static_cast< const HashTbl & >( *this ).find( key_ ) );
+    }
+
     /*!
      * @brief Returns a reference to the data associated with the given key key_, if any. If the key is not in the 
      * table, the method performs the insert and returns the reference to the newly inserted data in the table.
@@ -466,15 +952,154 @@ namespace ac {
 	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
     DataType& HashTbl<KeyType, DataType, KeyHash, KeyEqual>::operator[]( const KeyType & key_ )
     {
-        // Tries to find the element through the at method.
-        try {
-            auto it = at( key_ );
-            return at( key_ );
+        KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+        auto hash{ hashFunc( key_ ) };
+        auto end{ hash % m_size };
+        auto & bucket = fresh( end );
+        // One lookup in the collision list (none when the filter proves the key is absent).
+        if (not filter_rejects( hash )) {
+            auto it = locate( end, hash, key_ );
+            if (it != bucket.end())
+                return it->m_data;
+            filter_missed();
+        }
+        // Not found: append a default entry. rehash() splices list nodes, so the
+        // reference taken here stays valid if the insertion triggers it.
+        bucket.emplace_back( key_, DataType{} );
+        DataType & data = bucket.back().m_data;
+        appended( end, hash );
+        return data;
+    }
+
+    /*!
+     * @brief Sets the collision list length at which a list gets an ordered index.
+     * Lists that are already that long are indexed right away; 0 drops every index.
+     * @param n the new threshold (0 disables treeification).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::treeify_threshold( size_type n )
+    {
+        m_treeify_threshold = n;
+        rebuild_trees();
+    }
+
+    /*!
+     * @brief Finds a key in a collision list: through its index when the list has one
+     * (O(log n) comparisons), by a scan with KeyEqual otherwise.
+     * @param b_ the collision list.
+     * @param hash_ KeyHash value of key_.
+     * @param key_ the key to look for.
+     * @return the entry of key_, or the end() of the list.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename HashTbl<KeyType, DataType, KeyHash, KeyEqual>::list_type::iterator
+    HashTbl<KeyType, DataType, KeyHash, KeyEqual>::locate( size_type b_, size_type hash_, const KeyType & key_ ) const
+    {
+        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
+        auto & bucket = m_table[b_];
+        if (stale( b_ )) return bucket.end();
+        if (m_trees and m_trees[b_]) {
+            // Keys not ordered by < (see TreeLess) share one tree position per hash value: scan those.
+            auto range = m_trees[b_]->equal_range( TreeKey{ hash_, &key_ } );
+            for (auto it = range.first; it != range.second; ++it) {
+                if ( true == equalFunc( it->second->m_key, key_ ) )
+                    return it->second;
+            }
+            return bucket.end();
+        }
+        for (auto it = bucket.begin(); it != bucket.end(); ++it) {
+            if ( true == equalFunc( it->m_key, key_ ) )
+                return it;
+        }
+        return bucket.end();
+    }
+
+    /*!
+     * @brief Accounts for an entry just appended to collision list b_: counts it, adds it
+     * to the filter and to the list index (treeifying the list when it reaches the
+     * threshold), and grows the table if the load factor is exceeded.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::appended( size_type b_, size_type hash_ )
+    {
+        m_count++;
+        if (m_filter) m_filter->add( hash_ );
+        if (m_trees and m_trees[b_]) {
+            auto it = std::prev( m_table[b_].end() );
+            m_trees[b_]->emplace( TreeKey{ hash_, &it->m_key }, it );
+        }
+        else if (m_treeify_threshold > 0 and m_table[b_].size() >= m_treeify_threshold)
+            treeify( b_ );
+        // Check if it is necessary to rehash().
+        if (m_count / m_size > m_max_load_factor) {
+            rehash();
+        }
+    }
+
+    /*!
+     * @brief Erases entry it_ from collision list b_ and from the list index, which is
+     * dropped once the list is short again.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::unlink( size_type b_, size_type hash_,
+                                                                typename list_type::iterator it_ )
+    {
+        if (m_trees and m_trees[b_]) {
+            auto & tree = *m_trees[b_];
+            auto range = tree.equal_range( TreeKey{ hash_, &it_->m_key } );
+            for (auto t = range.first; t != range.second; ++t) {
+                if (t->second == it_) { tree.erase( t ); break; }
+            }
+            // Some slack below the threshold, so a list at its edge does not flip back and forth.
+            if (m_table[b_].size() - 1 <= m_treeify_threshold * 3 / 4) {
+                m_trees[b_].reset();
+                m_n_trees--;
+            }
         }
-        // If the exception is returned we do an insertion of the key.
-        catch (const std::out_of_range& e) {
-            insert( key_, DataType{} );
-            return at( key_ );
+        m_table[b_].erase( it_ );
+    }
+
+    /*!
+     * @brief Gives collision list b_ an ordered index over (KeyHash value, key), as Java's
+     * HashMap does with its tree bins. Lookups in the list then cost O(log n) comparisons
+     * instead of one KeyEqual call per entry, whether the list is long because of a weak
+     * KeyHash or of keys chosen to collide. Entries of equal hash are ordered by operator<
+     * only when KeyEqual is std::equal_to or declares `agrees_with_less`; otherwise they
+     * are told apart by a scan with KeyEqual, so a KeyEqual looser than < still works.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::treeify( size_type b_ )
+    {
+        if (not m_trees) {
+            m_trees.reset( new std::unique_ptr< tree_type >[m_size] );
+        }
+        m_trees[b_] = build_tree( b_ );
+        m_n_trees++;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    std::unique_ptr< typename HashTbl<KeyType, DataType, KeyHash, KeyEqual>::tree_type >
+    HashTbl<KeyType, DataType, KeyHash, KeyEqual>::build_tree( size_type b_ ) const
+    {
+        KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+        std::unique_ptr< tree_type > tree( new tree_type );
+        for (auto it = m_table[b_].begin(); it != m_table[b_].end(); ++it)
+            tree->emplace( TreeKey{ hashFunc( it->m_key ), &it->m_key }, it );
+        return tree;
+    }
+
+    /*!
+     * @brief Drops the list indexes and treeifies again every list at or over the threshold.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void HashTbl<KeyType, DataType, KeyHash, KeyEqual>::rebuild_trees()
+    {
+        m_trees.reset();
+        m_n_trees = 0;
+        if (m_treeify_threshold == 0) return;
+        for (size_type i{0}; i < m_size; i++) {
+            if (not stale( i ) and m_table[i].size() >= m_treeify_threshold)
+                treeify( i );
         }
     }
 } // Namespace ac.
@@ -0,0 +1,224 @@
+/*!
+ * @file hashtbl_dump.h
+ * Buffered text and binary export of a hash table to a file descriptor.
+ */
+#ifndef _HASHTBL_DUMP_H_
+#define _HASHTBL_DUMP_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>  // std::runtime_error
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>   // write
+
+namespace ac // Associative container
+{
+    /// Buffered writer over a file descriptor: the descriptor only sees large writes.
+    class FdWriter {
+        public:
+            explicit FdWriter( int fd_, std::size_t buffer_bytes_ = 1u << 20 )
+                : m_fd{fd_}, m_capacity{ std::max< std::size_t >( buffer_bytes_, 4096 ) }
+            { m_buffer.reserve( m_capacity ); }
+            ~FdWriter() { try { flush(); } catch (...) {} }
+            FdWriter( const FdWriter & ) = delete;
+            FdWriter & operator=( const FdWriter & ) = delete;
+
+            /// Appends bytes, writing the buffer out whenever it fills up.
+            void write( const char * p_, std::size_t n_ ) {
+                if (m_buffer.size() + n_ > m_capacity) {
+                    flush();
+                    if (n_ >= m_capacity) { write_fully( p_, n_ ); return; }
+                }
+                m_buffer.append( p_, n_ );
+            }
+            void write( const std::string & s_ ) { write( s_.data(), s_.size() ); }
+
+            /// Writes the buffered bytes to the descriptor.
+            void flush() {
+                write_fully( m_buffer.data(), m_buffer.size() );
+                m_buffer.clear();
+            }
+
+            /// Total bytes handed to the descriptor so far.
+            std::size_t bytes_written() const { return m_written; }
+
+        private:
+            void write_fully( const char * p_, std::size_t n_ ) {
+                while (n_ > 0) {
+                    auto w = ::write( m_fd, p_, n_ );
+                    if (w < 0) {
+                        if (errno == EINTR) continue;
+                        throw std::runtime_error( std::string("[FdWriter::write()]: ") + std::strerror( errno ) );
+                    }
+                    p_ += w;
+                    n_ -= static_cast< std::size_t >( w );
+                    m_written += static_cast< std::size_t >( w );
+                }
+            }
+
+            int m_fd;               //!< Destination; not owned.
+            std::size_t m_capacity; //!< Buffer size.
+            std::string m_buffer;   //!< Pending bytes.
+            std::size_t m_written = 0;
+    };
+
+    /// Default text formatter: the entry's operator<<, into a reused string stream.
+    /*! Prefer a formatter that appends to the string directly when one exists. */
+    struct OstreamFormatter {
+        template< class Entry >
+        void operator()( const Entry & e_, std::string & out_ ) {
+            m_os.str( std::string() );
+            m_os << e_;
+            out_ += m_os.str();
+        }
+        std::ostringstream m_os;
+    };
+
+    /// Writes one line per element (the same text operator<< produces) to fd_.
+    /*!
+     *  @param table_ the table to be dumped.
+     *  @param fd_ destination file descriptor.
+     *  @param fmt_ called as fmt(const entry_type &, std::string & out), appends the text of one element.
+     *  @param buffer_bytes_ size of the writes issued to fd_.
+     *  @return the number of elements written.
+     */
+    template< class Table, class Formatter = OstreamFormatter >
+    std::size_t dump_text( const Table & table_, int fd_, Formatter fmt_ = Formatter{},
+                           std::size_t buffer_bytes_ = 1u << 20 )
+    {
+        FdWriter out{ fd_, buffer_bytes_ };
+        std::string line;
+        std::size_t n{0};
+        table_.for_each( [&]( const typename Table::entry_type & e ) {
+            line.clear();
+            fmt_( e, line );
+            line += '\n';
+            out.write( line );
+            n++;
+        } );
+        out.flush();
+        return n;
+    }
+
+    /// Header of a binary dump; each record then follows as [uint32 length][bytes].
+    struct DumpHeader {
+        char m_magic[4];        //!< "HTBD".
+        std::uint32_t m_version;//!< Format version (1).
+        std::uint64_t m_count;  //!< Number of records.
+    };
+
+    /// Writes a binary dump: a DumpHeader and one length-prefixed record per element.
+    /*!
+     *  @param encode_ called as encode(const entry_type &, std::string & out), appends the record bytes.
+     *  @return the number of elements written.
+     */
+    template< class Table, class Encoder >
+    std::size_t dump_binary( const Table & table_, int fd_, Encoder encode_,
+                             std::size_t buffer_bytes_ = 1u << 20 )
+    {
+        FdWriter out{ fd_, buffer_bytes_ };
+        DumpHeader header{ {'H','T','B','D'}, 1, static_cast< std::uint64_t >( table_.size() ) };
+        out.write( reinterpret_cast< const char * >( &header ), sizeof( header ) );
+        std::string record;
+        std::size_t n{0};
+        table_.for_each( [&]( const typename Table::entry_type & e ) {
+            record.assign( sizeof( std::uint32_t ), '\0' );
+            encode_( e, record );
+            auto len = static_cast< std::uint32_t >( record.size() - sizeof( std::uint32_t ) );
+            std::memcpy( &record[0], &len, sizeof( len ) );
+            out.write( record );
+            n++;
+        } );
+        out.flush();
+        return n;
+    }
+
+    /// Same output as dump_text(), with bucket ranges formatted by several threads.
+    /*! Workers format consecutive bucket ranges into their own buffers; the calling
+     *  thread writes the buffers in table order. At most `threads_ * 2` formatted
+     *  ranges wait in memory at any time.
+     *  @param make_fmt_ called once per worker to get its formatter.
+     *  @return the number of elements written.
+     */
+    template< class Table, class FormatterFactory >
+    std::size_t parallel_dump_text( const Table & table_, int fd_, FormatterFactory make_fmt_,
+                                    std::size_t threads_ = std::thread::hardware_concurrency(),
+                                    std::size_t buffer_bytes_ = 1u << 20 )
+    {
+        threads_ = std::max< std::size_t >( threads_, 1 );
+        const std::size_t buckets = table_.bucket_count();
+        const std::size_t n_ranges = std::min< std::size_t >( buckets, threads_ * 16 );
+        const std::size_t window = threads_ * 2;
+
+        struct Range { std::string text; std::size_t count = 0; bool done = false; };
+        std::vector< Range > ranges( n_ranges );
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::size_t next{0}, written{0};
+
+        auto worker = [&]() {
+            auto fmt = make_fmt_();
+            for (;;) {
+                std::size_t r;
+                {
+                    std::unique_lock< std::mutex > lock( mtx );
+                    cv.wait( lock, [&]() { return next >= n_ranges or next < written + window; } );
+                    if (next >= n_ranges) return;
+                    r = next++;
+                }
+                Range & range = ranges[r];
+                table_.for_each( r * buckets / n_ranges, ( r + 1 ) * buckets / n_ranges,
+                                 [&]( const typename Table::entry_type & e ) {
+                                     fmt( e, range.text );
+                                     range.text += '\n';
+                                     range.count++;
+                                 } );
+                std::lock_guard< std::mutex > lock( mtx );
+                range.done = true;
+                cv.notify_all();
+            }
+        };
+        std::vector< std::thread > pool;
+        for (std::size_t t{0}; t < threads_; t++)
+            pool.emplace_back( worker );
+
+        FdWriter out{ fd_, buffer_bytes_ };
+        std::size_t n{0};
+        try {
+            for (std::size_t r{0}; r < n_ranges; r++) {
+                {
+                    std::unique_lock< std::mutex > lock( mtx );
+                    cv.wait( lock, [&]() { return ranges[r].done; } );
+                }
+                out.write( ranges[r].text );
+                n += ranges[r].count;
+                std::string().swap( ranges[r].text );
+                std::lock_guard< std::mutex > lock( mtx );
+                written = r + 1;
+                cv.notify_all();
+            }
+            out.flush();
+        }
+        catch (...) {
+            {
+                std::lock_guard< std::mutex > lock( mtx );
+                next = n_ranges; // Stop the workers.
+                cv.notify_all();
+            }
+            for (auto & t : pool) t.join();
+            throw;
+        }
+        for (auto & t : pool) t.join();
+        return n;
+    }
+
+} // namespace ac
+#endif
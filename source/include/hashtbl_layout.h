@@ -0,0 +1,40 @@
+/*!
+ * @file hashtbl_layout.h
+ * Compile-time choice of the storage layout behind the HashTbl interface.
+ */
+#ifndef _HASHTBL_LAYOUT_H_
+#define _HASHTBL_LAYOUT_H_
+
+#include "hashtbl.h"
+#include "cuckoo_hashtbl.h"
+
+namespace ac // Associative container
+{
+    struct chained_layout {}; //!< HashTbl: prime number of std::list collision lists.
+    struct cuckoo_layout {};  //!< CuckooHashTbl: two 4-slot buckets per key, at most two buckets per lookup.
+
+    template< class Layout >
+    struct layout_traits;
+
+    template<>
+    struct layout_traits< chained_layout > {
+        template< class K, class D, class H, class E >
+        using table = HashTbl< K, D, H, E >;
+    };
+
+    template<>
+    struct layout_traits< cuckoo_layout > {
+        template< class K, class D, class H, class E >
+        using table = CuckooHashTbl< K, D, H, E >;
+    };
+
+    /// A hash table with the HashTbl interface and the storage layout given by Layout.
+    template< class KeyType,
+              class DataType,
+              class KeyHash = std::hash< KeyType >,
+              class KeyEqual = std::equal_to< KeyType >,
+              class Layout = chained_layout >
+    using BasicHashTbl = typename layout_traits< Layout >::template table< KeyType, DataType, KeyHash, KeyEqual >;
+
+} // namespace ac
+#endif
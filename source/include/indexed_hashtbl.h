@@ -0,0 +1,150 @@
+/*!
+ * @file indexed_hashtbl.h
+ * HashTbl with secondary indexes on projections of the data, kept up to date on every write.
+ */
+#ifndef _INDEXED_HASHTBL_H_
+#define _INDEXED_HASHTBL_H_
+
+#include <functional>   // std::function, std::hash, std::equal_to
+#include <memory>       // std::unique_ptr
+#include <vector>
+
+#include "hashtbl.h"
+
+namespace ac // Associative container
+{
+    namespace detail {
+        /// What an IndexedHashTbl needs of its indexes, whatever their key type.
+        template< class DataType >
+        struct IndexBase {
+            virtual ~IndexBase() = default;
+            virtual void add( const DataType * data_ ) = 0;
+            virtual void remove( const DataType * data_ ) = 0;
+            virtual void clear() = 0;
+        };
+    } // namespace detail
+
+    /// Secondary index: maps the projection of each element's data to the elements that share it.
+    /*! A posting list holds pointers to the data of the elements in the table (HashTbl
+     *  moves list nodes, not entries, so they stay valid until the element is erased);
+     *  nothing is copied. Each element remembers its position in its posting list, so
+     *  removing it costs O(1) too. The order of a posting list is unspecified.
+     */
+	template< class DataType,
+		      class IndexKey,
+		      class IndexHash = std::hash< IndexKey >,
+		      class IndexEqual = std::equal_to< IndexKey > >
+	class SecondaryIndex : public detail::IndexBase< DataType > {
+        public:
+            using size_type = std::size_t;
+            using handle = const DataType *;
+            using posting_list = std::vector< handle >;
+
+            explicit SecondaryIndex( std::function< IndexKey( const DataType & ) > projection_ )
+                : m_projection( std::move( projection_ ) ) {}
+
+            // The elements whose data projects to key_ (an empty list if there are none).
+            const posting_list & find( const IndexKey & key_ ) const {
+                static const posting_list none;
+                const posting_list * list = m_postings.find( key_ );
+                return list != nullptr ? *list : none;
+            }
+            size_type count( const IndexKey & key_ ) const { return find( key_ ).size(); }
+            // Number of distinct index keys.
+            size_type keys() const { return m_postings.size(); }
+            // Index key of data_.
+            IndexKey key_of( const DataType & data_ ) const { return m_projection( data_ ); }
+
+            void add( const DataType * data_ ) override {
+                posting_list & list = m_postings[ m_projection( *data_ ) ];
+                m_positions.insert( data_, list.size() );
+                list.push_back( data_ );
+            }
+            // data_ must still hold the data it was added with.
+            void remove( const DataType * data_ ) override {
+                auto key = m_projection( *data_ );
+                posting_list & list = m_postings.at( key );
+                auto pos = m_positions.at( data_ );
+                list[ pos ] = list.back();   // The last handle takes the place of the removed one.
+                m_positions[ list[ pos ] ] = pos;
+                list.pop_back();
+                m_positions.erase( data_ );
+                if (list.empty()) m_postings.erase( key );
+            }
+            void clear() override { m_postings.clear(); m_positions.clear(); }
+
+        private:
+            std::function< IndexKey( const DataType & ) > m_projection;
+            HashTbl< IndexKey, posting_list, IndexHash, IndexEqual > m_postings;
+            HashTbl< handle, size_type > m_positions;   //!< Position of each element in its posting list.
+    };
+
+    /// A HashTbl whose elements are also reachable through secondary indexes.
+    /*! add_index() indexes the data by a projection, e.g. the (bank, branch) codes of
+     *  an account; the index's find() then returns the matching elements in time
+     *  proportional to their number, instead of a scan of the table. insert(),
+     *  erase(), modify() and assignments through operator[] keep every index up to date.
+     *  The data is only reachable read-only otherwise, so that no write goes unseen.
+     */
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class IndexedHashTbl {
+        public:
+            using size_type = std::size_t;
+            using table_type = HashTbl< KeyType, DataType, KeyHash, KeyEqual >;
+
+            /// Result of operator[]: reads the element's data; assigning to it reindexes the element.
+            class DataRef {
+                public:
+                    DataRef & operator=( const DataType & data_ ) { m_owner->assign( *m_data, data_ ); return *this; }
+                    operator const DataType &() const { return *m_data; }
+                    const DataType & get() const { return *m_data; }
+                private:
+                    friend class IndexedHashTbl;
+                    DataRef( IndexedHashTbl * owner_, DataType * data_ ) : m_owner{ owner_ }, m_data{ data_ } {}
+                    IndexedHashTbl * m_owner;
+                    DataType * m_data;
+            };
+
+            explicit IndexedHashTbl( size_type table_sz_ = 1024 ) : m_table( table_sz_ ) {}
+            IndexedHashTbl( const IndexedHashTbl & ) = delete;
+            IndexedHashTbl & operator=( const IndexedHashTbl & ) = delete;
+
+            // Adds an index of the data by projection_ (a callable DataType -> IndexKey), filled
+            // with the elements already stored. The index lives as long as the table.
+            template< class IndexKey, class IndexHash = std::hash< IndexKey >,
+                      class IndexEqual = std::equal_to< IndexKey >, class Projection >
+            const SecondaryIndex< DataType, IndexKey, IndexHash, IndexEqual > & add_index( Projection projection_ );
+            size_type index_count() const { return m_indexes.size(); }
+
+            bool insert( const KeyType & key_, const DataType & data_ );
+            bool erase( const KeyType & key_ );
+            bool retrieve( const KeyType & key_, DataType & data_ ) const { return m_table.retrieve( key_, data_ ); }
+            const DataType * find( const KeyType & key_ ) const { return m_table.find( key_ ); }
+            size_type count( const KeyType & key_ ) const { return m_table.count( key_ ); }
+            // Calls f(data) on the data of key_ and reindexes it; false if the key is not stored.
+            template< class Func >
+            bool modify( const KeyType & key_, Func f );
+            // The data of key_, inserted as DataType{} if the key is not stored.
+            DataRef operator[]( const KeyType & key_ );
+            void clear();
+            size_type size() const { return m_table.size(); }
+            bool empty() const { return m_table.empty(); }
+            // The underlying table, read-only (writes must go through this class).
+            const table_type & table() const { return m_table; }
+
+        private:
+            // Replaces the data of a stored element, updating the indexes.
+            void assign( DataType & stored_, const DataType & data_ );
+            void unindex_all( const DataType * data_ ) { for (auto & index : m_indexes) index->remove( data_ ); }
+            void index_all( const DataType * data_ ) { for (auto & index : m_indexes) index->add( data_ ); }
+
+            table_type m_table;
+            std::vector< std::unique_ptr< detail::IndexBase< DataType > > > m_indexes;
+    };
+
+} // namespace ac
+#include "indexed_hashtbl.inl"
+#endif
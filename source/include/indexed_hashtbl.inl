@@ -0,0 +1,116 @@
+#include "indexed_hashtbl.h"
+
+namespace ac {
+    /*!
+     * @brief Adds a secondary index of the data, built from the elements already stored.
+     * @tparam IndexKey type the projection returns.
+     * @tparam IndexHash hash function of the index keys.
+     * @tparam IndexEqual equality of the index keys.
+     * @tparam Projection callable taking a const DataType & and returning an IndexKey.
+     * @param projection_ the projection that gives the index key of an element's data.
+     * @return the index, whose find() lists the elements of an index key.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class IndexKey, class IndexHash, class IndexEqual, class Projection >
+	const SecondaryIndex< DataType, IndexKey, IndexHash, IndexEqual > &
+    IndexedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::add_index( Projection projection_ )
+    {
+        using index_type = SecondaryIndex< DataType, IndexKey, IndexHash, IndexEqual >;
+        std::unique_ptr< index_type > index( new index_type( projection_ ) );
+        m_table.for_each( [&]( const typename table_type::entry_type & e ) { index->add( &e.m_data ); } );
+        const index_type & ref = *index;
+        m_indexes.push_back( std::move( index ) );
+        return ref;
+    }
+
+    /*!
+     * @brief Inserts an element, or replaces the data of its key, and updates the indexes.
+     * @param key_ element key to be inserted.
+     * @param data_ element data to be inserted.
+     * @return true if a new element was inserted; false if the key's data was overwritten.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	bool IndexedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert( const KeyType & key_, const DataType & data_ )
+    {
+        auto before = m_table.size();
+        DataType & stored = m_table[ key_ ];   // One lookup whether the key is new or not.
+        if (m_table.size() == before) {
+            assign( stored, data_ );
+            return false;
+        }
+        stored = data_;
+        index_all( &stored );
+        return true;
+    }
+
+    /*!
+     * @brief Removes an element from the indexes and from the table.
+     * @param key_ key of the element to be removed.
+     * @return true if the key was found; false otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	bool IndexedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::erase( const KeyType & key_ )
+    {
+        const DataType * stored = m_table.find( key_ );
+        if (stored == nullptr) return false;
+        unindex_all( stored );
+        return m_table.erase( key_ );
+    }
+
+    /*!
+     * @brief Changes the data of an element in place, then reindexes it.
+     * @param key_ key of the element to be changed.
+     * @param f callable taking a DataType &.
+     * @return true if the key was found; false otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Func >
+	bool IndexedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::modify( const KeyType & key_, Func f )
+    {
+        DataType * stored = m_table.find( key_ );
+        if (stored == nullptr) return false;
+        unindex_all( stored );
+        f( *stored );
+        index_all( stored );
+        return true;
+    }
+
+    /*!
+     * @brief Accesses the data of a key, inserting (and indexing) DataType{} if the key is not stored.
+     * @param key_ key of the element.
+     * @return a reference to the data; assigning to it updates the indexes.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	typename IndexedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::DataRef
+    IndexedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::operator[]( const KeyType & key_ )
+    {
+        auto before = m_table.size();
+        DataType & stored = m_table[ key_ ];
+        if (m_table.size() != before) index_all( &stored );
+        return DataRef( this, &stored );
+    }
+
+    /*!
+     * @brief Removes every element, from the table and from the indexes (which stay defined).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void IndexedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::clear()
+    {
+        for (auto & index : m_indexes) index->clear();
+        m_table.clear();
+    }
+
+    /*!
+     * @brief Overwrites the data of a stored element: out of the indexes with its old data, back in with the new.
+     * @param stored_ the data of the element, in the table.
+     * @param data_ the new data.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	void IndexedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::assign( DataType & stored_, const DataType & data_ )
+    {
+        unindex_all( &stored_ );
+        stored_ = data_;
+        index_all( &stored_ );
+    }
+
+} // Namespace ac.
@@ -0,0 +1,147 @@
+/*!
+ * @file int_hashtbl.h
+ * Open-addressed hash table specialized for integer keys.
+ * Linear probing in Robin Hood order, with backward-shift deletion.
+ */
+#ifndef _INT_HASHTBL_H_
+#define _INT_HASHTBL_H_
+
+#include <iostream>     // ostream
+#include <cstdint>      // uint32_t, uint64_t
+#include <limits>       // numeric_limits
+#include <type_traits>  // is_integral, conditional, is_trivially_destructible
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>    // std::out_of_range, std::invalid_argument
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "hashtbl.h"
+
+namespace ac // Associative container
+{
+    //! True for the key types that may use the IntHashTbl fast path.
+    template< class KeyType >
+    struct is_int_key : std::integral_constant< bool,
+        std::is_integral< KeyType >::value and
+        not std::is_same< KeyType, bool >::value and
+        sizeof( KeyType ) <= sizeof( std::uint64_t ) > {};
+
+    /// Fibonacci (multiplicative) hashing: keeps the top `bits` bits of key * 2^w/phi.
+    /*! Keys up to 32 bits are hashed with a 32-bit multiplier, so eight of them fit
+     *  in one AVX2 register; wider keys use the 64-bit multiplier.
+     */
+    template< class KeyType >
+    struct MultiplicativeHash {
+        static constexpr bool narrow = sizeof( KeyType ) <= sizeof( std::uint32_t );
+        static constexpr unsigned word_bits = narrow ? 32 : 64;
+
+        // Index of key_ in a table of 2^bits slots (1 <= bits <= word_bits).
+        static inline std::size_t apply( KeyType key_, unsigned bits ) {
+            return narrow ?
+                std::size_t( std::uint32_t( std::uint32_t( key_ ) * 0x9E3779B9u ) >> ( 32 - bits ) ) :
+                std::size_t( ( std::uint64_t( key_ ) * 0x9E3779B97F4A7C15ull ) >> ( 64 - bits ) );
+        }
+
+        // Hashes n keys into out[], eight keys per step when AVX2 is available.
+        static void apply_batch( const KeyType * keys, std::size_t n, unsigned bits, std::size_t * out );
+    };
+
+	template< class KeyType, class DataType >
+	class IntHashTbl {
+        static_assert( is_int_key< KeyType >::value, "IntHashTbl requires an integer key type" );
+
+        public:
+            // Aliases
+            using entry_type = HashEntry<KeyType,DataType>;
+            using hasher = MultiplicativeHash<KeyType>;
+            using size_type = std::size_t;
+
+            explicit IntHashTbl( size_type table_sz_ = DEFAULT_SIZE,
+                                 KeyType empty_key_ = std::numeric_limits<KeyType>::max(),
+                                 const MemoryPolicy & policy_ = MemoryPolicy{} );
+            IntHashTbl( const IntHashTbl& );
+            IntHashTbl( const std::initializer_list< entry_type > & );
+            IntHashTbl& operator=( const IntHashTbl& );
+            IntHashTbl& operator=( const std::initializer_list< entry_type > & );
+
+            virtual ~IntHashTbl() = default;
+
+            bool insert( const KeyType &, const DataType & );
+            size_type insert( const KeyType *, const DataType *, size_type );
+            bool retrieve( const KeyType &, DataType & ) const;
+            bool erase( const KeyType & );
+            void clear();
+            bool empty() const { return m_count == 0; };
+            inline size_type size() const { return m_count; };
+            DataType& at( const KeyType& );
+            DataType& operator[]( const KeyType& );
+            // Returns 1 if the key is stored in the table; 0, otherwise.
+            size_type count( const KeyType& ) const;
+            // Makes room for n_ elements without triggering a rehash().
+            void reserve( size_type n_ );
+            // Average and longest distance of the elements from their home slot.
+            void probe_stats( double &, size_type & ) const;
+            // Returns the number of slots of the table.
+            size_type capacity() const { return m_capacity; };
+            // Returns the maximum load factor of the hash table.
+            float max_load_factor() const { return m_max_load_factor; };
+            // Changes the maximum load factor of the hash table; it must be in (0, MAX_LOAD_FACTOR]:
+            // probing needs empty slots. Throws std::invalid_argument otherwise.
+            void max_load_factor(float mlf) {
+                if (not ( mlf > 0 and mlf <= MAX_LOAD_FACTOR ))   // NaN fails too.
+                    throw std::invalid_argument( "[IntHashTbl::max_load_factor()]: must be in (0, 0.95]." );
+                m_max_load_factor = mlf;
+            };
+            // Where the slot arrays are allocated (set at construction).
+            const MemoryPolicy & memory_policy() const { return m_policy; };
+
+            //* Generates a textual representation of the table and its elements.
+            friend std::ostream & operator<<( std::ostream & os_, const IntHashTbl & ht_ ) {
+                for (size_type i{0}; i < ht_.m_capacity; i++)
+                    if ( ht_.m_keys[i] != ht_.m_empty_key )
+                        os_ << ht_.m_data[i] << '\n';
+                if ( ht_.m_has_empty_key )
+                    os_ << ht_.m_data[ht_.m_capacity] << '\n';
+                return os_;
+            }
+
+        private:
+            size_type find_slot( const KeyType &, size_type ) const;
+            // Stores a key that is not in the table; returns its slot.
+            size_type place( KeyType, DataType, size_type );
+            // Drops the data of a freed slot, so what it holds (memory, handles) is released now.
+            void release( size_type i ) { if (not std::is_trivially_destructible< DataType >::value) m_data[i] = DataType{}; };
+            void allocate( size_type );
+            void rehash( size_type );
+            void copy_from( const IntHashTbl& );
+            inline size_type next( size_type i ) const { return ( i + 1 ) & m_mask; };
+            // Distance of the element in slot i from its home slot.
+            inline size_type distance( size_type i ) const { return ( i - hasher::apply( m_keys[i], m_bits ) ) & m_mask; };
+
+        private:
+            size_type m_capacity;  //!< Number of slots, always a power of two.
+            size_type m_mask;      //!< m_capacity - 1.
+            unsigned m_bits;       //!< log2(m_capacity).
+            size_type m_count;     //!< Number of elements in the table.
+            float m_max_load_factor = 0.75; //!< Load factor that triggers rehash().
+            KeyType m_empty_key;   //!< Key value that marks an empty slot.
+            bool m_has_empty_key = false; //!< Whether the sentinel itself was inserted as a key.
+            MemoryPolicy m_policy;              //!< Placement of the slot arrays.
+            PageArray<KeyType> m_keys;          //!< Slot keys (probed alone, one cache line per 8-16 keys).
+            PageArray<DataType> m_data;         //!< Slot data; m_data[m_capacity] holds the sentinel key's data.
+            static const short DEFAULT_SIZE = 16;
+            static constexpr float MAX_LOAD_FACTOR = 0.95f; //!< Leaves probes room to end on an empty slot.
+    };
+
+    /// Picks IntHashTbl for integer keys and the chained HashTbl for any other key type.
+    template< class KeyType, class DataType >
+    using FastHashTbl = typename std::conditional< is_int_key< KeyType >::value,
+                                                   IntHashTbl< KeyType, DataType >,
+                                                   HashTbl< KeyType, DataType > >::type;
+
+} // namespace ac
+#include "int_hashtbl.inl"
+#endif
@@ -0,0 +1,493 @@
+#include "int_hashtbl.h"
+
+namespace ac {
+    namespace detail {
+        // Scalar fallback, used for 8/16-bit keys, for the batch tail, and when AVX2 is off.
+        template< class KeyType >
+        inline void multiplicative_hash_scalar( const KeyType * keys, std::size_t first, std::size_t n,
+                                                unsigned bits, std::size_t * out )
+        {
+            for (std::size_t i{first}; i < n; i++)
+                out[i] = MultiplicativeHash<KeyType>::apply( keys[i], bits );
+        }
+
+        template< class KeyType, std::size_t W >
+        inline std::size_t multiplicative_hash_simd( const KeyType *, std::size_t, unsigned,
+                                                     std::size_t *, std::integral_constant<std::size_t, W> )
+        { return 0; }
+
+#if defined(__AVX2__)
+        static_assert( sizeof(std::size_t) == 8, "AVX2 batch hashing writes 64-bit indices" );
+
+        // 32-bit keys: one _mm256_mullo_epi32 hashes 8 keys.
+        template< class KeyType >
+        inline std::size_t multiplicative_hash_simd( const KeyType * keys, std::size_t n, unsigned bits,
+                                                     std::size_t * out, std::integral_constant<std::size_t, 4> )
+        {
+            const __m256i mul = _mm256_set1_epi32( int( 0x9E3779B9u ) );
+            const __m128i shift = _mm_cvtsi32_si128( int( 32 - bits ) );
+            std::size_t i{0};
+            for (; i + 8 <= n; i += 8) {
+                __m256i k = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( keys + i ) );
+                __m256i h = _mm256_srl_epi32( _mm256_mullo_epi32( k, mul ), shift );
+                _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i ),
+                                     _mm256_cvtepu32_epi64( _mm256_castsi256_si128( h ) ) );
+                _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i + 4 ),
+                                     _mm256_cvtepu32_epi64( _mm256_extracti128_si256( h, 1 ) ) );
+            }
+            return i;
+        }
+
+        // Low 64 bits of a * b on each lane (AVX2 has no 64-bit mullo).
+        inline __m256i mullo_epi64( __m256i a, __m256i b, __m256i b_hi )
+        {
+            __m256i lolo = _mm256_mul_epu32( a, b );
+            __m256i cross = _mm256_add_epi64( _mm256_mul_epu32( _mm256_srli_epi64( a, 32 ), b ),
+                                              _mm256_mul_epu32( a, b_hi ) );
+            return _mm256_add_epi64( lolo, _mm256_slli_epi64( cross, 32 ) );
+        }
+
+        // 64-bit keys: two registers of 4 keys are hashed per step.
+        template< class KeyType >
+        inline std::size_t multiplicative_hash_simd( const KeyType * keys, std::size_t n, unsigned bits,
+                                                     std::size_t * out, std::integral_constant<std::size_t, 8> )
+        {
+            const __m256i mul = _mm256_set1_epi64x( (long long)( 0x9E3779B97F4A7C15ull ) );
+            const __m256i mul_hi = _mm256_srli_epi64( mul, 32 );
+            const __m128i shift = _mm_cvtsi32_si128( int( 64 - bits ) );
+            std::size_t i{0};
+            for (; i + 8 <= n; i += 8) {
+                __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( keys + i ) );
+                __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( keys + i + 4 ) );
+                _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i ),
+                                     _mm256_srl_epi64( mullo_epi64( a, mul, mul_hi ), shift ) );
+                _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + i + 4 ),
+                                     _mm256_srl_epi64( mullo_epi64( b, mul, mul_hi ), shift ) );
+            }
+            return i;
+        }
+#endif
+    } // namespace detail
+
+    /*!
+     * @brief Hashes a batch of keys with the same function as apply().
+     * @tparam KeyType integer key type.
+     * @param keys the keys to be hashed.
+     * @param n number of keys.
+     * @param bits log2 of the table size.
+     * @param out receives the n slot indices.
+     */
+    template< class KeyType >
+    void MultiplicativeHash<KeyType>::apply_batch( const KeyType * keys, std::size_t n, unsigned bits, std::size_t * out )
+    {
+        auto done = detail::multiplicative_hash_simd( keys, n, bits, out,
+                        std::integral_constant<std::size_t, sizeof(KeyType)>{} );
+        detail::multiplicative_hash_scalar( keys, done, n, bits, out );
+    }
+
+    /*!
+     * @brief Regular constructor of an integer-key hash table.
+     * @tparam KeyType integer type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @param sz the table gets the smallest power of two >= sz slots (at least 8).
+     * @param empty_key key value reserved to mark empty slots. It may still be
+     * inserted: it is kept in a dedicated slot past the end of the table.
+     * @param policy_ where the slot arrays are allocated (huge pages, NUMA node).
+     */
+	template< class KeyType, class DataType >
+	IntHashTbl<KeyType,DataType>::IntHashTbl( size_type sz, KeyType empty_key, const MemoryPolicy & policy_ )
+        : m_count{0}, m_empty_key{empty_key}, m_policy{policy_}
+	{
+        size_type cap{8};
+        while (cap < sz) cap <<= 1;
+        allocate( cap );
+	}
+
+    /*!
+     * @brief Copy constructor from another integer-key hash table.
+     * @param source the hash table that will be copied.
+     */
+	template< class KeyType, class DataType >
+	IntHashTbl<KeyType,DataType>::IntHashTbl( const IntHashTbl& source )
+        : m_policy{ source.m_policy }
+	{
+        copy_from( source );
+	}
+
+    /*!
+     * @brief Constructor from an initializer list.
+     * @param ilist the initializer list that the data of the elements will be copied.
+     */
+	template< class KeyType, class DataType >
+	IntHashTbl<KeyType,DataType>::IntHashTbl( const std::initializer_list<entry_type>& ilist )
+        : IntHashTbl( ilist.size() )
+    {
+        for (const auto & e : ilist)
+            insert( e.m_key, e.m_data );
+    }
+
+    /*!
+     * @brief Assignment operator with another integer-key hash table.
+     * @param clone the hash table that will be copied.
+     * @return the hash table with the same elements as the copied hash table.
+     * This table keeps its own memory policy.
+     */
+	template< class KeyType, class DataType >
+	IntHashTbl<KeyType,DataType>& IntHashTbl<KeyType,DataType>::operator=( const IntHashTbl& clone )
+    {
+        if (this != &clone)
+            copy_from( clone );
+        return *this;
+    }
+
+    /*!
+     * @brief Assignment operator with an initializer list.
+     * @param ilist the initializer list that the data of the elements will be copied.
+     * @return the hash table with the data of the elements of the initializer list.
+     */
+	template< class KeyType, class DataType >
+	IntHashTbl<KeyType,DataType>&
+    IntHashTbl<KeyType,DataType>::operator=( const std::initializer_list< entry_type >& ilist )
+    {
+        clear();
+        reserve( ilist.size() );
+        for (const auto & e : ilist)
+            insert( e.m_key, e.m_data );
+        return *this;
+    }
+
+    /*!
+     * @brief Inserts into the table the information contained in new_data_ and associated with a key key_.
+     * @param key_ element key to be inserted.
+     * @param new_data_ element data to be inserted.
+     * @return true if a new element was inserted in the table.
+     * @return false if the key already exists and the data has just been overwritten.
+     */
+	template< class KeyType, class DataType >
+	bool IntHashTbl<KeyType,DataType>::insert( const KeyType & key_, const DataType & new_data_ )
+    {
+        if (key_ == m_empty_key) {
+            m_data[m_capacity] = new_data_;
+            if (m_has_empty_key) return false;
+            m_has_empty_key = true;
+            m_count++;
+            return true;
+        }
+        auto slot = find_slot( key_, hasher::apply( key_, m_bits ) );
+        if (slot != m_capacity) {
+            m_data[slot] = new_data_;
+            return false;
+        }
+        // Grow before placing, so the probe sequence always ends at an empty slot.
+        if (m_count + 1 > m_max_load_factor * m_capacity)
+            rehash( m_capacity * 2 );
+        place( key_, new_data_, hasher::apply( key_, m_bits ) );
+        m_count++;
+        return true;
+    }
+
+    /*!
+     * @brief Bulk insertion of n_ key/data pairs. The table is reserved once, the
+     * home slots are computed in batches by MultiplicativeHash::apply_batch() and
+     * prefetched before probing.
+     * @param keys_ keys to be inserted.
+     * @param data_ data associated with each key.
+     * @param n_ number of elements.
+     * @return the number of new elements (keys already stored are overwritten).
+     */
+	template< class KeyType, class DataType >
+	typename IntHashTbl<KeyType,DataType>::size_type
+    IntHashTbl<KeyType,DataType>::insert( const KeyType * keys_, const DataType * data_, size_type n_ )
+    {
+        constexpr size_type BATCH = 64;
+        size_type homes[BATCH];
+        size_type inserted{0};
+        reserve( m_count + n_ );
+        for (size_type b{0}; b < n_; b += BATCH) {
+            auto len = std::min( BATCH, n_ - b );
+            hasher::apply_batch( keys_ + b, len, m_bits, homes );
+#if defined(__GNUC__)
+            for (size_type i{0}; i < len; i++)
+                __builtin_prefetch( &m_keys[homes[i]] );
+#endif
+            for (size_type i{0}; i < len; i++) {
+                const auto & key = keys_[b + i];
+                if (key == m_empty_key) {
+                    inserted += insert( key, data_[b + i] ) ? 1 : 0;
+                    continue;
+                }
+                auto slot = find_slot( key, homes[i] );
+                if (slot != m_capacity) {
+                    m_data[slot] = data_[b + i];
+                }
+                else {
+                    place( key, data_[b + i], homes[i] );
+                    m_count++;
+                    inserted++;
+                }
+            }
+        }
+        return inserted;
+    }
+
+    /*!
+     * @brief Clears the data table. The slots are kept; their data is reset, unless it is
+     * trivially destructible (and so holds nothing that needs freeing).
+     */
+	template< class KeyType, class DataType >
+    void IntHashTbl<KeyType,DataType>::clear()
+    {
+        std::fill( m_keys.get(), m_keys.get() + m_capacity, m_empty_key );
+        if (not std::is_trivially_destructible< DataType >::value)
+            std::fill( m_data.get(), m_data.get() + m_capacity + 1, DataType{} );
+        m_has_empty_key = false;
+        m_count = 0;
+    }
+
+    /*!
+     * @brief Retrieves a data item from the table, based on the key associated with the data.
+     * @param key_ Data key to search for in the table.
+     * @param data_item_ Data record to be filled in when data item is found.
+     * @return true if the data item is found; false, otherwise.
+     */
+	template< class KeyType, class DataType >
+    bool IntHashTbl<KeyType,DataType>::retrieve( const KeyType & key_, DataType & data_item_ ) const
+    {
+        if (key_ == m_empty_key) {
+            if (m_has_empty_key) data_item_ = m_data[m_capacity];
+            return m_has_empty_key;
+        }
+        auto slot = find_slot( key_, hasher::apply( key_, m_bits ) );
+        if (slot == m_capacity)
+            return false;
+        data_item_ = m_data[slot];
+        return true;
+    }
+
+    /*!
+     * @brief Removes a table item identified by its key_ key, with backward-shift
+     * deletion: the following elements of the cluster that are not in their home
+     * slot move back one slot. No tombstone is left, so probe lengths do not grow
+     * with the number of erasures.
+     * @param key_ the key of the element to be removed.
+     * @return true if key is found; false, otherwise.
+     */
+	template< class KeyType, class DataType >
+    bool IntHashTbl<KeyType,DataType>::erase( const KeyType & key_ )
+    {
+        if (key_ == m_empty_key) {
+            if (not m_has_empty_key) return false;
+            m_has_empty_key = false;
+            release( m_capacity );
+            m_count--;
+            return true;
+        }
+        auto slot = find_slot( key_, hasher::apply( key_, m_bits ) );
+        if (slot == m_capacity)
+            return false;
+        auto j = next( slot );
+        while (m_keys[j] != m_empty_key and distance( j ) > 0) {
+            m_keys[slot] = m_keys[j];
+            m_data[slot] = std::move( m_data[j] );
+            slot = j;
+            j = next( j );
+        }
+        m_keys[slot] = m_empty_key;
+        release( slot );
+        m_count--;
+        return true;
+    }
+
+    /*!
+     * @brief Returns 1 if key_ is in the table, since open addressing has no collision list.
+     * @param key_ the key to be searched for.
+     */
+	template< class KeyType, class DataType >
+    typename IntHashTbl<KeyType,DataType>::size_type
+    IntHashTbl<KeyType,DataType>::count( const KeyType & key_ ) const
+    {
+        if (key_ == m_empty_key)
+            return m_has_empty_key ? 1 : 0;
+        return find_slot( key_, hasher::apply( key_, m_bits ) ) == m_capacity ? 0 : 1;
+    }
+
+    /*!
+     * @brief Returns a reference to the data associated with the given key key_.
+     * If the key is not in the table, the method throws an exception of type std::out_of_range.
+     * @param key_ key that we look for the data.
+     * @return DataType& reference to the data associated with the given key.
+     */
+	template< class KeyType, class DataType >
+    DataType& IntHashTbl<KeyType,DataType>::at( const KeyType & key_ )
+    {
+        if (key_ == m_empty_key) {
+            if (m_has_empty_key) return m_data[m_capacity];
+        }
+        else {
+            auto slot = find_slot( key_, hasher::apply( key_, m_bits ) );
+            if (slot != m_capacity) return m_data[slot];
+        }
+        throw std::out_of_range("[IntHashTbl::at()]: key doesn't exist in the hash table.");
+    }
+
+    /*!
+     * @brief Returns a reference to the data associated with the given key key_,
+     * inserting a default-constructed data first if the key is not in the table.
+     * The key is hashed and probed once; a new key is used where place() stored it.
+     * @param key_ the given key.
+     * @return DataType& reference to the data associated with the given key.
+     */
+	template< class KeyType, class DataType >
+    DataType& IntHashTbl<KeyType,DataType>::operator[]( const KeyType & key_ )
+    {
+        if (key_ == m_empty_key) {
+            if (not m_has_empty_key) {
+                m_data[m_capacity] = DataType{};
+                m_has_empty_key = true;
+                m_count++;
+            }
+            return m_data[m_capacity];
+        }
+        auto home = hasher::apply( key_, m_bits );
+        auto slot = find_slot( key_, home );
+        if (slot != m_capacity)
+            return m_data[slot];
+        if (m_count + 1 > m_max_load_factor * m_capacity) {
+            rehash( m_capacity * 2 );
+            home = hasher::apply( key_, m_bits );
+        }
+        slot = place( key_, DataType{}, home );
+        m_count++;
+        return m_data[slot];
+    }
+
+    /*!
+     * @brief Makes room for n_ elements, so that inserting them does not trigger a rehash().
+     * @param n_ expected number of elements.
+     */
+	template< class KeyType, class DataType >
+    void IntHashTbl<KeyType,DataType>::reserve( size_type n_ )
+    {
+        size_type cap{m_capacity};
+        while (n_ > m_max_load_factor * cap) cap <<= 1;
+        if (cap != m_capacity)
+            rehash( cap );
+    }
+
+    /*!
+     * @brief Linear probing from home_ until key_ is found. The search stops early at an
+     * empty slot or at an element closer to its home than key_ would be (Robin Hood order).
+     * @return the slot of key_, or m_capacity if key_ is not in the table.
+     */
+	template< class KeyType, class DataType >
+    typename IntHashTbl<KeyType,DataType>::size_type
+    IntHashTbl<KeyType,DataType>::find_slot( const KeyType & key_, size_type home_ ) const
+    {
+        size_type dist{0};
+        for (auto i = home_; m_keys[i] != m_empty_key; i = next( i ), dist++) {
+            if (m_keys[i] == key_)
+                return i;
+            if (distance( i ) < dist)
+                break;
+        }
+        return m_capacity;
+    }
+
+    /*!
+     * @brief Robin Hood insertion of a key that is not in the table: whenever the
+     * element being placed is farther from its home than the slot occupant, they swap
+     * and the occupant continues the probe.
+     * @param key_ the key to be stored.
+     * @param data_ the data to be stored.
+     * @param home_ home slot of key_.
+     * @return the slot key_ ended up in (the elements it displaced move on past it).
+     */
+	template< class KeyType, class DataType >
+    typename IntHashTbl<KeyType,DataType>::size_type
+    IntHashTbl<KeyType,DataType>::place( KeyType key_, DataType data_, size_type home_ )
+    {
+        size_type dist{0};
+        size_type placed{m_capacity};   // Slot of the original key_, once it is stored.
+        for (auto i = home_; ; i = next( i ), dist++) {
+            if (m_keys[i] == m_empty_key) {
+                m_keys[i] = key_;
+                m_data[i] = std::move( data_ );
+                return placed != m_capacity ? placed : i;
+            }
+            auto occupant = distance( i );
+            if (occupant < dist) {
+                std::swap( key_, m_keys[i] );
+                std::swap( data_, m_data[i] );
+                dist = occupant;
+                if (placed == m_capacity) placed = i;
+            }
+        }
+    }
+
+    /*!
+     * @brief Returns the average and the maximum distance of the elements from their home slot.
+     */
+	template< class KeyType, class DataType >
+    void IntHashTbl<KeyType,DataType>::probe_stats( double & average_, size_type & longest_ ) const
+    {
+        size_type total{0}, n{0};
+        longest_ = 0;
+        for (size_type i{0}; i < m_capacity; i++) {
+            if (m_keys[i] == m_empty_key) continue;
+            auto d = distance( i );
+            total += d;
+            longest_ = std::max( longest_, d );
+            n++;
+        }
+        average_ = n ? double( total ) / n : 0.0;
+    }
+
+    /*!
+     * @brief Allocates an empty table with cap_ slots (a power of two).
+     */
+	template< class KeyType, class DataType >
+    void IntHashTbl<KeyType,DataType>::allocate( size_type cap_ )
+    {
+        m_capacity = cap_;
+        m_mask = cap_ - 1;
+        m_bits = 0;
+        while ((size_type{1} << m_bits) < cap_) m_bits++;
+        m_keys = PageArray<KeyType>( m_capacity, m_policy, m_empty_key );
+        m_data = PageArray<DataType>( m_capacity + 1, m_policy );
+    }
+
+    /*!
+     * @brief Moves every element into a new table with cap_ slots.
+     * @param cap_ new number of slots (a power of two).
+     */
+	template< class KeyType, class DataType >
+    void IntHashTbl<KeyType,DataType>::rehash( size_type cap_ )
+    {
+        auto old_capacity = m_capacity;
+        auto old_keys = std::move( m_keys );
+        auto old_data = std::move( m_data );
+        allocate( cap_ );
+        for (size_type i{0}; i < old_capacity; i++) {
+            if (old_keys[i] != m_empty_key) {
+                place( old_keys[i], std::move( old_data[i] ), hasher::apply( old_keys[i], m_bits ) );
+            }
+        }
+        if (m_has_empty_key)
+            m_data[m_capacity] = std::move( old_data[old_capacity] );
+    }
+
+    /*!
+     * @brief Makes this table an exact copy of source.
+     */
+	template< class KeyType, class DataType >
+    void IntHashTbl<KeyType,DataType>::copy_from( const IntHashTbl& source )
+    {
+        m_empty_key = source.m_empty_key;
+        m_max_load_factor = source.m_max_load_factor;
+        allocate( source.m_capacity );
+        std::copy( source.m_keys.get(), source.m_keys.get() + m_capacity, m_keys.get() );
+        std::copy( source.m_data.get(), source.m_data.get() + m_capacity + 1, m_data.get() );
+        m_has_empty_key = source.m_has_empty_key;
+        m_count = source.m_count;
+    }
+} // Namespace ac.
@@ -0,0 +1,322 @@
+/*!
+ * @file page_alloc.h
+ * Memory for the large arrays and nodes of the tables: 2 MiB transparent huge pages
+ * and NUMA node binding (Linux; elsewhere the policy is ignored).
+ */
+#ifndef _PAGE_ALLOC_H_
+#define _PAGE_ALLOC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <new>          // std::bad_alloc, placement new
+#include <sstream>
+#include <string>
+#include <utility>      // std::swap
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>      // sched_setaffinity
+#include <sys/mman.h>   // mmap, madvise
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ac // Associative container
+{
+    /// Where a table puts its bucket/slot arrays and its nodes.
+    /*! The default policy uses the regular heap. huge_pages maps the memory with
+     *  madvise(MADV_HUGEPAGE), so that a table of gigabytes takes one TLB entry per
+     *  2 MiB instead of per 4 KiB (the kernel must have transparent huge pages set to
+     *  "always" or "madvise"). numa_node binds the memory to that node with mbind()
+     *  before it is first touched. Both are hints: where the kernel refuses them the
+     *  memory is still valid, only placed as usual.
+     */
+    struct MemoryPolicy {
+        bool huge_pages = false; //!< Back the memory with 2 MiB transparent huge pages.
+        int numa_node = -1;      //!< NUMA node to bind the memory to; -1 lets the kernel choose.
+
+        bool is_default() const { return not huge_pages and numa_node < 0; }
+        bool operator==( const MemoryPolicy & o ) const { return huge_pages == o.huge_pages and numa_node == o.numa_node; }
+        bool operator!=( const MemoryPolicy & o ) const { return not ( *this == o ); }
+    };
+
+    static const std::size_t HUGE_PAGE_SIZE = std::size_t{2} << 20;
+
+    /// NUMA topology of the machine and thread placement.
+    namespace numa {
+        namespace detail {
+            // Parses a sysfs list such as "0-3,8,10-11".
+            inline std::vector< int > parse_list( const std::string & s_ ) {
+                std::vector< int > out;
+                std::stringstream ss( s_ );
+                std::string item;
+                while (std::getline( ss, item, ',' )) {
+                    if (item.empty() or item[0] < '0' or item[0] > '9') continue;
+                    auto dash = item.find( '-' );
+                    int first = std::stoi( item.substr( 0, dash ) );
+                    int last = dash == std::string::npos ? first : std::stoi( item.substr( dash + 1 ) );
+                    for (int i = first; i <= last; i++) out.push_back( i );
+                }
+                return out;
+            }
+            inline std::string read_line( const std::string & path_ ) {
+                std::ifstream in( path_ );
+                std::string line;
+                std::getline( in, line );
+                return line;
+            }
+        } // namespace detail
+
+        // Number of NUMA nodes (1 on machines without NUMA or without sysfs).
+        inline int node_count() {
+            auto nodes = detail::parse_list( detail::read_line( "/sys/devices/system/node/online" ) );
+            int n{0};
+            for (auto v : nodes) if (v + 1 > n) n = v + 1;
+            return n > 0 ? n : 1;
+        }
+
+        // CPUs of node_ (empty when unknown).
+        inline std::vector< int > cpus_of( int node_ ) {
+            return detail::parse_list( detail::read_line( "/sys/devices/system/node/node" + std::to_string( node_ ) + "/cpulist" ) );
+        }
+
+        // Node of the CPU the calling thread runs on (0 when unknown).
+        inline int current_node() {
+#if defined(__linux__) && defined(SYS_getcpu)
+            unsigned cpu{0}, node{0};
+            if (::syscall( SYS_getcpu, &cpu, &node, nullptr ) == 0) return int( node );
+#endif
+            return 0;
+        }
+
+        // Restricts the calling thread to the CPUs of node_, so that it runs next to that
+        // node's memory. False if the node has no known CPUs or the affinity was refused.
+        inline bool run_on_node( int node_ ) {
+#if defined(__linux__)
+            auto cpus = cpus_of( node_ );
+            if (cpus.empty()) return false;
+            cpu_set_t set;
+            CPU_ZERO( &set );
+            for (auto c : cpus) if (c < CPU_SETSIZE) CPU_SET( c, &set );
+            return ::sched_setaffinity( 0, sizeof( set ), &set ) == 0;
+#else
+            (void) node_;
+            return false;
+#endif
+        }
+
+        // Binds the pages of [addr_, addr_ + bytes_) (page aligned) to node_; false if refused.
+        inline bool bind( void * addr_, std::size_t bytes_, int node_ ) {
+#if defined(__linux__) && defined(SYS_mbind)
+            const int MPOL_BIND_ = 2; // <numaif.h> is part of libnuma, which we do not require.
+            const std::size_t bits = 8 * sizeof( unsigned long );
+            if (node_ < 0 or std::size_t( node_ ) >= 16 * bits) return false;
+            unsigned long mask[16] = {};
+            mask[ node_ / bits ] = 1ul << ( node_ % bits );
+            return ::syscall( SYS_mbind, addr_, bytes_, MPOL_BIND_, mask, 16 * bits, 0 ) == 0;
+#else
+            (void) addr_; (void) bytes_; (void) node_;
+            return false;
+#endif
+        }
+    } // namespace numa
+
+    namespace detail {
+        // Whether page_allocate() maps bytes_ itself (rather than using the heap).
+        inline bool page_mapped( std::size_t bytes_, const MemoryPolicy & policy_ ) {
+#if defined(__linux__)
+            // A huge page is only worth it for arrays of half a huge page or more.
+            return policy_.numa_node >= 0 or ( policy_.huge_pages and bytes_ >= HUGE_PAGE_SIZE / 2 );
+#else
+            (void) bytes_; (void) policy_;
+            return false;
+#endif
+        }
+        inline std::size_t page_rounded( std::size_t bytes_, const MemoryPolicy & policy_ ) {
+            std::size_t page = policy_.huge_pages ? HUGE_PAGE_SIZE : 4096;
+            return ( bytes_ + page - 1 ) / page * page;
+        }
+    } // namespace detail
+
+    /// Allocates bytes_ under policy_; throws std::bad_alloc. Release with page_free().
+    /*! Mapped memory is aligned to 2 MiB when huge_pages is set, so that the kernel can
+     *  back it with huge pages from the first byte.
+     */
+    inline void * page_allocate( std::size_t bytes_, const MemoryPolicy & policy_ ) {
+        if (not detail::page_mapped( bytes_, policy_ )) return ::operator new( bytes_ );
+#if defined(__linux__)
+        auto len = detail::page_rounded( bytes_, policy_ );
+        auto extra = policy_.huge_pages ? HUGE_PAGE_SIZE : 0; // Slack to align the start.
+        void * raw = ::mmap( nullptr, len + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        auto base = reinterpret_cast< std::uintptr_t >( raw );
+        auto start = extra ? ( base + extra - 1 ) / extra * extra : base;
+        if (start > base) ::munmap( raw, start - base );
+        if (base + extra > start) ::munmap( reinterpret_cast< void * >( start + len ), base + extra - start );
+        void * p = reinterpret_cast< void * >( start );
+        if (policy_.huge_pages) ::madvise( p, len, MADV_HUGEPAGE );
+        if (policy_.numa_node >= 0) numa::bind( p, len, policy_.numa_node );
+        return p;
+#else
+        return ::operator new( bytes_ );
+#endif
+    }
+
+    /// Releases memory of page_allocate( bytes_, policy_ ).
+    inline void page_free( void * p_, std::size_t bytes_, const MemoryPolicy & policy_ ) {
+        if (p_ == nullptr) return;
+        if (not detail::page_mapped( bytes_, policy_ )) { ::operator delete( p_ ); return; }
+#if defined(__linux__)
+        ::munmap( p_, detail::page_rounded( bytes_, policy_ ) );
+#endif
+    }
+
+    /// A fixed-size array of T in page_allocate() memory, e.g. the buckets or slots of a table.
+    /*! Move-only; the elements are constructed in place from the same arguments. */
+    template< class T >
+    class PageArray {
+        public:
+            PageArray() = default;
+            template< class... Args >
+            PageArray( std::size_t n_, const MemoryPolicy & policy_, const Args & ... args_ )
+                : m_size{ n_ }, m_policy{ policy_ }
+            {
+                m_data = static_cast< T * >( page_allocate( n_ * sizeof( T ), policy_ ) );
+                std::size_t i{0};
+                try {
+                    for (; i < n_; i++) new ( m_data + i ) T( args_... );
+                }
+                catch (...) {
+                    m_size = i;
+                    release();
+                    throw;
+                }
+            }
+            PageArray( PageArray && o_ ) noexcept { swap( o_ ); }
+            PageArray & operator=( PageArray && o_ ) noexcept { PageArray( std::move( o_ ) ).swap( *this ); return *this; }
+            ~PageArray() { release(); }
+
+            // Like unique_ptr<T[]>, a const array still hands out mutable elements.
+            T & operator[]( std::size_t i_ ) const { return m_data[i_]; }
+            T * get() const { return m_data; }
+            std::size_t size() const { return m_size; }
+
+            void swap( PageArray & o_ ) noexcept {
+                std::swap( m_data, o_.m_data );
+                std::swap( m_size, o_.m_size );
+                std::swap( m_policy, o_.m_policy );
+            }
+
+        private:
+            void release() {
+                for (std::size_t i{0}; i < m_size; i++) m_data[i].~T();
+                page_free( m_data, m_size * sizeof( T ), m_policy );
+                m_data = nullptr;
+                m_size = 0;
+            }
+
+            T * m_data = nullptr;
+            std::size_t m_size = 0;
+            MemoryPolicy m_policy;
+    };
+
+    /// Fixed-size nodes carved out of huge-page chunks, with a free list.
+    /*! The node size is fixed by the first allocation; other sizes go to the heap.
+     *  Freed nodes are reused, and the chunks are only returned when the arena is
+     *  destroyed. Not synchronized: it belongs to one table.
+     */
+    class PageArena {
+        public:
+            explicit PageArena( const MemoryPolicy & policy_ ) : m_policy{ policy_ } {}
+            PageArena( const PageArena & ) = delete;
+            PageArena & operator=( const PageArena & ) = delete;
+            ~PageArena() { for (auto c : m_chunks) page_free( c, CHUNK, m_policy ); }
+
+            void * allocate( std::size_t bytes_ ) {
+                if (m_node == 0) m_node = rounded( bytes_ );
+                if (rounded( bytes_ ) != m_node) return ::operator new( bytes_ );
+                if (m_free != nullptr) {
+                    auto p = m_free;
+                    m_free = *reinterpret_cast< void ** >( p );
+                    return p;
+                }
+                if (m_next == m_end) {
+                    if (m_used == m_chunks.size())
+                        m_chunks.push_back( static_cast< char * >( page_allocate( CHUNK, m_policy ) ) );
+                    auto c = m_chunks[ m_used++ ];
+                    m_next = c;
+                    m_end = c + CHUNK / m_node * m_node;
+                }
+                auto p = m_next;
+                m_next += m_node;
+                return p;
+            }
+            void deallocate( void * p_, std::size_t bytes_ ) {
+                if (rounded( bytes_ ) != m_node) { ::operator delete( p_ ); return; }
+                *reinterpret_cast< void ** >( p_ ) = m_free;
+                m_free = p_;
+            }
+
+            // Takes every node back at once, without visiting them: their objects must need no
+            // destructor (or have been destroyed). The chunks are handed out again from the start.
+            void reset() {
+                m_free = nullptr;
+                m_next = m_end = nullptr;
+                m_used = 0;
+            }
+
+            const MemoryPolicy & policy() const { return m_policy; }
+            // Bytes mapped for nodes.
+            std::size_t reserved_bytes() const { return m_chunks.size() * CHUNK; }
+
+        private:
+            static const std::size_t CHUNK = HUGE_PAGE_SIZE;
+            static std::size_t rounded( std::size_t b_ ) {
+                const std::size_t a = alignof( std::max_align_t ) < sizeof( void * ) ? sizeof( void * ) : alignof( std::max_align_t );
+                return ( b_ + a - 1 ) / a * a;
+            }
+
+            MemoryPolicy m_policy;
+            std::size_t m_node = 0;        //!< Node size; 0 until the first allocation.
+            void * m_free = nullptr;       //!< Freed nodes, linked through their first word.
+            char * m_next = nullptr;       //!< Next unused node of the last chunk.
+            char * m_end = nullptr;
+            std::vector< char * > m_chunks;
+            std::size_t m_used = 0;        //!< Chunks handed out since construction or reset().
+    };
+
+    /// Allocator for container nodes: from a PageArena when it has one, else the heap.
+    /*! Copies of a container get a heap allocator (the arena belongs to the original). */
+    template< class T >
+    class NodeAllocator {
+        public:
+            using value_type = T;
+
+            NodeAllocator() = default;
+            explicit NodeAllocator( PageArena * arena_ ) : m_arena{ arena_ } {}
+            template< class U >
+            NodeAllocator( const NodeAllocator< U > & o_ ) : m_arena{ o_.arena() } {}
+
+            T * allocate( std::size_t n_ ) {
+                return static_cast< T * >( m_arena ? m_arena->allocate( n_ * sizeof( T ) ) : ::operator new( n_ * sizeof( T ) ) );
+            }
+            void deallocate( T * p_, std::size_t n_ ) {
+                if (m_arena) m_arena->deallocate( p_, n_ * sizeof( T ) );
+                else ::operator delete( p_ );
+            }
+            NodeAllocator select_on_container_copy_construction() const { return NodeAllocator(); }
+
+            PageArena * arena() const { return m_arena; }
+
+        private:
+            PageArena * m_arena = nullptr;
+    };
+
+    template< class T, class U >
+    bool operator==( const NodeAllocator< T > & a_, const NodeAllocator< U > & b_ ) { return a_.arena() == b_.arena(); }
+    template< class T, class U >
+    bool operator!=( const NodeAllocator< T > & a_, const NodeAllocator< U > & b_ ) { return a_.arena() != b_.arena(); }
+
+} // namespace ac
+#endif
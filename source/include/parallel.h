@@ -0,0 +1,66 @@
+/*!
+ * @file parallel.h
+ * Minimal fork/join helpers: run a function on a set of workers, hand out work in morsels.
+ */
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <algorithm>    // std::min
+#include <atomic>
+#include <cstddef>
+#include <exception>    // std::exception_ptr
+#include <thread>
+#include <vector>
+
+namespace ac // Associative container
+{
+    /// Number of workers to use for a request of requested_ (0 means one per hardware thread).
+    inline std::size_t worker_count( std::size_t requested_ ) {
+        if (requested_ > 0) return requested_;
+        auto hw = std::thread::hardware_concurrency();
+        return hw > 0 ? hw : 1;
+    }
+
+    /// Calls f(worker) for worker in [0, n_): the calling thread is worker 0, the others get
+    /// a thread each. Returns when every call has; rethrows the first exception thrown.
+    template< class Func >
+    void run_workers( std::size_t n_, Func f_ ) {
+        n_ = std::max< std::size_t >( n_, 1 );
+        std::vector< std::exception_ptr > errors( n_ );
+        auto guarded = [&]( std::size_t w_ ) {
+            try { f_( w_ ); }
+            catch (...) { errors[w_] = std::current_exception(); }
+        };
+        std::vector< std::thread > pool;
+        pool.reserve( n_ - 1 );
+        for (std::size_t w{1}; w < n_; w++)
+            pool.emplace_back( guarded, w );
+        guarded( 0 );
+        for (auto & t : pool) t.join();
+        for (auto & e : errors)
+            if (e) std::rethrow_exception( e );
+    }
+
+    /// Splits [0, total) into ranges of at most morsel items, handed out in order to
+    /// whichever worker asks next, so fast workers take more of them.
+    class MorselQueue {
+        public:
+            MorselQueue( std::size_t total_, std::size_t morsel_ )
+                : m_total{ total_ }, m_morsel{ std::max< std::size_t >( morsel_, 1 ) }, m_next{ 0 } {}
+
+            /// Claims the next range [begin_, end_). False when the work is exhausted.
+            bool next( std::size_t & begin_, std::size_t & end_ ) {
+                begin_ = m_next.fetch_add( m_morsel, std::memory_order_relaxed );
+                if (begin_ >= m_total) return false;
+                end_ = std::min( begin_ + m_morsel, m_total );
+                return true;
+            }
+
+        private:
+            std::size_t m_total;
+            std::size_t m_morsel;
+            std::atomic< std::size_t > m_next;
+    };
+
+} // namespace ac
+#endif
@@ -0,0 +1,216 @@
+/*!
+ * @file partitioned_hashtbl.h
+ * A table split over local server processes, reached through Unix domain sockets.
+ */
+#ifndef _PARTITIONED_HASHTBL_H_
+#define _PARTITIONED_HASHTBL_H_
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>      // std::strerror
+#include <functional>   // std::hash, std::equal_to
+#include <stdexcept>    // std::runtime_error
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "codec.h"
+#include "hash_ring.h"
+#include "hashtbl.h"
+
+namespace ac // Associative container
+{
+    /// Operations a PartitionedHashTbl batches for its servers.
+    enum class PartitionOp : std::uint8_t { insert, retrieve, erase };
+
+    namespace detail {
+        /// Frame kinds of the wire protocol: a frame is a 32-bit length, the kind, then its body.
+        enum class FrameKind : std::uint8_t { batch, copy, drop, size, shutdown };
+        /// Largest frame length either side sends or accepts, checked before anything is allocated.
+        const std::uint32_t MAX_FRAME = 64u << 20;
+
+        [[noreturn]] inline void socket_error( const std::string & what_ ) {
+            throw std::runtime_error( "[PartitionedHashTbl]: " + what_ + ": " + std::strerror( errno ) );
+        }
+
+        /// Reads exactly n_ bytes; false on end of file before the first byte.
+        inline bool read_full( int fd_, char * p_, std::size_t n_ ) {
+            std::size_t done{0};
+            while (done < n_) {
+                auto r = ::read( fd_, p_ + done, n_ - done );
+                if (r < 0 and errno == EINTR) continue;
+                if (r < 0) socket_error( "read" );
+                if (r == 0) {
+                    if (done == 0) return false;
+                    errno = EPIPE;
+                    socket_error( "read (truncated frame)" );
+                }
+                done += std::size_t( r );
+            }
+            return true;
+        }
+
+        inline void write_full( int fd_, const char * p_, std::size_t n_ ) {
+            while (n_ > 0) {
+                auto w = ::send( fd_, p_, n_, MSG_NOSIGNAL );
+                if (w < 0 and errno == EINTR) continue;
+                if (w < 0) socket_error( "write" );
+                p_ += w;
+                n_ -= std::size_t( w );
+            }
+        }
+
+        /// Starts a frame of kind_ in out_ (its length is filled in by end_frame()).
+        inline void begin_frame( std::string & out_, FrameKind kind_ ) {
+            out_.assign( sizeof( std::uint32_t ), '\0' );
+            out_ += char( kind_ );
+        }
+        inline void end_frame( std::string & out_ ) {
+            if (out_.size() - sizeof( std::uint32_t ) > MAX_FRAME) {
+                errno = EMSGSIZE;
+                socket_error( "frame too large" );
+            }
+            auto len = std::uint32_t( out_.size() - sizeof( std::uint32_t ) );
+            std::memcpy( &out_[0], &len, sizeof( len ) );
+        }
+
+        /// Reads one frame body (kind included) into in_; false at end of file.
+        inline bool read_frame( int fd_, std::string & in_ ) {
+            std::uint32_t len;
+            if (not read_full( fd_, reinterpret_cast< char * >( &len ), sizeof( len ) )) return false;
+            if (len > MAX_FRAME) {   // A bogus length must not become a huge allocation.
+                errno = EMSGSIZE;
+                socket_error( "read (frame too large)" );
+            }
+            in_.resize( len );
+            if (len > 0 and not read_full( fd_, &in_[0], len )) {
+                errno = EPIPE;
+                socket_error( "read (truncated frame)" );
+            }
+            return true;
+        }
+
+        inline sockaddr_un socket_address( const std::string & path_ ) {
+            sockaddr_un addr;
+            std::memset( &addr, 0, sizeof( addr ) );
+            addr.sun_family = AF_UNIX;
+            if (path_.size() >= sizeof( addr.sun_path ))
+                throw std::invalid_argument( "[PartitionedHashTbl]: socket path too long: " + path_ );
+            std::memcpy( addr.sun_path, path_.c_str(), path_.size() + 1 );
+            return addr;
+        }
+    } // namespace detail
+
+    /// One partition: a HashTbl served over a Unix domain socket.
+    /*! run() answers the frames of every connected client, one frame at a time (poll()
+     *  over the listening socket and the clients), until a client asks it to shut down.
+     *  Keys and data travel in their Codec encoding. A client that sends a malformed or
+     *  oversized frame is disconnected.
+     */
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class PartitionServer {
+        public:
+            using size_type = std::size_t;
+            using table_type = HashTbl< KeyType, DataType, KeyHash, KeyEqual >;
+
+            // Listens at path_ (a stale socket file there is replaced); answers copy frames in frames
+            // of about chunk_bytes_ of entries. Throws std::runtime_error.
+            explicit PartitionServer( const std::string & path_, size_type table_sz_ = 1024,
+                                      size_type chunk_bytes_ = 1u << 20 );
+            PartitionServer( const PartitionServer & ) = delete;
+            PartitionServer & operator=( const PartitionServer & ) = delete;
+            // Closes the connections and removes the socket file.
+            ~PartitionServer();
+
+            // Serves until a client sends a shutdown frame.
+            void run();
+            const table_type & table() const { return m_table; }
+
+        private:
+            // Answers one frame from client fd_; false when the client left (or asked to shut down).
+            bool serve( int fd_ );
+            // Reads the (first, last) ring arcs of a copy or drop frame; false if malformed.
+            static bool read_arcs( const char *& p_, const char * end_, std::vector< HashRing::Range > & arcs_ );
+            static bool in_arcs( const KeyType & key_, const std::vector< HashRing::Range > & arcs_ );
+
+            table_type m_table;
+            std::string m_path;
+            size_type m_chunk_bytes;
+            int m_listen = -1;
+            std::vector< int > m_clients;
+            bool m_stop = false;
+            std::string m_in, m_out;
+    };
+
+    /// A table spread over PartitionServer processes, each owning the keys that consistent
+    /// hashing (HashRing, over the KeyHash values) assigns to it.
+    /*! execute() groups requests by partition and sends them in frames of up to batch_
+     *  operations. Each round writes one frame to every partition that has work before
+     *  reading any answer, so the partitions serve their batches at the same time.
+     *  add_partition() moves to the new server only the keys of the arcs it takes over:
+     *  it copies them, inserts them into the new server, and only once those inserts are
+     *  acknowledged drops them from their old servers. The front end is single-threaded.
+     */
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class PartitionedHashTbl {
+        public:
+            using size_type = std::size_t;
+
+            /// One operation of execute(): m_ok and (for a found retrieve) m_data are set on return.
+            struct Request {
+                PartitionOp m_op;
+                KeyType m_key;
+                DataType m_data;   //!< Data to insert; the data retrieved.
+                bool m_ok;         //!< insert: the key was new; retrieve, erase: the key was found.
+            };
+
+            explicit PartitionedHashTbl( size_type batch_ = 256, size_type vnodes_ = 128 )
+                : m_ring( vnodes_ ), m_batch{ std::max< size_type >( batch_, 1 ) } {}
+            PartitionedHashTbl( const PartitionedHashTbl & ) = delete;
+            PartitionedHashTbl & operator=( const PartitionedHashTbl & ) = delete;
+            ~PartitionedHashTbl() { for (int fd : m_fds) ::close( fd ); }
+
+            // Connects to the server at path_ (waiting up to wait_ms_ for it to listen), adds it to
+            // the ring and moves to it the keys it now owns. Returns the number of keys moved. If the
+            // copy fails, the ring is left as it was and the old servers keep every key.
+            size_type add_partition( const std::string & path_, int wait_ms_ = 2000 );
+
+            bool insert( const KeyType & key_, const DataType & data_ );
+            bool retrieve( const KeyType & key_, DataType & data_ );
+            bool erase( const KeyType & key_ );
+            // Runs requests_, batched per partition; fills in their results.
+            void execute( std::vector< Request > & requests_ );
+
+            // Elements stored in partition p_ (asks its server).
+            size_type partition_size( size_type p_ );
+            // Elements stored over all partitions.
+            size_type size();
+            size_type partitions() const { return m_fds.size(); }
+            // The partition that owns key_.
+            size_type partition_of( const KeyType & key_ ) const { return m_ring.owner( KeyHash{}( key_ ) ); }
+            // Asks every server to exit, and disconnects from them.
+            void shutdown();
+
+        private:
+            // Sends frame out_ (nothing if it is empty) to partition p_ and reads its answer into in_.
+            void call( size_type p_, const std::string & out_, std::string & in_ );
+
+            HashRing m_ring;
+            size_type m_batch;
+            std::vector< int > m_fds;   //!< Connection to each partition.
+            std::string m_out, m_in;
+    };
+
+} // namespace ac
+#include "partitioned_hashtbl.inl"
+#endif
@@ -0,0 +1,416 @@
+#include "partitioned_hashtbl.h"
+
+#include <chrono>
+#include <thread>       // std::this_thread::sleep_for
+
+namespace ac {
+    /*!
+     * @brief Binds a Unix domain socket at path_ and listens on it.
+     * @param path_ the socket file.
+     * @param table_sz_ initial size of the partition's table.
+     * @param chunk_bytes_ entry bytes after which an answer to a copy frame goes out and a new one starts.
+     * @throw std::runtime_error if the socket cannot be created, bound or listened on.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    PartitionServer<KeyType,DataType,KeyHash,KeyEqual>::PartitionServer( const std::string & path_, size_type table_sz_,
+                                                                        size_type chunk_bytes_ )
+        : m_table( table_sz_ ), m_path{ path_ },
+          m_chunk_bytes{ std::min< size_type >( std::max< size_type >( chunk_bytes_, 1 ), detail::MAX_FRAME / 2 ) }
+    {
+        auto addr = detail::socket_address( path_ );
+        m_listen = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+        if (m_listen < 0) detail::socket_error( "socket" );
+        ::unlink( path_.c_str() );
+        if (::bind( m_listen, reinterpret_cast< sockaddr * >( &addr ), sizeof( addr ) ) != 0 or ::listen( m_listen, 64 ) != 0) {
+            int err = errno;
+            ::close( m_listen );
+            errno = err;
+            detail::socket_error( "bind " + path_ );
+        }
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    PartitionServer<KeyType,DataType,KeyHash,KeyEqual>::~PartitionServer()
+    {
+        for (int fd : m_clients) ::close( fd );
+        ::close( m_listen );
+        ::unlink( m_path.c_str() );
+    }
+
+    /*!
+     * @brief Waits on the listening socket and the clients with poll(), accepting new
+     * clients and answering one frame of each ready client per round. A client that
+     * sends a malformed or oversized frame, or whose answer cannot be built, is disconnected.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void PartitionServer<KeyType,DataType,KeyHash,KeyEqual>::run()
+    {
+        std::vector< pollfd > fds;
+        while (not m_stop) {
+            fds.assign( 1, pollfd{ m_listen, POLLIN, 0 } );
+            for (int c : m_clients) fds.push_back( pollfd{ c, POLLIN, 0 } );
+            if (::poll( fds.data(), fds.size(), -1 ) < 0) {
+                if (errno == EINTR) continue;
+                detail::socket_error( "poll" );
+            }
+            for (size_type i{1}; i < fds.size() and not m_stop; i++) {
+                if (not ( fds[i].revents & ( POLLIN | POLLHUP | POLLERR ) )) continue;
+                bool keep;
+                try { keep = serve( fds[i].fd ); }
+                catch (const std::exception &) { keep = false; }   // std::bad_alloc included.
+                if (not keep) {
+                    ::close( fds[i].fd );
+                    m_clients.erase( std::find( m_clients.begin(), m_clients.end(), fds[i].fd ) );
+                }
+            }
+            if (fds[0].revents & POLLIN) {
+                int c = ::accept4( m_listen, nullptr, nullptr, SOCK_CLOEXEC );
+                if (c >= 0) m_clients.push_back( c );
+            }
+        }
+    }
+
+    /*!
+     * @brief Reads one frame from a client and writes its answer.
+     * - batch: u32 count, then per operation its PartitionOp byte, the key and (insert) the data.
+     *   Answer: u32 count, then per operation an ok byte, followed by the data for a found retrieve.
+     * - copy: u32 count, then (first, last) ring arcs. Answer: one or more frames, each a last byte
+     *   (1 on the final one), a u32 count and the (key, data) of that many entries whose ring
+     *   position falls in an arc; a frame goes out once it holds chunk_bytes_ of entries.
+     * - drop: arcs, as for copy. Erases the entries in them. Answer: u32 count erased.
+     * - size: answer u64 size().
+     * - shutdown: empty answer; run() returns.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool PartitionServer<KeyType,DataType,KeyHash,KeyEqual>::serve( int fd_ )
+    {
+        if (not detail::read_frame( fd_, m_in ) or m_in.empty()) return false;
+        const char * p = m_in.data() + 1;
+        const char * end = m_in.data() + m_in.size();
+        auto malformed = []() { throw std::runtime_error( "[PartitionServer]: malformed frame." ); };
+        auto kind = detail::FrameKind( m_in[0] );
+        detail::begin_frame( m_out, kind );
+        std::uint32_t n;
+        switch (kind) {
+            case detail::FrameKind::batch: {
+                if (not Codec< std::uint32_t >::decode( p, end, n )) malformed();
+                Codec< std::uint32_t >::encode( m_out, n );
+                KeyType key;
+                DataType data;
+                for (std::uint32_t i{0}; i < n; i++) {
+                    std::uint8_t op;
+                    if (not Codec< std::uint8_t >::decode( p, end, op ) or not Codec< KeyType >::decode( p, end, key ))
+                        malformed();
+                    switch (PartitionOp( op )) {
+                        case PartitionOp::insert:
+                            if (not Codec< DataType >::decode( p, end, data )) malformed();
+                            m_out += char( m_table.insert( key, data ) );
+                            break;
+                        case PartitionOp::retrieve: {
+                            const DataType * found = m_table.find( key );
+                            m_out += char( found != nullptr );
+                            if (found != nullptr) Codec< DataType >::encode( m_out, *found );
+                            break;
+                        }
+                        case PartitionOp::erase:
+                            m_out += char( m_table.erase( key ) );
+                            break;
+                        default:
+                            malformed();
+                    }
+                }
+                break;
+            }
+            case detail::FrameKind::copy: {
+                std::vector< HashRing::Range > arcs;
+                if (not read_arcs( p, end, arcs )) malformed();
+                std::string entries;
+                std::uint32_t copied{0};
+                auto answer = [&]( bool last_ ) {
+                    m_out += char( last_ );
+                    Codec< std::uint32_t >::encode( m_out, copied );
+                    m_out += entries;
+                    entries.clear();
+                    copied = 0;
+                    if (last_) return;   // Sent below, like any answer.
+                    detail::end_frame( m_out );
+                    detail::write_full( fd_, m_out.data(), m_out.size() );
+                    detail::begin_frame( m_out, kind );
+                };
+                m_table.for_each( [&]( const typename table_type::entry_type & e_ ) {
+                    if (not in_arcs( e_.m_key, arcs )) return;
+                    Codec< KeyType >::encode( entries, e_.m_key );
+                    Codec< DataType >::encode( entries, e_.m_data );
+                    copied++;
+                    if (entries.size() >= m_chunk_bytes) answer( false );
+                } );
+                answer( true );
+                break;
+            }
+            case detail::FrameKind::drop: {
+                std::vector< HashRing::Range > arcs;
+                if (not read_arcs( p, end, arcs )) malformed();
+                n = std::uint32_t( m_table.erase_if( [&]( const KeyType & key_, const DataType & ) {
+                    return in_arcs( key_, arcs );
+                } ) );
+                Codec< std::uint32_t >::encode( m_out, n );
+                break;
+            }
+            case detail::FrameKind::size:
+                Codec< std::uint64_t >::encode( m_out, m_table.size() );
+                break;
+            case detail::FrameKind::shutdown:
+                m_stop = true;
+                break;
+            default:
+                malformed();
+        }
+        detail::end_frame( m_out );
+        detail::write_full( fd_, m_out.data(), m_out.size() );
+        return not m_stop;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool PartitionServer<KeyType,DataType,KeyHash,KeyEqual>::read_arcs( const char *& p_, const char * end_,
+                                                                       std::vector< HashRing::Range > & arcs_ )
+    {
+        std::uint32_t n;
+        if (not Codec< std::uint32_t >::decode( p_, end_, n )) return false;
+        for (std::uint32_t i{0}; i < n; i++) {
+            HashRing::Range r;
+            if (not Codec< HashRing::Range >::decode( p_, end_, r )) return false;
+            arcs_.push_back( r );
+        }
+        return true;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool PartitionServer<KeyType,DataType,KeyHash,KeyEqual>::in_arcs( const KeyType & key_,
+                                                                     const std::vector< HashRing::Range > & arcs_ )
+    {
+        auto pos = HashRing::position( KeyHash{}( key_ ) );
+        for (const auto & r : arcs_)
+            if (pos >= r.first and pos <= r.second) return true;
+        return false;
+    }
+
+    /*!
+     * @brief Connects to a new partition server and gives it its share of the ring. Each arc
+     * the new partition takes over belonged to exactly one old partition, which is asked for
+     * a copy of the entries of those arcs only (a copy frame); they are inserted into the new
+     * one, and only after every insert is acknowledged are they dropped from the old ones
+     * (drop frames). Until then a failure leaves the old partitions whole: the ring is put
+     * back and the new server, which may hold some copies, is disconnected.
+     * @param path_ socket path of the server.
+     * @param wait_ms_ how long to retry while the server is not listening yet.
+     * @return the number of keys moved to the new partition.
+     * @throw std::runtime_error if the server cannot be reached.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::add_partition( const std::string & path_, int wait_ms_ )
+    {
+        auto addr = detail::socket_address( path_ );
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( wait_ms_ );
+        int fd;
+        for (;;) {
+            fd = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+            if (fd < 0) detail::socket_error( "socket" );
+            if (::connect( fd, reinterpret_cast< sockaddr * >( &addr ), sizeof( addr ) ) == 0) break;
+            int err = errno;
+            ::close( fd );
+            errno = err;
+            if (( err != ENOENT and err != ECONNREFUSED ) or std::chrono::steady_clock::now() >= deadline)
+                detail::socket_error( "connect " + path_ );
+            std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+        }
+
+        const size_type added = m_fds.size();
+        HashRing before = m_ring;
+        m_ring.add( added );
+        m_fds.push_back( fd );
+        if (added == 0) return 0;
+
+        std::vector< std::vector< HashRing::Range > > from( added );
+        for (const auto & r : m_ring.ranges_of( added ))
+            from[ before.owner_of_position( r.second ) ].push_back( r );
+        auto arcs_frame = [this, &from]( detail::FrameKind kind_, size_type q_ ) {
+            detail::begin_frame( m_out, kind_ );
+            Codec< std::uint32_t >::encode( m_out, std::uint32_t( from[q_].size() ) );
+            for (const auto & r : from[q_]) Codec< HashRing::Range >::encode( m_out, r );
+            detail::end_frame( m_out );
+        };
+        size_type moved{0};
+        std::vector< Request > inserts;
+        try {
+            for (size_type q{0}; q < added; q++) {
+                if (from[q].empty()) continue;
+                arcs_frame( detail::FrameKind::copy, q );
+                inserts.clear();
+                for (bool last{false}; not last; ) {   // Read every chunk before talking to the new server.
+                    call( q, m_out, m_in );
+                    m_out.clear();                     // Later chunks come unasked.
+                    const char * p = m_in.data() + 1;
+                    const char * end = m_in.data() + m_in.size();
+                    std::uint8_t flag;
+                    std::uint32_t n;
+                    if (not Codec< std::uint8_t >::decode( p, end, flag ) or not Codec< std::uint32_t >::decode( p, end, n ))
+                        throw std::runtime_error( "[PartitionedHashTbl]: malformed answer." );
+                    last = flag != 0;
+                    for (std::uint32_t i{0}; i < n; i++) {
+                        Request r{ PartitionOp::insert, KeyType{}, DataType{}, false };
+                        if (not Codec< KeyType >::decode( p, end, r.m_key ) or not Codec< DataType >::decode( p, end, r.m_data ))
+                            throw std::runtime_error( "[PartitionedHashTbl]: malformed answer." );
+                        inserts.push_back( std::move( r ) );
+                    }
+                }
+                execute( inserts );   // Returns once the new server acknowledged each insert.
+                moved += inserts.size();
+            }
+        }
+        catch (...) {
+            m_ring = before;
+            m_fds.pop_back();
+            ::close( fd );
+            throw;
+        }
+        for (size_type q{0}; q < added; q++) {
+            if (from[q].empty()) continue;
+            arcs_frame( detail::FrameKind::drop, q );
+            call( q, m_out, m_in );
+        }
+        return moved;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert( const KeyType & key_, const DataType & data_ )
+    {
+        std::vector< Request > one{ Request{ PartitionOp::insert, key_, data_, false } };
+        execute( one );
+        return one[0].m_ok;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::retrieve( const KeyType & key_, DataType & data_ )
+    {
+        std::vector< Request > one{ Request{ PartitionOp::retrieve, key_, DataType{}, false } };
+        execute( one );
+        if (one[0].m_ok) data_ = std::move( one[0].m_data );
+        return one[0].m_ok;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::erase( const KeyType & key_ )
+    {
+        std::vector< Request > one{ Request{ PartitionOp::erase, key_, DataType{}, false } };
+        execute( one );
+        return one[0].m_ok;
+    }
+
+    /*!
+     * @brief Runs a list of requests on their partitions. In every round, each partition
+     * with requests left gets one frame of up to batch_ of them; all frames are written
+     * before the first answer is read, so the servers work on them concurrently (and a
+     * server never blocks on an answer the front end is not reading yet).
+     * @param requests_ the operations; their m_ok and m_data are filled in.
+     * @throw std::logic_error if there is no partition; std::runtime_error on a socket error.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::execute( std::vector< Request > & requests_ )
+    {
+        if (m_fds.empty()) throw std::logic_error( "[PartitionedHashTbl::execute()]: no partition." );
+        KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+        const size_type parts = m_fds.size();
+        std::vector< std::vector< size_type > > queue( parts );
+        for (size_type i{0}; i < requests_.size(); i++)
+            queue[ m_ring.owner( hashFunc( requests_[i].m_key ) ) ].push_back( i );
+        std::vector< size_type > next( parts, 0 ), sent( parts, 0 );
+        for (;;) {
+            bool any{false};
+            for (size_type p{0}; p < parts; p++) {
+                sent[p] = std::min( m_batch, queue[p].size() - next[p] );
+                if (sent[p] == 0) continue;
+                any = true;
+                detail::begin_frame( m_out, detail::FrameKind::batch );
+                Codec< std::uint32_t >::encode( m_out, std::uint32_t( sent[p] ) );
+                for (size_type j{0}; j < sent[p]; j++) {
+                    const Request & r = requests_[ queue[p][ next[p] + j ] ];
+                    m_out += char( r.m_op );
+                    Codec< KeyType >::encode( m_out, r.m_key );
+                    if (r.m_op == PartitionOp::insert) Codec< DataType >::encode( m_out, r.m_data );
+                }
+                detail::end_frame( m_out );
+                detail::write_full( m_fds[p], m_out.data(), m_out.size() );
+            }
+            if (not any) return;
+            for (size_type p{0}; p < parts; p++) {
+                if (sent[p] == 0) continue;
+                if (not detail::read_frame( m_fds[p], m_in ))
+                    throw std::runtime_error( "[PartitionedHashTbl]: partition " + std::to_string( p ) + " closed the connection." );
+                const char * in = m_in.data() + 1;
+                const char * end = m_in.data() + m_in.size();
+                std::uint32_t n;
+                if (not Codec< std::uint32_t >::decode( in, end, n ) or n != sent[p])
+                    throw std::runtime_error( "[PartitionedHashTbl]: malformed answer." );
+                for (size_type j{0}; j < sent[p]; j++) {
+                    Request & r = requests_[ queue[p][ next[p] + j ] ];
+                    std::uint8_t ok;
+                    if (not Codec< std::uint8_t >::decode( in, end, ok ))
+                        throw std::runtime_error( "[PartitionedHashTbl]: malformed answer." );
+                    r.m_ok = ok != 0;
+                    if (r.m_ok and r.m_op == PartitionOp::retrieve and not Codec< DataType >::decode( in, end, r.m_data ))
+                        throw std::runtime_error( "[PartitionedHashTbl]: malformed answer." );
+                }
+                next[p] += sent[p];
+            }
+        }
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::partition_size( size_type p_ )
+    {
+        detail::begin_frame( m_out, detail::FrameKind::size );
+        detail::end_frame( m_out );
+        call( p_, m_out, m_in );
+        const char * p = m_in.data() + 1;
+        std::uint64_t n;
+        if (not Codec< std::uint64_t >::decode( p, m_in.data() + m_in.size(), n ))
+            throw std::runtime_error( "[PartitionedHashTbl]: malformed answer." );
+        return n;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size()
+    {
+        size_type total{0};
+        for (size_type p{0}; p < m_fds.size(); p++) total += partition_size( p );
+        return total;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::shutdown()
+    {
+        detail::begin_frame( m_out, detail::FrameKind::shutdown );
+        detail::end_frame( m_out );
+        for (int fd : m_fds) {
+            try {
+                detail::write_full( fd, m_out.data(), m_out.size() );
+                detail::read_frame( fd, m_in );
+            }
+            catch (const std::runtime_error &) { /* Already gone. */ }
+            ::close( fd );
+        }
+        m_fds.clear();
+        m_ring = HashRing( m_ring.vnodes() );
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void PartitionedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::call( size_type p_, const std::string & out_, std::string & in_ )
+    {
+        detail::write_full( m_fds.at( p_ ), out_.data(), out_.size() );
+        if (not detail::read_frame( m_fds[p_], in_ ) or in_.empty())
+            throw std::runtime_error( "[PartitionedHashTbl]: partition " + std::to_string( p_ ) + " closed the connection." );
+    }
+} // Namespace ac.
@@ -0,0 +1,66 @@
+/*!
+ * @file rw_lock.h
+ * Reader-writer spin lock for short critical sections (C++11 has no shared_mutex).
+ */
+#ifndef _RW_LOCK_H_
+#define _RW_LOCK_H_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>   // std::this_thread::yield
+
+namespace ac // Associative container
+{
+    /// Many readers or one writer. A waiting writer blocks new readers, so writers do not starve.
+    /*! Meets the Lockable requirements (lock/unlock), so it works with std::lock_guard;
+     *  use SharedLock for the reader side.
+     */
+    class RwLock {
+        public:
+            RwLock() = default;
+            RwLock( const RwLock & ) = delete;
+            RwLock & operator=( const RwLock & ) = delete;
+
+            void lock_shared() {
+                for (;;) {
+                    auto s = m_state.load( std::memory_order_relaxed );
+                    if (not ( s & WRITER ) and
+                        m_state.compare_exchange_weak( s, s + 1, std::memory_order_acquire, std::memory_order_relaxed ))
+                        return;
+                    std::this_thread::yield();
+                }
+            }
+            void unlock_shared() { m_state.fetch_sub( 1, std::memory_order_release ); }
+
+            void lock() {
+                // Claim the writer bit first (no new readers get in), then wait for the readers to leave.
+                for (;;) {
+                    auto s = m_state.load( std::memory_order_relaxed );
+                    if (not ( s & WRITER ) and
+                        m_state.compare_exchange_weak( s, s | WRITER, std::memory_order_acquire, std::memory_order_relaxed ))
+                        break;
+                    std::this_thread::yield();
+                }
+                while (m_state.load( std::memory_order_acquire ) != WRITER)
+                    std::this_thread::yield();
+            }
+            void unlock() { m_state.fetch_and( ~WRITER, std::memory_order_release ); }
+
+        private:
+            static constexpr std::uint32_t WRITER = 1u << 31; //!< Set while a writer holds or waits for the lock.
+            std::atomic< std::uint32_t > m_state{ 0 };        //!< WRITER bit plus the number of readers.
+    };
+
+    /// RAII reader side of a RwLock.
+    class SharedLock {
+        public:
+            explicit SharedLock( RwLock & lock_ ) : m_lock( lock_ ) { m_lock.lock_shared(); }
+            ~SharedLock() { m_lock.unlock_shared(); }
+            SharedLock( const SharedLock & ) = delete;
+            SharedLock & operator=( const SharedLock & ) = delete;
+        private:
+            RwLock & m_lock;
+    };
+
+} // namespace ac
+#endif
@@ -0,0 +1,93 @@
+/*!
+ * @file sharded_hashtbl.h
+ * Thread-safe hash table split into independently locked HashTbl shards, with
+ * optional huge pages and per-shard NUMA binding.
+ */
+#ifndef _SHARDED_HASHTBL_H_
+#define _SHARDED_HASHTBL_H_
+
+#include <algorithm>      // std::max
+#include <cstdint>
+#include <memory>
+#include <mutex>        // std::lock_guard
+#include <vector>
+
+#include "hashtbl.h"
+#include "page_alloc.h"
+#include "rw_lock.h"
+
+namespace ac // Associative container
+{
+    /// Layout of a ShardedHashTbl.
+    struct ShardOptions {
+        std::size_t shards = 16;  //!< Independently locked shards.
+        std::size_t expected = 0; //!< Elements expected in total; presizes the shards (0 lets them grow).
+        bool huge_pages = false;  //!< Allocate the shards' lists and nodes on 2 MiB huge pages.
+        bool numa = false;        //!< Spread the shards over the NUMA nodes and bind each one's memory to its node.
+    };
+
+    /// A HashTbl split into shards, each with its own lock and its own memory.
+    /*! A key belongs to one shard, chosen from its KeyHash value. With ShardOptions::numa,
+     *  shard s lives on node s % numa::node_count(): its collision lists and nodes are
+     *  bound there (see MemoryPolicy). Threads are routed to local shards by the caller:
+     *  a worker pins itself with numa::run_on_node( n ) and takes the keys whose
+     *  node_of( key ) is n, or walks shards_on_node( n ).
+     */
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class ShardedHashTbl {
+        public:
+            using size_type = std::size_t;
+            using table_type = HashTbl< KeyType, DataType, KeyHash, KeyEqual >;
+
+            explicit ShardedHashTbl( const ShardOptions & opts_ = ShardOptions{} );
+            ShardedHashTbl( const ShardedHashTbl & ) = delete;
+            ShardedHashTbl & operator=( const ShardedHashTbl & ) = delete;
+
+            // Inserts or replaces; true if key_ was new.
+            bool insert( const KeyType & key_, const DataType & data_ );
+            bool retrieve( const KeyType & key_, DataType & data_ ) const;
+            bool erase( const KeyType & key_ );
+            // Returns 1 if key_ is stored; 0, otherwise.
+            size_type count( const KeyType & key_ ) const;
+            // Calls f(data) on the data of key_ under the shard's write lock; false if key_ is absent.
+            template< class Func >
+            bool modify( const KeyType & key_, Func f_ );
+            // Calls f(entry) for every element, one shard at a time under its read lock.
+            template< class Func >
+            void for_each( Func f_ ) const;
+            void clear();
+            size_type size() const;
+            bool empty() const { return size() == 0; }
+
+            size_type shard_count() const { return m_shards.size(); }
+            // Shard that holds (or would hold) key_.
+            size_type shard_of( const KeyType & key_ ) const;
+            // Elements in shard s_.
+            size_type shard_size( size_type s_ ) const;
+            // NUMA node the memory of shard s_ is bound to; -1 without ShardOptions::numa.
+            int node_of_shard( size_type s_ ) const { return m_shards[s_]->m_table.memory_policy().numa_node; }
+            // NUMA node of the shard of key_.
+            int node_of( const KeyType & key_ ) const { return node_of_shard( shard_of( key_ ) ); }
+            // Shards bound to node_.
+            std::vector< size_type > shards_on_node( int node_ ) const;
+
+        private:
+            //! A lock and the table it guards.
+            struct Shard {
+                // expected_ elements fit without a rehash() (at the default maximum load factor).
+                Shard( size_type expected_, const MemoryPolicy & policy_ ) : m_table( std::max< size_type >( expected_, 10 ), policy_ ) {}
+                mutable RwLock m_lock;
+                table_type m_table;
+            };
+
+            Shard & shard( const KeyType & key_ ) const { return *m_shards[ shard_of( key_ ) ]; }
+
+            std::vector< std::unique_ptr< Shard > > m_shards;
+    };
+
+} // namespace ac
+#include "sharded_hashtbl.inl"
+#endif
@@ -0,0 +1,162 @@
+#include "sharded_hashtbl.h"
+
+namespace ac {
+    /*!
+     * @brief Creates the shards, each with its own memory policy.
+     * @tparam KeyType type of key stored in the table.
+     * @tparam DataType data type stored in the table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function received by the client.
+     * @param opts_ number of shards, expected size, huge pages and NUMA spreading.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+	ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::ShardedHashTbl( const ShardOptions & opts_ )
+	{
+        const size_type shards = std::max< size_type >( opts_.shards, 1 );
+        const int nodes = opts_.numa ? numa::node_count() : 0;
+        const size_type per_shard = opts_.expected / shards;
+        for (size_type s{0}; s < shards; s++) {
+            MemoryPolicy policy;
+            policy.huge_pages = opts_.huge_pages;
+            policy.numa_node = opts_.numa ? int( s % nodes ) : -1;
+            m_shards.emplace_back( new Shard( per_shard, policy ) );
+        }
+	}
+
+    /*!
+     * @brief Inserts a new element, or replaces the data of an existing key.
+     * @param key_ the key of the element.
+     * @param data_ the data of the element.
+     * @return true if key_ was not in the table; false, if its data was replaced.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert( const KeyType & key_, const DataType & data_ )
+    {
+        Shard & s = shard( key_ );
+        std::lock_guard< RwLock > lock( s.m_lock );
+        return s.m_table.insert( key_, data_ );
+    }
+
+    /*!
+     * @brief Looks a key up under its shard's read lock.
+     * @param key_ the key to search for.
+     * @param data_ receives a copy of the data when the key is found.
+     * @return true if the key was found; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::retrieve( const KeyType & key_, DataType & data_ ) const
+    {
+        Shard & s = shard( key_ );
+        SharedLock lock( s.m_lock );
+        return s.m_table.retrieve( key_, data_ );
+    }
+
+    /*!
+     * @brief Removes the element of a key.
+     * @param key_ the key of the element.
+     * @return true if the key was found and removed; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::erase( const KeyType & key_ )
+    {
+        Shard & s = shard( key_ );
+        std::lock_guard< RwLock > lock( s.m_lock );
+        return s.m_table.erase( key_ );
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::count( const KeyType & key_ ) const
+    {
+        Shard & s = shard( key_ );
+        SharedLock lock( s.m_lock );
+        return s.m_table.find( key_ ) == nullptr ? 0 : 1;
+    }
+
+    /*!
+     * @brief Updates the data of a key in place, under its shard's write lock.
+     * @param key_ the key of the element.
+     * @param f_ called as f_( data ).
+     * @return true if the key was found; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Func >
+    bool ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::modify( const KeyType & key_, Func f_ )
+    {
+        Shard & s = shard( key_ );
+        std::lock_guard< RwLock > lock( s.m_lock );
+        DataType * data = s.m_table.find( key_ );
+        if (data == nullptr) return false;
+        f_( *data );
+        return true;
+    }
+
+    /*!
+     * @brief Visits every element. Each shard is read-locked while it is visited, so the
+     * walk is not a snapshot of the whole table.
+     * @param f_ called as f_( entry ) for every element.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Func >
+    void ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::for_each( Func f_ ) const
+    {
+        for (const auto & s : m_shards) {
+            SharedLock lock( s->m_lock );
+            s->m_table.for_each( f_ );
+        }
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::clear()
+    {
+        for (auto & s : m_shards) {
+            std::lock_guard< RwLock > lock( s->m_lock );
+            s->m_table.clear();
+        }
+    }
+
+    /*!
+     * @brief Number of elements, summed shard by shard (not a snapshot under writers).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size() const
+    {
+        size_type n{0};
+        for (size_type s{0}; s < m_shards.size(); s++)
+            n += shard_size( s );
+        return n;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::shard_size( size_type s_ ) const
+    {
+        SharedLock lock( m_shards[s_]->m_lock );
+        return m_shards[s_]->m_table.size();
+    }
+
+    /*!
+     * @brief Picks the shard from the high bits of the mixed hash, so that the choice
+     * does not correlate with the collision list the shard's table picks (hash % size).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    typename ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type
+    ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::shard_of( const KeyType & key_ ) const
+    {
+        KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+        auto h = static_cast< std::uint64_t >( hashFunc( key_ ) );
+        auto mixed = ( h ^ ( h >> 32 ) ) * 0x9E3779B97F4A7C15ull;
+        return ( mixed >> 40 ) % m_shards.size();
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    std::vector< typename ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type >
+    ShardedHashTbl<KeyType,DataType,KeyHash,KeyEqual>::shards_on_node( int node_ ) const
+    {
+        std::vector< size_type > out;
+        for (size_type s{0}; s < m_shards.size(); s++)
+            if (node_of_shard( s ) == node_) out.push_back( s );
+        return out;
+    }
+} // Namespace ac.
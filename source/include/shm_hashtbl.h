@@ -0,0 +1,162 @@
+/*!
+ * @file shm_hashtbl.h
+ * Hash table in a POSIX shared-memory segment, read by many processes at once.
+ */
+#ifndef _SHM_HASHTBL_H_
+#define _SHM_HASHTBL_H_
+
+#include <algorithm>    // std::max
+#include <atomic>
+#include <cstdint>
+#include <cstring>      // std::memcpy, std::strerror
+#include <functional>   // std::hash, std::equal_to
+#include <stdexcept>    // std::runtime_error, std::length_error, std::logic_error
+#include <string>
+#include <thread>       // std::this_thread::yield
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>      // O_* constants
+#include <signal.h>     // kill
+#include <sys/mman.h>   // shm_open, mmap
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ac // Associative container
+{
+    /// Counters of the lookups made through one mapping of a ShmHashTbl (a snapshot; the
+    /// mapping keeps them in its process, not in the segment).
+    struct ShmReadStats {
+        std::size_t lookups = 0;
+        std::size_t retries = 0;   //!< Lookups repeated because a writer changed the bucket meanwhile.
+    };
+
+    /// A chained hash table laid out in one shared-memory segment, so that every
+    /// process maps the same copy.
+    /*! The segment holds a header, the bucket heads and a fixed pool of entries.
+     *  Links are offsets from the start of the segment, so the table works at any
+     *  address each process maps it to. Keys and data must be trivially copyable
+     *  (no heap pointers), and KeyHash must give the same value in every process.
+     *
+     *  One writer at a time: mutations take a spin lock in the header, so writers
+     *  in several processes are serialized. Readers take no lock. Each bucket is
+     *  covered by one of STRIPES sequence counters, which a writer makes odd while
+     *  it changes the bucket; a reader copies the data out and retries if the
+     *  counter moved (a seqlock), so it never returns a torn value.
+     *
+     *  The lock holds the pid of its owner. A writer that dies holding it (or with
+     *  a counter left odd) would block every writer, and the readers of its stripe:
+     *  whoever waits on it checks now and then whether the owner still exists and,
+     *  if not, takes the lock over and repairs the table (see recover()). The entry
+     *  the dead writer was overwriting may keep a torn value. Ownership is told by
+     *  pid, so the processes must share a pid namespace; a dead owner whose pid was
+     *  reused, or a zombie not reaped yet, still counts as alive.
+     *
+     *  The capacity is fixed when the segment is created: an insert into a full
+     *  table throws std::length_error. Erased entries are reused.
+     */
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType > >
+	class ShmHashTbl {
+        static_assert( std::is_trivially_copyable< KeyType >::value and std::is_trivially_copyable< DataType >::value,
+                       "ShmHashTbl stores keys and data by value in shared memory" );
+        static_assert( ATOMIC_LLONG_LOCK_FREE == 2, "ShmHashTbl needs lock-free 64-bit atomics" );
+
+        public:
+            using size_type = std::size_t;
+            static const size_type STRIPES = 1024;   //!< Sequence counters shared by the buckets.
+
+            // Creates the segment name_ (a POSIX shm name such as "/accounts"; it must not exist)
+            // for capacity_ entries in buckets_ collision lists (0: as many as entries).
+            static ShmHashTbl create( const std::string & name_, size_type capacity_, size_type buckets_ = 0 );
+            // Maps the existing segment name_; a mapping opened with writable_ false can only read.
+            static ShmHashTbl open( const std::string & name_, bool writable_ = false );
+            // Removes the segment name_; mappings already open stay valid. False if it did not exist.
+            static bool remove( const std::string & name_ ) { return ::shm_unlink( name_.c_str() ) == 0; }
+
+            ShmHashTbl( ShmHashTbl && other_ ) noexcept { *this = std::move( other_ ); }
+            ShmHashTbl & operator=( ShmHashTbl && other_ ) noexcept;
+            ShmHashTbl( const ShmHashTbl & ) = delete;
+            ShmHashTbl & operator=( const ShmHashTbl & ) = delete;
+            ~ShmHashTbl() { unmap(); }
+
+            // Inserts or replaces; true if key_ was new. Throws std::length_error when full.
+            bool insert( const KeyType & key_, const DataType & data_ );
+            bool erase( const KeyType & key_ );
+            void clear();
+            // Copies the data of key_ into data_; false if key_ is absent. Lock-free.
+            bool retrieve( const KeyType & key_, DataType & data_ ) const;
+            // Returns 1 if key_ is stored; 0, otherwise.
+            size_type count( const KeyType & key_ ) const { DataType d; return retrieve( key_, d ) ? 1 : 0; }
+            // Calls f(key, data) for every entry. Holds the writer lock, so it sees no concurrent change.
+            template< class Func >
+            void for_each( Func f_ ) const;
+
+            size_type size() const { return header()->m_count.load( std::memory_order_acquire ); }
+            bool empty() const { return size() == 0; }
+            size_type capacity() const { return header()->m_capacity; }
+            size_type bucket_count() const { return header()->m_buckets; }
+            // Bytes of the segment (the memory every process shares).
+            size_type segment_bytes() const { return m_bytes; }
+            bool writable() const { return m_writable; }
+            ShmReadStats read_stats() const;
+            // If the writer lock is held by a process that no longer exists, takes it over, makes
+            // every sequence counter even, rebuilds the entry count and the free list from the lists,
+            // and releases it. True if it did. Writers and stalled lookups call it by themselves.
+            bool recover() const;
+
+        private:
+            //! Segment header; everything after it is addressed by offsets from the segment start.
+            struct Header {
+                std::uint64_t m_magic;
+                std::uint32_t m_key_size, m_data_size;
+                std::uint64_t m_capacity, m_buckets;
+                std::uint64_t m_heads;             //!< Offset of the bucket heads.
+                std::uint64_t m_nodes;             //!< Offset of the entry pool.
+                std::atomic< std::uint64_t > m_count;
+                std::uint64_t m_unused;            //!< Pool entries never handed out yet.
+                std::uint64_t m_free;              //!< First erased entry (0: none), linked through m_next.
+                std::atomic< std::uint32_t > m_writer;
+                std::atomic< std::uint64_t > m_seq[STRIPES];
+            };
+            struct Node {
+                std::atomic< std::uint64_t > m_next; //!< Offset of the next entry of the list; 0 ends it.
+                KeyType m_key;
+                DataType m_data;
+            };
+            static const std::uint64_t MAGIC = 0x4C42544853434148ull; // "HACSHTBL"
+
+            ShmHashTbl() = default;
+            static ShmHashTbl map( const std::string & name_, int fd_, size_type bytes_, bool writable_ );
+            void unmap();
+
+            Header * header() const { return reinterpret_cast< Header * >( m_base ); }
+            std::atomic< std::uint64_t > * heads() const {
+                return reinterpret_cast< std::atomic< std::uint64_t > * >( m_base + header()->m_heads );
+            }
+            Node * node( std::uint64_t off_ ) const { return reinterpret_cast< Node * >( m_base + off_ ); }
+            size_type bucket( const KeyType & key_ ) const { return KeyHash{}( key_ ) % header()->m_buckets; }
+            std::atomic< std::uint64_t > & seq( size_type b_ ) const { return header()->m_seq[ b_ % STRIPES ]; }
+
+            void lock_writer() const;
+            void unlock_writer() const { header()->m_writer.store( 0, std::memory_order_release ); }
+            // Restores the invariants a writer may have left broken. Needs the writer lock.
+            void repair() const;
+            void check_writable( const char * what_ ) const;
+            // Marks bucket b_ as changing (odd counter) / changed (even counter).
+            void begin_write( size_type b_ ) const;
+            void end_write( size_type b_ ) const { seq( b_ ).fetch_add( 1, std::memory_order_release ); }
+
+            char * m_base = nullptr;
+            size_type m_bytes = 0;
+            bool m_writable = false;
+            // ShmReadStats, bumped by the lookups of any thread of this process.
+            mutable std::atomic< std::size_t > m_lookups{ 0 };
+            mutable std::atomic< std::size_t > m_retries{ 0 };
+    };
+
+} // namespace ac
+#include "shm_hashtbl.inl"
+#endif
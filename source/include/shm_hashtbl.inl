@@ -0,0 +1,389 @@
+#include "shm_hashtbl.h"
+
+namespace ac {
+    /*!
+     * @brief Creates and initializes a shared-memory table.
+     * @tparam KeyType trivially copyable type of key stored in the table.
+     * @tparam DataType trivially copyable data type stored in the table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function received by the client.
+     * @param name_ POSIX shared-memory name ("/something"); the segment must not exist yet.
+     * @param capacity_ maximum number of entries.
+     * @param buckets_ number of collision lists; 0 means one per entry.
+     * @return a writable mapping of the new table.
+     * @throw std::runtime_error if the segment cannot be created or mapped.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>
+    ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::create( const std::string & name_, size_type capacity_, size_type buckets_ )
+    {
+        capacity_ = std::max< size_type >( capacity_, 1 );
+        buckets_ = buckets_ ? buckets_ : capacity_;
+        const size_type heads = ( sizeof( Header ) + 63 ) / 64 * 64;
+        const size_type nodes = ( heads + buckets_ * sizeof( std::uint64_t ) + 63 ) / 64 * 64;
+        const size_type bytes = nodes + capacity_ * sizeof( Node );
+
+        int fd = ::shm_open( name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600 );
+        if (fd < 0)
+            throw std::runtime_error( "[ShmHashTbl::create()]: " + name_ + ": " + std::strerror( errno ) );
+        if (::ftruncate( fd, off_t( bytes ) ) != 0) {
+            int err = errno;
+            ::close( fd );
+            ::shm_unlink( name_.c_str() );
+            throw std::runtime_error( "[ShmHashTbl::create()]: " + name_ + ": " + std::strerror( err ) );
+        }
+        ShmHashTbl table;
+        try {
+            table = map( name_, fd, bytes, true );
+        }
+        catch (...) { ::shm_unlink( name_.c_str() ); throw; }
+        // The new segment reads as zeros: the counters, heads and free list start out empty.
+        Header * h = table.header();
+        h->m_key_size = sizeof( KeyType );
+        h->m_data_size = sizeof( DataType );
+        h->m_capacity = capacity_;
+        h->m_buckets = buckets_;
+        h->m_heads = heads;
+        h->m_nodes = nodes;
+        h->m_unused = capacity_;
+        h->m_free = 0;
+        // Published last: open() refuses a segment whose header is not complete.
+        reinterpret_cast< std::atomic< std::uint64_t > * >( &h->m_magic )->store( MAGIC, std::memory_order_release );
+        return table;
+    }
+
+    /*!
+     * @brief Maps a table created by create(), possibly in another process.
+     * @param name_ POSIX shared-memory name of the table.
+     * @param writable_ whether this mapping may change the table.
+     * @throw std::runtime_error if the segment does not exist or was made for other key or data types.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>
+    ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::open( const std::string & name_, bool writable_ )
+    {
+        int fd = ::shm_open( name_.c_str(), O_RDWR, 0 );
+        if (fd < 0)
+            throw std::runtime_error( "[ShmHashTbl::open()]: " + name_ + ": " + std::strerror( errno ) );
+        struct stat st;
+        if (::fstat( fd, &st ) != 0 or size_type( st.st_size ) < sizeof( Header )) {
+            ::close( fd );
+            throw std::runtime_error( "[ShmHashTbl::open()]: " + name_ + ": not a table segment." );
+        }
+        ShmHashTbl table = map( name_, fd, size_type( st.st_size ), writable_ );
+        Header * h = table.header();
+        if (reinterpret_cast< std::atomic< std::uint64_t > * >( &h->m_magic )->load( std::memory_order_acquire ) != MAGIC or
+            h->m_key_size != sizeof( KeyType ) or h->m_data_size != sizeof( DataType ) or
+            h->m_nodes + h->m_capacity * sizeof( Node ) > table.m_bytes)
+            throw std::runtime_error( "[ShmHashTbl::open()]: " + name_ + ": not a table of these key and data types." );
+        return table;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>
+    ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::map( const std::string & name_, int fd_, size_type bytes_, bool writable_ )
+    {
+        // Atomics need write access to be read safely (a plain load may be a locked instruction),
+        // so every mapping is PROT_WRITE; writable_ only gates the mutating methods.
+        void * p = ::mmap( nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0 );
+        int err = errno;
+        ::close( fd_ );
+        if (p == MAP_FAILED)
+            throw std::runtime_error( "[ShmHashTbl]: mmap " + name_ + ": " + std::strerror( err ) );
+        ShmHashTbl table;
+        table.m_base = static_cast< char * >( p );
+        table.m_bytes = bytes_;
+        table.m_writable = writable_;
+        return table;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual> &
+    ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::operator=( ShmHashTbl && other_ ) noexcept
+    {
+        if (this != &other_) {
+            unmap();
+            m_base = other_.m_base;
+            m_bytes = other_.m_bytes;
+            m_writable = other_.m_writable;
+            m_lookups.store( other_.m_lookups.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+            m_retries.store( other_.m_retries.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+            other_.m_base = nullptr;
+            other_.m_bytes = 0;
+        }
+        return *this;
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::unmap()
+    {
+        if (m_base != nullptr) ::munmap( m_base, m_bytes );
+        m_base = nullptr;
+    }
+
+    /*!
+     * @brief Inserts a new entry, or replaces the data of an existing key. A new entry is
+     * filled in before it is linked, so a reader never reaches a half-written one.
+     * @param key_ the key of the entry.
+     * @param data_ the data of the entry.
+     * @return true if key_ was new; false, if its data was replaced.
+     * @throw std::length_error if key_ is new and every entry of the pool is in use.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::insert( const KeyType & key_, const DataType & data_ )
+    {
+        check_writable( "insert" );
+        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
+        Header * h = header();
+        auto b = bucket( key_ );
+        lock_writer();
+        for (auto off = heads()[b].load( std::memory_order_relaxed ); off != 0; off = node( off )->m_next.load( std::memory_order_relaxed )) {
+            Node * n = node( off );
+            if (equalFunc( n->m_key, key_ )) {
+                begin_write( b );
+                std::memcpy( static_cast< void * >( &n->m_data ), &data_, sizeof( DataType ) );
+                end_write( b );
+                unlock_writer();
+                return false;
+            }
+        }
+        std::uint64_t off;
+        if (h->m_free != 0) {
+            off = h->m_free;
+            h->m_free = node( off )->m_next.load( std::memory_order_relaxed );
+        }
+        else if (h->m_unused > 0) {
+            off = h->m_nodes + ( h->m_capacity - h->m_unused ) * sizeof( Node );
+            h->m_unused--;
+        }
+        else {
+            unlock_writer();
+            throw std::length_error( "[ShmHashTbl::insert()]: the table is full." );
+        }
+        // An erased entry may still be under a reader of its old bucket; that bucket's
+        // counter moved when it was erased, so the reader retries.
+        begin_write( b );
+        Node * n = node( off );
+        std::memcpy( static_cast< void * >( &n->m_key ), &key_, sizeof( KeyType ) );
+        std::memcpy( static_cast< void * >( &n->m_data ), &data_, sizeof( DataType ) );
+        n->m_next.store( heads()[b].load( std::memory_order_relaxed ), std::memory_order_relaxed );
+        heads()[b].store( off, std::memory_order_release );
+        end_write( b );
+        h->m_count.fetch_add( 1, std::memory_order_release );
+        unlock_writer();
+        return true;
+    }
+
+    /*!
+     * @brief Removes the entry of a key; its slot goes back to the pool.
+     * @param key_ the key of the entry.
+     * @return true if the key was found and removed; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::erase( const KeyType & key_ )
+    {
+        check_writable( "erase" );
+        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
+        Header * h = header();
+        auto b = bucket( key_ );
+        lock_writer();
+        std::atomic< std::uint64_t > * link = &heads()[b];
+        for (auto off = link->load( std::memory_order_relaxed ); off != 0; off = link->load( std::memory_order_relaxed )) {
+            Node * n = node( off );
+            if (equalFunc( n->m_key, key_ )) {
+                begin_write( b );
+                link->store( n->m_next.load( std::memory_order_relaxed ), std::memory_order_release );
+                end_write( b );
+                // The entry keeps its old link until it is reused, so a reader standing on it
+                // still reaches the end of a list (and then retries).
+                n->m_next.store( h->m_free, std::memory_order_relaxed );
+                h->m_free = off;
+                h->m_count.fetch_sub( 1, std::memory_order_release );
+                unlock_writer();
+                return true;
+            }
+            link = &n->m_next;
+        }
+        unlock_writer();
+        return false;
+    }
+
+    /*!
+     * @brief Empties the table and returns every entry to the pool.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::clear()
+    {
+        check_writable( "clear" );
+        Header * h = header();
+        lock_writer();
+        for (size_type b{0}; b < h->m_buckets; b++) {
+            if (heads()[b].load( std::memory_order_relaxed ) == 0) continue;
+            begin_write( b );
+            heads()[b].store( 0, std::memory_order_release );
+            end_write( b );
+        }
+        h->m_free = 0;
+        h->m_unused = h->m_capacity;
+        h->m_count.store( 0, std::memory_order_release );
+        unlock_writer();
+    }
+
+    /*!
+     * @brief Looks a key up without locking. The data is copied out between two reads
+     * of the bucket's sequence counter; if a writer changed the bucket meanwhile
+     * (odd or different counter), the lookup starts over. A counter that stays odd
+     * may belong to a dead writer: the lookup then tries recover() from time to time.
+     * @param key_ the key to search for.
+     * @param data_ receives a copy of the data when the key is found.
+     * @return true if the key was found; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::retrieve( const KeyType & key_, DataType & data_ ) const
+    {
+        KeyEqual equalFunc; // Instantiate the "functor" for the equal to test.
+        const Header * h = header();
+        auto b = bucket( key_ );
+        auto & counter = seq( b );
+        m_lookups.fetch_add( 1, std::memory_order_relaxed );
+        for (size_type odd{0};; m_retries.fetch_add( 1, std::memory_order_relaxed )) {
+            auto before = counter.load( std::memory_order_acquire );
+            if (before & 1) {
+                if (++odd % 1024 == 0) recover();
+                std::this_thread::yield();
+                continue;
+            }
+            bool found{false};
+            // At most capacity steps: a list that changed under us may have led into another one.
+            size_type steps{0};
+            for (auto off = heads()[b].load( std::memory_order_acquire ); off != 0 and steps <= h->m_capacity; steps++) {
+                const Node * n = node( off );
+                KeyType key;
+                std::memcpy( static_cast< void * >( &key ), &n->m_key, sizeof( KeyType ) );
+                if (equalFunc( key, key_ )) {
+                    std::memcpy( static_cast< void * >( &data_ ), &n->m_data, sizeof( DataType ) );
+                    found = true;
+                    break;
+                }
+                off = n->m_next.load( std::memory_order_acquire );
+            }
+            std::atomic_thread_fence( std::memory_order_acquire );
+            if (counter.load( std::memory_order_relaxed ) == before)
+                return found;
+        }
+    }
+
+    /*!
+     * @brief Visits every entry under the writer lock.
+     * @param f_ called as f_( key, data ) for every entry.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    template< class Func >
+    void ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::for_each( Func f_ ) const
+    {
+        lock_writer();
+        try {
+            for (size_type b{0}; b < header()->m_buckets; b++)
+                for (auto off = heads()[b].load( std::memory_order_acquire ); off != 0; off = node( off )->m_next.load( std::memory_order_relaxed ))
+                    f_( static_cast< const KeyType & >( node( off )->m_key ), static_cast< const DataType & >( node( off )->m_data ) );
+        }
+        catch (...) { unlock_writer(); throw; }
+        unlock_writer();
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    ShmReadStats ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::read_stats() const
+    {
+        ShmReadStats stats;
+        stats.lookups = m_lookups.load( std::memory_order_relaxed );
+        stats.retries = m_retries.load( std::memory_order_relaxed );
+        return stats;
+    }
+
+    /*!
+     * @brief Takes the writer lock, stamped with the pid of this process. Every 1024 failed
+     * attempts, checks whether the owner died (see recover()).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::lock_writer() const
+    {
+        auto & w = header()->m_writer;
+        const auto self = std::uint32_t( ::getpid() );
+        for (size_type attempt{1};; attempt++) {
+            std::uint32_t expected{0};
+            if (w.compare_exchange_weak( expected, self, std::memory_order_acquire, std::memory_order_relaxed ))
+                return;
+            if (attempt % 1024 == 0 and recover()) continue;
+            std::this_thread::yield();
+        }
+    }
+
+    /*!
+     * @brief Takes over the writer lock of a dead process and repairs the table.
+     * The owner is dead when kill(owner, 0) fails with ESRCH. Of several processes
+     * that find it dead, one takes the lock over; the others go on waiting for it.
+     * @return true if this call repaired the table.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    bool ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::recover() const
+    {
+        auto & w = header()->m_writer;
+        auto owner = w.load( std::memory_order_acquire );
+        if (owner == 0 or ::kill( pid_t( owner ), 0 ) == 0 or errno != ESRCH) return false;
+        if (not w.compare_exchange_strong( owner, std::uint32_t( ::getpid() ), std::memory_order_acquire, std::memory_order_relaxed ))
+            return false;
+        repair();
+        unlock_writer();
+        return true;
+    }
+
+    /*!
+     * @brief Brings the table back to a consistent state after a writer died mid-change.
+     * The lists themselves are always whole (each link changes in one store), but the
+     * writer may have left a counter odd, taken an entry from the pool without linking
+     * it, or unlinked one without returning it. So every counter is made even, and the
+     * count and the free list are rebuilt from the entries the lists reach.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::repair() const
+    {
+        Header * h = header();
+        for (auto & counter : h->m_seq)
+            if (counter.load( std::memory_order_relaxed ) & 1) counter.fetch_add( 1, std::memory_order_release );
+        std::vector< char > linked( h->m_capacity - h->m_unused, 0 );   // Entries ever handed out.
+        size_type count{0};
+        for (size_type b{0}; b < h->m_buckets; b++) {
+            size_type steps{0};
+            for (auto off = heads()[b].load( std::memory_order_relaxed ); off != 0 and steps < h->m_capacity; steps++) {
+                linked[ ( off - h->m_nodes ) / sizeof( Node ) ] = 1;
+                count++;
+                off = node( off )->m_next.load( std::memory_order_relaxed );
+            }
+        }
+        h->m_free = 0;
+        for (size_type i{ linked.size() }; i-- > 0; ) {
+            if (linked[i]) continue;
+            auto off = h->m_nodes + i * sizeof( Node );
+            node( off )->m_next.store( h->m_free, std::memory_order_relaxed );
+            h->m_free = off;
+        }
+        h->m_count.store( count, std::memory_order_release );
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::check_writable( const char * what_ ) const
+    {
+        if (not m_writable)
+            throw std::logic_error( std::string( "[ShmHashTbl::" ) + what_ + "()]: the table was opened read-only." );
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    void ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::begin_write( size_type b_ ) const
+    {
+        seq( b_ ).fetch_add( 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+    }
+
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual >
+    const typename ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::size_type ShmHashTbl<KeyType,DataType,KeyHash,KeyEqual>::STRIPES;
+} // Namespace ac.
@@ -0,0 +1,150 @@
+/*!
+ * @file string_pool.h
+ * String interning pool backed by a single arena.
+ */
+#ifndef _STRING_POOL_H_
+#define _STRING_POOL_H_
+
+#include <cstdint>   // uint32_t
+#include <cstring>   // memcmp, memcpy, strlen
+#include <string>
+#include <vector>
+#include <stdexcept> // std::length_error
+
+namespace ac // Associative container
+{
+    /// Compact reference to a string stored in a StringPool.
+    /*! Two handles from the same pool are equal iff they refer to the same
+     *  string, so comparing them never touches the characters.
+     */
+    struct StringHandle {
+        std::uint32_t m_offset; //!< Position of the string in the pool arena.
+        std::uint32_t m_hash;   //!< Hash of the characters, computed once when interned.
+
+        bool operator==( const StringHandle & rhs ) const { return m_offset == rhs.m_offset; }
+        bool operator!=( const StringHandle & rhs ) const { return m_offset != rhs.m_offset; }
+    };
+
+    /// Interns strings: each distinct string is stored once, in one growing arena.
+    /*! Handles are offsets, so they stay valid while the arena grows. A pool is
+     *  meant to be shared by every table whose keys hold its handles; copying or
+     *  rehashing those tables copies handles only.
+     */
+    class StringPool {
+        public:
+            using size_type = std::size_t;
+
+            explicit StringPool( size_type expected_strings_ = 64 )
+            {
+                size_type cap{16};
+                while (cap < 2 * expected_strings_) cap <<= 1;
+                m_index.assign( cap, std::uint32_t( EMPTY ) );
+            }
+
+            /// Returns the handle of s_, storing it first if it was not interned yet.
+            StringHandle intern( const char * s_, size_type len_ )
+            {
+                auto h = hash( s_, len_ );
+                auto slot = probe( s_, len_, h );
+                if (m_index[slot] != EMPTY)
+                    return StringHandle{ m_index[slot], h };
+                if (m_arena.size() + 2 * HEADER + len_ + 1 > UINT32_MAX)
+                    throw std::length_error("[StringPool::intern()]: arena is full.");
+                auto offset = static_cast<std::uint32_t>( m_arena.size() );
+                m_arena.resize( m_arena.size() + 2 * HEADER + len_ + 1 );
+                std::uint32_t len32 = static_cast<std::uint32_t>( len_ );
+                std::memcpy( &m_arena[offset], &len32, sizeof(len32) );
+                std::memcpy( &m_arena[offset + HEADER], &h, sizeof(h) );
+                std::memcpy( &m_arena[offset + 2 * HEADER], s_, len_ );
+                m_arena[offset + 2 * HEADER + len_] = '\0';
+                m_index[slot] = offset;
+                if (++m_count * 2 > m_index.size())
+                    grow();
+                return StringHandle{ offset, h };
+            }
+            StringHandle intern( const std::string & s_ ) { return intern( s_.data(), s_.size() ); }
+
+            /// Looks s_ up without interning it. Never allocates.
+            /*! @return true and fills handle_ if s_ is in the pool; false, otherwise. */
+            bool find( const char * s_, size_type len_, StringHandle & handle_ ) const
+            {
+                auto h = hash( s_, len_ );
+                auto slot = probe( s_, len_, h );
+                if (m_index[slot] == EMPTY)
+                    return false;
+                handle_ = StringHandle{ m_index[slot], h };
+                return true;
+            }
+            bool find( const std::string & s_, StringHandle & handle_ ) const { return find( s_.data(), s_.size(), handle_ ); }
+
+            /// Characters of an interned string (null terminated).
+            const char * c_str( StringHandle h_ ) const { return &m_arena[h_.m_offset + 2 * HEADER]; }
+            /// Length of an interned string.
+            size_type length( StringHandle h_ ) const
+            {
+                std::uint32_t len;
+                std::memcpy( &len, &m_arena[h_.m_offset], sizeof(len) );
+                return len;
+            }
+            /// Copy of an interned string.
+            std::string str( StringHandle h_ ) const { return std::string( c_str( h_ ), length( h_ ) ); }
+
+            /// Number of distinct strings.
+            size_type size() const { return m_count; }
+            /// Bytes used by the arena.
+            size_type bytes() const { return m_arena.size(); }
+
+            /// FNV-1a, folded to 32 bits.
+            static std::uint32_t hash( const char * s_, size_type len_ )
+            {
+                std::uint64_t h{ 0xcbf29ce484222325ull };
+                for (size_type i{0}; i < len_; i++) {
+                    h ^= static_cast<unsigned char>( s_[i] );
+                    h *= 0x100000001b3ull;
+                }
+                return static_cast<std::uint32_t>( h ^ ( h >> 32 ) );
+            }
+
+        private:
+            // Slot holding s_, or the empty slot where it would go.
+            size_type probe( const char * s_, size_type len_, std::uint32_t h_ ) const
+            {
+                auto mask = m_index.size() - 1;
+                for (auto i = h_ & mask; ; i = ( i + 1 ) & mask) {
+                    auto off = m_index[i];
+                    if (off == EMPTY)
+                        return i;
+                    std::uint32_t stored_hash;
+                    std::memcpy( &stored_hash, &m_arena[off + HEADER], sizeof(stored_hash) );
+                    if (stored_hash == h_ and length( StringHandle{ off, h_ } ) == len_ and
+                        std::memcmp( &m_arena[off + 2 * HEADER], s_, len_ ) == 0)
+                        return i;
+                }
+            }
+
+            // Doubles the index; the arena is left untouched.
+            void grow()
+            {
+                std::vector< std::uint32_t > old( m_index.size() * 2, std::uint32_t( EMPTY ) );
+                old.swap( m_index );
+                auto mask = m_index.size() - 1;
+                for (auto off : old) {
+                    if (off == EMPTY) continue;
+                    std::uint32_t h;
+                    std::memcpy( &h, &m_arena[off + HEADER], sizeof(h) );
+                    auto i = h & mask;
+                    while (m_index[i] != EMPTY) i = ( i + 1 ) & mask;
+                    m_index[i] = off;
+                }
+            }
+
+        private:
+            enum : std::uint32_t { EMPTY = UINT32_MAX }; //!< Free slot of m_index.
+            static const size_type HEADER = sizeof(std::uint32_t); //!< Each string is stored as [length][hash][chars]['\0'].
+            std::vector< char > m_arena;           //!< All interned strings, back to back.
+            std::vector< std::uint32_t > m_index;  //!< Open-addressed set of arena offsets.
+            size_type m_count = 0;                 //!< Number of distinct strings.
+    };
+
+} // namespace ac
+#endif
@@ -0,0 +1,505 @@
+/*!
+ * @file table_diff.h
+ * Digests, diffs and merges of HashTbls, for replicating a table by change sets.
+ */
+#ifndef _TABLE_DIFF_H_
+#define _TABLE_DIFF_H_
+
+#include <algorithm>    // std::min
+#include <cstdint>
+#include <cstring>      // std::memcpy
+#include <functional>   // std::hash
+#include <stdexcept>    // std::invalid_argument
+#include <string>
+#include <vector>
+
+#include "codec.h"
+#include "hashtbl.h"
+#include "parallel.h"
+
+namespace ac // Associative container
+{
+    /// How merge() and apply() treat the keys both tables hold, and those only the target holds.
+    enum class MergePolicy : std::uint8_t {
+        overwrite,       //!< Take the source's data; keep the keys the source lacks.
+        keep_existing,   //!< Only add the keys the target lacks.
+        mirror           //!< Make the target equal to the source (erase the keys the source lacks).
+    };
+
+    struct DiffOptions {
+        unsigned leaf_bits = 0;        //!< log2 of the digest leaves; 0 derives it from the table sizes.
+        std::size_t threads = 0;       //!< Workers; 0 means one per hardware thread.
+        std::size_t morsel = 4096;     //!< Collision lists a worker claims at a time.
+    };
+
+    struct DiffStats {
+        std::size_t leaves = 0;             //!< Hash ranges the digests have.
+        std::size_t differing_leaves = 0;   //!< Ranges whose digests differ: only their entries were compared.
+        std::size_t compared = 0;           //!< Entries looked up in the other table.
+    };
+
+    namespace detail {
+        /// splitmix64 finalizer.
+        inline std::uint64_t digest_mix( std::uint64_t x ) {
+            x += 0x9E3779B97F4A7C15ull;
+            x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+            x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBull;
+            return x ^ ( x >> 31 );
+        }
+
+        /// Codec encoding of v_ in scratch_ (reused between calls), and its hash.
+        template< class T >
+        std::uint64_t encoded_digest( std::string & scratch_, const T & v_ ) {
+            scratch_.clear();
+            Codec< T >::encode( scratch_, v_ );
+            return std::hash< std::string >()( scratch_ );
+        }
+    } // namespace detail
+
+    /// Digest of a table's contents, split into 2^bits ranges ("leaves") of key hashes.
+    /*! A leaf holds the sum of the digests of its entries, each a mix of the KeyHash
+     *  value and of a hash of the data's Codec encoding. A sum ignores the order of the
+     *  entries and can take an entry in or out in O(1); it does not depend on the size
+     *  of the table either, so the digests of two tables compare leaf by leaf. Tables
+     *  whose leaves match hold the same entries there (up to 64-bit collisions).
+     */
+    class TableDigest {
+        public:
+            static const unsigned MAX_BITS = 20;   //!< 8 MiB of leaves.
+
+            explicit TableDigest( unsigned bits_ )
+                : m_bits{ std::min( bits_, unsigned( MAX_BITS ) ) }, m_leaves( std::size_t{1} << m_bits, 0 ) {}
+
+            /// Leaf bits for tables of up to n_ elements: about 8 entries a leaf.
+            static unsigned bits_for( std::size_t n_ ) {
+                unsigned bits{0};
+                while (bits < MAX_BITS and ( std::size_t{8} << bits ) < n_) bits++;
+                return bits;
+            }
+
+            unsigned bits() const { return m_bits; }
+            std::size_t leaf_count() const { return m_leaves.size(); }
+            std::uint64_t leaf( std::size_t i_ ) const { return m_leaves[i_]; }
+            /// The leaf of a key of hash key_hash_ (a KeyHash value).
+            std::size_t leaf_of( std::uint64_t key_hash_ ) const {
+                return m_bits == 0 ? 0 : std::size_t( detail::digest_mix( key_hash_ ) >> ( 64 - m_bits ) );
+            }
+
+            /// Takes in / out the entry of key hash key_hash_ and data hash data_digest_.
+            void add( std::uint64_t key_hash_, std::uint64_t data_digest_ ) {
+                m_leaves[ leaf_of( key_hash_ ) ] += entry_digest( key_hash_, data_digest_ );
+            }
+            void remove( std::uint64_t key_hash_, std::uint64_t data_digest_ ) {
+                m_leaves[ leaf_of( key_hash_ ) ] -= entry_digest( key_hash_, data_digest_ );
+            }
+            /// Adds the leaves of other_ (a digest of other entries, e.g. from another worker).
+            void merge( const TableDigest & other_ ) {
+                check_bits( other_ );
+                for (std::size_t i{0}; i < m_leaves.size(); i++) m_leaves[i] += other_.m_leaves[i];
+            }
+
+            /// Digest of the whole table.
+            std::uint64_t root() const {
+                std::uint64_t h{ m_bits };
+                for (auto l : m_leaves) h = detail::digest_mix( h ^ l );
+                return h;
+            }
+            /// The leaves whose digests differ from other_'s (which must have as many bits).
+            std::vector< std::size_t > differing( const TableDigest & other_ ) const {
+                check_bits( other_ );
+                std::vector< std::size_t > leaves;
+                for (std::size_t i{0}; i < m_leaves.size(); i++)
+                    if (m_leaves[i] != other_.m_leaves[i]) leaves.push_back( i );
+                return leaves;
+            }
+            bool operator==( const TableDigest & other_ ) const {
+                return m_bits == other_.m_bits and m_leaves == other_.m_leaves;
+            }
+            bool operator!=( const TableDigest & other_ ) const { return not ( *this == other_ ); }
+
+            /// Appends the encoding of the digest (bits, then the leaves as Codec does integers) to
+            /// out_, e.g. for a replica to send to its primary (see changes_for()).
+            void encode( std::string & out_ ) const {
+                Codec< std::uint8_t >::encode( out_, std::uint8_t( m_bits ) );
+                out_.append( reinterpret_cast< const char * >( m_leaves.data() ), m_leaves.size() * sizeof( std::uint64_t ) );
+            }
+            /// Replaces the digest with the one encoded in [p_, end_); false if the input is malformed.
+            bool decode( const char *& p_, const char * end_ ) {
+                std::uint8_t bits;
+                if (not Codec< std::uint8_t >::decode( p_, end_, bits ) or bits > MAX_BITS) return false;
+                std::size_t n = std::size_t{1} << bits;
+                if (std::size_t( end_ - p_ ) < n * sizeof( std::uint64_t )) return false;
+                m_bits = bits;
+                m_leaves.resize( n );
+                std::memcpy( m_leaves.data(), p_, n * sizeof( std::uint64_t ) );
+                p_ += n * sizeof( std::uint64_t );
+                return true;
+            }
+
+        private:
+            static std::uint64_t entry_digest( std::uint64_t key_hash_, std::uint64_t data_digest_ ) {
+                return detail::digest_mix( detail::digest_mix( key_hash_ ) ^ data_digest_ );
+            }
+            void check_bits( const TableDigest & other_ ) const {
+                if (other_.m_bits != m_bits)
+                    throw std::invalid_argument( "[TableDigest]: digests of different leaf bits." );
+            }
+
+            unsigned m_bits;
+            std::vector< std::uint64_t > m_leaves;
+    };
+
+    /// Changes that turn one table into another: entries to insert or overwrite, keys to erase.
+    /*! A change set made by changes_for() cannot name the keys to erase, as it never saw the
+     *  other table: it lists instead the leaves (of a digest of m_leaf_bits) whose entries
+     *  its upserts replace, and MergePolicy::mirror erases the other keys of those leaves.
+     */
+    template< class KeyType, class DataType >
+    struct ChangeSet {
+        std::vector< HashEntry< KeyType, DataType > > m_upserts;
+        std::vector< KeyType > m_erases;
+        std::vector< std::uint32_t > m_leaves;   //!< Leaves replaced whole.
+        unsigned m_leaf_bits = 0;
+
+        std::size_t size() const { return m_upserts.size() + m_erases.size(); }
+        bool empty() const { return size() == 0; }
+
+        /// Appends the Codec encoding of the changes to out_, e.g. to ship them to a replica.
+        void encode( std::string & out_ ) const {
+            Codec< std::uint64_t >::encode( out_, m_upserts.size() );
+            for (const auto & e : m_upserts) {
+                Codec< KeyType >::encode( out_, e.m_key );
+                Codec< DataType >::encode( out_, e.m_data );
+            }
+            Codec< std::uint64_t >::encode( out_, m_erases.size() );
+            for (const auto & k : m_erases) Codec< KeyType >::encode( out_, k );
+            Codec< std::uint8_t >::encode( out_, std::uint8_t( m_leaf_bits ) );
+            Codec< std::uint64_t >::encode( out_, m_leaves.size() );
+            for (auto l : m_leaves) Codec< std::uint32_t >::encode( out_, l );
+        }
+        /// Replaces the changes with those encoded in [p_, end_); false if the input is truncated.
+        bool decode( const char *& p_, const char * end_ ) {
+            m_upserts.clear();
+            m_erases.clear();
+            m_leaves.clear();
+            std::uint64_t n;
+            if (not Codec< std::uint64_t >::decode( p_, end_, n ) or n > std::uint64_t( end_ - p_ )) return false;
+            for (std::uint64_t i{0}; i < n; i++) {
+                KeyType k;
+                DataType d;
+                if (not Codec< KeyType >::decode( p_, end_, k ) or not Codec< DataType >::decode( p_, end_, d ))
+                    return false;
+                m_upserts.emplace_back( k, d );
+            }
+            if (not Codec< std::uint64_t >::decode( p_, end_, n ) or n > std::uint64_t( end_ - p_ )) return false;
+            m_erases.resize( n );
+            for (auto & k : m_erases)
+                if (not Codec< KeyType >::decode( p_, end_, k )) return false;
+            std::uint8_t bits;
+            if (not Codec< std::uint8_t >::decode( p_, end_, bits ) or bits > TableDigest::MAX_BITS) return false;
+            m_leaf_bits = bits;
+            if (not Codec< std::uint64_t >::decode( p_, end_, n ) or n > std::uint64_t( end_ - p_ ) / sizeof( std::uint32_t ))
+                return false;
+            m_leaves.resize( n );
+            for (auto & l : m_leaves)
+                if (not Codec< std::uint32_t >::decode( p_, end_, l ) or l >> bits != 0) return false;
+            return true;
+        }
+    };
+
+    /// Digest of table_ with 2^bits_ leaves, computed by threads_ workers over the collision lists.
+    /*! DataType needs a Codec (see codec.h). */
+    template< class KeyType, class DataType, class KeyHash, class KeyEqual >
+    TableDigest digest( const HashTbl< KeyType, DataType, KeyHash, KeyEqual > & table_, unsigned bits_,
+                        std::size_t threads_ = 0, std::size_t morsel_ = 4096 ) {
+        using entry_type = typename HashTbl< KeyType, DataType, KeyHash, KeyEqual >::entry_type;
+        auto workers = std::min( worker_count( threads_ ), std::max< std::size_t >( table_.size() / 65536, 1 ) );
+        std::vector< TableDigest > partial( workers, TableDigest( bits_ ) );
+        MorselQueue queue( table_.bucket_count(), morsel_ );
+        run_workers( workers, [&]( std::size_t w_ ) {
+            KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+            std::string scratch;
+            std::size_t b, e;
+            while (queue.next( b, e ))
+                table_.for_each( b, e, [&]( const entry_type & entry_ ) {
+                    partial[w_].add( hashFunc( entry_.m_key ), detail::encoded_digest( scratch, entry_.m_data ) );
+                } );
+        } );
+        for (std::size_t w{1}; w < workers; w++) partial[0].merge( partial[w] );
+        return std::move( partial[0] );
+    }
+
+    namespace detail {
+        /// Calls f(worker, entry, scratch) on the entries of table_ whose leaf (in digest_) is marked
+        /// in changed_; returns the number visited.
+        template< class KeyType, class DataType, class KeyHash, class KeyEqual, class Func >
+        std::size_t scan_leaves( const HashTbl< KeyType, DataType, KeyHash, KeyEqual > & table_, const TableDigest & digest_,
+                                 const std::vector< char > & changed_, std::size_t workers_, std::size_t morsel_, Func f_ ) {
+            using entry_type = typename HashTbl< KeyType, DataType, KeyHash, KeyEqual >::entry_type;
+            std::vector< std::size_t > counts( workers_, 0 );
+            MorselQueue queue( table_.bucket_count(), morsel_ );
+            run_workers( workers_, [&]( std::size_t w_ ) {
+                KeyHash hashFunc; // Instantiate the "functor" for primary hash.
+                std::string scratch;
+                std::size_t b, e;
+                while (queue.next( b, e ))
+                    table_.for_each( b, e, [&]( const entry_type & entry_ ) {
+                        if (not changed_[ digest_.leaf_of( hashFunc( entry_.m_key ) ) ]) return;
+                        counts[w_]++;
+                        f_( w_, entry_, scratch );
+                    } );
+            } );
+            std::size_t visited{0};
+            for (auto c : counts) visited += c;
+            return visited;
+        }
+
+        /// diff() of two tables whose digests (of the same bits) are at hand.
+        template< class KeyType, class DataType, class KeyHash, class KeyEqual >
+        ChangeSet< KeyType, DataType > diff_digested( const HashTbl< KeyType, DataType, KeyHash, KeyEqual > & from_,
+                                                      const TableDigest & from_digest_,
+                                                      const HashTbl< KeyType, DataType, KeyHash, KeyEqual > & to_,
+                                                      const TableDigest & to_digest_,
+                                                      const DiffOptions & options_, DiffStats * stats_ ) {
+            using entry_type = typename HashTbl< KeyType, DataType, KeyHash, KeyEqual >::entry_type;
+            std::vector< char > changed( from_digest_.leaf_count(), 0 );
+            std::size_t n_changed{0};
+            for (auto leaf : from_digest_.differing( to_digest_ )) { changed[leaf] = 1; n_changed++; }
+
+            ChangeSet< KeyType, DataType > changes;
+            std::size_t compared{0};
+            if (n_changed > 0) {
+                auto workers = std::min( worker_count( options_.threads ),
+                                         std::max< std::size_t >( std::max( from_.size(), to_.size() ) / 65536, 1 ) );
+                std::vector< ChangeSet< KeyType, DataType > > partial( workers );
+                // Entries of to_ that from_ lacks, or holds with other data.
+                compared += scan_leaves( to_, from_digest_, changed, workers, options_.morsel,
+                                         [&]( std::size_t w_, const entry_type & entry_, std::string & scratch_ ) {
+                    const DataType * old = from_.find( entry_.m_key );
+                    if (old != nullptr) {
+                        scratch_.clear();
+                        Codec< DataType >::encode( scratch_, *old );
+                        auto old_size = scratch_.size();
+                        Codec< DataType >::encode( scratch_, entry_.m_data );
+                        if (scratch_.compare( old_size, std::string::npos, scratch_, 0, old_size ) == 0) return;
+                    }
+                    partial[w_].m_upserts.emplace_back( entry_.m_key, entry_.m_data );
+                } );
+                // Keys of from_ that to_ lacks.
+                compared += scan_leaves( from_, from_digest_, changed, workers, options_.morsel,
+                                         [&]( std::size_t w_, const entry_type & entry_, std::string & ) {
+                    if (to_.find( entry_.m_key ) == nullptr) partial[w_].m_erases.push_back( entry_.m_key );
+                } );
+                for (std::size_t w{0}; w < workers; w++) {
+                    changes.m_upserts.insert( changes.m_upserts.end(), partial[w].m_upserts.begin(), partial[w].m_upserts.end() );
+                    changes.m_erases.insert( changes.m_erases.end(), partial[w].m_erases.begin(), partial[w].m_erases.end() );
+                }
+            }
+            if (stats_ != nullptr) {
+                stats_->leaves = from_digest_.leaf_count();
+                stats_->differing_leaves = n_changed;
+                stats_->compared = compared;
+            }
+            return changes;
+        }
+
+        /// changes_for() with the digest of table_ at hand.
+        template< class KeyType, class DataType, class KeyHash, class KeyEqual >
+        ChangeSet< KeyType, DataType > changes_digested( const HashTbl< KeyType, DataType, KeyHash, KeyEqual > & table_,
+                                                         const TableDigest & digest_, const TableDigest & remote_,
+                                                         const DiffOptions & options_, DiffStats * stats_ ) {
+            using entry_type = typename HashTbl< KeyType, DataType, KeyHash, KeyEqual >::entry_type;
+            ChangeSet< KeyType, DataType > changes;
+            changes.m_leaf_bits = digest_.bits();
+            std::vector< char > changed( digest_.leaf_count(), 0 );
+            for (auto leaf : digest_.differing( remote_ )) {
+                changed[leaf] = 1;
+                changes.m_leaves.push_back( std::uint32_t( leaf ) );
+            }
+            std::size_t compared{0};
+            if (not changes.m_leaves.empty()) {
+                auto workers = std::min( worker_count( options_.threads ), std::max< std::size_t >( table_.size() / 65536, 1 ) );
+                std::vector< ChangeSet< KeyType, DataType > > partial( workers );
+                compared = scan_leaves( table_, digest_, changed, workers, options_.morsel,
+                                        [&]( std::size_t w_, const entry_type & entry_, std::string & ) {
+                    partial[w_].m_upserts.emplace_back( entry_.m_key, entry_.m_data );
+                } );
+                for (const auto & part : partial)
+                    changes.m_upserts.insert( changes.m_upserts.end(), part.m_upserts.begin(), part.m_upserts.end() );
+            }
+            if (stats_ != nullptr) {
+                stats_->leaves = digest_.leaf_count();
+                stats_->differing_leaves = changes.m_leaves.size();
+                stats_->compared = compared;
+            }
+            return changes;
+        }
+
+        /// apply() through the insert(), erase() and find() of into_ (a HashTbl or a DigestedHashTbl);
+        /// table_ is the HashTbl of into_, read to find the keys of the replaced leaves.
+        template< class Table, class KeyType, class DataType, class KeyHash, class KeyEqual >
+        std::size_t apply_changes( Table & into_, const HashTbl< KeyType, DataType, KeyHash, KeyEqual > & table_,
+                                   const ChangeSet< KeyType, DataType > & changes_, MergePolicy policy_ ) {
+            using entry_type = typename HashTbl< KeyType, DataType, KeyHash, KeyEqual >::entry_type;
+            std::size_t applied{0};
+            if (policy_ == MergePolicy::mirror and not changes_.m_leaves.empty()) {
+                // Erase the keys of the replaced leaves that the upserts do not bring back.
+                TableDigest leaves( changes_.m_leaf_bits );
+                std::vector< char > replaced( leaves.leaf_count(), 0 );
+                for (auto l : changes_.m_leaves) replaced[l] = 1;
+                HashTbl< KeyType, char, KeyHash, KeyEqual > kept( 2 * changes_.m_upserts.size() + 1 );
+                for (const auto & e : changes_.m_upserts) kept.insert( e.m_key, 0 );
+                auto workers = std::min( worker_count( 0 ), std::max< std::size_t >( table_.size() / 65536, 1 ) );
+                std::vector< std::vector< KeyType > > gone( workers );
+                scan_leaves( table_, leaves, replaced, workers, 4096, [&]( std::size_t w_, const entry_type & e_, std::string & ) {
+                    if (kept.find( e_.m_key ) == nullptr) gone[w_].push_back( e_.m_key );
+                } );
+                for (const auto & part : gone)
+                    for (const auto & k : part) applied += into_.erase( k ) ? 1 : 0;
+            }
+            for (const auto & e : changes_.m_upserts) {
+                if (policy_ == MergePolicy::keep_existing and into_.find( e.m_key ) != nullptr) continue;
+                into_.insert( e.m_key, e.m_data );
+                applied++;
+            }
+            if (policy_ == MergePolicy::mirror)
+                for (const auto & k : changes_.m_erases) applied += into_.erase( k ) ? 1 : 0;
+            return applied;
+        }
+    } // namespace detail
+
+    /// The changes that turn from_ into to_.
+    /*! Both tables are digested with the same leaves; only the entries of the leaves whose
+     *  digests differ are looked up in the other table and compared (by their Codec
+     *  encoding), so the cost beyond the two digests grows with the changes, not with
+     *  the tables. The digests themselves read every entry: to sync often, keep them up
+     *  to date with DigestedHashTbl instead. DataType needs a Codec.
+     */
+    template< class KeyType, class DataType, class KeyHash, class KeyEqual >
+    ChangeSet< KeyType, DataType > diff( const HashTbl< KeyType, DataType, KeyHash, KeyEqual > & from_,
+                                         const HashTbl< KeyType, DataType, KeyHash, KeyEqual > & to_,
+                                         const DiffOptions & options_ = DiffOptions{}, DiffStats * stats_ = nullptr ) {
+        auto bits = options_.leaf_bits > 0 ? options_.leaf_bits
+                                            : TableDigest::bits_for( std::max( from_.size(), to_.size() ) );
+        auto from_digest = digest( from_, bits, options_.threads, options_.morsel );
+        auto to_digest = digest( to_, bits, options_.threads, options_.morsel );
+        return detail::diff_digested( from_, from_digest, to_, to_digest, options_, stats_ );
+    }
+
+    /// The changes that turn a remote table of digest remote_ into table_, for a primary
+    /// that only has the digest of its replica.
+    /*! The change set holds every entry of table_ in the leaves where the digests differ,
+     *  and those leaves: applied with MergePolicy::mirror, it also erases the replica's
+     *  other keys there. The cost beyond the digest of table_ (of remote_.bits()) is one
+     *  pass over the key hashes. DataType needs a Codec.
+     */
+    template< class KeyType, class DataType, class KeyHash, class KeyEqual >
+    ChangeSet< KeyType, DataType > changes_for( const HashTbl< KeyType, DataType, KeyHash, KeyEqual > & table_,
+                                                const TableDigest & remote_,
+                                                const DiffOptions & options_ = DiffOptions{}, DiffStats * stats_ = nullptr ) {
+        auto local = digest( table_, remote_.bits(), options_.threads, options_.morsel );
+        return detail::changes_digested( table_, local, remote_, options_, stats_ );
+    }
+
+    /// Applies changes_ to into_ under policy_; returns the number of elements inserted, overwritten or erased.
+    template< class KeyType, class DataType, class KeyHash, class KeyEqual >
+    std::size_t apply( HashTbl< KeyType, DataType, KeyHash, KeyEqual > & into_, const ChangeSet< KeyType, DataType > & changes_,
+                       MergePolicy policy_ = MergePolicy::mirror ) {
+        return detail::apply_changes( into_, into_, changes_, policy_ );
+    }
+
+    /// Merges from_ into into_ under policy_, through diff(): the ranges both tables agree on
+    /// are skipped. Returns the number of elements inserted, overwritten or erased.
+    template< class KeyType, class DataType, class KeyHash, class KeyEqual >
+    std::size_t merge( HashTbl< KeyType, DataType, KeyHash, KeyEqual > & into_,
+                       const HashTbl< KeyType, DataType, KeyHash, KeyEqual > & from_,
+                       MergePolicy policy_ = MergePolicy::overwrite, const DiffOptions & options_ = DiffOptions{} ) {
+        return apply( into_, diff( into_, from_, options_ ), policy_ );
+    }
+
+    /// A HashTbl that keeps its TableDigest up to date: each insert or erase adds or takes out
+    /// the digest of one entry, so diff(), changes_for() and digest() read no entry to get it.
+    /*! The writes pay for it: an insert hashes the Codec encoding of the new data, and
+     *  of the old one when it overwrites. The leaf bits are fixed when the table is made;
+     *  the digests of both sides of a sync must have the same. DataType needs a Codec.
+     */
+    template< class KeyType,
+              class DataType,
+              class KeyHash = std::hash< KeyType >,
+              class KeyEqual = std::equal_to< KeyType > >
+    class DigestedHashTbl {
+        public:
+            using size_type = std::size_t;
+            using table_type = HashTbl< KeyType, DataType, KeyHash, KeyEqual >;
+            using entry_type = typename table_type::entry_type;
+
+            // A digest of 2^bits_ leaves (see TableDigest::bits_for()) over a table of table_sz_ buckets.
+            explicit DigestedHashTbl( unsigned bits_, size_type table_sz_ = 1024 )
+                : m_table( table_sz_ ), m_digest( bits_ ) {}
+
+            // Inserts an element, or replaces the data of its key; true if the key is new.
+            bool insert( const KeyType & key_, const DataType & data_ ) {
+                auto h = KeyHash{}( key_ );
+                DataType * old = m_table.find( key_ );
+                if (old != nullptr) {
+                    m_digest.remove( h, detail::encoded_digest( m_scratch, *old ) );
+                    *old = data_;
+                }
+                else
+                    m_table.insert( key_, data_ );
+                m_digest.add( h, detail::encoded_digest( m_scratch, data_ ) );
+                return old == nullptr;
+            }
+            bool erase( const KeyType & key_ ) {
+                const DataType * old = m_table.find( key_ );
+                if (old == nullptr) return false;
+                m_digest.remove( KeyHash{}( key_ ), detail::encoded_digest( m_scratch, *old ) );
+                return m_table.erase( key_ );
+            }
+            void clear() {
+                m_table.clear();
+                m_digest = TableDigest( m_digest.bits() );
+            }
+            const DataType * find( const KeyType & key_ ) const { return m_table.find( key_ ); }
+            bool retrieve( const KeyType & key_, DataType & data_ ) const { return m_table.retrieve( key_, data_ ); }
+            size_type count( const KeyType & key_ ) const { return m_table.count( key_ ); }
+            size_type size() const { return m_table.size(); }
+            bool empty() const { return m_table.empty(); }
+            template< class Func >
+            void for_each( Func f_ ) const { m_table.for_each( f_ ); }
+
+            // The table itself, read-only: writes must go through this class.
+            const table_type & table() const { return m_table; }
+            const TableDigest & digest() const { return m_digest; }
+
+        private:
+            table_type m_table;
+            TableDigest m_digest;
+            std::string m_scratch;   //!< Encoding buffer.
+    };
+
+    /// diff() of two DigestedHashTbls (of the same leaf bits), with their digests at hand.
+    template< class KeyType, class DataType, class KeyHash, class KeyEqual >
+    ChangeSet< KeyType, DataType > diff( const DigestedHashTbl< KeyType, DataType, KeyHash, KeyEqual > & from_,
+                                         const DigestedHashTbl< KeyType, DataType, KeyHash, KeyEqual > & to_,
+                                         const DiffOptions & options_ = DiffOptions{}, DiffStats * stats_ = nullptr ) {
+        return detail::diff_digested( from_.table(), from_.digest(), to_.table(), to_.digest(), options_, stats_ );
+    }
+
+    /// changes_for() of a DigestedHashTbl, with its digest at hand: one pass over the key hashes.
+    template< class KeyType, class DataType, class KeyHash, class KeyEqual >
+    ChangeSet< KeyType, DataType > changes_for( const DigestedHashTbl< KeyType, DataType, KeyHash, KeyEqual > & table_,
+                                                const TableDigest & remote_,
+                                                const DiffOptions & options_ = DiffOptions{}, DiffStats * stats_ = nullptr ) {
+        return detail::changes_digested( table_.table(), table_.digest(), remote_, options_, stats_ );
+    }
+
+    /// apply() to a DigestedHashTbl, whose digest follows the changes.
+    template< class KeyType, class DataType, class KeyHash, class KeyEqual >
+    std::size_t apply( DigestedHashTbl< KeyType, DataType, KeyHash, KeyEqual > & into_,
+                       const ChangeSet< KeyType, DataType > & changes_, MergePolicy policy_ = MergePolicy::mirror ) {
+        return detail::apply_changes( into_, into_.table(), changes_, policy_ );
+    }
+
+} // namespace ac
+#endif
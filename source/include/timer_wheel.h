@@ -0,0 +1,171 @@
+/*!
+ * @file timer_wheel.h
+ * Hierarchical timer wheel: O(1) add and cancel, expiry work spread evenly over the ticks.
+ */
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <cstdint>   // uint32_t, uint64_t
+#include <utility>   // std::move
+#include <vector>
+
+namespace ac // Associative container
+{
+    /// Timers carrying a Payload, keyed by an integer tick.
+    /*! Level l splits time into blocks of 2^(BITS*l) ticks and keeps a ring of
+     *  RING such blocks; a timer goes to the lowest level where it is due less than
+     *  SPAN blocks ahead. Before a block of level l starts, its timers are moved
+     *  down to level l-1 (whose ring has room for two of its spans). The move is
+     *  spread over the preceding block, a few timers per tick, instead of done in
+     *  one burst when the block starts, so advance() never stalls on a cascade.
+     *  Each timer moves at most LEVELS - 1 times before it fires.
+     *  Timers beyond the top level are parked in its furthest block and re-placed
+     *  when that block drains. Each slot is an intrusive doubly linked list over a
+     *  node pool, so cancel() is O(1) given the handle returned by add().
+     */
+    template< class Payload >
+    class TimerWheel {
+        public:
+            using handle_type = std::uint32_t;
+            static constexpr handle_type NONE = UINT32_MAX; //!< "No timer" handle.
+            enum : unsigned { BITS = 6, SPAN = 1u << BITS, RING = 2 * SPAN, LEVELS = 4 };
+
+            explicit TimerWheel( std::uint64_t now_ = 0 ) : m_now{ now_ }
+            { clear(); }
+
+            /// Current tick: every timer due at or before it has fired.
+            std::uint64_t now() const { return m_now; }
+            /// Number of pending timers.
+            std::size_t size() const { return m_size; }
+
+            /// Schedules payload_ to fire at tick due_ (the next tick if due_ already passed).
+            handle_type add( std::uint64_t due_, Payload payload_ ) {
+                handle_type h;
+                if (m_free != NONE) {
+                    h = m_free;
+                    m_free = m_nodes[h].m_next;
+                    m_nodes[h].m_payload = std::move( payload_ );
+                }
+                else {
+                    h = static_cast< handle_type >( m_nodes.size() );
+                    m_nodes.push_back( Node{ std::move( payload_ ), 0, NONE, NONE, 0 } );
+                }
+                m_nodes[h].m_due = due_ > m_now ? due_ : m_now + 1;
+                place( h, LEVELS - 1, m_now + 1 );   // The drains of tick m_now are done.
+                m_size++;
+                return h;
+            }
+
+            /// Removes a pending timer.
+            void cancel( handle_type h_ ) {
+                unlink( h_ );
+                m_nodes[h_].m_payload = Payload{};
+                m_nodes[h_].m_next = m_free;
+                m_free = h_;
+                m_size--;
+            }
+
+            /// Moves the wheel to tick now_, calling fire(payload) for every timer due by then.
+            /*! fire may add and cancel other timers. */
+            template< class Fire >
+            std::size_t advance( std::uint64_t now_, Fire fire_ ) {
+                std::size_t fired{0};
+                while (m_now < now_) {
+                    if (m_size == 0) { m_now = now_; break; } // Nothing to move or fire.
+                    m_now++;
+                    for (unsigned level{LEVELS - 1}; level > 0; level--)
+                        drain( level );
+                    auto & head = m_heads[ m_now & ( RING - 1 ) ];
+                    while (head != NONE) {
+                        auto h = head;
+                        Payload payload = std::move( m_nodes[h].m_payload );
+                        cancel( h );
+                        fire_( payload );
+                        fired++;
+                    }
+                }
+                return fired;
+            }
+
+            /// Drops every timer.
+            void clear() {
+                m_nodes.clear();
+                for (auto & h : m_heads) h = NONE;
+                for (auto & c : m_counts) c = 0;
+                m_free = NONE;
+                m_size = 0;
+            }
+
+        private:
+            struct Node {
+                Payload m_payload;
+                std::uint64_t m_due;  //!< Tick at which the timer fires.
+                handle_type m_prev;   //!< Neighbours in the slot list (or free list, via m_next).
+                handle_type m_next;
+                std::uint32_t m_slot; //!< Index in m_heads of the list holding the node.
+            };
+
+            // Block of level l that holds tick t.
+            static std::uint64_t block( std::uint64_t t_, unsigned level_ ) { return t_ >> ( BITS * level_ ); }
+
+            // Puts node h_ in the lowest level (up to max_level_) where it is due less than SPAN
+            // blocks after tick ref_; at max_level_ itself it may be up to RING - 1 blocks ahead.
+            // ref_ is the first tick whose drains have not run yet: a block that starts after
+            // the block of ref_ is still drained in time, but the next block of m_now is not
+            // once the last tick of the current one has been processed.
+            void place( handle_type h_, unsigned max_level_, std::uint64_t ref_ ) {
+                Node & n = m_nodes[h_];
+                unsigned level{0};
+                while (level < max_level_ and block( n.m_due, level ) - block( ref_, level ) >= SPAN)
+                    level++;
+                auto b = block( n.m_due, level );
+                if (level == LEVELS - 1 and b - block( ref_, level ) >= SPAN) // Beyond the wheel: park it.
+                    b = block( ref_, level ) + SPAN - 1;
+                auto slot = level * RING + ( b & ( RING - 1 ) );
+                n.m_slot = static_cast< std::uint32_t >( slot );
+                n.m_prev = NONE;
+                n.m_next = m_heads[slot];
+                if (n.m_next != NONE) m_nodes[n.m_next].m_prev = h_;
+                m_heads[slot] = h_;
+                m_counts[slot]++;
+            }
+
+            void unlink( handle_type h_ ) {
+                Node & n = m_nodes[h_];
+                if (n.m_prev != NONE) m_nodes[n.m_prev].m_next = n.m_next;
+                else m_heads[n.m_slot] = n.m_next;
+                if (n.m_next != NONE) m_nodes[n.m_next].m_prev = n.m_prev;
+                m_counts[n.m_slot]--;
+            }
+
+            // Moves part of the next block of `level` down one level, so that it is empty one
+            // block of level - 1 before it starts (giving level - 1 a full block to drain it).
+            void drain( unsigned level_ ) {
+                auto next = block( m_now, level_ ) + 1;
+                auto slot = level_ * RING + ( next & ( RING - 1 ) );
+                auto pending = m_counts[slot];
+                if (pending == 0) return;
+                auto deadline = ( next << ( BITS * level_ ) ) - ( std::uint64_t( 1 ) << ( BITS * ( level_ - 1 ) ) );
+                std::uint64_t moves = m_now >= deadline ? pending
+                                                        : ( pending + ( deadline - m_now ) - 1 ) / ( deadline - m_now );
+                for (; moves > 0; moves--) {
+                    auto h = m_heads[slot];
+                    unlink( h );
+                    bool parked = level_ == LEVELS - 1 and block( m_nodes[h].m_due, level_ ) != next;
+                    place( h, parked ? level_ : level_ - 1, m_now );   // Lower levels drain later in this tick.
+                }
+            }
+
+            std::uint64_t m_now;                        //!< Last processed tick.
+            std::vector< Node > m_nodes;                //!< Node pool; handles are indices.
+            handle_type m_heads[ LEVELS * RING ];       //!< First node of each slot list.
+            std::uint32_t m_counts[ LEVELS * RING ];    //!< Length of each slot list.
+            handle_type m_free = NONE;                  //!< Free list of recycled nodes.
+            std::size_t m_size = 0;                     //!< Pending timers.
+    };
+
+    template< class Payload >
+    constexpr typename TimerWheel< Payload >::handle_type TimerWheel< Payload >::NONE;
+
+} // namespace ac
+#endif
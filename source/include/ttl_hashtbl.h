@@ -0,0 +1,89 @@
+/*!
+ * @file ttl_hashtbl.h
+ * HashTbl whose entries may carry an expiry time, collected by a hierarchical timer wheel.
+ */
+#ifndef _TTL_HASHTBL_H_
+#define _TTL_HASHTBL_H_
+
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>    // std::out_of_range
+
+#include "hashtbl.h"
+#include "timer_wheel.h"
+
+namespace ac // Associative container
+{
+    /// A HashTbl in which an entry may expire.
+    /*! Entries inserted without a time to live never expire. Expired entries are
+     *  never returned: retrieve(), at() and count() check the expiry of the entry
+     *  they find and erase it on the spot. The timer wheel removes the others, in
+     *  expiry order, whenever expire() runs, and insert() runs it too, so memory
+     *  is reclaimed without ever scanning the table.
+     *  @tparam Clock a std::chrono clock (anything with a static now()).
+     */
+	template< class KeyType,
+		      class DataType,
+		      class KeyHash = std::hash< KeyType >,
+		      class KeyEqual = std::equal_to< KeyType >,
+		      class Clock = std::chrono::steady_clock >
+	class TtlHashTbl {
+        public:
+            // Aliases
+            using size_type = std::size_t;
+            using duration = typename Clock::duration;
+            using time_point = typename Clock::time_point;
+
+            explicit TtlHashTbl( size_type table_sz_ = DEFAULT_SIZE,
+                                 duration resolution_ = std::chrono::milliseconds( 1 ) );
+
+            // Inserts an entry that never expires (clearing the expiry of an existing key).
+            bool insert( const KeyType &, const DataType & );
+            // Inserts an entry that expires ttl after now (replacing the expiry of an existing key).
+            bool insert( const KeyType &, const DataType &, duration ttl );
+            // Sets the expiry of an existing entry. False if the key is not in the table.
+            bool expire_at( const KeyType &, time_point );
+            // Makes an existing entry permanent. False if the key is not in the table.
+            bool persist( const KeyType & );
+            bool retrieve( const KeyType &, DataType & );
+            DataType& at( const KeyType & );
+            bool erase( const KeyType & );
+            // Returns 1 if the key is stored in the table and has not expired; 0, otherwise.
+            size_type count( const KeyType & );
+            void clear();
+            // Removes every entry whose expiry has passed. Returns how many were removed.
+            size_type expire();
+            // Number of entries, counting expired ones that were not removed yet.
+            size_type size() const { return m_table.size(); };
+            bool empty() const { return m_table.empty(); };
+            // Number of entries that carry an expiry.
+            size_type expiring() const { return m_wheel.size(); };
+
+        private:
+            //! The data plus its expiry; m_timer is TimerWheel::NONE for permanent entries.
+            struct Timed {
+                DataType m_data;
+                time_point m_expires;
+                typename TimerWheel< KeyType >::handle_type m_timer;
+            };
+            using table_type = HashTbl< KeyType, Timed, KeyHash, KeyEqual >;
+
+            // Converts a time point to a wheel tick, rounding up (a timer never fires early).
+            std::uint64_t tick_of( time_point ) const;
+            void schedule( const KeyType &, Timed &, time_point );
+            void unschedule( Timed & );
+            // Returns the live entry of key_, erasing it first if it has expired.
+            Timed * find_live( const KeyType & );
+
+        private:
+            table_type m_table;               //!< The entries.
+            TimerWheel< KeyType > m_wheel;    //!< One timer per expiring entry, carrying its key.
+            time_point m_epoch;               //!< Time of tick 0.
+            duration m_resolution;            //!< Length of one tick.
+            static const short DEFAULT_SIZE = 10;
+    };
+
+} // namespace ac
+#include "ttl_hashtbl.inl"
+#endif
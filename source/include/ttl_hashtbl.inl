@@ -0,0 +1,236 @@
+#include "ttl_hashtbl.h"
+
+namespace ac {
+    /*!
+     * @brief Regular constructor of a hash table with expiring entries.
+     * @tparam KeyType type of key stored in hash table.
+     * @tparam DataType data type stored in hash table.
+     * @tparam KeyHash type of primary dispersion function received by the client.
+     * @tparam KeyEqual type of equal key comparison function received by the client.
+     * @tparam Clock clock the expiry times refer to.
+     * @param sz initial size of the table.
+     * @param resolution length of a timer wheel tick: entries are removed by expire()
+     * at most one tick after they expire (lookups never see them after their expiry).
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+	TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::TtlHashTbl( size_type sz, duration resolution )
+        : m_table( sz ), m_epoch{ Clock::now() }, m_resolution{ resolution }
+	{
+        if (m_resolution <= duration::zero())
+            m_resolution = duration( 1 );
+	}
+
+    /*!
+     * @brief Inserts or overwrites an entry that never expires.
+     * @param key_ element key to be inserted.
+     * @param new_data_ element data to be inserted.
+     * @return true if a new element was inserted; false if the key's data was overwritten.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+	bool TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::insert( const KeyType & key_, const DataType & new_data_ )
+    {
+        expire();
+        Timed * entry = find_live( key_ );
+        if (entry != nullptr) {
+            unschedule( *entry );
+            entry->m_data = new_data_;
+            return false;
+        }
+        return m_table.insert( key_, Timed{ new_data_, time_point::max(), TimerWheel< KeyType >::NONE } );
+    }
+
+    /*!
+     * @brief Inserts or overwrites an entry that expires ttl_ from now.
+     * @param key_ element key to be inserted.
+     * @param new_data_ element data to be inserted.
+     * @param ttl_ time to live of the entry.
+     * @return true if a new element was inserted; false if the key's data was overwritten.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+	bool TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::insert( const KeyType & key_, const DataType & new_data_,
+                                                                      duration ttl_ )
+    {
+        expire();
+        auto when = Clock::now() + ttl_;
+        Timed * entry = find_live( key_ );
+        if (entry != nullptr) {
+            schedule( key_, *entry, when );
+            entry->m_data = new_data_;
+            return false;
+        }
+        return m_table.insert( key_, Timed{ new_data_, when, m_wheel.add( tick_of( when ), key_ ) } );
+    }
+
+    /*!
+     * @brief Sets when an existing entry expires.
+     * @param key_ the key of the entry.
+     * @param when_ its new expiry time.
+     * @return true if the entry exists (and had not expired); false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+	bool TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::expire_at( const KeyType & key_, time_point when_ )
+    {
+        Timed * entry = find_live( key_ );
+        if (entry == nullptr)
+            return false;
+        schedule( key_, *entry, when_ );
+        return true;
+    }
+
+    /*!
+     * @brief Removes the expiry of an existing entry.
+     * @param key_ the key of the entry.
+     * @return true if the entry exists (and had not expired); false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+	bool TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::persist( const KeyType & key_ )
+    {
+        Timed * entry = find_live( key_ );
+        if (entry == nullptr)
+            return false;
+        unschedule( *entry );
+        return true;
+    }
+
+    /*!
+     * @brief Retrieves the data of a key that has not expired.
+     * @param key_ Data key to search for in the table.
+     * @param data_item_ Data record to be filled in when data item is found.
+     * @return true if the data item is found; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+	bool TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::retrieve( const KeyType & key_, DataType & data_item_ )
+    {
+        Timed * entry = find_live( key_ );
+        if (entry == nullptr)
+            return false;
+        data_item_ = entry->m_data;
+        return true;
+    }
+
+    /*!
+     * @brief Returns a reference to the data of a key that has not expired.
+     * If there is no such key, the method throws an exception of type std::out_of_range.
+     * @param key_ key that we look for the data.
+     * @return DataType& reference to the data associated with the given key.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+	DataType& TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::at( const KeyType & key_ )
+    {
+        Timed * entry = find_live( key_ );
+        if (entry == nullptr)
+            throw std::out_of_range("[TtlHashTbl::at()]: key doesn't exist in the hash table.");
+        return entry->m_data;
+    }
+
+    /*!
+     * @brief Removes an entry and its timer.
+     * @param key_ the key of the element to be removed.
+     * @return true if the key was found and had not expired; false, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+	bool TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::erase( const KeyType & key_ )
+    {
+        Timed * entry = m_table.find( key_ );
+        if (entry == nullptr)
+            return false;
+        bool live = entry->m_timer == TimerWheel< KeyType >::NONE or entry->m_expires > Clock::now();
+        unschedule( *entry );
+        m_table.erase( key_ );
+        return live;
+    }
+
+    /*!
+     * @brief Tells whether a key is in the table and has not expired.
+     * @param key_ the key to search for.
+     * @return 1 if the key is present; 0, otherwise.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+    typename TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::size_type
+    TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::count( const KeyType & key_ )
+    {
+        return find_live( key_ ) == nullptr ? 0 : 1;
+    }
+
+    /*!
+     * @brief Removes every entry and timer.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+	void TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::clear()
+    {
+        m_table.clear();
+        m_wheel.clear();
+    }
+
+    /*!
+     * @brief Advances the timer wheel to the current time, erasing the entries whose
+     * timers fire. The work is proportional to the ticks elapsed since the last call
+     * plus the entries removed; the table itself is never scanned.
+     * @return the number of entries removed.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+    typename TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::size_type
+    TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::expire()
+    {
+        auto now = Clock::now();
+        std::uint64_t now_tick = now <= m_epoch ? 0 : ( now - m_epoch ) / m_resolution;
+        // Every pending timer belongs to the current entry of its key (replacing or erasing
+        // an entry cancels its timer), so a firing timer just erases its key.
+        return m_wheel.advance( now_tick, [this]( const KeyType & key_ ) { m_table.erase( key_ ); } );
+    }
+
+    /*!
+     * @brief Returns the tick at or after a time point.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+    std::uint64_t TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::tick_of( time_point when_ ) const
+    {
+        if (when_ <= m_epoch) return 0;
+        auto elapsed = ( when_ - m_epoch ).count();
+        return static_cast< std::uint64_t >( ( elapsed + m_resolution.count() - 1 ) / m_resolution.count() );
+    }
+
+    /*!
+     * @brief Replaces the timer of an entry by one that fires at when_.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+    void TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::schedule( const KeyType & key_, Timed & entry_, time_point when_ )
+    {
+        unschedule( entry_ );
+        entry_.m_expires = when_;
+        entry_.m_timer = m_wheel.add( tick_of( when_ ), key_ );
+    }
+
+    /*!
+     * @brief Cancels the timer of an entry, making it permanent.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+    void TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::unschedule( Timed & entry_ )
+    {
+        if (entry_.m_timer != TimerWheel< KeyType >::NONE) {
+            m_wheel.cancel( entry_.m_timer );
+            entry_.m_timer = TimerWheel< KeyType >::NONE;
+        }
+        entry_.m_expires = time_point::max();
+    }
+
+    /*!
+     * @brief Finds the entry of a key, erasing it instead if it has expired.
+     * @param key_ the key to search for.
+     * @return the entry; nullptr if the key is absent or expired.
+     */
+	template< typename KeyType, typename DataType, typename KeyHash, typename KeyEqual, typename Clock >
+    typename TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::Timed *
+    TtlHashTbl<KeyType,DataType,KeyHash,KeyEqual,Clock>::find_live( const KeyType & key_ )
+    {
+        Timed * entry = m_table.find( key_ );
+        if (entry == nullptr)
+            return nullptr;
+        if (entry->m_timer != TimerWheel< KeyType >::NONE and entry->m_expires <= Clock::now()) {
+            unschedule( *entry );
+            m_table.erase( key_ );
+            return nullptr;
+        }
+        return entry;
+    }
+} // Namespace ac.
@@ -0,0 +1,249 @@
+/*!
+ * @file wal.h
+ * Append-only write-ahead log with group commit.
+ */
+#ifndef _WAL_H_
+#define _WAL_H_
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>  // std::runtime_error
+#include <string>
+
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // write, fdatasync, ftruncate, close
+
+namespace ac // Associative container
+{
+    /// When a committed record reaches stable storage.
+    enum class SyncMode {
+        none,  //!< write() only: survives a process crash, not a power loss.
+        every, //!< fdatasync() per commit; commits that arrive during a sync share the next one.
+        group  //!< Like every, but the syncing thread first waits up to max_delay for more commits.
+    };
+
+    struct WalOptions {
+        SyncMode mode = SyncMode::group;
+        std::chrono::microseconds max_delay{ 500 }; //!< Longest a commit waits for others to join its sync.
+        std::size_t max_batch_bytes = 1u << 20;     //!< A batch this large is synced without waiting.
+    };
+
+    struct WalStats {
+        std::uint64_t records = 0; //!< Records appended.
+        std::uint64_t bytes = 0;   //!< Bytes written.
+        std::uint64_t syncs = 0;   //!< Batches written (and synced, unless SyncMode::none).
+    };
+
+    namespace detail {
+        /// CRC-32 (IEEE 802.3), table driven.
+        inline std::uint32_t crc32( const char * p_, std::size_t n_, std::uint32_t crc_ = 0 ) {
+            struct Table {
+                std::uint32_t v[256];
+                Table() {
+                    for (std::uint32_t i{0}; i < 256; i++) {
+                        std::uint32_t c = i;
+                        for (int k{0}; k < 8; k++) c = ( c & 1 ) ? 0xEDB88320u ^ ( c >> 1 ) : c >> 1;
+                        v[i] = c;
+                    }
+                }
+            };
+            static const Table table;
+            crc_ = ~crc_;
+            for (std::size_t i{0}; i < n_; i++)
+                crc_ = table.v[ ( crc_ ^ static_cast< unsigned char >( p_[i] ) ) & 0xFF ] ^ ( crc_ >> 8 );
+            return ~crc_;
+        }
+    } // namespace detail
+
+    /// Log of (op, payload) records. Each record is [uint32 size][op][payload][uint32 crc32],
+    /// where size counts op and payload; a torn or corrupt tail is cut off by replay().
+    /*! append() only buffers a record and returns its sequence number; commit(lsn)
+     *  blocks until that record is durable. The first committer to find no sync in
+     *  progress becomes the leader: it writes and syncs every buffered record, its
+     *  own and those of the threads that committed meanwhile, which just wait.
+     *  In SyncMode::group the leader first waits (up to max_delay) for as many
+     *  records as the previous batch held, so steady writers keep sharing syncs.
+     *  A failed write or sync fails the log for good: what reached the file is
+     *  unknown, so every commit not yet durable, waiting or later, and every later
+     *  append throws the error of the leader. Thread-safe.
+     */
+    class WriteAheadLog {
+        public:
+            using lsn_type = std::uint64_t;
+
+            explicit WriteAheadLog( const std::string & path_, WalOptions options_ = WalOptions{} )
+                : m_path{ path_ }, m_options( options_ )
+            { m_fd = open_log( m_path ); }
+
+            ~WriteAheadLog() {
+                try { commit( m_appended ); } catch (...) {}
+                ::close( m_fd );
+            }
+            WriteAheadLog( const WriteAheadLog & ) = delete;
+            WriteAheadLog & operator=( const WriteAheadLog & ) = delete;
+
+            /// Buffers a record. Returns its sequence number, to be passed to commit().
+            lsn_type append( std::uint8_t op_, const std::string & payload_ ) {
+                auto size = static_cast< std::uint32_t >( payload_.size() + 1 );
+                char head[ sizeof( size ) + 1 ];
+                std::memcpy( head, &size, sizeof( size ) );
+                head[ sizeof( size ) ] = static_cast< char >( op_ );
+                auto crc = detail::crc32( payload_.data(), payload_.size(), detail::crc32( head + sizeof( size ), 1 ) );
+
+                std::lock_guard< std::mutex > lock( m_mtx );
+                if (not m_error.empty()) throw std::runtime_error( m_error );
+                m_pending.append( head, sizeof( head ) );
+                m_pending += payload_;
+                m_pending.append( reinterpret_cast< const char * >( &crc ), sizeof( crc ) );
+                m_stats.records++;
+                if (++m_pending_records >= m_last_batch or m_pending.size() >= m_options.max_batch_bytes)
+                    m_cv.notify_all(); // Wakes a leader waiting for the batch to fill.
+                return ++m_appended;
+            }
+
+            /// Blocks until the record lsn_ (and every one before it) is durable.
+            void commit( lsn_type lsn_ ) {
+                std::unique_lock< std::mutex > lock( m_mtx );
+                while (m_durable < lsn_) {
+                    if (not m_error.empty()) throw std::runtime_error( m_error );
+                    if (m_syncing) { m_cv.wait( lock ); continue; }
+                    m_syncing = true;
+                    // Waiting only pays off when other writers are around: the last batch had several.
+                    // It ends as soon as this batch is as large as the last one.
+                    if (m_options.mode == SyncMode::group and m_last_batch > 1)
+                        m_cv.wait_for( lock, m_options.max_delay, [this]() {
+                            return m_pending_records >= m_last_batch or m_pending.size() >= m_options.max_batch_bytes;
+                        } );
+                    std::string batch;
+                    batch.swap( m_pending );
+                    m_pending_records = 0;
+                    lsn_type target = m_appended;
+                    lock.unlock();
+                    try {
+                        write_fully( batch );
+                        if (m_options.mode != SyncMode::none and ::fdatasync( m_fd ) != 0)
+                            fail( "fdatasync" );
+                    }
+                    catch (const std::exception & e) {
+                        lock.lock();
+                        m_error = e.what();
+                        m_syncing = false;
+                        m_cv.notify_all();
+                        throw;
+                    }
+                    lock.lock();
+                    m_last_batch = target - m_durable;
+                    m_durable = target;
+                    m_stats.bytes += batch.size();
+                    m_stats.syncs++;
+                    m_syncing = false;
+                    m_cv.notify_all();
+                }
+            }
+
+            /// Makes every appended record durable.
+            void sync() { commit( last_lsn() ); }
+
+            // True once a write or sync failed: the log accepts nothing after it.
+            bool failed() const { std::lock_guard< std::mutex > lock( m_mtx ); return not m_error.empty(); }
+            lsn_type last_lsn() const { std::lock_guard< std::mutex > lock( m_mtx ); return m_appended; }
+            WalStats stats() const { std::lock_guard< std::mutex > lock( m_mtx ); return m_stats; }
+            const std::string & path() const { return m_path; }
+
+            /// Reopens the log file at path() after it was replaced (see DurableHashTbl::checkpoint()).
+            /*! The caller must make sure nothing is appended meanwhile. */
+            void reopen() {
+                sync();
+                std::lock_guard< std::mutex > lock( m_mtx );
+                ::close( m_fd );
+                m_fd = open_log( m_path );
+            }
+
+            /// Calls f(op, payload, size) for each intact record of the log at path_, in order.
+            /*! A torn or corrupt record ends the log: the file is truncated right before it.
+             *  @return the number of records replayed.
+             */
+            template< class Func >
+            static std::size_t replay( const std::string & path_, Func f_ ) {
+                int fd = ::open( path_.c_str(), O_RDWR );
+                if (fd < 0) {
+                    if (errno == ENOENT) return 0;
+                    fail( "open " + path_ );
+                }
+                struct stat st;
+                if (::fstat( fd, &st ) != 0) { ::close( fd ); fail( "fstat " + path_ ); }
+                std::size_t size = static_cast< std::size_t >( st.st_size ), good{0}, n{0};
+                if (size > 0) {
+                    void * map = ::mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+                    if (map == MAP_FAILED) { ::close( fd ); fail( "mmap " + path_ ); }
+                    const char * base = static_cast< const char * >( map );
+                    try {
+                        while (good + sizeof( std::uint32_t ) <= size) {
+                            std::uint32_t len, crc;
+                            std::memcpy( &len, base + good, sizeof( len ) );
+                            if (len == 0 or size - good - sizeof( len ) < std::size_t( len ) + sizeof( crc )) break;
+                            const char * body = base + good + sizeof( len );
+                            std::memcpy( &crc, body + len, sizeof( crc ) );
+                            if (detail::crc32( body, len ) != crc) break;
+                            f_( static_cast< std::uint8_t >( body[0] ), body + 1, std::size_t( len - 1 ) );
+                            good += sizeof( len ) + len + sizeof( crc );
+                            n++;
+                        }
+                    }
+                    catch (...) { ::munmap( map, size ); ::close( fd ); throw; }
+                    ::munmap( map, size );
+                }
+                if (good < size and ::ftruncate( fd, static_cast< off_t >( good ) ) != 0) {
+                    ::close( fd );
+                    fail( "ftruncate " + path_ );
+                }
+                ::close( fd );
+                return n;
+            }
+
+        private:
+            [[noreturn]] static void fail( const std::string & what_ ) {
+                throw std::runtime_error( "[WriteAheadLog]: " + what_ + ": " + std::strerror( errno ) );
+            }
+            static int open_log( const std::string & path_ ) {
+                int fd = ::open( path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644 );
+                if (fd < 0) fail( "open " + path_ );
+                return fd;
+            }
+            void write_fully( const std::string & buf_ ) {
+                const char * p = buf_.data();
+                std::size_t n = buf_.size();
+                while (n > 0) {
+                    auto w = ::write( m_fd, p, n );
+                    if (w < 0) {
+                        if (errno == EINTR) continue;
+                        fail( "write" );
+                    }
+                    p += w;
+                    n -= static_cast< std::size_t >( w );
+                }
+            }
+
+            std::string m_path;
+            WalOptions m_options;
+            int m_fd;
+            mutable std::mutex m_mtx;
+            std::condition_variable m_cv;
+            std::string m_pending;       //!< Appended records not written yet.
+            lsn_type m_pending_records = 0; //!< Records in m_pending.
+            lsn_type m_appended = 0;     //!< Last appended record.
+            lsn_type m_durable = 0;      //!< Last durable record.
+            lsn_type m_last_batch = 0;   //!< Records in the last sync.
+            bool m_syncing = false;      //!< A leader is writing a batch.
+            std::string m_error;         //!< Error of the failed write or sync, if any.
+            WalStats m_stats;
+    };
+
+} // namespace ac
+#endif
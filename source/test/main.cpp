@@ -3,10 +3,44 @@
 #include <algorithm>            // std::min_element
 #include <array>
 #include <map>
+#include <memory>
+#include <vector>
+#include <limits>
+#include <cstdio>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <sys/wait.h>
 
 #include "gtest/gtest.h"        // gtest lib
 #include "../include/hashtbl.h"   // header file for tested functions
+#include "../include/int_hashtbl.h"
+#include "../include/string_pool.h"
+#include "../include/hashtbl_dump.h"
+#include "../include/hashtbl_layout.h"
+#include "../include/hash_cache.h"
+#include "../include/ttl_hashtbl.h"
+#include "../include/durable_hashtbl.h"
+#include "../include/hash_join.h"
+#include "../include/group_by.h"
+#include "../include/page_alloc.h"
+#include "../include/sharded_hashtbl.h"
+#include "../include/shm_hashtbl.h"
+#include "../include/disk_hashtbl.h"
+#include "../include/partitioned_hashtbl.h"
+#include "../include/buffered_hashtbl.h"
+#include "../include/indexed_hashtbl.h"
+#include "../include/table_diff.h"
+#include "../include/compressed_hashtbl.h"
 #include "../driver/account.h"  // To get the account class
+#include "../driver/account_loader.h"
+#include "../driver/workload.h"
 
 // ============================================================================
 // Test Fxture
@@ -328,6 +362,32 @@ TEST_F(HTTest, AssignmentInitializer)
     }
 }
 
+TEST_F(HTTest, Swap)
+{
+    using Key = Account::AcctKey;
+    ac::MemoryPolicy policy;
+    policy.huge_pages = true;   // Nodes in an arena, which moves along with them.
+    ac::HashTbl< Key, Account, KeyHash, KeyEqual > colliding( 10, policy ), small;
+    for ( int i{0}; i < 40; ++i )   // One treeified collision list.
+        colliding.insert( Key( "Mallory", i, i, 0 ), Account( "Mallory", i, i, 0, float( i ) ) );
+    small.insert( Key( "Alice", 1, 1, 0 ), Account( "Alice", 1, 1, 0, 5.f ) );
+
+    colliding.swap( small );
+    ASSERT_EQ( 1u, colliding.size() );
+    ASSERT_EQ( 40u, small.size() );
+    ASSERT_EQ( 1u, small.treeified_buckets() );
+    ASSERT_TRUE( small.memory_policy().huge_pages );
+    Account a;
+    ASSERT_TRUE( colliding.retrieve( Key( "Alice", 1, 1, 0 ), a ) );
+    for ( int i{0}; i < 40; ++i )
+    {
+        ASSERT_TRUE( small.retrieve( Key( "Mallory", i, i, 0 ), a ) );
+        ASSERT_EQ( float( i ), a.m_balance );
+    }
+    ASSERT_TRUE( small.erase( Key( "Mallory", 7, 7, 0 ) ) );
+    ASSERT_FALSE( small.retrieve( Key( "Mallory", 7, 7, 0 ), a ) );
+}
+
 TEST_F(HTTest, Insert)
 {
     ac::HashTbl<char, int> htable( 3 );
@@ -547,6 +607,2142 @@ TEST_F(HTTest, Count)
     //std::cout << "The table: \n" << htable << std::endl;
 }
 
+// ============================================================================
+// TESTING INTEGER-KEY HASH TABLE
+// ============================================================================
+
+TEST(IntHTTest, BatchHashMatchesScalar)
+{
+    std::vector<std::uint32_t> k32( 37 );
+    std::vector<std::uint64_t> k64( 37 );
+    for ( size_t i{0}; i < k32.size(); ++i )
+    {
+        k32[i] = static_cast<std::uint32_t>( i * 2654435761u );
+        k64[i] = i * 0x9E3779B97F4A7C15ull + 17;
+    }
+    std::vector<size_t> out( k32.size() );
+
+    ac::MultiplicativeHash<std::uint32_t>::apply_batch( k32.data(), k32.size(), 10, out.data() );
+    for ( size_t i{0}; i < k32.size(); ++i )
+        ASSERT_EQ( ac::MultiplicativeHash<std::uint32_t>::apply( k32[i], 10 ), out[i] );
+
+    ac::MultiplicativeHash<std::uint64_t>::apply_batch( k64.data(), k64.size(), 20, out.data() );
+    for ( size_t i{0}; i < k64.size(); ++i )
+        ASSERT_EQ( ac::MultiplicativeHash<std::uint64_t>::apply( k64[i], 20 ), out[i] );
+}
+
+TEST(IntHTTest, InsertRetrieveErase)
+{
+    ac::IntHashTbl<int, int> htable( 2 );
+    std::map<int, int> expected;
+    for ( int i{0}; i < 1000; ++i )
+    {
+        ASSERT_TRUE( htable.insert( i * 7, i ) );
+        expected[i * 7] = i;
+    }
+    ASSERT_EQ( expected.size(), htable.size() );
+    ASSERT_FALSE( htable.insert( 7, 42 ) );
+    expected[7] = 42;
+
+    // Erase every other key; the remaining ones must still be reachable.
+    for ( int i{0}; i < 1000; i += 2 )
+    {
+        ASSERT_TRUE( htable.erase( i * 7 ) );
+        expected.erase( i * 7 );
+    }
+    ASSERT_FALSE( htable.erase( 0 ) );
+    ASSERT_EQ( expected.size(), htable.size() );
+    for ( const auto &e : expected )
+    {
+        int data;
+        ASSERT_TRUE( htable.retrieve( e.first, data ) );
+        ASSERT_EQ( e.second, data );
+    }
+    for ( int i{0}; i < 1000; i += 2 )
+        ASSERT_EQ( 0u, htable.count( i * 7 ) );
+}
+
+TEST(IntHTTest, MaxLoadFactorBounds)
+{
+    ac::IntHashTbl<int, int> htable;
+    ASSERT_THROW( htable.max_load_factor( 0.f ), std::invalid_argument );
+    ASSERT_THROW( htable.max_load_factor( -0.5f ), std::invalid_argument );
+    ASSERT_THROW( htable.max_load_factor( 1.f ), std::invalid_argument );
+    ASSERT_THROW( htable.max_load_factor( std::nanf( "" ) ), std::invalid_argument );
+    ASSERT_EQ( 0.75f, htable.max_load_factor() );   // Unchanged by the rejected values.
+    htable.max_load_factor( 0.95f );
+    for ( int i{0}; i < 10000; ++i )
+        ASSERT_TRUE( htable.insert( i, i ) );
+    ASSERT_LE( htable.size(), 0.95 * htable.capacity() );
+    ASSERT_EQ( 1u, htable.count( 9999 ) );
+    ASSERT_EQ( 0u, htable.count( 10000 ) );   // A miss still finds an empty slot.
+}
+
+TEST(IntHTTest, FreedSlotsReleaseTheirData)
+{
+    auto shared = std::make_shared< int >( 7 );
+    ac::IntHashTbl<int, std::shared_ptr< int >> htable;
+    for ( int i{0}; i < 100; ++i )
+        htable.insert( i, shared );
+    htable.insert( std::numeric_limits< int >::max(), shared );   // The sentinel key's own slot.
+    ASSERT_EQ( 102, shared.use_count() );
+    ASSERT_TRUE( htable.erase( 5 ) );
+    ASSERT_TRUE( htable.erase( std::numeric_limits< int >::max() ) );
+    ASSERT_EQ( 100, shared.use_count() );
+    htable.clear();
+    ASSERT_EQ( 1, shared.use_count() );   // Not held until the slots are reused.
+}
+
+TEST(IntHTTest, SubscriptInsertsInOnePass)
+{
+    ac::IntHashTbl<int, int> htable;
+    std::map<int, int> expected;
+    unsigned x{11};
+    for ( int i{0}; i < 20000; ++i )   // Enough new keys to rehash several times and displace others.
+    {
+        x = x * 1103515245u + 12345u;
+        int key = int( x >> 8 ) % 5000;
+        htable[key] += i;
+        expected[key] += i;
+    }
+    htable[std::numeric_limits< int >::max()] = 3;
+    ASSERT_EQ( expected.size() + 1, htable.size() );
+    for ( const auto & e : expected )
+        ASSERT_EQ( e.second, htable.at( e.first ) );
+    ASSERT_EQ( 3, htable.at( std::numeric_limits< int >::max() ) );
+}
+
+TEST(IntHTTest, SentinelKeyAndBulkInsert)
+{
+    ac::IntHashTbl<std::uint64_t, int> htable;
+    std::vector<std::uint64_t> keys{ 1, 2, 3, std::numeric_limits<std::uint64_t>::max(), 2 };
+    std::vector<int> data{ 10, 20, 30, 40, 50 };
+
+    ASSERT_EQ( 4u, htable.insert( keys.data(), data.data(), keys.size() ) );
+    ASSERT_EQ( 4u, htable.size() );
+    ASSERT_EQ( 50, htable.at( 2 ) );
+    ASSERT_EQ( 40, htable.at( std::numeric_limits<std::uint64_t>::max() ) );
+    ASSERT_TRUE( htable.erase( std::numeric_limits<std::uint64_t>::max() ) );
+    ASSERT_THROW( htable.at( std::numeric_limits<std::uint64_t>::max() ), std::out_of_range );
+
+    ac::IntHashTbl<std::uint64_t, int> copy( htable );
+    htable.clear();
+    ASSERT_TRUE( htable.empty() );
+    ASSERT_EQ( 3u, copy.size() );
+    ++copy[99];
+    ASSERT_EQ( 1, copy[99] );
+}
+
+TEST(IntHTTest, ChurnKeepsProbesShort)
+{
+    ac::IntHashTbl<std::uint32_t, int> htable;
+    std::vector<std::uint32_t> live( 2000 );
+    std::uint32_t next_key{0};
+    for ( auto &k : live )
+    {
+        k = next_key++;
+        htable.insert( k, int( k ) );
+    }
+    auto capacity = htable.capacity();
+    // Erase and insert many times the table size; no tombstones may pile up.
+    for ( int i{0}; i < 200000; ++i )
+    {
+        auto &victim = live[( i * 7919u ) % live.size()];
+        ASSERT_TRUE( htable.erase( victim ) );
+        victim = next_key++;
+        ASSERT_TRUE( htable.insert( victim, int( victim ) ) );
+    }
+    ASSERT_EQ( live.size(), htable.size() );
+    ASSERT_EQ( capacity, htable.capacity() );
+    for ( auto k : live )
+        ASSERT_EQ( int( k ), htable.at( k ) );
+
+    double average;
+    size_t longest;
+    htable.probe_stats( average, longest );
+    ASSERT_LT( average, 4.0 );
+    ASSERT_LT( longest, 64u );
+}
+
+TEST(IntHTTest, FastHashTblSelection)
+{
+    ASSERT_TRUE( ( std::is_same< ac::FastHashTbl<int, char>, ac::IntHashTbl<int, char> >::value ) );
+    ASSERT_TRUE( ( std::is_same< ac::FastHashTbl<std::string, char>, ac::HashTbl<std::string, char> >::value ) );
+}
+
+// ============================================================================
+// TESTING STRING INTERNING
+// ============================================================================
+
+TEST(StringPoolTest, InternIsUnique)
+{
+    ac::StringPool pool( 2 );
+    auto a = pool.intern( "Alex Bastos" );
+    auto b = pool.intern( std::string( "Aline Souza" ) );
+    // Force the index to grow a few times.
+    for ( int i{0}; i < 100; ++i )
+        pool.intern( "name" + std::to_string( i ) );
+
+    ASSERT_EQ( a, pool.intern( "Alex Bastos" ) );
+    ASSERT_NE( a, b );
+    ASSERT_EQ( "Aline Souza", pool.str( b ) );
+    ASSERT_EQ( 102u, pool.size() );
+
+    ac::StringHandle h;
+    ASSERT_TRUE( pool.find( "name42", h ) );
+    ASSERT_EQ( "name42", std::string( pool.c_str( h ) ) );
+    ASSERT_FALSE( pool.find( "Cristiano Ronaldo", h ) );
+    ASSERT_EQ( 102u, pool.size() );
+}
+
+TEST_F(HTTest, InternedKeys)
+{
+    ac::StringPool pool;
+    ac::HashTbl< Account::InternedKey, Account, InternedKeyHash, InternedKeyEqual > ht_interned{ 2 };
+    for( auto & e : m_accounts )
+        ASSERT_TRUE( ht_interned.insert( e.getKey( pool ), e ) );
+    ASSERT_EQ( m_accounts.size(), pool.size() );
+
+    // A copy (and the rehash triggered above) shares the handles.
+    auto copy( ht_interned );
+    for( auto & e : m_accounts )
+    {
+        Account::InternedKey key;
+        ASSERT_TRUE( e.findKey( pool, key ) );
+        Account temp;
+        ASSERT_TRUE( copy.retrieve( key, temp ) );
+        ASSERT_EQ( e, temp );
+    }
+
+    Account stranger{ "Nobody", 1, 1668, 54321, 0.f };
+    Account::InternedKey key;
+    ASSERT_FALSE( stranger.findKey( pool, key ) );
+}
+
+TEST_F(HTTest, PackedKeys)
+{
+    ac::StringPool pool;
+    ac::HashTbl< Account::PackedKey, Account, PackedKeyHash, PackedKeyEqual > ht_packed{ 2 };
+    for( auto & e : m_accounts )
+        ASSERT_TRUE( ht_packed.insert( e.getPackedKey( pool ), e ) );
+    // Same codes, another client: told apart by the name handle.
+    Account twin{ "Twin", 1, 1668, 54321, 7.f };
+    ASSERT_TRUE( ht_packed.insert( twin.getPackedKey( pool ), twin ) );
+    ASSERT_EQ( m_accounts.size() + 1, ht_packed.size() );
+
+    for( auto & e : m_accounts )
+    {
+        Account::PackedKey key;
+        ASSERT_TRUE( e.findKey( pool, key ) );
+        ASSERT_EQ( e.m_bank_code, key.bank() );
+        ASSERT_EQ( e.m_branch_code, key.branch() );
+        ASSERT_EQ( e.m_number, key.number() );
+        ASSERT_EQ( e, ht_packed.at( key ) );
+    }
+    ASSERT_EQ( 7.f, ht_packed.at( twin.getPackedKey( pool ) ).m_balance );
+
+    Account::PackedKey key;
+    Account stranger{ "Nobody", 1, 1668, 54321, 0.f };
+    ASSERT_FALSE( stranger.findKey( pool, key ) );
+    Account wide{ "Alex Bastos", 70000, 1, -5, 0.f };   // Bank code wider than 16 bits.
+    ASSERT_FALSE( wide.findKey( pool, key ) );
+    ASSERT_THROW( wide.getPackedKey( pool ), std::out_of_range );
+    Account negative{ "Alex Bastos", 1, 2, -5, 0.f };
+    ASSERT_EQ( -5, negative.getPackedKey( pool ).number() );
+}
+
+// ============================================================================
+// TESTING BULK INSERTION AND LOADING
+// ============================================================================
+
+TEST_F(HTTest, InsertRangeAndReserve)
+{
+    std::vector< ac::HashEntry< Account::AcctKey, Account > > entries;
+    for( auto & e : m_accounts )
+        entries.emplace_back( e.getKey(), e );
+
+    ht_accounts.reserve( 100 );
+    auto buckets = ht_accounts.bucket_count();
+    ASSERT_GE( buckets * ht_accounts.max_load_factor(), 100 );
+    ASSERT_EQ( m_accounts.size(), ht_accounts.insert( entries.begin(), entries.end() ) );
+    ASSERT_EQ( 0u, ht_accounts.insert( entries.begin(), entries.end() ) );
+    ASSERT_EQ( buckets, ht_accounts.bucket_count() ); // No rehash happened.
+    for( auto & e : m_accounts )
+        ASSERT_EQ( ht_accounts.at( e.getKey() ), e );
+}
+
+TEST_F(HTTest, LoadAccounts)
+{
+    std::vector< Account > accounts( m_accounts.begin(), m_accounts.end() );
+    for ( int i{0}; i < 500; ++i )
+        accounts.emplace_back( "Client " + std::to_string( i ), i % 7, i % 13, i, i * 1.5f );
+    accounts.emplace_back( "Souza, \"Lima\" Jr", 1, 2, 3, 4.f );   // Quoted in CSV.
+    const Account long_name( std::string( 48, 'x' ), 1, 2, 4, 5.f );   // Does not fit an AccountRecord.
+
+    for ( auto fmt : { AccountFormat::csv, AccountFormat::binary } )
+    {
+        const std::string path = "load_accounts_test.dat";
+        auto all = accounts;
+        all.push_back( long_name );
+        all.emplace_back( "Two\nlines", 1, 2, 5, 6.f );   // Not a CSV line.
+        ASSERT_EQ( 1u, save_accounts( path, fmt, all ) );
+        AccountTable table;
+        LoadOptions opts;
+        opts.threads = 3;
+        opts.chunk_bytes = 1000; // Many small chunks.
+        auto stats = load_accounts( path, fmt, table, opts );
+
+        auto expected = accounts.size() + 1;   // The long name, or the line break.
+        ASSERT_EQ( expected, stats.records );
+        ASSERT_EQ( expected, stats.inserted );
+        ASSERT_EQ( 0u, stats.rejected );
+        ASSERT_EQ( expected, table.size() );
+        for ( const auto & a : accounts )
+            ASSERT_EQ( table.at( a.getKey() ), a );
+        ASSERT_EQ( fmt == AccountFormat::csv, table.find( long_name.getKey() ) != nullptr );
+
+        // Damaged input is counted, not loaded.
+        {
+            std::ofstream out( path, std::ios::binary | std::ios::app );
+            if ( fmt == AccountFormat::csv )
+                out << "\"Unterminated,1,2,3,4\nBad,x,2,3,4\nBig,1,2,2147483648,4\n"
+                    << "Long,1,2,3,1" << std::string( 40, '0' ) << "x\n"   // Still a number if cut at 31 chars.
+                    << "Min,1,2,-2147483648,4\n";
+            else {
+                AccountRecord r;
+                std::memset( &r, 'y', sizeof( r ) );   // A name without its '\0'.
+                out.write( reinterpret_cast< const char * >( &r ), sizeof( r ) );
+                out.write( "partial", 7 );
+            }
+        }
+        AccountTable damaged;
+        stats = load_accounts( path, fmt, damaged, opts );
+        std::remove( path.c_str() );
+        ASSERT_EQ( expected + ( fmt == AccountFormat::csv ? 1 : 0 ), stats.records );
+        ASSERT_EQ( fmt == AccountFormat::csv ? 4u : 2u, stats.rejected );
+        if ( fmt == AccountFormat::csv )
+            ASSERT_EQ( 4.f, damaged.at( Account::AcctKey( "Min", 1, 2, std::numeric_limits< int >::min() ) ).m_balance );
+    }
+    AccountTable table;
+    ASSERT_THROW( load_accounts( "no/such/file.csv", AccountFormat::csv, table ), std::runtime_error );
+}
+
+// ============================================================================
+// TESTING TABLE DUMPS
+// ============================================================================
+
+/// Runs dump(fd) on a temporary file and returns what was written.
+template< class Dump >
+std::string dump_to_string( Dump dump )
+{
+    std::FILE * f = std::tmpfile();
+    dump( fileno( f ) );
+    std::rewind( f );
+    std::string out;
+    char buf[4096];
+    for ( std::size_t n; ( n = std::fread( buf, 1, sizeof( buf ), f ) ) > 0; )
+        out.append( buf, n );
+    std::fclose( f );
+    return out;
+}
+
+TEST_F(HTTest, DumpText)
+{
+    for ( int i{0}; i < 300; ++i )
+        ht_accounts.insert( Account( "Client " + std::to_string( i ), i, i, i, i / 3.f ).getKey(),
+                            Account( "Client " + std::to_string( i ), i, i, i, i / 3.f ) );
+    insert_accounts();
+    std::ostringstream expected;
+    expected << ht_accounts;
+
+    auto text = dump_to_string( [&]( int fd ) {
+        ASSERT_EQ( ht_accounts.size(), ac::dump_text( ht_accounts, fd, AccountFormatter{}, 4096 ) ); } );
+    ASSERT_EQ( expected.str(), text );
+
+    text = dump_to_string( [&]( int fd ) { ac::dump_text( ht_accounts, fd ); } );
+    ASSERT_EQ( expected.str(), text );
+
+    text = dump_to_string( [&]( int fd ) {
+        ASSERT_EQ( ht_accounts.size(),
+                   ac::parallel_dump_text( ht_accounts, fd, []() { return AccountFormatter{}; }, 3, 4096 ) ); } );
+    ASSERT_EQ( expected.str(), text );
+}
+
+TEST_F(HTTest, DumpBinary)
+{
+    insert_accounts();
+    auto bytes = dump_to_string( [&]( int fd ) { ac::dump_binary( ht_accounts, fd, AccountEncoder{} ); } );
+
+    ac::DumpHeader header;
+    ASSERT_GE( bytes.size(), sizeof( header ) );
+    std::memcpy( &header, bytes.data(), sizeof( header ) );
+    ASSERT_EQ( 0, std::memcmp( header.m_magic, "HTBD", 4 ) );
+    ASSERT_EQ( m_accounts.size(), header.m_count );
+
+    // Every record holds [length][name length][name][3 codes][balance].
+    std::size_t pos = sizeof( header ), records{0};
+    while ( pos < bytes.size() )
+    {
+        std::uint32_t len, name_len;
+        std::memcpy( &len, &bytes[pos], sizeof( len ) );
+        std::memcpy( &name_len, &bytes[pos + 4], sizeof( name_len ) );
+        ASSERT_EQ( len, 4 + name_len + 3 * 4 + 4 );
+        auto name = bytes.substr( pos + 8, name_len );
+        ASSERT_EQ( 1, std::count_if( m_accounts.begin(), m_accounts.end(),
+                                     [&]( const Account & a ) { return a.m_name == name; } ) );
+        pos += 4 + len;
+        records++;
+    }
+    ASSERT_EQ( m_accounts.size(), records );
+}
+
+// ============================================================================
+// TESTING CUCKOO LAYOUT
+// ============================================================================
+
+TEST_F(HTTest, CuckooAccounts)
+{
+    ac::BasicHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual, ac::cuckoo_layout > cuckoo{ 2 };
+    ASSERT_TRUE( ( std::is_same< decltype( cuckoo ),
+                                 ac::CuckooHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > >::value ) );
+    for( auto & e : m_accounts )
+        ASSERT_TRUE( cuckoo.insert( e.getKey(), e ) );
+    ASSERT_EQ( m_accounts.size(), cuckoo.size() );
+    for( auto & e : m_accounts )
+        ASSERT_EQ( cuckoo.at( e.getKey() ), e );
+
+    auto copy( cuckoo );
+    ASSERT_TRUE( cuckoo.erase( m_accounts[2].getKey() ) );
+    ASSERT_FALSE( cuckoo.erase( m_accounts[2].getKey() ) );
+    ASSERT_EQ( 0u, cuckoo.count( m_accounts[2].getKey() ) );
+    ASSERT_EQ( 1u, copy.count( m_accounts[2].getKey() ) );
+    ASSERT_THROW( cuckoo.at( m_accounts[2].getKey() ), std::out_of_range );
+}
+
+TEST(CuckooHTTest, MatchesStdMap)
+{
+    ac::CuckooHashTbl<int, int> htable;
+    std::map<int, int> expected;
+    unsigned x{12345};
+    for ( int i{0}; i < 20000; ++i )
+    {
+        x = x * 1103515245u + 12345u;
+        int key = int( x >> 8 ) % 5000;
+        if ( x & 0x10 )
+        {
+            ASSERT_EQ( expected.count( key ) == 0, htable.insert( key, i ) );
+            expected[key] = i;
+        }
+        else
+        {
+            ASSERT_EQ( expected.erase( key ) == 1, htable.erase( key ) );
+        }
+    }
+    ASSERT_EQ( expected.size(), htable.size() );
+    for ( const auto &e : expected )
+        ASSERT_EQ( e.second, htable.at( e.first ) );
+    size_t visited{0};
+    htable.for_each( [&]( const ac::HashEntry<int, int> & ) { ++visited; } );
+    ASSERT_EQ( expected.size(), visited );
+}
+
+/// Every key hashes to the same value.
+struct ConstantHash {
+    size_t operator()( int ) const { return 42; }
+};
+
+TEST(CuckooHTTest, CollidingHashes)
+{
+    // Keys of one hash value fill their two buckets, then the stash; no table size separates
+    // more of them, so the next one is refused rather than stashed past the cap.
+    using Table = ac::CuckooHashTbl<int, int, ConstantHash>;
+    Table htable;
+    const int fit = int( 2 * Table::SLOTS + Table::STASH_SIZE );
+    for ( int i{0}; i < fit; ++i )
+        ASSERT_TRUE( htable.insert( i, i * i ) );
+    ASSERT_THROW( htable.insert( fit, 0 ), std::length_error );
+    ASSERT_EQ( size_t( fit ), htable.size() );
+    ASSERT_EQ( 0u, htable.count( fit ) );
+    ASSERT_FALSE( htable.insert( 3, -9 ) );   // Overwrites still work.
+    for ( int i{0}; i < fit; ++i )
+        ASSERT_EQ( i == 3 ? -9 : i * i, htable[i] );
+    for ( int i{0}; i < fit; i += 2 )
+        ASSERT_TRUE( htable.erase( i ) );
+    ASSERT_EQ( size_t( fit / 2 ), htable.size() );
+    for ( int i{1}; i < fit; i += 2 )
+        ASSERT_EQ( i == 3 ? -9 : i * i, htable.at( i ) );
+    for ( int i{fit}; i < fit + fit / 2; ++i )   // Erased room is reused.
+        ASSERT_TRUE( htable.insert( i, i ) );
+}
+
+/// Counts its calls: one per lookup or insertion.
+struct CountingHash {
+    static size_t calls;
+    size_t operator()( int k ) const { ++calls; return std::hash< int >()( k ); }
+};
+size_t CountingHash::calls = 0;
+
+TEST(CuckooHTTest, SubscriptLooksUpOnce)
+{
+    ac::CuckooHashTbl<int, int, CountingHash> htable;
+    CountingHash::calls = 0;
+    htable[7] = 49;   // A miss: looked up, then stored where the lookup left off.
+    ASSERT_EQ( 1u, CountingHash::calls );
+    htable[7] += 1;
+    ASSERT_EQ( 2u, CountingHash::calls );
+    ASSERT_EQ( 50, htable.at( 7 ) );
+
+    // A new key that lands in the stash.
+    using Table = ac::CuckooHashTbl<int, int, ConstantHash>;
+    Table colliding;
+    const int fit = int( 2 * Table::SLOTS + Table::STASH_SIZE );
+    for ( int i{0}; i < fit - 1; ++i )
+        colliding[i] = i;
+    colliding[fit - 1] = -1;
+    ASSERT_EQ( size_t( fit ), colliding.size() );
+    ASSERT_EQ( -1, colliding.at( fit - 1 ) );
+    ASSERT_THROW( colliding[fit], std::length_error );
+    ASSERT_EQ( 0u, colliding.count( fit ) );
+}
+
+// ============================================================================
+// TESTING MEMBERSHIP FILTER
+// ============================================================================
+
+TEST_F(HTTest, FilterAnswersMisses)
+{
+    insert_accounts();
+    ht_accounts.enable_filter( 0.01 );
+    Account temp;
+    for( auto & e : m_accounts )
+        ASSERT_TRUE( ht_accounts.retrieve( e.getKey(), temp ) );
+    ASSERT_EQ( 0u, ht_accounts.filter_stats().definite_misses );
+
+    Account absent{"Nobody", 99, 999, 99999, 0.f};
+    ASSERT_FALSE( ht_accounts.retrieve( absent.getKey(), temp ) );
+    ASSERT_THROW( ht_accounts.at( absent.getKey() ), std::out_of_range );
+    ASSERT_EQ( 2u, ht_accounts.filter_stats().definite_misses + ht_accounts.filter_stats().false_positives );
+
+    // Erased keys, inserts after a rehash, clear() and copies must all stay exact.
+    ASSERT_TRUE( ht_accounts.erase( m_accounts[3].getKey() ) );
+    ASSERT_FALSE( ht_accounts.retrieve( m_accounts[3].getKey(), temp ) );
+    ASSERT_TRUE( ht_accounts.insert( absent.getKey(), absent ) );
+    ASSERT_TRUE( ht_accounts.retrieve( absent.getKey(), temp ) );
+    auto copy( ht_accounts );
+    ASSERT_NE( nullptr, copy.filter() );
+    ASSERT_TRUE( copy.retrieve( m_accounts[5].getKey(), temp ) );
+    ht_accounts.clear();
+    ASSERT_FALSE( ht_accounts.retrieve( m_accounts[5].getKey(), temp ) );
+    ASSERT_TRUE( copy.retrieve( m_accounts[5].getKey(), temp ) );
+}
+
+TEST(FilterTest, FalsePositiveRate)
+{
+    ac::HashTbl<int, int> htable;
+    htable.enable_filter( 0.01 );
+    for ( int i{0}; i < 20000; ++i )
+        htable.insert( i, i );
+    for ( int i{0}; i < 20000; i += 2 )   // Leaves stale bits behind until the filter is rebuilt.
+        ASSERT_TRUE( htable.erase( i ) );
+    int v;
+    for ( int i{0}; i < 20000; ++i )
+        ASSERT_EQ( i % 2 == 1, htable.retrieve( i, v ) );
+    ASSERT_EQ( 30000u, htable.filter_stats().lookups );   // erase() consults the filter too.
+
+    // Keys that were never inserted.
+    htable.reset_filter_stats();
+    for ( int i{20000}; i < 120000; ++i )
+        ASSERT_FALSE( htable.retrieve( i, v ) );
+    auto stats = htable.filter_stats();
+    ASSERT_EQ( 100000u, stats.definite_misses + stats.false_positives );
+    ASSERT_LT( stats.false_positive_rate(), 0.03 );
+
+    for ( double fpr : { 0.0, -0.5, 1.0, 2.0, std::nan( "" ) } )
+        ASSERT_THROW( htable.enable_filter( fpr ), std::invalid_argument );
+    ASSERT_EQ( 0.01, htable.filter()->fpr() );   // The filter in place is kept.
+    ASSERT_THROW( ac::BlockedBloomFilter( 100, 0.0 ), std::invalid_argument );
+}
+
+TEST(FilterTest, ConcurrentLookupsCountEveryOne)
+{
+    ac::HashTbl<int, int> htable;
+    htable.enable_filter( 0.01 );
+    for ( int i{0}; i < 1000; ++i )
+        htable.insert( i, i );
+    const int n_threads = 4, per_thread = 50000;
+    std::vector< std::thread > readers;
+    for ( int t{0}; t < n_threads; ++t )
+        readers.emplace_back( [&htable, t]() {
+            int v;
+            for ( int i{0}; i < per_thread; ++i )
+                htable.retrieve( ( t + 1 ) * 1000000 + i, v );   // Absent: the filter or the list answers.
+        } );
+    for ( auto & r : readers ) r.join();
+    auto stats = htable.filter_stats();
+    ASSERT_EQ( size_t( n_threads * per_thread ), stats.lookups );
+    ASSERT_EQ( stats.lookups, stats.definite_misses + stats.false_positives );
+}
+
+// ============================================================================
+// TESTING BOUNDED CACHE
+// ============================================================================
+
+TEST(HashCacheTest, ClockEviction)
+{
+    ac::HashCache<int, int> cache{ 4, 1 };
+    for ( int i{1}; i <= 4; ++i )
+        ASSERT_TRUE( cache.put( i, i * 10 ) );
+    int v;
+    ASSERT_TRUE( cache.get( 1, v ) );
+    ASSERT_EQ( 10, v );
+    ASSERT_TRUE( cache.get( 2, v ) );
+    ASSERT_FALSE( cache.get( 7, v ) );
+
+    // 1 and 2 were read since they were stored: the clock evicts 3, the first one that was not.
+    ASSERT_TRUE( cache.put( 5, 50 ) );
+    ASSERT_EQ( 4u, cache.size() );
+    ASSERT_FALSE( cache.get( 3, v ) );
+    ASSERT_TRUE( cache.get( 1, v ) );
+    ASSERT_TRUE( cache.get( 5, v ) );
+    ASSERT_FALSE( cache.put( 5, 55 ) );
+    ASSERT_TRUE( cache.get( 5, v ) );
+    ASSERT_EQ( 55, v );
+
+    auto stats = cache.stats();
+    ASSERT_EQ( 5u, stats.hits );
+    ASSERT_EQ( 2u, stats.misses );
+    ASSERT_EQ( 1u, stats.evictions );
+
+    ASSERT_TRUE( cache.erase( 1 ) );
+    ASSERT_FALSE( cache.erase( 1 ) );
+    ASSERT_TRUE( cache.put( 6, 60 ) );   // Takes the erased slot: no eviction.
+    ASSERT_EQ( 1u, cache.stats().evictions );
+    cache.clear();
+    ASSERT_EQ( 0u, cache.size() );
+}
+
+TEST_F(HTTest, CacheReadThrough)
+{
+    insert_accounts();
+    ac::HashCache< Account::AcctKey, Account, KeyHash, KeyEqual > cache{ 4 };
+    size_t loads{0};
+    auto load = [&]( const Account::AcctKey & k ) { ++loads; return ht_accounts.at( k ); };
+    for ( int round{0}; round < 3; ++round )
+        for( auto & e : m_accounts )
+            ASSERT_EQ( e, cache.get_or_load( e.getKey(), load ) );
+    ASSERT_LE( cache.size(), cache.capacity() );
+    ASSERT_EQ( loads, cache.stats().misses );
+    ASSERT_GE( loads, m_accounts.size() );
+}
+
+TEST(HashCacheTest, ConcurrentReadersAndWriters)
+{
+    ac::HashCache<int, int> cache{ 1000, 8 };
+    std::vector< std::thread > threads;
+    for ( int t{0}; t < 4; ++t )
+        threads.emplace_back( [&cache, t]() {
+            int v;
+            for ( int i{0}; i < 20000; ++i ) {
+                int key = ( i * 7 + t ) % 3000;
+                if ( cache.get( key, v ) )
+                    ASSERT_EQ( key * 2, v );
+                else
+                    cache.put( key, key * 2 );
+            }
+        } );
+    for ( auto & t : threads ) t.join();
+    ASSERT_LE( cache.size(), cache.capacity() );
+    auto stats = cache.stats();
+    ASSERT_EQ( 80000u, stats.hits + stats.misses );
+}
+
+// ============================================================================
+// TESTING ENTRY EXPIRY
+// ============================================================================
+
+/// A clock the tests move by hand.
+struct ManualClock {
+    using duration = std::chrono::milliseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point< ManualClock >;
+    static const bool is_steady = true;
+    static time_point now() { return s_now; }
+    static time_point s_now;
+};
+ManualClock::time_point ManualClock::s_now;
+
+TEST(TtlHashTblTest, LazyAndWheelExpiry)
+{
+    using std::chrono::milliseconds;
+    ManualClock::s_now = ManualClock::time_point{};
+    ac::TtlHashTbl< int, int, std::hash<int>, std::equal_to<int>, ManualClock > htable;
+    ASSERT_TRUE( htable.insert( 1, 10 ) );
+    ASSERT_TRUE( htable.insert( 2, 20, milliseconds( 50 ) ) );
+    ASSERT_TRUE( htable.insert( 3, 30, milliseconds( 5000 ) ) );
+    ASSERT_TRUE( htable.insert( 4, 40, milliseconds( 5000 ) ) );
+    ASSERT_EQ( 3u, htable.expiring() );
+
+    int v;
+    ManualClock::s_now += milliseconds( 49 );
+    ASSERT_TRUE( htable.retrieve( 2, v ) );
+    ManualClock::s_now += milliseconds( 1 );
+    ASSERT_FALSE( htable.retrieve( 2, v ) );   // Lazily removed, before any expire().
+    ASSERT_THROW( htable.at( 2 ), std::out_of_range );
+    ASSERT_EQ( 3u, htable.size() );
+
+    ASSERT_TRUE( htable.persist( 4 ) );
+    ASSERT_FALSE( htable.insert( 1, 11, milliseconds( 100 ) ) );
+    ManualClock::s_now += milliseconds( 10000 );
+    ASSERT_EQ( 3u, htable.size() );             // 1 and 3 expired, but nothing looked at them yet.
+    ASSERT_EQ( 2u, htable.expire() );
+    ASSERT_EQ( 1u, htable.size() );
+    ASSERT_EQ( 0u, htable.expiring() );
+    ASSERT_EQ( 40, htable.at( 4 ) );
+    ASSERT_FALSE( htable.expire_at( 3, ManualClock::s_now ) );
+}
+
+TEST(TtlHashTblTest, WheelMatchesDeadlines)
+{
+    using std::chrono::milliseconds;
+    ManualClock::s_now = ManualClock::time_point{};
+    ac::TtlHashTbl< int, int, std::hash<int>, std::equal_to<int>, ManualClock > htable;
+    std::map< int, long > deadline;   // Key -> expiry, in ms.
+    unsigned x{99};
+    for ( int i{0}; i < 5000; ++i )
+    {
+        x = x * 1103515245u + 12345u;
+        long ttl = 1 + long( x >> 8 ) % 300000;   // Up to 5 minutes: spans three wheel levels.
+        htable.insert( i, i, milliseconds( ttl ) );
+        deadline[i] = ttl;
+    }
+    for ( long now{0}; now <= 310000; now += 997 )
+    {
+        ManualClock::s_now = ManualClock::time_point{ milliseconds( now ) };
+        htable.expire();
+        // Deadlines fall on tick boundaries here, so expire() removes exactly the due entries.
+        size_t live{0};
+        for ( const auto & d : deadline ) live += d.second > now;
+        ASSERT_EQ( live, htable.size() );
+    }
+    ASSERT_EQ( 0u, htable.size() );
+}
+
+TEST(TtlHashTblTest, WheelFiresAtDueAcrossBlocks)
+{
+    // Timers added on the first and last ticks of level blocks, due across one or more
+    // block boundaries of every level, must fire on their due tick exactly.
+    ac::TimerWheel< std::uint64_t > wheel;
+    const std::uint64_t offsets[] = { 1, 2, 63, 64, 65, 127, 128, 129, 4095, 4096, 4097, 8000,
+                                      262143, 262144, 262145, 300000 };
+    std::size_t added{0}, fired{0}, wrong{0};
+    for ( std::uint64_t t{0}; t < 600000; ++t )
+    {
+        if ( t < 270000 and ( t % 64 <= 1 or t % 64 >= 62 ) )
+            for ( auto o : offsets ) { wheel.add( t + o, t + o ); ++added; }
+        wheel.advance( t + 1, [&]( std::uint64_t due ) { ++fired; wrong += due != wheel.now(); } );
+    }
+    ASSERT_EQ( added, fired );
+    ASSERT_EQ( 0u, wrong );
+    ASSERT_EQ( 0u, wheel.size() );
+}
+
+// ============================================================================
+// TESTING WRITE-AHEAD LOG
+// ============================================================================
+
+TEST_F(HTTest, DurableAccountsSurviveReopen)
+{
+    const std::string path = "durable_accounts_test.log";
+    std::remove( path.c_str() );
+    {
+        ac::DurableHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > table( path );
+        for ( auto & e : m_accounts )
+            ASSERT_TRUE( table.insert( e.getKey(), e ) );
+        ASSERT_TRUE( table.erase( m_accounts[3].getKey() ) );
+        ASSERT_FALSE( table.erase( m_accounts[3].getKey() ) );
+        table.modify( m_accounts[0].getKey(), []( Account & a ) { a.m_balance += 100.f; } );
+    }
+    ac::DurableHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > table( path );
+    ASSERT_EQ( 10u, table.recovered() );   // 8 inserts, 1 erase, 1 modify.
+    ASSERT_EQ( 7u, table.size() );
+    ASSERT_EQ( 0u, table.count( m_accounts[3].getKey() ) );
+    ASSERT_EQ( 1600.f, table.at( target.getKey() ).m_balance );
+    ASSERT_EQ( table.at( m_accounts[7].getKey() ), m_accounts[7] );
+
+    table.checkpoint();   // Drops the erase and the first write of account 0.
+    {
+        ac::DurableHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > reopened( path, ac::WalOptions{}, 8 );
+        ASSERT_EQ( 7u, reopened.recovered() );
+        ASSERT_EQ( 1600.f, reopened.at( target.getKey() ).m_balance );
+    }
+    std::remove( path.c_str() );
+}
+
+TEST(WalTest, TornTailIsDropped)
+{
+    const std::string path = "wal_torn_test.log";
+    std::remove( path.c_str() );
+    {
+        ac::DurableHashTbl< int, std::string > table( path );
+        for ( int i{0}; i < 100; ++i )
+            table.insert( i, "value " + std::to_string( i ) );
+        table.clear();
+        for ( int i{0}; i < 10; ++i )
+            table.insert( i, std::to_string( i ) );
+    }
+    std::FILE * f = std::fopen( path.c_str(), "ab" );
+    std::fputs( "\x20\x00\x00\x00\x01garbage", f );   // A record cut short by a crash.
+    std::fclose( f );
+
+    for ( int round{0}; round < 2; ++round )   // The first open truncates the tail; the second sees a clean log.
+    {
+        ac::DurableHashTbl< int, std::string > table( path );
+        ASSERT_EQ( 111u, table.recovered() );
+        ASSERT_EQ( 10u, table.size() );
+        ASSERT_EQ( "7", table.at( 7 ) );
+        ASSERT_THROW( table.at( 50 ), std::out_of_range );
+    }
+    // A corrupted byte ends the log at the record holding it.
+    f = std::fopen( path.c_str(), "r+b" );
+    std::fseek( f, -3, SEEK_END );
+    std::fputc( '#', f );
+    std::fclose( f );
+    ac::DurableHashTbl< int, std::string > table( path );
+    ASSERT_EQ( 110u, table.recovered() );
+    ASSERT_EQ( 0u, table.count( 9 ) );
+    ASSERT_EQ( "8", table.at( 8 ) );
+    std::remove( path.c_str() );
+}
+
+TEST(WalTest, GroupCommitSharesSyncs)
+{
+    const std::string path = "wal_group_test.log";
+    std::remove( path.c_str() );
+    const int n_threads = 4, per_thread = 200;
+    {
+        ac::WalOptions options;
+        options.mode = ac::SyncMode::group;
+        options.max_delay = std::chrono::microseconds( 2000 );
+        ac::DurableHashTbl< int, int > table( path, options );
+        std::vector< std::thread > writers;
+        for ( int t{0}; t < n_threads; ++t )
+            writers.emplace_back( [&table, t]() {
+                for ( int i{0}; i < per_thread; ++i )
+                    table.modify( i, [t]( int & v ) { v += t + 1; } );
+            } );
+        for ( auto & w : writers ) w.join();
+        auto stats = table.log_stats();
+        ASSERT_EQ( unsigned( n_threads * per_thread ), stats.records );
+        ASSERT_LE( stats.syncs, stats.records );
+    }
+    ac::DurableHashTbl< int, int > table( path );
+    ASSERT_EQ( size_t( per_thread ), table.size() );
+    for ( int i{0}; i < per_thread; ++i )
+        ASSERT_EQ( 1 + 2 + 3 + 4, table.at( i ) );   // No update was lost, in memory or in the log.
+    std::remove( path.c_str() );
+}
+
+TEST(WalTest, FailedSyncIsSticky)
+{
+    // Every write to /dev/full fails with ENOSPC.
+    {
+        ac::WriteAheadLog log( "/dev/full" );
+        auto lsn = log.append( 1, "lost" );
+        ASSERT_THROW( log.commit( lsn ), std::runtime_error );
+        ASSERT_TRUE( log.failed() );
+        ASSERT_THROW( log.commit( lsn ), std::runtime_error );   // Never reported durable.
+        ASSERT_THROW( log.append( 1, "later" ), std::runtime_error );
+        ASSERT_THROW( log.sync(), std::runtime_error );
+    }
+    ac::DurableHashTbl< int, int > table( "/dev/full" );
+    ASSERT_THROW( table.insert( 1, 10 ), std::runtime_error );
+    ASSERT_EQ( 0u, table.size() );   // Nothing unlogged is applied.
+    ASSERT_EQ( 0u, table.count( 1 ) );
+    ASSERT_THROW( table.insert( 2, 20 ), std::runtime_error );
+    ASSERT_THROW( table.modify( 1, []( int & v ) { v++; } ), std::runtime_error );
+    ASSERT_EQ( 0u, table.size() );
+}
+
+// ============================================================================
+// TESTING HASH JOIN
+// ============================================================================
+
+TEST_F(HTTest, JoinTransactions)
+{
+    struct Txn { Account::AcctKey account; float amount; };
+    std::vector< Account > accounts( m_accounts.begin(), m_accounts.end() );
+    std::vector< Txn > txns;
+    for ( int i{0}; i < 300; ++i )
+        txns.push_back( { m_accounts[ i % 8 ].getKey(), float( i ) } );
+    txns.push_back( { Account::AcctKey( "Nobody", 0, 0, 0 ), 1.f } );
+
+    for ( bool radix : { false, true } )
+    {
+        ac::JoinOptions opts;
+        opts.threads = 3;
+        opts.radix = radix;
+        opts.radix_bits = radix ? 2 : 0;
+        std::vector< float > totals( m_accounts.size(), 0.f );
+        std::mutex mtx;
+        auto stats = ac::hash_join< Account::AcctKey, KeyHash, KeyEqual >(
+            accounts, []( const Account & a ) { return a.getKey(); },
+            txns, []( const Txn & t ) -> const Account::AcctKey & { return t.account; },
+            [&]( const Account & a, const Txn & t, size_t ) {
+                std::lock_guard< std::mutex > lock( mtx );
+                totals[ &a - accounts.data() ] += t.amount;
+            },
+            opts );
+        ASSERT_EQ( 8u, stats.build_rows );
+        ASSERT_EQ( 301u, stats.probe_rows );
+        ASSERT_EQ( 300u, stats.matches );
+        for ( size_t i{0}; i < totals.size(); ++i )
+        {
+            float expected{0};
+            for ( int j = int( i ); j < 300; j += 8 ) expected += float( j );
+            ASSERT_EQ( expected, totals[i] );
+        }
+    }
+}
+
+TEST(JoinTest, MatchesNestedLoop)
+{
+    // Duplicate keys on both sides; keys 0..49 on the build side, 0..59 on the probe side.
+    std::vector< std::pair< int, int > > build, probe;
+    unsigned x{7};
+    for ( int i{0}; i < 500; ++i ) { x = x * 1103515245u + 12345u; build.emplace_back( int( x >> 16 ) % 50, i ); }
+    for ( int i{0}; i < 2000; ++i ) { x = x * 1103515245u + 12345u; probe.emplace_back( int( x >> 16 ) % 60, i ); }
+    std::vector< std::pair< int, int > > expected;   // (build id, probe id)
+    for ( const auto & b : build )
+        for ( const auto & p : probe )
+            if ( b.first == p.first ) expected.emplace_back( b.second, p.second );
+    std::sort( expected.begin(), expected.end() );
+
+    auto key = []( const std::pair< int, int > & r ) { return r.first; };
+    for ( unsigned bits : { 0u, 1u, 4u } )
+        for ( bool radix : { false, true } )
+        {
+            ac::JoinOptions opts;
+            opts.threads = 4;
+            opts.morsel_rows = 64;
+            opts.radix = radix;
+            opts.radix_bits = bits;
+            auto pairs = ac::hash_join_pairs< int >( build, key, probe, key, opts );
+            std::vector< std::pair< int, int > > got;
+            for ( const auto & m : pairs ) got.emplace_back( m.first->second, m.second->second );
+            std::sort( got.begin(), got.end() );
+            ASSERT_EQ( expected, got );
+        }
+}
+
+// ============================================================================
+// TESTING GROUP-BY AGGREGATION
+// ============================================================================
+
+/// Hash of a (bank, branch) pair.
+struct BranchHash {
+    size_t operator()( const std::pair< int, int > & k ) const {
+        return std::hash< int >()( k.first ) * 31 + std::hash< int >()( k.second );
+    }
+};
+
+TEST_F(HTTest, SubscriptInsertsDefaultOnce)
+{
+    ac::HashTbl< int, int > htable{ 3 };
+    for ( int i{0}; i < 1000; ++i )
+    {
+        int & v = htable[ i % 100 ];   // Misses grow the table; the references stay valid.
+        v += i;
+    }
+    ASSERT_EQ( 100u, htable.size() );
+    for ( int k{0}; k < 100; ++k )
+        ASSERT_EQ( 10 * k + 4500, htable.at( k ) );
+}
+
+TEST_F(HTTest, GroupBalancesByBranch)
+{
+    using Stats = ac::agg::Combine< ac::agg::Sum< float >, ac::agg::Count, ac::agg::Min< float >, ac::agg::Max< float > >;
+    std::vector< Account > accounts( m_accounts.begin(), m_accounts.end() );
+    accounts.push_back( { "Maria Lima", 1, 1668, 99, 20.f } );   // Joins the (1, 1668) branch.
+    auto branch = []( const Account & a ) { return std::make_pair( a.m_bank_code, a.m_branch_code ); };
+    auto balance = []( const Account & a ) { return a.m_balance; };
+
+    ac::GroupBy< std::pair< int, int >, Stats, BranchHash > serial;
+    for ( const auto & a : accounts )
+        serial.update( branch( a ), a.m_balance );
+    auto batched = ac::GroupBy< std::pair< int, int >, Stats, BranchHash >::aggregate( accounts, branch, balance, 3, 2 );
+
+    for ( const auto * g : { &serial, &batched } )
+    {
+        ASSERT_EQ( 7u, g->size() );
+        const auto * ours = g->find( { 1, 1668 } );
+        ASSERT_NE( nullptr, ours );
+        ASSERT_EQ( 2050.f, std::get< 0 >( *ours ) );
+        ASSERT_EQ( 3u, std::get< 1 >( *ours ) );
+        ASSERT_EQ( 20.f, std::get< 2 >( *ours ) );
+        ASSERT_EQ( 1500.f, std::get< 3 >( *ours ) );
+        ASSERT_EQ( nullptr, g->find( { 2, 1668 } ) );
+    }
+}
+
+TEST(GroupByTest, ParallelMatchesSerial)
+{
+    std::vector< std::pair< int, long > > rows;
+    unsigned x{5};
+    for ( int i{0}; i < 100000; ++i )
+    {
+        x = x * 1103515245u + 12345u;
+        int key = ( i / 7 ) % 500;   // Runs of equal keys, as in clustered data.
+        rows.emplace_back( key, long( x >> 8 ) % 2001 - 1000 );
+    }
+    std::map< int, std::array< long, 3 > > expected;   // sum, min, max
+    for ( const auto & r : rows )
+    {
+        auto it = expected.find( r.first );
+        if ( it == expected.end() ) expected[ r.first ] = {{ r.second, r.second, r.second }};
+        else {
+            it->second[0] += r.second;
+            it->second[1] = std::min( it->second[1], r.second );
+            it->second[2] = std::max( it->second[2], r.second );
+        }
+    }
+    auto key = []( const std::pair< int, long > & r ) { return r.first; };
+    auto value = []( const std::pair< int, long > & r ) { return r.second; };
+    for ( size_t threads : { 1, 4 } )
+    {
+        auto sums = ac::GroupBy< int, ac::agg::Sum< long > >::aggregate( rows, key, value, threads, 1000 );
+        auto mins = ac::GroupBy< int, ac::agg::Min< long > >::aggregate( rows, key, value, threads, 1000 );
+        auto maxs = ac::GroupBy< int, ac::agg::Max< long > >::aggregate( rows, key, value, threads, 1000 );
+        auto counts = ac::GroupBy< int, ac::agg::Count >::aggregate( rows, key, value, threads, 0 );   // Morsels of one row.
+        ASSERT_EQ( expected.size(), sums.size() );
+        ASSERT_EQ( expected.size(), counts.size() );
+        for ( const auto & e : expected )
+        {
+            ASSERT_EQ( e.second[0], *sums.find( e.first ) );
+            ASSERT_EQ( e.second[1], *mins.find( e.first ) );
+            ASSERT_EQ( e.second[2], *maxs.find( e.first ) );
+        }
+    }
+}
+
+// ============================================================================
+// TESTING TREEIFIED COLLISION LISTS
+// ============================================================================
+
+TEST_F(HTTest, TreeifiedCollidingAccounts)
+{
+    // KeyHash XORs the key fields, so (name, i, i, 0) hashes the same for every i.
+    ac::HashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > htable;
+    const int n = 2000;
+    for ( int i{0}; i < n; ++i )
+        ASSERT_TRUE( htable.insert( Account::AcctKey( "Mallory", i, i, 0 ), Account( "Mallory", i, i, 0, float( i ) ) ) );
+    ASSERT_EQ( 1u, htable.treeified_buckets() );
+    for ( int i{0}; i < n; ++i )
+        ASSERT_EQ( float( i ), htable.at( Account::AcctKey( "Mallory", i, i, 0 ) ).m_balance );
+    ASSERT_FALSE( htable.insert( Account::AcctKey( "Mallory", 7, 7, 0 ), Account( "Mallory", 7, 7, 0, -1.f ) ) );
+    ASSERT_EQ( -1.f, htable[ Account::AcctKey( "Mallory", 7, 7, 0 ) ].m_balance );
+    ASSERT_EQ( nullptr, htable.find( Account::AcctKey( "Mallory", 7, 7, 1 ) ) );
+
+    auto copy = htable;   // The copy indexes its own lists.
+    for ( int i{0}; i < n; i += 2 )
+        ASSERT_TRUE( htable.erase( Account::AcctKey( "Mallory", i, i, 0 ) ) );
+    ASSERT_EQ( size_t( n / 2 ), htable.size() );
+    Account a;
+    for ( int i{0}; i < n; ++i )
+    {
+        ASSERT_EQ( i % 2 == 1, htable.retrieve( Account::AcctKey( "Mallory", i, i, 0 ), a ) );
+        ASSERT_TRUE( copy.retrieve( Account::AcctKey( "Mallory", i, i, 0 ), a ) );
+    }
+    for ( int i{1}; i < n; i += 2 )
+        ASSERT_TRUE( htable.erase( Account::AcctKey( "Mallory", i, i, 0 ) ) );
+    ASSERT_EQ( 0u, htable.treeified_buckets() );   // Short lists lose their index.
+    ASSERT_EQ( 1u, copy.treeified_buckets() );
+    copy.treeify_threshold( 0 );
+    ASSERT_EQ( 0u, copy.treeified_buckets() );
+    ASSERT_EQ( float( n - 1 ), copy.at( Account::AcctKey( "Mallory", n - 1, n - 1, 0 ) ).m_balance );
+}
+
+/// A key with == but no <.
+struct OpaqueKey {
+    int v;
+    bool operator==( const OpaqueKey & o ) const { return v == o.v; }
+};
+struct OpaqueHash {
+    size_t operator()( const OpaqueKey & k ) const { return size_t( k.v % 3 ); }   // Three hash values in all.
+};
+
+TEST(TreeifyTest, KeysWithoutOrdering)
+{
+    ac::HashTbl< OpaqueKey, int, OpaqueHash > htable{ 1 };
+    for ( int i{0}; i < 300; ++i )
+        ASSERT_TRUE( htable.insert( OpaqueKey{ i }, i ) );
+    ASSERT_GE( htable.treeified_buckets(), 1u );
+    for ( int i{0}; i < 300; ++i )
+        ASSERT_EQ( i, htable.at( OpaqueKey{ i } ) );
+    for ( int i{0}; i < 300; i += 3 )
+        ASSERT_TRUE( htable.erase( OpaqueKey{ i } ) );
+    ASSERT_FALSE( htable.erase( OpaqueKey{ 0 } ) );
+    ASSERT_EQ( 200u, htable.size() );
+    ASSERT_EQ( 299, htable.at( OpaqueKey{ 299 } ) );
+}
+
+/// Equality that ignores case, which std::string's < does not.
+struct CaseInsensitiveEqual {
+    bool operator()( const std::string & a, const std::string & b ) const {
+        return a.size() == b.size() and std::equal( a.begin(), a.end(), b.begin(), []( char x, char y ) {
+            return std::tolower( static_cast< unsigned char >( x ) ) == std::tolower( static_cast< unsigned char >( y ) );
+        } );
+    }
+};
+struct ConstantStringHash {
+    size_t operator()( const std::string & ) const { return 42; }   // Every key in one list.
+};
+
+TEST(TreeifyTest, KeyEqualLooserThanLess)
+{
+    ac::HashTbl< std::string, int, ConstantStringHash, CaseInsensitiveEqual > htable;
+    const std::vector< std::string > keys{ "Alpha", "Bravo", "Charlie", "Delta", "Echo",
+                                           "Foxtrot", "Golf", "Hotel", "India", "Juliett" };
+    for ( size_t i{0}; i < keys.size(); ++i )
+        ASSERT_TRUE( htable.insert( keys[i], int( i ) ) );
+    ASSERT_EQ( 1u, htable.treeified_buckets() );
+    int v;
+    ASSERT_TRUE( htable.retrieve( "alpha", v ) );
+    ASSERT_EQ( 0, v );
+    ASSERT_FALSE( htable.insert( "echo", 40 ) );   // Replaces "Echo".
+    ASSERT_EQ( keys.size(), htable.size() );
+    ASSERT_EQ( 40, htable.at( "ECHO" ) );
+    ASSERT_TRUE( htable.erase( "juliett" ) );
+    ASSERT_FALSE( htable.retrieve( "Juliett", v ) );
+}
+
+// ============================================================================
+// TESTING HUGE PAGES AND NUMA PLACEMENT
+// ============================================================================
+
+TEST_F(HTTest, HugePageAccounts)
+{
+    ac::MemoryPolicy policy;
+    policy.huge_pages = true;
+    policy.numa_node = 0;
+    ac::HashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > htable{ 4, policy };
+    for ( const auto & e : m_accounts )
+        ASSERT_TRUE( htable.insert( e.getKey(), e ) );
+    const int n = 100000;   // Enough for the bucket array to outgrow half a huge page.
+    for ( int i{0}; i < n; ++i )
+        ASSERT_TRUE( htable.insert( Account::AcctKey( "Client", 1, i, 0 ), Account( "Client", 1, i, 0, float( i ) ) ) );
+    for ( int i{0}; i < n; i += 2 )
+        ASSERT_TRUE( htable.erase( Account::AcctKey( "Client", 1, i, 0 ) ) );
+    ASSERT_TRUE( htable.memory_policy() == policy );
+
+    auto copy = htable;   // The copy allocates from an arena of its own.
+    ac::HashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > heap;
+    heap = htable;        // Assignment keeps the heap policy of heap.
+    ASSERT_TRUE( copy.memory_policy() == policy );
+    ASSERT_TRUE( heap.memory_policy().is_default() );
+    htable.clear();
+    Account a;
+    for ( int i{0}; i < n; ++i )
+    {
+        Account::AcctKey key( "Client", 1, i, 0 );
+        ASSERT_EQ( i % 2 == 1, copy.retrieve( key, a ) );
+        ASSERT_EQ( i % 2 == 1, heap.retrieve( key, a ) );
+        ASSERT_FALSE( htable.retrieve( key, a ) );
+    }
+    for ( const auto & e : m_accounts )
+        ASSERT_EQ( e.m_balance, copy.at( e.getKey() ).m_balance );
+}
+
+TEST(PageAllocTest, HugePageSlots)
+{
+    ac::MemoryPolicy policy;
+    policy.huge_pages = true;
+    void * p = ac::page_allocate( 3 * ac::HUGE_PAGE_SIZE + 1, policy );
+    ASSERT_EQ( 0u, reinterpret_cast< std::uintptr_t >( p ) % ac::HUGE_PAGE_SIZE );
+    std::memset( p, 1, 3 * ac::HUGE_PAGE_SIZE + 1 );
+    ac::page_free( p, 3 * ac::HUGE_PAGE_SIZE + 1, policy );
+
+    ac::IntHashTbl< std::uint64_t, int > htable( 1 << 20, std::numeric_limits< std::uint64_t >::max(), policy );
+    for ( int i{0}; i < 500000; ++i )
+        ASSERT_TRUE( htable.insert( std::uint64_t( i ) * 7919, i ) );
+    htable.reserve( 2000000 );   // Rehash into new huge-page slot arrays.
+    for ( int i{0}; i < 500000; ++i )
+        ASSERT_EQ( i, htable.at( std::uint64_t( i ) * 7919 ) );
+    ASSERT_GE( ac::numa::node_count(), 1 );
+}
+
+TEST(ShardedTest, ConcurrentWritersAndNodeRouting)
+{
+    ac::ShardOptions opts;
+    opts.shards = 8;
+    opts.expected = 40000;
+    opts.huge_pages = true;
+    opts.numa = true;
+    ac::ShardedHashTbl< int, int > htable( opts );
+    const int per_thread = 10000;
+    std::vector< std::thread > writers;
+    for ( int t{0}; t < 4; ++t )
+        writers.emplace_back( [&htable, t, per_thread] {
+            for ( int i{0}; i < per_thread; ++i ) htable.insert( t * per_thread + i, i );
+            for ( int i{0}; i < per_thread; i += 2 ) htable.modify( t * per_thread + i, []( int & v ) { v = -v; } );
+        } );
+    for ( auto & w : writers ) w.join();
+    ASSERT_EQ( size_t( 4 * per_thread ), htable.size() );
+    int v;
+    for ( int k{0}; k < 4 * per_thread; ++k )
+    {
+        ASSERT_TRUE( htable.retrieve( k, v ) );
+        ASSERT_EQ( k % 2 == 0 ? -( k % per_thread ) : k % per_thread, v );
+        ASSERT_EQ( htable.node_of_shard( htable.shard_of( k ) ), htable.node_of( k ) );
+    }
+    // Every shard is bound to exactly one node.
+    size_t routed{0};
+    for ( int node{0}; node < ac::numa::node_count(); ++node )
+        for ( auto s : htable.shards_on_node( node ) )
+        {
+            ASSERT_EQ( node, htable.node_of_shard( s ) );
+            routed++;
+        }
+    ASSERT_EQ( htable.shard_count(), routed );
+    ASSERT_TRUE( htable.erase( 7 ) );
+    ASSERT_FALSE( htable.erase( 7 ) );
+    ASSERT_EQ( 0u, htable.count( 7 ) );
+    htable.clear();
+    ASSERT_TRUE( htable.empty() );
+}
+
+// ============================================================================
+// TESTING WORKLOAD GENERATION AND LATENCY HISTOGRAMS
+// ============================================================================
+
+TEST(HdrHistogramTest, PercentilesWithinPrecision)
+{
+    HdrHistogram h;
+    for ( std::uint64_t v{1}; v <= 100000; ++v )
+        h.record( v * 1000 );   // 1 us .. 100 ms, uniformly.
+    ASSERT_EQ( 100000u, h.count() );
+    ASSERT_EQ( 1000u, h.min() );
+    ASSERT_EQ( 100000000u, h.max() );
+    for ( double q : { 50.0, 90.0, 99.0, 99.9 } )
+    {
+        double exact = q / 100 * 100000 * 1000;
+        ASSERT_NEAR( exact, double( h.percentile( q ) ), exact / 256 );
+    }
+    ASSERT_EQ( h.max(), h.percentile( 100 ) );
+
+    HdrHistogram low;
+    low.record( 7, 3 );   // Small values are exact.
+    ASSERT_EQ( 7u, low.percentile( 50 ) );
+    low.merge( h );
+    ASSERT_EQ( 100003u, low.count() );
+    ASSERT_EQ( 7u, low.min() );
+    ASSERT_EQ( h.max(), low.max() );
+}
+
+TEST(WorkloadTest, ZipfSkewAndOperationMix)
+{
+    std::mt19937_64 rng( 1 );
+    ZipfGenerator zipf( 1000, 0.99 ), uniform( 1000, 0 );
+    std::vector< int > hot( 1000 ), flat( 1000 );
+    for ( int i{0}; i < 200000; ++i )
+    {
+        hot[ zipf.next( rng ) ]++;
+        flat[ uniform.next( rng ) ]++;
+    }
+    ASSERT_GT( hot[0], hot[1] );
+    ASSERT_GT( hot[1], hot[100] );
+    ASSERT_GT( hot[0], 200000 / 20 );   // Rank 0 alone takes over 5% of the draws.
+    ASSERT_LT( *std::max_element( flat.begin(), flat.end() ), 2 * 200000 / 1000 );
+    ASSERT_THROW( ZipfGenerator( 10, 1.0 ), std::invalid_argument );
+
+    WorkloadSpec spec;
+    spec.population = 2000;
+    spec.operations = 20000;
+    spec.read = 6; spec.insert = 2; spec.update = 1; spec.erase = 1;
+    spec.hit_ratio = 0.75;
+    auto population = make_population( spec );
+    AccountTable table;
+    for ( const auto & a : population )
+        ASSERT_TRUE( table.insert( a.getKey(), a ) );   // Distinct ids, distinct keys.
+    auto result = run_workload( table, make_operations( spec ) );
+
+    auto count = [&]( OpType t ) { return double( result.latency[ std::size_t( t ) ].count() ); };
+    auto hits = [&]( OpType t ) { return double( result.hits[ std::size_t( t ) ] ); };
+    ASSERT_NEAR( 0.6, count( OpType::read ) / spec.operations, 0.02 );
+    ASSERT_NEAR( 0.2, count( OpType::insert ) / spec.operations, 0.02 );
+    ASSERT_NEAR( 0.75, hits( OpType::read ) / count( OpType::read ), 0.02 );
+    ASSERT_EQ( count( OpType::insert ), hits( OpType::insert ) );
+    ASSERT_EQ( count( OpType::update ), hits( OpType::update ) );   // The population is never erased.
+    ASSERT_EQ( spec.population + hits( OpType::insert ) - hits( OpType::erase ), double( table.size() ) );
+
+    auto json = workload_json( spec, result, "test \"run\"" );
+    ASSERT_NE( std::string::npos, json.find( "\"label\": \"test \\\"run\\\"\"" ) );
+    ASSERT_NE( std::string::npos, json.find( "\"p999_ns\"" ) );
+    const std::string long_label( 1000, 'x' );   // Longer than any fixed buffer would be.
+    json = workload_json( spec, result, long_label + "\\\t" );
+    ASSERT_NE( std::string::npos, json.find( "\"label\": \"" + long_label + "\\\\\\u0009\"," ) );
+    ASSERT_EQ( "}\n", json.substr( json.size() - 2 ) );
+}
+
+// ============================================================================
+// TESTING SHARED-MEMORY TABLE
+// ============================================================================
+
+TEST(ShmTest, SharedAcrossMappingsAndProcesses)
+{
+    using Table = ac::ShmHashTbl< std::uint64_t, double >;
+    const std::string name = "/ac_test_shm_" + std::to_string( ::getpid() );
+    Table::remove( name );
+    {
+        Table writer = Table::create( name, 1000 );
+        ASSERT_TRUE( writer.writable() );
+        for ( std::uint64_t k{0}; k < 1000; ++k )
+            ASSERT_TRUE( writer.insert( k, k * 0.5 ) );
+        ASSERT_FALSE( writer.insert( 10, 99.0 ) );   // Replaced in place.
+        ASSERT_THROW( writer.insert( 1000, 0.0 ), std::length_error );
+        ASSERT_TRUE( writer.erase( 999 ) );
+        ASSERT_TRUE( writer.insert( 1000, 500.0 ) );   // Reuses the erased entry.
+        ASSERT_EQ( 1000u, writer.size() );
+        ASSERT_THROW( Table::create( name, 10 ), std::runtime_error );
+
+        // A second mapping, at another address, sees the same entries.
+        Table reader = Table::open( name );
+        ASSERT_FALSE( reader.writable() );
+        ASSERT_EQ( 1000u, reader.size() );
+        double d;
+        ASSERT_TRUE( reader.retrieve( 10, d ) );
+        ASSERT_EQ( 99.0, d );
+        ASSERT_TRUE( reader.retrieve( 1000, d ) );
+        ASSERT_EQ( 500.0, d );
+        ASSERT_EQ( 0u, reader.count( 999 ) );
+        ASSERT_THROW( reader.insert( 5, 1.0 ), std::logic_error );
+        ASSERT_THROW( ( ac::ShmHashTbl< std::uint32_t, double >::open( name ) ), std::runtime_error );
+
+        // A forked child maps it on its own and checks every entry.
+        pid_t child = ::fork();
+        if ( child == 0 )
+        {
+            Table mine = Table::open( name );
+            double v;
+            for ( std::uint64_t k{0}; k < 999; ++k )
+                if ( not mine.retrieve( k, v ) or v != ( k == 10 ? 99.0 : k * 0.5 ) ) ::_exit( 1 );
+            ::_exit( mine.count( 999 ) == 0 ? 0 : 2 );
+        }
+        int status{-1};
+        ASSERT_EQ( child, ::waitpid( child, &status, 0 ) );
+        ASSERT_TRUE( WIFEXITED( status ) );
+        ASSERT_EQ( 0, WEXITSTATUS( status ) );
+
+        std::size_t visited{0};
+        reader.for_each( [&]( std::uint64_t, double ) { ++visited; } );
+        ASSERT_EQ( 1000u, visited );
+        writer.clear();
+        ASSERT_TRUE( reader.empty() );
+        ASSERT_EQ( 0u, reader.count( 10 ) );
+    }
+    ASSERT_TRUE( Table::remove( name ) );
+    ASSERT_THROW( Table::open( name ), std::runtime_error );
+}
+
+TEST(ShmTest, RecoversFromADeadWriter)
+{
+    using Table = ac::ShmHashTbl< std::uint64_t, double >;
+    const std::string name = "/ac_test_shm_dead_" + std::to_string( ::getpid() );
+    Table::remove( name );
+    Table writer = Table::create( name, 100 );
+    for ( std::uint64_t k{0}; k < 50; ++k )
+        writer.insert( k, double( k ) );
+    // A child dies holding the writer lock: for_each() takes it.
+    auto die_locked = [&]() {
+        pid_t child = ::fork();
+        if ( child == 0 )
+        {
+            Table mine = Table::open( name, true );
+            mine.for_each( []( std::uint64_t, double ) { ::_exit( 0 ); } );
+            ::_exit( 1 );
+        }
+        int status{-1};
+        ::waitpid( child, &status, 0 );
+        return WIFEXITED( status ) and WEXITSTATUS( status ) == 0;
+    };
+    ASSERT_TRUE( die_locked() );
+    ASSERT_TRUE( writer.insert( 50, 50.0 ) );   // Takes the lock over by itself.
+    ASSERT_EQ( 51u, writer.size() );
+    ASSERT_FALSE( writer.recover() );           // Nothing left to recover.
+
+    ASSERT_TRUE( die_locked() );
+    Table reader = Table::open( name );
+    ASSERT_TRUE( reader.recover() );            // Any mapping may recover.
+    ASSERT_FALSE( reader.recover() );
+    double d;
+    ASSERT_TRUE( reader.retrieve( 50, d ) );
+    ASSERT_TRUE( writer.erase( 0 ) );
+    ASSERT_TRUE( writer.insert( 100, 1.0 ) );
+    ASSERT_EQ( 51u, reader.size() );
+    Table::remove( name );
+}
+
+TEST(ShmTest, ReadersNeverSeeTornValues)
+{
+    // Both halves of the value always match; a torn copy would mix two writes.
+    struct Pair { std::uint64_t a, b; };
+    using Table = ac::ShmHashTbl< std::uint32_t, Pair >;
+    const std::string name = "/ac_test_shm_torn_" + std::to_string( ::getpid() );
+    Table::remove( name );
+    Table writer = Table::create( name, 64, 8 );
+    for ( std::uint32_t k{0}; k < 32; ++k )
+        writer.insert( k, Pair{ 0, 0 } );
+    Table reader = Table::open( name );
+
+    std::atomic< bool > done{ false };
+    std::thread churn( [&]() {
+        for ( std::uint64_t v{1}; v <= 20000; ++v )
+        {
+            std::uint32_t k = std::uint32_t( v % 32 );
+            writer.insert( k, Pair{ v, v } );
+            if ( v % 7 == 0 ) { writer.erase( k + 32 ); writer.insert( k + 32, Pair{ v, v } ); }
+        }
+        done = true;
+    } );
+    std::size_t torn{0}, found{0};
+    while ( not done )
+    {
+        Pair p;
+        for ( std::uint32_t k{0}; k < 64; ++k )
+            if ( reader.retrieve( k, p ) ) { ++found; torn += p.a != p.b; }
+    }
+    churn.join();
+    ASSERT_EQ( 0u, torn );
+    ASSERT_GT( found, 0u );
+    ASSERT_GE( reader.read_stats().lookups, found );
+    Table::remove( name );
+}
+
+// ============================================================================
+// TESTING PARALLEL BULK OPERATIONS
+// ============================================================================
+
+TEST_F(HTTest, ParallelBulkOperations)
+{
+    using Key = Account::AcctKey;
+    for ( bool huge : { false, true } )
+    {
+        ac::MemoryPolicy policy;
+        policy.huge_pages = huge;   // Huge pages put the nodes in an arena.
+        ac::HashTbl< Key, Account, KeyHash, KeyEqual > htable( 10, policy );
+        htable.enable_filter();
+        const int n = 20000;
+        for ( int i{0}; i < n; ++i )
+            htable.insert( Key( "Client", 1, i, 0 ), Account( "Client", 1, i, 0, 100.f ) );
+        for ( int i{0}; i < 40; ++i )   // One long, treeified collision list.
+            htable.insert( Key( "Mallory", i, i, 0 ), Account( "Mallory", i, i, 0, 100.f ) );
+        ASSERT_EQ( 1u, htable.treeified_buckets() );
+
+        // Interest on every balance, with small morsels so the four workers interleave.
+        htable.parallel_for_each( []( const Key &, Account & a ) { a.m_balance *= 1.5f; }, 4, 64 );
+        double total = htable.parallel_reduce( 0.0, []( const decltype( htable )::entry_type & e ) { return double( e.m_data.m_balance ); },
+                                               []( double a, double b ) { return a + b; }, 4, 64 );
+        ASSERT_DOUBLE_EQ( 150.0 * ( n + 40 ), total );
+
+        // Purge the odd branches and half of the colliding accounts.
+        auto erased = htable.erase_if( []( const Key & k, const Account & ) { return std::get<2>( k ) % 2 == 1; }, 4, 64 );
+        ASSERT_EQ( size_t( n / 2 + 20 ), erased );
+        ASSERT_EQ( size_t( n / 2 + 20 ), htable.size() );
+        ASSERT_EQ( 1u, htable.treeified_buckets() );   // 20 entries left: the index was rebuilt.
+        Account a;
+        for ( int i{0}; i < n; ++i )
+            ASSERT_EQ( i % 2 == 0, htable.retrieve( Key( "Client", 1, i, 0 ), a ) );
+        for ( int i{0}; i < 40; ++i )
+            ASSERT_EQ( i % 2 == 0, htable.retrieve( Key( "Mallory", i, i, 0 ), a ) );
+        ASSERT_EQ( size_t( n / 2 + 20 ), htable.parallel_reduce( size_t( 0 ), []( const decltype( htable )::entry_type & ) { return size_t( 1 ); },
+                                                                 []( size_t x, size_t y ) { return x + y; } ) );
+
+        ASSERT_EQ( 20u, htable.erase_if( []( const Key & k, const Account & ) { return std::get<0>( k ) == "Mallory"; } ) );
+        ASSERT_EQ( 0u, htable.treeified_buckets() );
+        ASSERT_EQ( 0u, htable.erase_if( []( const Key &, const Account & ) { return false; } ) );
+        ASSERT_TRUE( htable.insert( Key( "Client", 1, 1, 0 ), Account( "Client", 1, 1, 0, 1.f ) ) );   // Erased keys are gone for good.
+        ASSERT_EQ( size_t( n / 2 + 1 ), htable.size() );
+    }
+}
+
+TEST_F(HTTest, ThrowingEraseIfKeepsTheCount)
+{
+    using Key = Account::AcctKey;
+    ac::HashTbl< Key, Account, KeyHash, KeyEqual > htable( 10 );
+    const int n = 20000;
+    for ( int i{0}; i < n; ++i )
+        htable.insert( Key( "Client", 1, i, 0 ), Account( "Client", 1, i, 0, 100.f ) );
+
+    // Erase the odd branches, but give up at one of them: the others erased so far stay erased.
+    ASSERT_THROW( htable.erase_if( []( const Key & k, const Account & ) {
+        if ( std::get<2>( k ) == 7777 ) throw std::runtime_error( "stop" );
+        return std::get<2>( k ) % 2 == 1;
+    }, 4, 64 ), std::runtime_error );
+    auto left = htable.parallel_reduce( size_t( 0 ), []( const decltype( htable )::entry_type & ) { return size_t( 1 ); },
+                                        []( size_t x, size_t y ) { return x + y; } );
+    ASSERT_EQ( left, htable.size() );
+    ASSERT_LT( size_t( n / 2 ), left );
+    Account a;
+    ASSERT_TRUE( htable.retrieve( Key( "Client", 1, 7777, 0 ), a ) );
+    for ( int i{0}; i < n; i += 2 )
+        ASSERT_TRUE( htable.retrieve( Key( "Client", 1, i, 0 ), a ) );
+
+    ASSERT_EQ( left - n / 2, htable.erase_if( []( const Key & k, const Account & ) { return std::get<2>( k ) % 2 == 1; } ) );
+    ASSERT_EQ( size_t( n / 2 ), htable.size() );
+}
+
+// ============================================================================
+// TESTING DISK-BACKED TABLE
+// ============================================================================
+
+TEST(DiskTest, SplitsEvictsAndReopens)
+{
+    using Table = ac::DiskHashTbl< std::uint64_t, AccountRecord >;
+    const std::string path = "/tmp/ac_test_disk_" + std::to_string( ::getpid() ) + ".tbl";
+    const std::uint64_t n = 20000;
+    auto record = []( int number, float balance ) {
+        AccountRecord r{};
+        r.m_number = number;
+        r.m_balance = balance;
+        return r;
+    };
+    {
+        Table table( path, 8, true );   // 8 pages of cache for a table of hundreds.
+        for ( std::uint64_t k{0}; k < n; ++k )
+            ASSERT_TRUE( table.insert( k, record( int( k ), float( k ) ) ) );
+        ASSERT_FALSE( table.insert( 7, record( 7, -1.f ) ) );   // Replaced.
+        ASSERT_EQ( n, table.size() );
+        ASSERT_GT( table.page_count(), n / Table::slots_per_page() );
+        ASSERT_GT( table.global_depth(), 0u );
+        ASSERT_GT( table.pool_stats().evictions, 0u );
+
+        table.reset_pool_stats();
+        AccountRecord r;
+        for ( std::uint64_t k{0}; k < n; ++k )
+        {
+            ASSERT_TRUE( table.retrieve( k, r ) );
+            ASSERT_EQ( k == 7 ? -1.f : float( k ), r.m_balance );
+        }
+        ASSERT_GT( table.pool_stats().misses, 0u );   // The table does not fit in the pool.
+        ASSERT_FALSE( table.retrieve( n, r ) );
+        for ( std::uint64_t k{0}; k < n; k += 2 )
+            ASSERT_TRUE( table.erase( k ) );
+        ASSERT_FALSE( table.erase( 0 ) );
+        ASSERT_EQ( n / 2, table.size() );
+    }
+    {
+        Table table( path, 16 );   // The directory is rebuilt from the pages.
+        ASSERT_EQ( n / 2, table.size() );
+        AccountRecord r;
+        for ( std::uint64_t k{0}; k < n; ++k )
+            ASSERT_EQ( k % 2 == 1, table.retrieve( k, r ) );
+        ASSERT_TRUE( table.retrieve( 7, r ) );
+        ASSERT_EQ( -1.f, r.m_balance );
+        ASSERT_TRUE( table.insert( 0, record( 0, 0.f ) ) );
+    }
+    ASSERT_THROW( ( ac::DiskHashTbl< std::uint32_t, AccountRecord >( path ) ), std::runtime_error );
+    ASSERT_THROW( Table( "/nonexistent/dir/table" ), std::runtime_error );
+    ::unlink( path.c_str() );
+}
+
+TEST(DiskTest, CollidingKeysUseOverflowPages)
+{
+    using Table = ac::DiskHashTbl< std::uint64_t, std::uint64_t, ConstantHash >;
+    const std::string path = "/tmp/ac_test_disk_collide_" + std::to_string( ::getpid() ) + ".tbl";
+    {
+        Table table( path, 4, true );
+        const std::uint64_t n = 3 * Table::slots_per_page();
+        for ( std::uint64_t k{0}; k < n; ++k )
+            ASSERT_TRUE( table.insert( k, k * k ) );
+        ASSERT_EQ( 0u, table.global_depth() );   // No split could separate the keys.
+        ASSERT_EQ( 4u, table.page_count() );     // Header, bucket and two overflow pages.
+        std::uint64_t v;
+        for ( std::uint64_t k{0}; k < n; ++k )
+        {
+            ASSERT_TRUE( table.retrieve( k, v ) );
+            ASSERT_EQ( k * k, v );
+        }
+        ASSERT_TRUE( table.erase( 1 ) );
+        ASSERT_TRUE( table.insert( n, 0 ) );   // Into the freed slot.
+        ASSERT_EQ( 4u, table.page_count() );
+    }
+    ::unlink( path.c_str() );
+}
+
+// ============================================================================
+// TESTING CONSISTENT HASHING AND PARTITION SERVERS
+// ============================================================================
+
+TEST(HashRingTest, BalancedAndMinimalMovement)
+{
+    ac::HashRing ring( 128 );
+    for ( std::size_t p{0}; p < 4; ++p )
+        ring.add( p );
+    ASSERT_THROW( ring.add( 2 ), std::invalid_argument );
+    const std::size_t n = 100000;
+    std::vector< std::size_t > owner( n ), load( 5 );
+    for ( std::size_t h{0}; h < n; ++h )
+        load[ owner[h] = ring.owner( h ) ]++;
+    for ( std::size_t p{0}; p < 4; ++p )
+        ASSERT_NEAR( double( n / 4 ), double( load[p] ), n / 4 * 0.25 );
+
+    ring.add( 4 );
+    std::size_t moved{0};
+    for ( std::size_t h{0}; h < n; ++h )
+    {
+        auto now = ring.owner( h );
+        if ( now != owner[h] )
+        {
+            ASSERT_EQ( 4u, now );   // Keys only move to the new partition.
+            ++moved;
+        }
+        if ( h % 1000 == 0 )
+        {
+            // The arcs of a partition cover its keys.
+            auto pos = ac::HashRing::position( h );
+            bool in_arc{false};
+            for ( const auto & r : ring.ranges_of( now ) )
+                in_arc = in_arc or ( pos >= r.first and pos <= r.second );
+            ASSERT_TRUE( in_arc );
+        }
+    }
+    ASSERT_NEAR( double( n / 5 ), double( moved ), n / 5 * 0.25 );
+    ring.remove( 4 );
+    for ( std::size_t h{0}; h < n; h += 7 )
+        ASSERT_EQ( owner[h], ring.owner( h ) );
+}
+
+TEST(PartitionTest, ServesAndRebalancesOverSockets)
+{
+    using Server = ac::PartitionServer< Account::AcctKey, Account, KeyHash, KeyEqual >;
+    using Front = ac::PartitionedHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual >;
+    std::vector< pid_t > children;
+    auto spawn = [&]( const std::string & path, size_t chunk_bytes ) {
+        pid_t pid = ::fork();
+        if ( pid == 0 )
+        {
+            try { Server server( path, 1024, chunk_bytes ); server.run(); }
+            catch ( ... ) { ::_exit( 1 ); }
+            ::_exit( 0 );
+        }
+        children.push_back( pid );
+    };
+    const std::string base = "/tmp/ac_test_part_" + std::to_string( ::getpid() ) + "_";
+    spawn( base + "0", 4096 );   // Copies of its entries go out in several frames.
+    spawn( base + "1", 1u << 20 );
+
+    Front front( 64 );
+    ASSERT_EQ( 0u, front.add_partition( base + "0" ) );
+    ASSERT_EQ( 0u, front.add_partition( base + "1" ) );   // Its keys would come from partition 0, which has none.
+    const int n = 3000;
+    std::vector< Front::Request > batch;
+    for ( int i{0}; i < n; ++i )
+    {
+        Account a( "Client " + std::to_string( i ), 1, i % 100, i, float( i ) );
+        batch.push_back( Front::Request{ ac::PartitionOp::insert, a.getKey(), a, false } );
+    }
+    front.execute( batch );
+    for ( const auto & r : batch )
+        ASSERT_TRUE( r.m_ok );
+    ASSERT_EQ( size_t( n ), front.size() );
+    ASSERT_GT( front.partition_size( 0 ), 0u );
+    ASSERT_GT( front.partition_size( 1 ), 0u );
+
+    // A third partition takes over about a third of the keys, and only those.
+    spawn( base + "2", 1u << 20 );
+    auto moved = front.add_partition( base + "2" );
+    ASSERT_EQ( moved, front.partition_size( 2 ) );
+    ASSERT_NEAR( n / 3.0, double( moved ), n / 3.0 * 0.3 );
+    ASSERT_EQ( size_t( n ), front.size() );
+    size_t owned_by_new{0};
+    for ( auto & r : batch )
+    {
+        owned_by_new += front.partition_of( r.m_key ) == 2;
+        r.m_op = ac::PartitionOp::retrieve;
+        r.m_data = Account();
+    }
+    ASSERT_EQ( owned_by_new, moved );
+    front.execute( batch );
+    for ( int i{0}; i < n; ++i )
+    {
+        ASSERT_TRUE( batch[i].m_ok );
+        ASSERT_EQ( float( i ), batch[i].m_data.m_balance );
+    }
+
+    Account a;
+    ASSERT_FALSE( front.insert( batch[5].m_key, Account( "Client 5", 1, 5, 5, -5.f ) ) );
+    ASSERT_TRUE( front.retrieve( batch[5].m_key, a ) );
+    ASSERT_EQ( -5.f, a.m_balance );
+    ASSERT_TRUE( front.erase( batch[5].m_key ) );
+    ASSERT_FALSE( front.retrieve( batch[5].m_key, a ) );
+    ASSERT_EQ( size_t( n - 1 ), front.size() );
+
+    // A frame length over the limit gets the client disconnected, not the server killed.
+    int raw = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+    auto addr = ac::detail::socket_address( base + "0" );
+    ASSERT_EQ( 0, ::connect( raw, reinterpret_cast< sockaddr * >( &addr ), sizeof( addr ) ) );
+    const char bogus[] = { '\xf0', '\xff', '\xff', '\xff', char( ac::detail::FrameKind::size ) };
+    ASSERT_EQ( ssize_t( sizeof( bogus ) ), ::write( raw, bogus, sizeof( bogus ) ) );
+    char byte;
+    ASSERT_GE( 0, ::read( raw, &byte, 1 ) );   // End of file, or a reset: the kind byte went unread.
+    ::close( raw );
+    ASSERT_EQ( size_t( n - 1 ), front.size() );
+
+    front.shutdown();
+    ASSERT_EQ( 0u, front.partitions() );
+    for ( pid_t c : children )
+    {
+        int status{-1};
+        ASSERT_EQ( c, ::waitpid( c, &status, 0 ) );
+        ASSERT_TRUE( WIFEXITED( status ) );
+        ASSERT_EQ( 0, WEXITSTATUS( status ) );
+    }
+}
+
+// ============================================================================
+// TESTING WRITE BUFFER
+// ============================================================================
+
+TEST(WriteBufferTest, TombstonesUpdatesAndMerges)
+{
+    ac::BufferedHashTbl< int, int > table{ 64, 7 };
+    for ( int i{0}; i < 1000; ++i )
+        table.insert( i, i );
+    for ( int i{0}; i < 1000; i += 2 )
+        table.insert( i, -i );      // Updates: buffered in place, or over merged entries.
+    for ( int i{0}; i < 1000; i += 5 )
+        table.erase( i );           // Tombstones hide merged entries until they are merged too.
+    int v;
+    for ( int i{0}; i < 1000; ++i )
+    {
+        if ( i % 5 == 0 )
+            ASSERT_FALSE( table.retrieve( i, v ) );
+        else
+        {
+            ASSERT_TRUE( table.retrieve( i, v ) );
+            ASSERT_EQ( i % 2 == 0 ? -i : i, v );
+        }
+    }
+    ASSERT_GT( table.stats().merges, 0u );
+    ASSERT_EQ( 800u, table.size() );
+    ASSERT_EQ( 0u, table.pending() );
+    ASSERT_EQ( 0u, table.count( 5 ) );
+    ASSERT_EQ( 1u, table.count( 7 ) );
+
+    table.insert( 5, 55 );
+    table.erase( 7 );
+    ASSERT_EQ( 2u, table.pending() );
+    ASSERT_TRUE( table.retrieve( 5, v ) );
+    ASSERT_EQ( 55, v );
+    ASSERT_EQ( 0u, table.count( 7 ) );
+    ASSERT_EQ( 800u, table.size() );
+
+    table.insert( 2000, 1 );
+    table.clear();
+    ASSERT_EQ( 0u, table.count( 2000 ) );
+    ASSERT_TRUE( table.empty() );
+}
+
+TEST(WriteBufferTest, ReadersSeeEveryWriteDuringMerges)
+{
+    ac::BufferedHashTbl< int, int > table{ 256 };
+    const int n = 20000;
+    std::atomic< int > written{ 0 };
+    std::atomic< bool > done{ false };
+    std::vector< std::thread > readers;
+    for ( int t{0}; t < 2; ++t )
+        readers.emplace_back( [&, t]() {
+            unsigned x = t + 1;
+            int v;
+            while ( not done.load() )
+            {
+                int w = written.load();
+                if ( w == 0 ) continue;
+                x = x * 1103515245u + 12345u;
+                int key = int( x % unsigned( w ) );
+                ASSERT_TRUE( table.retrieve( key, v ) );    // Buffered, being merged or merged: never lost.
+                ASSERT_EQ( key * 3, v );
+            }
+        } );
+    for ( int i{0}; i < n; ++i )
+    {
+        table.insert( i, i * 3 );
+        written.store( i + 1 );
+    }
+    done.store( true );
+    for ( auto & r : readers ) r.join();
+    ASSERT_EQ( size_t( n ), table.size() );
+    auto stats = table.stats();
+    ASSERT_GE( stats.merges, size_t( n / 256 ) );
+    ASSERT_EQ( size_t( n ), stats.merged );
+}
+
+// ============================================================================
+// TESTING SECONDARY INDEXES
+// ============================================================================
+
+TEST(IndexTest, BranchQueriesFollowEveryWrite)
+{
+    using Table = ac::IndexedHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual >;
+    using Branch = std::pair< int, int >;
+    Table table( 16 );
+    for ( int i{0}; i < 500; ++i )
+    {
+        Account a( "Client " + std::to_string( i ), 1 + i % 2, i % 10, i, float( i ) );
+        table.insert( a.getKey(), a );
+    }
+    // Built from the stored elements; kept up to date from here on (through rehashes too).
+    const auto & branches = table.add_index< Branch, BranchHash >(
+        []( const Account & a ) { return Branch( a.m_bank_code, a.m_branch_code ); } );
+    const auto & banks = table.add_index< int >( []( const Account & a ) { return a.m_bank_code; } );
+    ASSERT_EQ( 2u, table.index_count() );
+    ASSERT_EQ( 10u, branches.keys() );
+    ASSERT_EQ( 50u, branches.count( Branch( 1, 4 ) ) );
+    ASSERT_EQ( 0u, branches.count( Branch( 2, 4 ) ) );
+    ASSERT_EQ( 250u, banks.count( 2 ) );
+    for ( const Account * a : branches.find( Branch( 2, 7 ) ) )
+    {
+        ASSERT_EQ( 7, a->m_number % 10 );
+        ASSERT_EQ( a, table.find( a->getKey() ) );   // Handles point into the table: no copies.
+    }
+
+    for ( int i{500}; i < 2000; ++i )
+    {
+        Account a( "Client " + std::to_string( i ), 1 + i % 2, i % 10, i, float( i ) );
+        ASSERT_TRUE( table.insert( a.getKey(), a ) );
+    }
+    ASSERT_EQ( 200u, branches.count( Branch( 1, 4 ) ) );
+
+    // Updates move elements between posting lists.
+    Account moved( "Client 4", 1, 4, 4, 4.f );
+    auto moved_key = moved.getKey();
+    moved.m_branch_code = 99;
+    ASSERT_FALSE( table.insert( moved_key, moved ) );
+    ASSERT_TRUE( table.modify( Account( "Client 14", 1, 4, 14 ).getKey(),
+                               []( Account & a ) { a.m_branch_code = 99; } ) );
+    Account added( "Client X", 3, 99, 1, 0.f );
+    table[ added.getKey() ] = added;
+    ASSERT_EQ( 198u, branches.count( Branch( 1, 4 ) ) );
+    ASSERT_EQ( 2u, branches.count( Branch( 1, 99 ) ) );
+    ASSERT_EQ( 1u, branches.count( Branch( 3, 99 ) ) );
+    ASSERT_EQ( 1000u, banks.count( 1 ) );
+    ASSERT_EQ( 1u, banks.count( 3 ) );
+    ASSERT_EQ( 3, table[ added.getKey() ].get().m_bank_code );
+
+    ASSERT_TRUE( table.erase( added.getKey() ) );
+    ASSERT_FALSE( table.erase( added.getKey() ) );
+    ASSERT_EQ( 0u, branches.count( Branch( 3, 99 ) ) );
+    ASSERT_EQ( 11u, branches.keys() );
+
+    // Every posting list matches a scan of the table.
+    std::map< Branch, size_t > scanned;
+    table.table().for_each( [&]( const Table::table_type::entry_type & e ) {
+        scanned[ Branch( e.m_data.m_bank_code, e.m_data.m_branch_code ) ]++;
+    } );
+    ASSERT_EQ( scanned.size(), branches.keys() );
+    for ( const auto & b : scanned )
+        ASSERT_EQ( b.second, branches.count( b.first ) );
+
+    table.clear();
+    ASSERT_TRUE( table.empty() );
+    ASSERT_EQ( 0u, branches.keys() );
+    ASSERT_EQ( 0u, banks.count( 1 ) );
+}
+
+// ============================================================================
+// TESTING TABLE DIFF AND MERGE
+// ============================================================================
+
+TEST(DiffTest, ReplicatesAccountChanges)
+{
+    using Table = ac::HashTbl< Account::AcctKey, Account, KeyHash, KeyEqual >;
+    Table primary( 1000 ), standby( 30011 );     // Digests do not depend on the table sizes.
+    const int n = 20000;
+    for ( int i{0}; i < n; ++i )
+    {
+        Account a( "Client " + std::to_string( i ), 1, i % 50, i, float( i ) );
+        primary.insert( a.getKey(), a );
+        standby.insert( a.getKey(), a );
+    }
+    ac::DiffStats stats;
+    ASSERT_TRUE( ac::diff( standby, primary, ac::DiffOptions{}, &stats ).empty() );
+    ASSERT_EQ( 0u, stats.differing_leaves );
+    ASSERT_EQ( 0u, stats.compared );
+    ASSERT_EQ( ac::digest( primary, 8 ).root(), ac::digest( standby, 8 ).root() );
+
+    // 0.3% of the primary changes: updates, inserts and erases.
+    for ( int i{0}; i < n; i += 1000 )
+    {
+        Account a( "Client " + std::to_string( i ), 1, i % 50, i, -1.f );
+        primary.insert( a.getKey(), a );
+        Account b( "New " + std::to_string( i ), 2, 0, i, 0.f );
+        primary.insert( b.getKey(), b );
+        primary.erase( Account( "Client " + std::to_string( i + 1 ), 1, ( i + 1 ) % 50, i + 1 ).getKey() );
+    }
+    auto changes = ac::diff( standby, primary, ac::DiffOptions{}, &stats );
+    ASSERT_EQ( 40u, changes.m_upserts.size() );
+    ASSERT_EQ( 20u, changes.m_erases.size() );
+    ASSERT_LE( stats.differing_leaves, 60u );
+    ASSERT_LT( stats.compared, size_t( n / 20 ) );   // Only the entries of the changed ranges.
+
+    // Shipped encoded, applied on the standby.
+    std::string wire;
+    changes.encode( wire );
+    ac::ChangeSet< Account::AcctKey, Account > received;
+    const char * p = wire.data();
+    ASSERT_TRUE( received.decode( p, wire.data() + wire.size() ) );
+    ASSERT_EQ( wire.data() + wire.size(), p );
+    p = wire.data();
+    ac::ChangeSet< Account::AcctKey, Account > truncated;
+    ASSERT_FALSE( truncated.decode( p, wire.data() + wire.size() / 2 ) );
+    ASSERT_EQ( 60u, ac::apply( standby, received ) );
+    ASSERT_EQ( primary.size(), standby.size() );
+    ASSERT_EQ( ac::digest( primary, 10 ), ac::digest( standby, 10 ) );
+    ASSERT_TRUE( ac::diff( standby, primary ).empty() );
+}
+
+TEST(DiffTest, MergePolicies)
+{
+    ac::HashTbl< int, int > from{ { 1, 10 }, { 2, 20 }, { 3, 30 } };
+    auto reset = []( ac::HashTbl< int, int > & t ) { t = { { 2, 0 }, { 3, 30 }, { 4, 40 } }; };
+    ac::HashTbl< int, int > into;
+    int v;
+
+    reset( into );
+    ASSERT_EQ( 2u, ac::merge( into, from ) );   // overwrite: 1 added, 2 updated, 4 kept.
+    ASSERT_EQ( 4u, into.size() );
+    ASSERT_TRUE( into.retrieve( 2, v ) );
+    ASSERT_EQ( 20, v );
+
+    reset( into );
+    ASSERT_EQ( 1u, ac::merge( into, from, ac::MergePolicy::keep_existing ) );
+    ASSERT_TRUE( into.retrieve( 2, v ) );
+    ASSERT_EQ( 0, v );
+    ASSERT_NE( nullptr, into.find( 1 ) );
+
+    reset( into );
+    ASSERT_EQ( 3u, ac::merge( into, from, ac::MergePolicy::mirror ) );
+    ASSERT_EQ( 3u, into.size() );
+    ASSERT_EQ( nullptr, into.find( 4 ) );
+    ASSERT_EQ( ac::digest( from, 4 ), ac::digest( into, 4 ) );
+    ASSERT_THROW( ac::digest( from, 4 ).differing( ac::digest( from, 5 ) ), std::invalid_argument );
+}
+
+TEST(DiffTest, SyncsFromTheReplicaDigest)
+{
+    using Table = ac::DigestedHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual >;
+    const unsigned bits = ac::TableDigest::bits_for( 10000 );
+    Table primary( bits ), standby( bits, 30011 );
+    for ( int i{0}; i < 10000; ++i )
+    {
+        Account a( "Client " + std::to_string( i ), 1, i % 50, i, float( i ) );
+        primary.insert( a.getKey(), a );
+        standby.insert( a.getKey(), a );
+    }
+    for ( int i{0}; i < 10000; i += 500 )
+    {
+        Account a( "Client " + std::to_string( i ), 1, i % 50, i, -1.f );
+        ASSERT_FALSE( primary.insert( a.getKey(), a ) );
+        Account b( "New " + std::to_string( i ), 2, 0, i, 0.f );
+        ASSERT_TRUE( primary.insert( b.getKey(), b ) );
+        ASSERT_TRUE( primary.erase( Account( "Client " + std::to_string( i + 1 ), 1, ( i + 1 ) % 50, i + 1 ).getKey() ) );
+    }
+    ASSERT_EQ( ac::digest( primary.table(), bits ), primary.digest() );   // Kept up to date, not recomputed.
+    ASSERT_EQ( 60u, ac::diff( standby, primary ).size() );
+
+    // The standby sends its digest; the primary answers with the entries of the differing leaves.
+    std::string wire;
+    standby.digest().encode( wire );
+    ac::TableDigest remote( 0 );
+    const char * p = wire.data();
+    ASSERT_TRUE( remote.decode( p, wire.data() + wire.size() ) );
+    ASSERT_EQ( wire.data() + wire.size(), p );
+    ASSERT_EQ( standby.digest(), remote );
+    p = wire.data();
+    ASSERT_FALSE( remote.decode( p, wire.data() + wire.size() - 1 ) );
+    p = wire.data();
+    remote.decode( p, wire.data() + wire.size() );
+
+    ac::DiffStats stats;
+    auto changes = ac::changes_for( primary, remote, ac::DiffOptions{}, &stats );
+    ASSERT_LE( changes.m_leaves.size(), 60u );
+    ASSERT_EQ( stats.differing_leaves, changes.m_leaves.size() );
+    ASSERT_TRUE( changes.m_erases.empty() );
+    wire.clear();
+    changes.encode( wire );
+    ac::ChangeSet< Account::AcctKey, Account > received;
+    p = wire.data();
+    ASSERT_TRUE( received.decode( p, wire.data() + wire.size() ) );
+    ASSERT_EQ( changes.m_leaves, received.m_leaves );
+
+    auto plain = standby.table();
+    ac::apply( standby, received );
+    ASSERT_EQ( primary.digest(), standby.digest() );
+    ASSERT_EQ( primary.size(), standby.size() );
+    ASSERT_TRUE( ac::diff( standby, primary ).empty() );
+    ac::apply( plain, received );   // A plain HashTbl: mirror erases the keys the leaves lost.
+    ASSERT_EQ( primary.size(), plain.size() );
+    ASSERT_EQ( primary.digest(), ac::digest( plain, bits ) );
+    ASSERT_TRUE( ac::changes_for( primary, standby.digest() ).empty() );
+}
+
+// ============================================================================
+// TESTING LAZY CLEAR
+// ============================================================================
+
+TEST_F(HTTest, LazyClearAccounts)
+{
+    ac::HashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > htable{ 7 };
+    htable.lazy_clear( true );
+    ASSERT_TRUE( htable.lazy_clear() );
+    Account a;
+    for ( int round{0}; round < 3; ++round )
+    {
+        for ( const auto & e : m_accounts )
+            ASSERT_TRUE( htable.insert( e.getKey(), e ) );   // Stale lists read as empty.
+        for ( int i{0}; i < 1000; ++i )
+            ASSERT_TRUE( htable.insert( Account::AcctKey( "Client", 1, i, round ), Account( "Client", 1, i, round, float( i ) ) ) );
+        ASSERT_EQ( m_accounts.size() + 1000, htable.size() );
+        if ( round == 1 )
+        {
+            auto copy = htable;
+            ASSERT_EQ( htable.size(), copy.size() );
+        }
+        htable.clear();
+        ASSERT_TRUE( htable.empty() );
+        ASSERT_EQ( 0u, htable.count( m_accounts[0].getKey() ) );
+        ASSERT_FALSE( htable.retrieve( Account::AcctKey( "Client", 1, 0, round ), a ) );
+        std::size_t seen{0};
+        htable.for_each( [&seen]( const decltype( htable )::entry_type & ) { ++seen; } );
+        ASSERT_EQ( 0u, seen );
+    }
+    htable.insert( m_accounts[0].getKey(), m_accounts[0] );
+    htable.lazy_clear( false );   // Empties the stale lists.
+    ASSERT_EQ( 1u, htable.size() );
+    ASSERT_EQ( 1u, htable.count( m_accounts[0].getKey() ) );
+}
+
+TEST(LazyClearTest, ArenaReuseAcrossGenerations)
+{
+    ac::MemoryPolicy policy;
+    policy.huge_pages = true;
+    for ( bool lazy : { false, true } )
+    {
+        ac::HashTbl< std::uint64_t, std::uint64_t > htable{ 4, policy };
+        htable.lazy_clear( lazy );
+        for ( std::uint64_t round{0}; round < 4; ++round )
+        {
+            for ( std::uint64_t i{0}; i < 50000; ++i )
+                htable.insert( i * 7 + round, i );
+            for ( std::uint64_t i{0}; i < 50000; i += 2 )
+                ASSERT_TRUE( htable.erase( i * 7 + round ) );
+            ASSERT_EQ( 25000u, htable.size() );
+            std::uint64_t d;
+            for ( std::uint64_t i{0}; i < 50000; ++i )
+                ASSERT_EQ( i % 2 == 1, htable.retrieve( i * 7 + round, d ) );
+            ac::HashTbl< std::uint64_t, std::uint64_t > heap;
+            heap = htable;
+            ASSERT_EQ( 25000u, heap.size() );
+            htable.clear();
+            ASSERT_FALSE( htable.retrieve( 7 + round, d ) );
+            htable.insert( 1, 1 );
+            htable.reserve( 100000 );   // A rehash right after a clear.
+            ASSERT_EQ( 1u, htable.size() );
+            htable.clear();
+        }
+    }
+}
+
+// ============================================================================
+// TESTING COMPRESSED VALUES
+// ============================================================================
+
+TEST(CompressedTest, ColumnRoundTrips)
+{
+    ac::StringPool dict;
+    std::vector< long long > ints{ -5, 3, 1LL << 40, -( 1LL << 62 ), 0, std::numeric_limits< long long >::max() };
+    std::string out;
+    ac::BlockCodec< long long >::encode( out, ints, dict );
+    std::vector< long long > ints_back( ints.size() );
+    const char * p = out.data();
+    ASSERT_TRUE( ac::BlockCodec< long long >::decode( p, p + out.size(), ints_back, dict ) );
+    ASSERT_EQ( ints, ints_back );
+    ASSERT_EQ( out.data() + out.size(), p );
+
+    std::vector< std::string > names{ "Bob", "Alice", "Bob", "", "Alicia", "Bob" };
+    out.clear();
+    ac::BlockCodec< std::string >::encode( out, names, dict );
+    ASSERT_EQ( 4u, dict.size() );   // Each distinct name is stored once.
+    std::vector< std::string > names_back( names.size() );
+    p = out.data();
+    ASSERT_TRUE( ac::BlockCodec< std::string >::decode( p, p + out.size(), names_back, dict ) );
+    ASSERT_EQ( names, names_back );
+    p = out.data();
+    ASSERT_FALSE( ac::BlockCodec< std::string >::decode( p, p + out.size() - 1, names_back, dict ) );
+
+    // Codes of 11 bits, bit-packed from the block minimum: the minimum (a 2-byte varint),
+    // the width (1 byte), then 11 bits a value.
+    std::vector< int > codes;
+    for ( int i{0}; i < 100; ++i ) codes.push_back( 1000 + i * 13 );
+    out.clear();
+    ac::BlockCodec< int >::encode( out, codes, dict );
+    ASSERT_EQ( 3u + ( 100 * 11 + 7 ) / 8, out.size() );
+}
+
+TEST_F(HTTest, CompressedAccounts)
+{
+    // Blocks of 8 accounts, 2 of them decompressed at a time: nearly every access loads a block.
+    ac::CompressedHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > htable{ 8, 2 };
+    for ( const auto & e : m_accounts )
+        ASSERT_TRUE( htable.insert( e.getKey(), e ) );
+    const int n = 2000;
+    for ( int i{0}; i < n; ++i )
+        ASSERT_TRUE( htable.insert( Account::AcctKey( "Client", 1, i % 7, i ), Account( "Client", 1, i % 7, i, float( i ) ) ) );
+    ASSERT_FALSE( htable.insert( m_accounts[0].getKey(), m_accounts[1] ) );   // Overwrites.
+    ASSERT_EQ( m_accounts[1].m_balance, htable.at( m_accounts[0].getKey() ).m_balance );
+    htable.insert( m_accounts[0].getKey(), m_accounts[0] );   // Back to its own data.
+    for ( int i{0}; i < n; i += 2 )
+        ASSERT_TRUE( htable.erase( Account::AcctKey( "Client", 1, i % 7, i ) ) );
+    ASSERT_TRUE( htable.modify( Account::AcctKey( "Client", 1, 1 % 7, 1 ), []( Account & a ) { a.m_balance += 0.5f; } ) );
+    auto blocks = htable.block_count();
+    for ( int i{0}; i < n; i += 2 )   // Into the slots the erases freed.
+        ASSERT_TRUE( htable.insert( Account::AcctKey( "Client", 1, i % 7, i ), Account( "Client", 2, i % 7, i, float( -i ) ) ) );
+    ASSERT_LE( htable.block_count(), blocks + 2 );
+    ASSERT_EQ( m_accounts.size() + n, htable.size() );
+
+    htable.flush();
+    Account a;
+    for ( const auto & e : m_accounts )
+    {
+        ASSERT_TRUE( htable.retrieve( e.getKey(), a ) );
+        ASSERT_EQ( e.m_name, a.m_name );
+        ASSERT_EQ( e.m_number, a.m_number );
+        ASSERT_EQ( e.m_balance, a.m_balance );
+    }
+    for ( int i{0}; i < n; ++i )
+    {
+        ASSERT_TRUE( htable.retrieve( Account::AcctKey( "Client", 1, i % 7, i ), a ) );
+        ASSERT_EQ( i % 2 == 0 ? 2 : 1, a.m_bank_code );
+        ASSERT_EQ( i % 2 == 0 ? float( -i ) : float( i ) + ( i == 1 ? 0.5f : 0.f ), a.m_balance );
+    }
+    ASSERT_GT( htable.stats().writes, 0u );
+    ASSERT_EQ( 0u, htable.count( Account::AcctKey( "Client", 1, 0, n ) ) );
+    ASSERT_THROW( htable.at( Account::AcctKey( "Client", 1, 0, n ) ), std::out_of_range );
+
+    // Blocks of the default size compress: the names repeat, the codes need a few bits.
+    ac::CompressedHashTbl< Account::AcctKey, Account, KeyHash, KeyEqual > dense;
+    for ( int i{0}; i < n; ++i )
+        dense.insert( Account::AcctKey( "Client", 1, i % 7, i ), Account( "Client", 1, i % 7, i, float( i ) ) );
+    dense.flush();
+    ASSERT_LT( dense.compressed_bytes(), dense.size() * sizeof( Account ) / 3 );
+
+    htable.clear();
+    ASSERT_TRUE( htable.empty() );
+    ASSERT_EQ( 0u, htable.block_count() );
+    ASSERT_TRUE( htable.insert( m_accounts[2].getKey(), m_accounts[2] ) );
+    ASSERT_EQ( m_accounts[2].m_name, htable.at( m_accounts[2].getKey() ).m_name );
+}
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);